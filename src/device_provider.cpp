@@ -2,13 +2,15 @@
 #include "device_provider.h"
 
 #include "driverlog.h"
+#include <algorithm>
 #include <cmath>
+#include <cstdio>
+#include <cstring>
 #include "display_edid_finder.h"
+#include "thread_policy.h"
 #include <thread>
 #include <chrono>
-
-// Simple global pointer to current provider (single instance assumption)
-static MyDeviceProvider* g_device_provider_instance = nullptr;
+#include <filesystem>
 
 //-----------------------------------------------------------------------------
 // Purpose: This is called by vrserver after it receives a pointer back from HmdDriverFactory.
@@ -16,56 +18,63 @@ static MyDeviceProvider* g_device_provider_instance = nullptr;
 //-----------------------------------------------------------------------------
 vr::EVRInitError MyDeviceProvider::Init( vr::IVRDriverContext *pDriverContext )
 {
-
-	g_device_provider_instance = this;
 	// We need to initialise our driver context to make calls to the server.
 	// OpenVR provides a macro to do this for us.
 	VR_INIT_SERVER_DRIVER_CONTEXT( pDriverContext );
 	
-	DriverLog("==========================================================");
-	DriverLog("EXPERIMENTAL 3DOF+XZ TRACKING ENABLED");
-	DriverLog("Using accelerometer for X/Z position, Y fixed at 1.5m");
-	DriverLog("WARNING: Horizontal drift expected! Use recenter often.");
-	DriverLog("Double-click brightness button to reset position/velocity");
-	DriverLog("==========================================================");
-	
-	InitRayneo();
+	// Everything tunable comes from the driver_rayneo section; hot values are re-read on settings events
+	settings_.Load();
+	pipeline_config_ = settings_.PipelineConfig();
+	DriverLog("[provider] Position mode: %s (eye height %.2fm); double-click brightness to recenter",
+		PositionModeName(pipeline_config_.position.mode), pipeline_config_.position.standing_height);
+	applied_settings_generation_ = settings_.Generation();
+	applied_settings_fusion_type_ = static_cast<int>(pipeline_config_.fusion_type);
+	display_discovery_timeout_ = std::chrono::milliseconds(settings_.display_discovery_timeout_ms.load());
 
-	// After switching to 3D mode, give Windows a brief window to expose
-	// the new desktop output so the compositor can bind to it reliably.
-	{
-		auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(2);
-		bool ready = false;
-		while (std::chrono::steady_clock::now() < deadline) {
-			try {
-				auto edid = DisplayEdidFinder::FindDisplayByEdid(980, 17);
-				if (edid) {
-					DisplayEdidInfo tmp = *edid;
-					if (DisplayEdidFinder::PopulateDesktopCoordinates(tmp)) {
-						DriverLog("[provider] Desktop output ready at (%d,%d) %dx%d", tmp.desktop_x, tmp.desktop_y, tmp.desktop_width, tmp.desktop_height);
-						ready = true;
-						break;
-					}
-				}
-			} catch(...) {
-				// ignore
-			}
-			std::this_thread::sleep_for(std::chrono::milliseconds(200));
-		}
-		if (!ready) {
-			DriverLog("[provider] Desktop output not ready within grace period; continuing");
-		}
+	pipeline_ = std::make_unique<TrackingPipeline>(pipeline_config_);
+	DriverLog("[provider] IMU fusion filter: %s", pipeline_->FusionFilter().Name());
+
+	if (settings_.record_imu.load()) {
+		StartRecording();
+	}
+
+	// Optional external tracker (startup); polled by the event thread, never blocking it
+	if (settings_.external_pose_enabled.load()) {
+		external_fusion_.SetParams(settings_.ExternalPoseFusionSettings());
+		external_source_.Open(settings_.ExternalPoseSourceSettings());
 	}
-	// Initialize our HMD tracked device.
-	my_hmd_device_ = std::make_unique< MyHMDControllerDeviceDriver >();
+
+	// From here on the IMU and pose threads log; keep IVRDriverLog off their paths
+	DriverLogStartAsync();
+	timer_resolution_.Request(static_cast<uint32_t>(settings_.timer_resolution_ms.load()));
+
+	// USB bring-up (which also enables the IMU) and display discovery both take seconds and don't
+	// depend on each other, so run them side by side and add the HMD straight away with a
+	// provisional display layout. Discovery updates the layout when the 3D mode output appears.
+	hmd_serial_ = ResolveHmdSerial();
+	my_hmd_device_ = std::make_unique< MyHMDControllerDeviceDriver >( tracking_, *this, MyProvisionalDisplayConfiguration() );
+
+	shutting_down_.store(false);
+	display_registry_.Start();
+	rayneo_supervisor_thread_ = std::thread(&MyDeviceProvider::RayneoSupervisorLoop, this);
+	display_discovery_thread_ = std::thread(&MyDeviceProvider::DisplayDiscoveryLoop, this);
 
 	// TrackedDeviceAdded returning true means we have had our device added to SteamVR.
 	if ( !vr::VRServerDriverHost()->TrackedDeviceAdded( my_hmd_device_->MyGetSerialNumber().c_str(), vr::TrackedDeviceClass_HMD, my_hmd_device_.get() ) )
 	{
 		DriverLog( "Failed to create hmd device!" );
+		StopStartupThreads();
+		StopRayneo();
+		external_source_.Close();
+		StopRecording();
+		timer_resolution_.Release();
+		DriverLogStopAsync();
 		return vr::VRInitError_Driver_Unknown;
 	}
 
+	// Further glasses become generic trackers once they report device info (see RunFrame)
+	StartExtraUnits();
+
 	return vr::VRInitError_None;
 }
 
@@ -93,22 +102,36 @@ bool MyDeviceProvider::ShouldBlockStandbyMode()
 //-----------------------------------------------------------------------------
 void MyDeviceProvider::RunFrame()
 {
+	const int64_t frame_start_ns = StatsNowNs();
+
 	// call our devices to run a frame
 	if ( my_hmd_device_ != nullptr )
 	{
 		my_hmd_device_->MyRunFrame();
 	}
 
+	RegisterExtraUnits();
+
+	// Persist newly learned gyro calibration every now and then (never from the IMU thread)
+	SaveCalibration(false);
+
 
 	//Now, process events that were submitted for this frame.
 	vr::VREvent_t vrevent{};
 	while ( vr::VRServerDriverHost()->PollNextEvent( &vrevent, sizeof( vr::VREvent_t ) ) )
 	{
+		if ( vrevent.eventType == vr::VREvent_OtherSectionSettingChanged || vrevent.eventType == vr::VREvent_AnyDriverSettingsChanged ||
+			vrevent.eventType == vr::VREvent_ChaperoneSettingsHaveChanged )
+		{
+			ReloadSettings();
+		}
 		if ( my_hmd_device_ != nullptr )
 		{
 			my_hmd_device_->MyProcessEvent( vrevent );
 		}
 	}
+
+	stats_.run_frame.Record( StatsNowNs() - frame_start_ns );
 }
 
 //-----------------------------------------------------------------------------
@@ -117,6 +140,7 @@ void MyDeviceProvider::RunFrame()
 //-----------------------------------------------------------------------------
 void MyDeviceProvider::EnterStandby()
 {
+	SetPowerReason(kPowerReasonStandby, true);
 }
 
 //-----------------------------------------------------------------------------
@@ -125,6 +149,7 @@ void MyDeviceProvider::EnterStandby()
 //-----------------------------------------------------------------------------
 void MyDeviceProvider::LeaveStandby()
 {
+	SetPowerReason(kPowerReasonStandby, false);
 }
 
 //-----------------------------------------------------------------------------
@@ -134,244 +159,916 @@ void MyDeviceProvider::LeaveStandby()
 //-----------------------------------------------------------------------------
 void MyDeviceProvider::Cleanup()
 {
+	// Discovery may still be about to touch the HMD; stop it before the device goes away
+	StopStartupThreads();
+
 	// Our controller devices will have already deactivated. Let's now destroy them.
+	StopExtraUnits();
 	my_hmd_device_ = nullptr;
 	StopRayneo();
-	g_device_provider_instance = nullptr; // clear global instance
+	external_source_.Close();
+	StopRecording();
+	timer_resolution_.Release();
+	DriverLogStopAsync();
+	SaveCalibration(true);
 }
 
-void MyDeviceProvider::InitRayneo()
+//-----------------------------------------------------------------------------
+// Purpose: One connection attempt: open the USB device, enable the IMU (subject to the power
+// state) and ask for device info. Supervisor thread only. Keeps the context for the next attempt.
+//-----------------------------------------------------------------------------
+bool MyDeviceProvider::ConnectRayneo()
 {
-	// Reinitialize if already present
-	if (rayneo_ctx_) {
-		return;
-	}
-
-	if (Rayneo_Create(&rayneo_ctx_) != RAYNEO_OK || !rayneo_ctx_) {
-		DriverLog("[provider] Rayneo_Create failed");
-		rayneo_ctx_ = nullptr;
-		return;
+	if (!rayneo_ctx_) {
+		if (Rayneo_Create(&rayneo_ctx_) != RAYNEO_OK || !rayneo_ctx_) {
+			DriverLog("[provider] Rayneo_Create failed");
+			rayneo_ctx_ = nullptr;
+			return false;
+		}
 	}
 
-	const uint16_t kVid = 0x1BBB;
-	const uint16_t kPid = 0xAF50;
-	Rayneo_SetTargetVidPid(rayneo_ctx_, kVid, kPid);
+	const uint16_t vid = static_cast<uint16_t>(settings_.usb_vid.load());
+	const uint16_t pid = static_cast<uint16_t>(settings_.usb_pid.load());
+	Rayneo_SetTargetVidPid(rayneo_ctx_, vid, pid);
 
 	RAYNEO_Result startRc = Rayneo_Start(rayneo_ctx_, 0);
 	if (startRc != RAYNEO_OK) {
 		DriverLog("[provider] Rayneo_Start failed: %d (Device not found?)", (int)startRc);
-		Rayneo_Destroy(rayneo_ctx_);
-		rayneo_ctx_ = nullptr;
-		return;
+		return false;
 	}
 	rayneo_started_ = true;
 
-	RAYNEO_Result imuRc = Rayneo_EnableImu(rayneo_ctx_);
-	if (imuRc == RAYNEO_OK) {
-		DriverLog("[provider] RayNeo_EnableImu success");
-	} else {
-		DriverLog("[provider] RayNeo_EnableImu failed: %d", (int)imuRc);
+	// A freshly attached device is awake; a sleep reported before a detach no longer applies
+	SetPowerReason(kPowerReasonGlassesSleep, false);
+
+	{
+		// Standby may have been entered while USB was still coming up; ApplyPowerState() takes it from here
+		std::lock_guard<std::mutex> lock(power_mutex_);
+		RAYNEO_Result imuRc = Rayneo_EnableImu(rayneo_ctx_);
+		if (imuRc == RAYNEO_OK) {
+			DriverLog("[provider] RayNeo_EnableImu success");
+		} else {
+			DriverLog("[provider] RayNeo_EnableImu failed: %d", (int)imuRc);
+		}
+		imu_available_ = true;
+		imu_enabled_ = true;
 	}
+	ApplyPowerState();
 
 	Rayneo_RequestDeviceInfo(rayneo_ctx_);
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Release a detached (or shutting down) device; the context is kept. Supervisor thread only.
+//-----------------------------------------------------------------------------
+void MyDeviceProvider::DisconnectRayneo()
+{
+	{
+		std::lock_guard<std::mutex> lock(power_mutex_);
+		imu_available_ = false;
+		imu_enabled_ = false;
+	}
+	if (rayneo_started_) {
+		Rayneo_Stop(rayneo_ctx_);
+		rayneo_started_ = false;
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Keep the glasses connected. Each session runs the event loop on this thread; after a
+// detach the pose is reported disconnected at once and Rayneo_Start is retried with exponential
+// backoff. The tracking pipeline (orientation, learned bias, recenter anchor) survives the gap,
+// so the view picks up where it left off instead of snapping to a new forward direction.
+//-----------------------------------------------------------------------------
+void MyDeviceProvider::RayneoSupervisorLoop()
+{
+	// This is the IMU event thread; a preempted batch delays every pose behind it
+	const ScopedThreadPolicy thread_policy("rayneo-event", settings_.EventThreadPolicy());
+	int64_t backoff_ms = 0;
+	bool was_connected = false;
+	while (!shutting_down_.load()) {
+		if (ConnectRayneo()) {
+			if (was_connected) {
+				DriverLog("[provider] RayNeo reconnected; resuming tracking with the previous orientation");
+				stats_.reconnects.Add();
+			}
+			// Never waits: the discovery thread checks the mode and confirms the switch
+			RequestDisplay3D();
+			// Fresh device clock, stale rates: let both re-converge; keep fusion state and anchor
+			imu_clock_.Reset();
+			resume_requested_.store(true);
+			PublishLinkState(true, false);
+			was_connected = true;
+			backoff_ms = 0;
+
+			RayneoEventLoop();
+
+			// Wakes the pose thread so the disconnected pose goes out now, not at the idle rate
+			PublishLinkState(false, published_pose_.sleeping);
+			// Cleanup: leave the glasses in the mode we found them in while the USB link is still up
+			if (shutting_down_.load()) RestoreDisplay2D();
+			DisconnectRayneo();
+			if (shutting_down_.load()) break;
+			DriverLog("[provider] RayNeo detached; reconnecting");
+		}
+
+		const int64_t initial_ms = settings_.reconnect_initial_backoff_ms.load();
+		const int64_t max_ms = std::max<int64_t>(settings_.reconnect_max_backoff_ms.load(), initial_ms);
+		backoff_ms = backoff_ms == 0 ? initial_ms : std::min(backoff_ms * 2, max_ms);
+
+		std::unique_lock<std::mutex> lock(startup_mutex_);
+		startup_cv_.wait_for(lock, std::chrono::milliseconds(backoff_ms), [this] { return shutting_down_.load(); });
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Wait for the glasses' 3D mode output (EDID product 980, serial 17 unless configured
+// otherwise) and hand its layout to the HMD, then stay around for the 3D requests of later
+// connects. Runs on its own thread so neither Init nor the event loop waits on the display; the
+// display registry wakes it on hotplug instead of it re-enumerating every EDID on a timer.
+//-----------------------------------------------------------------------------
+void MyDeviceProvider::DisplayDiscoveryLoop()
+{
+	SetCurrentThreadName("rayneo-discover");
+	const auto start = std::chrono::steady_clock::now();
+	const auto deadline = start + display_discovery_timeout_;
+	auto apply = [&](const DisplayEdidInfo &edid, std::chrono::steady_clock::time_point since) {
+		const bool have_coordinates = edid.desktop_width > 0 && edid.desktop_height > 0;
+		const auto elapsed_ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - since).count();
+		DriverLog("[provider] EDID (3D) display detected after %lld ms: instance='%s' name='%s' desktop=%s (%d,%d) %dx%d, preferred %ux%u@%.3f Hz, current %.3f Hz, %zu timings",
+			(long long)elapsed_ms, edid.device_instance_id.c_str(), edid.monitor_name.c_str(),
+			have_coordinates ? "yes" : "no", edid.desktop_x, edid.desktop_y, edid.desktop_width, edid.desktop_height,
+			edid.preferred_width, edid.preferred_height, edid.preferred_refresh_hz, edid.current_refresh_hz, edid.timings.size());
+		{
+			std::lock_guard<std::mutex> lock(display_config_mutex_);
+			display_edid_ = edid;
+		}
+		ApplyDisplayConfiguration();
+		return have_coordinates;
+	};
+
+	// First any sign of the 3D output, so the EDID based layout is used as early as possible...
+	// (the first connect's switch, if the glasses are in 2D, is what brings it up)
+	bool resolved = false;
+	std::optional<DisplayEdidInfo> edid = WaitForDisplayServing3D(MatchDisplay3D(), deadline);
+	if (shutting_down_.load()) return;
+	if (edid) resolved = apply(*edid, start);
+
+	// ...then its desktop origin, which can follow seconds later while the output is brought up
+	if (edid && !resolved) {
+		if (auto placed = WaitForDisplayServing3D(MatchDisplay3D(true), deadline)) {
+			apply(*placed, start);
+			resolved = true;
+		}
+		if (shutting_down_.load()) return;
+	}
+	if (!resolved) {
+		DriverLog("[provider] EDID (product=%u serial=%d) not resolved within %lld ms; keeping %s display layout",
+			(unsigned)settings_.display_edid_product.load(), settings_.display_edid_serial.load(), (long long)display_discovery_timeout_.count(), edid ? "EDID based" : "provisional");
+	}
+
+	// Reconnects: a replugged pair comes back in 2D, and its new output may sit elsewhere on the desktop
+	for (;;) {
+		{
+			std::unique_lock<std::mutex> lock(startup_mutex_);
+			startup_cv_.wait(lock, [this] { return shutting_down_.load() || display_3d_requested_; });
+		}
+		if (shutting_down_.load()) return;
+		const auto switch_start = std::chrono::steady_clock::now();
+		if (!ServeDisplay3DRequest()) continue;
+
+		const auto timeout = std::chrono::milliseconds(settings_.display_mode_switch_timeout_ms.load());
+		if (auto placed = display_registry_.WaitForDisplay(MatchDisplay3D(true), timeout)) {
+			apply(*placed, switch_start);
+		} else if (!shutting_down_.load()) {
+			DriverLog("[provider] Switched to 3D mode, but its output did not appear within %lld ms", (long long)timeout.count());
+		}
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Matches the glasses' 3D mode output by its EDID (display_edid_product / _serial)
+//-----------------------------------------------------------------------------
+DisplayRegistry::Predicate MyDeviceProvider::MatchDisplay3D(bool require_desktop) const
+{
+	const uint16_t product = static_cast<uint16_t>(settings_.display_edid_product.load());
+	const int serial_setting = settings_.display_edid_serial.load();
+	const std::optional<uint32_t> serial = serial_setting >= 0 ? std::optional<uint32_t>(static_cast<uint32_t>(serial_setting)) : std::nullopt;
+	return DisplayRegistry::MatchEdid(product, serial, require_desktop);
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Ask for the glasses to be put in 3D mode over the connection the driver already
+// holds, so no separate prelauncher has to open, switch and close the device before SteamVR
+// starts. Supervisor thread, after every connect; returns at once, the discovery thread does
+// the checking and waiting (ServeDisplay3DRequest) while the event loop keeps polling.
+//-----------------------------------------------------------------------------
+void MyDeviceProvider::RequestDisplay3D()
+{
+	if (!settings_.display_auto_3d.load()) return;
+	{
+		std::lock_guard<std::mutex> lock(startup_mutex_);
+		display_3d_requested_ = true;
+	}
+	startup_cv_.notify_all();
+}
 
+//-----------------------------------------------------------------------------
+// Purpose: Discovery thread: carry out a pending RequestDisplay3D(). Skipped when the 3D output
+// is already attached. The SDK call is made under power_mutex_, like ApplyPowerState()'s, so it
+// never races DisconnectRayneo() releasing the device or RestoreDisplay2D() on shutdown.
+// Returns true if the switch was issued; the caller waits for the output to confirm it.
+//-----------------------------------------------------------------------------
+bool MyDeviceProvider::ServeDisplay3DRequest()
+{
+	{
+		std::lock_guard<std::mutex> lock(startup_mutex_);
+		if (!display_3d_requested_) return false;
+		display_3d_requested_ = false;
+	}
 
-	StartRayneoEventThread();
+	const auto timeout = std::chrono::milliseconds(settings_.display_mode_switch_timeout_ms.load());
+	// The registry enumerates on its own thread; "not listed yet" must not be taken for 2D
+	if (!display_registry_.WaitForEnumeration(timeout)) {
+		if (shutting_down_.load()) return false;
+		DriverLog("[provider] Display list unavailable; switching to 3D without checking the current mode");
+	} else if (display_registry_.Find(MatchDisplay3D())) {
+		DriverLog("[provider] Display already in 3D mode; not switching");
+		return false;
+	}
+
+	RAYNEO_Result rc;
+	{
+		std::lock_guard<std::mutex> lock(power_mutex_);
+		if (!imu_available_ || shutting_down_.load()) return false; // detached (or closing) meanwhile
+		rc = Rayneo_DisplaySet3D(rayneo_ctx_);
+		if (rc == RAYNEO_OK) display_switched_to_3d_ = true;
+	}
+	if (rc != RAYNEO_OK) {
+		DriverLog("[provider] RayNeo_DisplaySet3D failed: %d", (int)rc);
+		return false;
+	}
+	DriverLog("[provider] RayNeo_DisplaySet3D success; waiting for the 3D output");
+
+	// The glasses drop the 2D output and bring up the 3D one; the hotplug notification wakes the waiter
+	display_registry_.RequestRefresh();
+	return true;
 }
 
-void MyDeviceProvider::StartRayneoEventThread()
+//-----------------------------------------------------------------------------
+// Purpose: WaitForDisplay() for the discovery thread's first layout wait, which must not hold up
+// the first connect's 3D request: that switch is usually what brings the awaited output up.
+// Wakes every kDisplayRequestPollInterval to serve it.
+//-----------------------------------------------------------------------------
+std::optional<DisplayEdidInfo> MyDeviceProvider::WaitForDisplayServing3D(const DisplayRegistry::Predicate &match, std::chrono::steady_clock::time_point deadline)
 {
-	if (rayneo_event_thread_running_.load() || !rayneo_ctx_ || !rayneo_started_) return;
-	rayneo_event_thread_running_.store(true);
-	rayneo_event_thread_ = std::thread(&MyDeviceProvider::RayneoEventLoop, this);
+	constexpr std::chrono::milliseconds kDisplayRequestPollInterval(250);
+	for (;;) {
+		ServeDisplay3DRequest();
+		const auto left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now());
+		const bool last = left <= kDisplayRequestPollInterval;
+		if (auto edid = display_registry_.WaitForDisplay(match, std::clamp(left, std::chrono::milliseconds(0), kDisplayRequestPollInterval))) return edid;
+		if (shutting_down_.load() || last) return std::nullopt;
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Undo the 3D switch on shutdown, so the glasses are a regular 2D monitor again once
+// SteamVR exits. Leaves a mode the driver did not set alone. Supervisor thread only, while the
+// device is still held.
+//-----------------------------------------------------------------------------
+void MyDeviceProvider::RestoreDisplay2D()
+{
+	std::lock_guard<std::mutex> lock(power_mutex_);
+	if (!display_switched_to_3d_) return;
+	display_switched_to_3d_ = false;
+	if (!settings_.display_restore_2d.load()) return;
+
+	const RAYNEO_Result rc = Rayneo_DisplaySet2D(rayneo_ctx_);
+	if (rc == RAYNEO_OK) {
+		DriverLog("[provider] RayNeo_DisplaySet2D success");
+	} else {
+		DriverLog("[provider] RayNeo_DisplaySet2D failed: %d", (int)rc);
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Recompute the HMD display layout from everything known so far (discovered EDID, the
+// glasses' reported fps) and push it if it changed. Called from the discovery and event threads.
+//-----------------------------------------------------------------------------
+void MyDeviceProvider::ApplyDisplayConfiguration()
+{
+	std::lock_guard<std::mutex> lock(display_config_mutex_);
+	MyHMDDisplayDriverConfiguration config;
+	if (display_edid_) {
+		const bool have_coordinates = display_edid_->desktop_width > 0 && display_edid_->desktop_height > 0;
+		config = MyDisplayConfigurationFromEdid(*display_edid_, have_coordinates, glasses_fps_);
+	} else {
+		config = MyProvisionalDisplayConfiguration();
+		config.display_frequency = MyResolveDisplayFrequency(nullptr, config.window_width, config.window_height, glasses_fps_);
+	}
+
+	if (!my_hmd_device_ || (applied_display_config_ && memcmp(&*applied_display_config_, &config, sizeof(config)) == 0)) return;
+
+	// glasses_fps is what the panel says it runs at; a mismatch usually means the OS picked another mode
+	if (glasses_fps_ > 0 && std::fabs(config.display_frequency - (float)glasses_fps_) > 1.5f) {
+		DriverLog("[provider] Display frequency %.3f Hz differs from glasses reported %d fps", config.display_frequency, glasses_fps_);
+	}
+	my_hmd_device_->MyUpdateDisplayConfiguration(config);
+	applied_display_config_ = config;
+}
+
+void MyDeviceProvider::StartExtraUnits()
+{
+	const int count = settings_.extra_unit_count.load();
+	for (int i = 1; i <= count; ++i) {
+		extra_units_.push_back(std::make_unique<RayneoUnit>(i, settings_));
+		trackers_.emplace_back();
+		extra_units_.back()->Start();
+	}
+	if (count > 0) DriverLog("[provider] Looking for %d additional RayNeo unit(s) to expose as trackers", count);
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Add a generic tracker for every extra unit that has reported its serial (see
+// AssignTrackerSerial). Main thread (RunFrame) only.
+//-----------------------------------------------------------------------------
+void MyDeviceProvider::RegisterExtraUnits()
+{
+	for (size_t i = 0; i < extra_units_.size(); ++i) {
+		RayneoUnit &unit = *extra_units_[i];
+		if (trackers_[i] || !unit.HasSerial()) continue;
+
+		const std::string serial = AssignTrackerSerial(unit);
+		trackers_[i] = std::make_unique<MyTrackerDeviceDriver>(unit.Tracking(), unit.DeviceIndex(), settings_, serial);
+		if (!vr::VRServerDriverHost()->TrackedDeviceAdded(serial.c_str(), vr::TrackedDeviceClass_GenericTracker, trackers_[i].get())) {
+			DriverLog("[provider] Failed to add tracker %s", serial.c_str());
+		}
+	}
+}
+
+void MyDeviceProvider::StopExtraUnits()
+{
+	// Trackers are already deactivated (their pose threads joined) and share their units' tracking state
+	trackers_.clear();
+	for (auto &unit : extra_units_) unit->Stop();
+	extra_units_.clear();
+}
+
+void MyDeviceProvider::StopStartupThreads()
+{
+	{
+		std::lock_guard<std::mutex> lock(startup_mutex_);
+		shutting_down_.store(true);
+	}
+	startup_cv_.notify_all();
+	// Releases the discovery thread from any WaitForDisplay
+	display_registry_.Stop();
+	if (display_discovery_thread_.joinable()) display_discovery_thread_.join();
+	if (rayneo_supervisor_thread_.joinable()) rayneo_supervisor_thread_.join();
 }
 
 void MyDeviceProvider::RayneoEventLoop()
 {
-	
-	// RAYNEO_Result r3d = Rayneo_DisplaySet3D(rayneo_ctx_);
-	// if (r3d == RAYNEO_OK) {
-	// 	DriverLog("[provider] RayNeo_DisplaySet3D success");
-	// } else {
-	// 	DriverLog("[provider] RayNeo_DisplaySet3D failed: %d", (int)r3d);
-	// }
-	
-	while (rayneo_event_thread_running_.load()) {
+	bool attached = true;
+	while (attached && !shutting_down_.load()) {
 		if (!rayneo_ctx_ || !rayneo_started_) break;
-		RAYNEO_Event evt{};
-		auto rc = Rayneo_PollEvent(rayneo_ctx_, &evt, 500);
-		if (rc == RAYNEO_OK) {
-			if (evt.type == RAYNEO_EVENT_DEVICE_DETACHED) {
-				DriverLog("[provider] RayNeo device detached");
+
+		// Block for the first event, then drain whatever else is already queued without waiting
+		const int64_t poll_start_ns = StatsNowNs();
+		const bool got_event = Rayneo_PollEvent(rayneo_ctx_, &event_batch_[0], 500) == RAYNEO_OK;
+		stats_.poll_wait.Record(StatsNowNs() - poll_start_ns);
+		if (!got_event) continue;
+		size_t count = 1;
+		if (batched_drain_) {
+			while (count < kMaxEventBatch && Rayneo_PollEvent(rayneo_ctx_, &event_batch_[count], 0) == RAYNEO_OK) {
+				++count;
+			}
+		}
+		RecordImuBatchSize(count);
+
+		// IMU samples first, in one pass, publishing a single snapshot for the whole batch
+		const int64_t receive_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+			std::chrono::steady_clock::now().time_since_epoch()).count();
+		size_t imu_count = 0;
+		int64_t last_sample_ns = 0;
+		for (size_t i = 0; i < count; ++i) {
+			const RAYNEO_Event &evt = event_batch_[i];
+			if (evt.type != RAYNEO_EVENT_IMU_SAMPLE) continue;
+			const RAYNEO_ImuSample &s = evt.data.imu;
+			if (!s.valid) {
+				stats_.imu_invalid_samples.Add();
+				continue;
+			}
+			last_sample_ns = imu_clock_.Update(s.tick, receive_ns);
+			stats_.imu_tick_to_receive.Record(receive_ns - last_sample_ns);
+
+			TrackingImuSample &in = imu_batch_[imu_count++];
+			in.tick = s.tick;
+			for (int k = 0; k < 3; ++k) {
+				in.gyro_rad[k] = s.gyroRad[k];
+				in.gyro_dps[k] = s.gyroDps[k];
+				in.acc[k] = s.acc[k];
+			}
+		}
+		if (imu_count > 0) {
+			const int64_t integrate_start_ns = StatsNowNs();
+			IntegrateImuBatch(imu_count, receive_ns);
+			stats_.integrate_sample.Record((StatsNowNs() - integrate_start_ns) / (int64_t)imu_count);
+			stats_.imu_samples.Add(imu_count);
+			PublishPoseSnapshot(imu_batch_[imu_count - 1].tick, last_sample_ns, receive_ns);
+			if (external_source_.IsOpen()) IntegrateExternalPoses(receive_ns);
+		}
+
+		// Then everything else (notify/log/info/attach), in arrival order
+		for (size_t i = 0; i < count; ++i) {
+			const RAYNEO_Event &evt = event_batch_[i];
+			if (evt.type == RAYNEO_EVENT_IMU_SAMPLE) continue;
+			stats_.other_events.Add();
+			if (!DispatchRayneoEvent(evt, receive_ns)) {
+				attached = false;
 				break;
-			} else if (evt.type == RAYNEO_EVENT_DEVICE_ATTACHED) {
-				DriverLog("[provider] RayNeo device attached");
-			} else if (evt.type == RAYNEO_EVENT_IMU_SAMPLE) {
-				// Integrate gyro to update orientation quaternion.
-				// Basic incremental quaternion integration (no drift correction).
-				const auto &s = evt.data.imu;
-				if (s.valid) {
-					std::lock_guard<std::mutex> lock(imu_mutex_);
-					// Compute dt (assuming tick is milliseconds)
-					float dt = 0.0f;
-					if (last_imu_tick_ != 0 && s.tick > last_imu_tick_) {
-						uint32_t dtMs = s.tick - last_imu_tick_;
-						dt = static_cast<float>(dtMs) * 0.001f;
-					}
-					last_imu_tick_ = s.tick;
-
-					// Angular velocity in rad/s (use gyroRad if filled else convert from gyroDps)
-					float wx = s.gyroRad[0];
-					float wy = s.gyroRad[1];
-					float wz = s.gyroRad[2];
-					if (wx == 0.f && wy == 0.f && wz == 0.f) {
-						// fallback convert from dps if rad array not provided
-						const float deg2rad = 3.14159265358979323846f / 180.f;
-						wx = s.gyroDps[0] * deg2rad;
-						wy = s.gyroDps[1] * deg2rad;
-						wz = s.gyroDps[2] * deg2rad;
-					}
-
-					if (dt > 0.f && dt < 0.1f) { // Sanity check on dt
-						// Apply sensitivity scaling for gyro
-						wx *= gyro_scale_;
-						wy *= gyro_scale_;
-						wz *= gyro_scale_;
-
-						// Form delta quaternion from angular velocity vector magnitude
-						float angle = std::sqrt(wx*wx + wy*wy + wz*wz) * dt; // radians
-						// Clamp per-step rotation to avoid runaway sensitivity
-						const float maxStep = 0.35f; // ~20 degrees per integration step
-						if (angle > maxStep) angle = maxStep;
-						if (angle > 0.f) {
-							float axis_x = wx;
-							float axis_y = wy;
-							float axis_z = wz;
-							float invMag = 1.f / std::sqrt(axis_x*axis_x + axis_y*axis_y + axis_z*axis_z);
-							axis_x *= invMag; axis_y *= invMag; axis_z *= invMag;
-							float half = angle * 0.5f;
-							float sinHalf = std::sin(half);
-							float dq_w = std::cos(half);
-							float dq_x = axis_x * sinHalf;
-							float dq_y = axis_y * sinHalf;
-							float dq_z = axis_z * sinHalf;
-							// Multiply current quaternion by delta: q_new = q * dq
-							float nw = imu_q_w_*dq_w - imu_q_x_*dq_x - imu_q_y_*dq_y - imu_q_z_*dq_z;
-							float nx = imu_q_w_*dq_x + imu_q_x_*dq_w + imu_q_y_*dq_z - imu_q_z_*dq_y;
-							float ny = imu_q_w_*dq_y - imu_q_x_*dq_z + imu_q_y_*dq_w + imu_q_z_*dq_x;
-							float nz = imu_q_w_*dq_z + imu_q_x_*dq_y - imu_q_y_*dq_x + imu_q_z_*dq_w;
-							// Normalize
-							float nrm = std::sqrt(nw*nw + nx*nx + ny*ny + nz*nz);
-							if (nrm > 0.f) { nw /= nrm; nx /= nrm; ny /= nrm; nz /= nrm; }
-							imu_q_w_ = nw; imu_q_x_ = nx; imu_q_y_ = ny; imu_q_z_ = nz;
-						}
-
-						// EXPERIMENTAL 6DOF: Integrate accelerometer for position tracking
-						// WARNING: This will drift significantly over time!
-						// NOTE: Y-axis (vertical) disabled to prevent floor-level drift in VRChat
-						if (use_experimental_6dof_) {
-							// Get acceleration in g units, convert to m/s^2
-							float ax = s.acc[0] * 9.81f;
-							float ay = s.acc[1] * 9.81f;
-							float az = s.acc[2] * 9.81f;
-
-							// Rotate acceleration from sensor frame to world frame using current orientation
-							// a_world = q * a_sensor * q^-1
-							float qw = imu_q_w_, qx = imu_q_x_, qy = imu_q_y_, qz = imu_q_z_;
-							float ax_w = ax*(qw*qw + qx*qx - qy*qy - qz*qz) + 2.0f*ay*(qx*qy - qw*qz) + 2.0f*az*(qx*qz + qw*qy);
-							float ay_w = 2.0f*ax*(qx*qy + qw*qz) + ay*(qw*qw - qx*qx + qy*qy - qz*qz) + 2.0f*az*(qy*qz - qw*qx);
-							float az_w = 2.0f*ax*(qx*qz - qw*qy) + 2.0f*ay*(qy*qz + qw*qx) + az*(qw*qw - qx*qx - qy*qy + qz*qz);
-
-							// Remove gravity (assuming Y-up, gravity = -9.81 m/s^2)
-							ay_w += 9.81f;
-
-							// Apply high-pass filter to reduce drift (experimental)
-							const float alpha = 0.8f; // Filter coefficient
-							static float prev_ax = 0, prev_ay = 0, prev_az = 0;
-							ax_w = alpha * (ax_w - prev_ax);
-							ay_w = alpha * (ay_w - prev_ay);
-							az_w = alpha * (az_w - prev_az);
-							prev_ax = ax_w; prev_ay = ay_w; prev_az = az_w;
-
-							// Integrate acceleration to velocity (X and Z only, keep Y fixed)
-							velocity_x_ += ax_w * dt;
-							// velocity_y_ += ay_w * dt; // DISABLED: causes floor-level drift
-							velocity_z_ += az_w * dt;
-
-							// Apply velocity damping to reduce drift
-							const float damping = 0.95f;
-							velocity_x_ *= damping;
-							// velocity_y_ *= damping; // Y velocity always 0
-							velocity_z_ *= damping;
-
-							// Integrate velocity to position (X and Z only)
-							position_x_ += velocity_x_ * dt;
-							// position_y_ += velocity_y_ * dt; // DISABLED: Y stays at 1.5m (standing height)
-							position_z_ += velocity_z_ * dt;
-
-							// Clamp position to reasonable bounds
-							position_x_ = std::max(-5.0f, std::min(5.0f, position_x_));
-							// position_y_ clamping removed - it stays constant at 1.5m
-							position_z_ = std::max(-5.0f, std::min(5.0f, position_z_));
-						}
-					}
-				}
-			} else if (evt.type == RAYNEO_EVENT_DEVICE_INFO) {
-				DriverLog("[provider] RayNeo device info received");
-				DriverLog("  Tick: %u", evt.data.info.tick);
-				DriverLog("  Sensor On: %d", evt.data.info.sensor_on);
-				DriverLog("  Board ID: %d", evt.data.info.board_id);
-				DriverLog("  Date: %s", evt.data.info.date);
-				DriverLog("  Flag: %d", evt.data.info.flag);
-				DriverLog("  Fps: %d", evt.data.info.glasses_fps);
-			} else if (evt.type == RAYNEO_EVENT_NOTIFY) {
-				DriverLog("[provider] RayNeo notify code=0x%X msg=%s", (unsigned)evt.data.notify.code, evt.data.notify.message);
-				if (evt.data.notify.code == RAYNEO_NOTIFY_SLEEP) {
-					sleeping_.store(true);
-					DriverLog("[provider] Sleep state entered");
-				} else if (evt.data.notify.code == RAYNEO_NOTIFY_WAKE) {
-					sleeping_.store(false);
-					DriverLog("[provider] Wake state");
-				} else if (evt.data.notify.code == RAYNEO_NOTIFY_BUTTON) {
-					// Treat as system button (e.g., power/system)
-					// Recenter();
-					button_system_click_pending_.store(true);
-					DriverLog("[provider] System button click");
-				} else if (evt.data.notify.code == RAYNEO_NOTIFY_BUTTON_VOLUME_UP) {
-					// Map to trigger click
-					button_trigger_click_pending_.store(true);
-					DriverLog("[provider] Volume Up -> trigger click");
-				} else if (evt.data.notify.code == RAYNEO_NOTIFY_BUTTON_VOLUME_DOWN) {
-					// Map to grip click
-					button_grip_click_pending_.store(true);
-					DriverLog("[provider] Volume Down -> grip click");
-				} else if (evt.data.notify.code == RAYNEO_NOTIFY_BUTTON_BRIGHTNESS) {
-					// Map to application_menu click
-					button_appmenu_click_pending_.store(true);
-					DriverLog("[provider] Brightness -> application_menu click");
-				} else if (evt.data.notify.code == RAYNEO_NOTIFY_IMU_OFF) {
-					DriverLog("[provider] IMU OFF notify");
-				} else if (evt.data.notify.code == RAYNEO_NOTIFY_IMU_ON) {
-					DriverLog("[provider] IMU ON notify");
-				}
-			} else if (evt.type == RAYNEO_EVENT_LOG) {
-				DriverLog("[provider] RayNeo log(level=%d): %s", (int)evt.data.log.level, evt.data.log.message);
 			}
 		}
 	}
-	rayneo_event_thread_running_.store(false);
 }
 
-MyDeviceProvider* GetMyDeviceProviderInstance() { return g_device_provider_instance; }
+//-----------------------------------------------------------------------------
+// Purpose: Feed the first count samples of imu_batch_ through the tracking pipeline in one
+// batch (bias learning, fusion, rates, position engine). Pending settings, resume,
+// recenter and fusion swaps take effect at batch boundaries. Event thread only.
+//-----------------------------------------------------------------------------
+void MyDeviceProvider::IntegrateImuBatch(size_t count, int64_t receive_ns)
+{
+	ApplyPendingSettings();
+	ApplyPendingResume();
+	ApplyPendingRecenter();
+	ApplyPendingFusionFilter();
+
+	const bool recording = recorder_.IsRecording();
+	const size_t advanced = pipeline_->ProcessBatch(imu_batch_, count, recording ? imu_batch_orientation_ : nullptr);
+
+	if (recording) {
+		// Raw samples plus the fused (un-anchored) orientation each one produced
+		for (size_t i = 0; i < count; ++i) {
+			const TrackingImuSample &s = imu_batch_[i];
+			ImuCaptureRecord rec{};
+			rec.tick = s.tick;
+			rec.flags = kImuCaptureValid | kImuCaptureHasReference;
+			for (int k = 0; k < 3; ++k) {
+				rec.gyro_rad[k] = s.gyro_rad[k];
+				rec.gyro_dps[k] = s.gyro_dps[k];
+				rec.acc[k] = s.acc[k];
+			}
+			const ImuQuat &q = imu_batch_orientation_[i];
+			rec.reference_q[0] = q.w; rec.reference_q[1] = q.x; rec.reference_q[2] = q.y; rec.reference_q[3] = q.z;
+			rec.receive_host_time_ns = receive_ns;
+			recorder_.Push(rec);
+		}
+	}
+	if (advanced == 0) return;
+
+	float bias[3];
+	pipeline_->BiasEstimator().GetBias(bias);
+	for (int i = 0; i < 3; ++i) learned_bias_[i].store(bias[i], std::memory_order_relaxed);
+	learned_bias_seconds_.store(pipeline_->BiasEstimator().LearnedSeconds(), std::memory_order_relaxed);
+	pipeline_->GetFusionGyroBias(bias);
+	for (int i = 0; i < 3; ++i) fusion_bias_[i].store(bias[i], std::memory_order_relaxed);
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Remember the snapshot just published for latency compensation, then fuse whatever the
+// external tracker produced since the last batch. Corrections land in the next snapshot.
+// Event thread only; the source never blocks, so a stalled producer costs one empty poll.
+//-----------------------------------------------------------------------------
+void MyDeviceProvider::IntegrateExternalPoses(int64_t receive_ns)
+{
+	external_fusion_.RecordEstimate(published_pose_);
+
+	const size_t count = external_source_.Poll(external_batch_, external_batch_receive_ns_, kMaxExternalBatch, receive_ns);
+	for (size_t i = 0; i < count; ++i) {
+		ExternalPoseCorrection correction;
+		if (!external_fusion_.Fuse(external_batch_[i], external_batch_receive_ns_[i], correction)) {
+			stats_.external_poses_rejected.Add();
+			continue;
+		}
+		if (correction.has_yaw) pipeline_->ApplyYawCorrection(correction.yaw);
+		if (correction.has_position) pipeline_->ApplyPositionCorrection(correction.position);
+		stats_.external_poses.Add();
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Handle a non-IMU RayNeo event. Returns false once the device has gone away.
+// receive_ns is when the batch was pulled from the SDK; button clicks are stamped with it.
+//-----------------------------------------------------------------------------
+bool MyDeviceProvider::DispatchRayneoEvent(const RAYNEO_Event &evt, int64_t receive_ns)
+{
+	if (evt.type == RAYNEO_EVENT_DEVICE_DETACHED) {
+		DriverLog("[provider] RayNeo device detached");
+		return false;
+	} else if (evt.type == RAYNEO_EVENT_DEVICE_ATTACHED) {
+		DriverLog("[provider] RayNeo device attached");
+	} else if (evt.type == RAYNEO_EVENT_DEVICE_INFO) {
+		DriverLog("[provider] RayNeo device info received");
+		DriverLog("  Tick: %u", evt.data.info.tick);
+		DriverLog("  Sensor On: %d", evt.data.info.sensor_on);
+		DriverLog("  Board ID: %d", evt.data.info.board_id);
+		DriverLog("  Date: %s", evt.data.info.date);
+		DriverLog("  Flag: %d", evt.data.info.flag);
+		DriverLog("  Fps: %d", evt.data.info.glasses_fps);
+		{
+			std::lock_guard<std::mutex> lock(display_config_mutex_);
+			glasses_fps_ = evt.data.info.glasses_fps;
+		}
+		ApplyDisplayConfiguration();
+		RememberHmdSerial((int)evt.data.info.board_id, evt.data.info.date);
+		LoadCalibration((int)evt.data.info.board_id, evt.data.info.date);
+	} else if (evt.type == RAYNEO_EVENT_NOTIFY) {
+		DriverLog("[provider] RayNeo notify code=0x%X msg=%s", (unsigned)evt.data.notify.code, evt.data.notify.message);
+		if (evt.data.notify.code == RAYNEO_NOTIFY_SLEEP) {
+			PublishLinkState(true, true);
+			DriverLog("[provider] Sleep state entered");
+			SetPowerReason(kPowerReasonGlassesSleep, true);
+		} else if (evt.data.notify.code == RAYNEO_NOTIFY_WAKE) {
+			PublishLinkState(true, false);
+			DriverLog("[provider] Wake state");
+			SetPowerReason(kPowerReasonGlassesSleep, false);
+		} else if (evt.data.notify.code == RAYNEO_NOTIFY_BUTTON) {
+			// Treat as system button (e.g., power/system)
+			// Recenter();
+			input_events_.Push(InputButton::System, receive_ns);
+			DriverLog("[provider] System button click");
+		} else if (evt.data.notify.code == RAYNEO_NOTIFY_BUTTON_VOLUME_UP) {
+			// Map to trigger click
+			input_events_.Push(InputButton::Trigger, receive_ns);
+			DriverLog("[provider] Volume Up -> trigger click");
+		} else if (evt.data.notify.code == RAYNEO_NOTIFY_BUTTON_VOLUME_DOWN) {
+			// Map to grip click
+			input_events_.Push(InputButton::Grip, receive_ns);
+			DriverLog("[provider] Volume Down -> grip click");
+		} else if (evt.data.notify.code == RAYNEO_NOTIFY_BUTTON_BRIGHTNESS) {
+			// Map to application_menu click
+			input_events_.Push(InputButton::AppMenu, receive_ns);
+			DriverLog("[provider] Brightness -> application_menu click");
+		} else if (evt.data.notify.code == RAYNEO_NOTIFY_IMU_OFF) {
+			DriverLog("[provider] IMU OFF notify");
+		} else if (evt.data.notify.code == RAYNEO_NOTIFY_IMU_ON) {
+			DriverLog("[provider] IMU ON notify");
+		}
+	} else if (evt.type == RAYNEO_EVENT_LOG) {
+		DriverLog("[provider] RayNeo log(level=%d): %s", (int)evt.data.log.level, evt.data.log.message);
+	}
+	return true;
+}
+
+void MyDeviceProvider::RecordImuBatchSize(size_t count)
+{
+	// Bins: 1, 2, 3-4, 5-8, 9-16, 17-32, 33-64
+	size_t bin = 0;
+	while (bin + 1 < kImuBatchHistogramBins && count > (size_t(1) << bin)) ++bin;
+	imu_batch_histogram_[bin].fetch_add(1, std::memory_order_relaxed);
+}
+
+void MyDeviceProvider::GetImuBatchHistogram(uint64_t out[kImuBatchHistogramBins]) const
+{
+	for (size_t i = 0; i < kImuBatchHistogramBins; ++i) out[i] = imu_batch_histogram_[i].load(std::memory_order_relaxed);
+}
+
+void MyDeviceProvider::ResetImuBatchHistogram()
+{
+	for (auto &bin : imu_batch_histogram_) bin.store(0, std::memory_order_relaxed);
+}
+
+std::string MyDeviceProvider::FormatStats() const
+{
+	uint64_t batches[kImuBatchHistogramBins];
+	GetImuBatchHistogram(batches);
+	return stats_.Format(batches, kImuBatchHistogramBins);
+}
+
+void MyDeviceProvider::ResetStats()
+{
+	stats_.RequestReset();
+	ResetImuBatchHistogram();
+}
+
+bool MyDeviceProvider::StartRecording()
+{
+	ImuRecorderConfig config;
+	const std::string dir = settings_.RecordDirectory();
+	if (!dir.empty()) {
+		config.directory = dir;
+	} else {
+		std::error_code ec;
+		config.directory = (std::filesystem::temp_directory_path(ec) / "rayneo_captures").string();
+	}
+	{
+		std::lock_guard<std::mutex> lock(calibration_mutex_);
+		config.source = calibration_key_.empty() ? "rayneo" : calibration_key_;
+	}
+
+	if (!recorder_.Start(config)) {
+		DriverLog("[provider] IMU recording failed to start: %s", recorder_.Status().error.c_str());
+		return false;
+	}
+	DriverLog("[provider] IMU recording to %s", recorder_.Status().current_file.c_str());
+	return true;
+}
+
+void MyDeviceProvider::StopRecording()
+{
+	if (!recorder_.IsRecording()) return;
+	recorder_.Stop();
+	const ImuRecorderStatus status = recorder_.Status();
+	DriverLog("[provider] IMU recording stopped: %llu records in %u file(s), %llu dropped",
+		(unsigned long long)status.records_written, status.files, (unsigned long long)status.records_dropped);
+}
+
+void MyDeviceProvider::RequestFusionFilter(ImuFusionType type)
+{
+	requested_fusion_type_.store(static_cast<int>(type));
+}
+
+void MyDeviceProvider::GetFusionGyroBias(float out[3]) const
+{
+	for (int i = 0; i < 3; ++i) out[i] = fusion_bias_[i].load(std::memory_order_relaxed);
+}
+
+void MyDeviceProvider::GetLearnedGyroBias(float out[3]) const
+{
+	for (int i = 0; i < 3; ++i) out[i] = learned_bias_[i].load(std::memory_order_relaxed);
+}
+
+static const char *my_calibration_settings_section = "rayneo_calibration";
+
+// Settings keys only allow a conservative character set
+static std::string SanitizeSettingsKey(const std::string &in)
+{
+	std::string out;
+	for (char c : in) {
+		if ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9')) out.push_back(c);
+		else if (!out.empty() && out.back() != '_') out.push_back('_');
+	}
+	return out;
+}
+
+// Serials the driver derived itself, reused on later launches so SteamVR keeps seeing the same devices
+static const char *my_serials_settings_section = "rayneo_serials";
+static const char *my_fallback_hmd_serial = "RayNeo-HMD";
+
+static std::string ReadStoredSerial(const std::string &key)
+{
+	char buf[128] = {};
+	vr::EVRSettingsError err = vr::VRSettingsError_None;
+	vr::VRSettings()->GetString(my_serials_settings_section, key.c_str(), buf, sizeof(buf), &err);
+	return err == vr::VRSettingsError_None ? std::string(buf) : std::string();
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: The HMD is added before the glasses report device info, so its serial is
+// driver_rayneo/serial_number when set, else the one derived on an earlier connect
+// (RememberHmdSerial). Only a launch that has never seen the glasses uses a generic serial.
+//-----------------------------------------------------------------------------
+std::string MyDeviceProvider::ResolveHmdSerial() const
+{
+	std::string serial = settings_.SerialNumber();
+	if (!serial.empty()) return serial;
+	serial = ReadStoredSerial("hmd");
+	if (!serial.empty()) return serial;
+	DriverLog("[provider] No HMD serial stored yet; using %s until the glasses report device info", my_fallback_hmd_serial);
+	return my_fallback_hmd_serial;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Store the serial derived from the glasses' device info (same form as the trackers')
+// for later launches. Event thread.
+//-----------------------------------------------------------------------------
+void MyDeviceProvider::RememberHmdSerial(int board_id, const char *date)
+{
+	if (!settings_.SerialNumber().empty()) return; // configured explicitly
+	char serial[96];
+	snprintf(serial, sizeof(serial), "RayNeo-%d-%.32s", board_id, date ? date : "");
+	if (ReadStoredSerial("hmd") == serial) return;
+	vr::VRSettings()->SetString(my_serials_settings_section, "hmd", serial);
+	DriverLog("[provider] Stored HMD serial %s; SteamVR sees it from the next launch (this session keeps %s)", serial, hmd_serial_.c_str());
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: SteamVR keys devices by serial, so a unit sharing board id and firmware date with the
+// HMD or another tracker gets its unit index appended. Which of an identical pair reports first
+// varies from launch to launch, so the serial each unit index got is stored and reused (the SDK
+// exposes no USB port path to key on). Main thread.
+//-----------------------------------------------------------------------------
+std::string MyDeviceProvider::AssignTrackerSerial(const RayneoUnit &unit) const
+{
+	const auto taken = [this](const std::string &serial) {
+		if (my_hmd_device_ && serial == my_hmd_device_->MyGetSerialNumber()) return true;
+		for (const auto &tracker : trackers_) {
+			if (tracker && tracker->MyGetSerialNumber() == serial) return true;
+		}
+		return false;
+	};
+	const std::string base = unit.Serial();
+	const std::string key = SanitizeSettingsKey("unit" + std::to_string(unit.DeviceIndex()) + "_" + base);
+	std::string serial = ReadStoredSerial(key);
+	if (serial.empty() || taken(serial)) {
+		serial = taken(base) ? base + "-u" + std::to_string(unit.DeviceIndex()) : base;
+		vr::VRSettings()->SetString(my_serials_settings_section, key.c_str(), serial.c_str());
+	}
+	return serial;
+}
+
+void MyDeviceProvider::LoadCalibration(int board_id, const char *date)
+{
+	// The SDK reports no serial or temperature, so board id + firmware date identify the unit
+	char raw_key[96];
+	snprintf(raw_key, sizeof(raw_key), "board%d_%.32s", board_id, date ? date : "");
+	const std::string key = SanitizeSettingsKey(raw_key);
+	{
+		std::lock_guard<std::mutex> lock(calibration_mutex_);
+		if (key == calibration_key_) return; // already loaded (device info is requested again on reconnect)
+		calibration_key_ = key;
+	}
+
+	vr::EVRSettingsError err = vr::VRSettingsError_None;
+	const float learned = vr::VRSettings()->GetFloat(my_calibration_settings_section, (key + "_learned_s").c_str(), &err);
+	if (err != vr::VRSettingsError_None || !(learned > 0.f)) {
+		DriverLog("[provider] No stored gyro calibration for '%s'; learning from scratch", key.c_str());
+		return;
+	}
+	float bias[3];
+	static const char *kAxis[3] = {"_gyro_bias_x", "_gyro_bias_y", "_gyro_bias_z"};
+	for (int i = 0; i < 3; ++i) {
+		bias[i] = vr::VRSettings()->GetFloat(my_calibration_settings_section, (key + kAxis[i]).c_str(), &err);
+		if (err != vr::VRSettingsError_None || !std::isfinite(bias[i])) return;
+	}
+	if (!pipeline_->SeedGyroBias(bias, learned)) {
+		DriverLog("[provider] Ignoring gyro calibration for '%s': bias=(%.5f, %.5f, %.5f) rad/s is beyond any real gyro bias; relearning",
+			key.c_str(), bias[0], bias[1], bias[2]);
+		return;
+	}
+	{
+		std::lock_guard<std::mutex> lock(calibration_mutex_);
+		calibration_saved_seconds_ = learned;
+	}
+	DriverLog("[provider] Loaded gyro calibration for '%s': bias=(%.5f, %.5f, %.5f) rad/s from %.0fs still time",
+		key.c_str(), bias[0], bias[1], bias[2], learned);
+}
+
+void MyDeviceProvider::SaveCalibration(bool force)
+{
+	const auto now = std::chrono::steady_clock::now();
+	if (!force && now - calibration_last_save_ < std::chrono::seconds(30)) return;
+	calibration_last_save_ = now;
+
+	std::string key;
+	float saved_seconds;
+	{
+		std::lock_guard<std::mutex> lock(calibration_mutex_);
+		key = calibration_key_;
+		saved_seconds = calibration_saved_seconds_;
+	}
+	const float learned = learned_bias_seconds_.load(std::memory_order_relaxed);
+	// Only write when there is meaningfully new still time behind the estimate
+	if (key.empty() || learned < saved_seconds + 5.f) return;
+
+	float bias[3];
+	GetLearnedGyroBias(bias);
+	static const char *kAxis[3] = {"_gyro_bias_x", "_gyro_bias_y", "_gyro_bias_z"};
+	for (int i = 0; i < 3; ++i)
+		vr::VRSettings()->SetFloat(my_calibration_settings_section, (key + kAxis[i]).c_str(), bias[i]);
+	vr::VRSettings()->SetFloat(my_calibration_settings_section, (key + "_learned_s").c_str(), learned);
+	{
+		std::lock_guard<std::mutex> lock(calibration_mutex_);
+		calibration_saved_seconds_ = learned;
+	}
+	DriverLog("[provider] Saved gyro calibration for '%s' (%.0fs still time)", key.c_str(), learned);
+}
+
+void MyDeviceProvider::ApplyPendingFusionFilter()
+{
+	const int requested = requested_fusion_type_.exchange(-1);
+	if (requested < 0) return;
+	if (pipeline_->SetFusionFilter(static_cast<ImuFusionType>(requested))) {
+		DriverLog("[provider] IMU fusion filter switched to %s", pipeline_->FusionFilter().Name());
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Record a reason to idle (or its end) and bring the IMU in line. Any thread.
+//-----------------------------------------------------------------------------
+void MyDeviceProvider::SetPowerReason(uint32_t reason, bool set)
+{
+	if (!tracking_->power.SetReason(reason, set)) return;
+	DriverLog("[provider] Power state -> %s (standby=%d glasses_sleep=%d)", tracking_->power.IsIdle() ? "idle" : "active",
+		(tracking_->power.Reasons() & kPowerReasonStandby) ? 1 : 0, (tracking_->power.Reasons() & kPowerReasonGlassesSleep) ? 1 : 0);
+	ApplyPowerState();
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Disable the IMU stream while idle and re-enable it on wake. Fusion state, learned
+// bias and the recenter anchor stay in the pipeline, so resuming costs one USB command.
+//-----------------------------------------------------------------------------
+void MyDeviceProvider::ApplyPowerState()
+{
+	std::lock_guard<std::mutex> lock(power_mutex_);
+	if (!imu_available_) return;
+
+	const bool want_imu = !tracking_->power.IsIdle();
+	if (want_imu == imu_enabled_) return;
+
+	const RAYNEO_Result rc = want_imu ? Rayneo_EnableImu(rayneo_ctx_) : Rayneo_DisableImu(rayneo_ctx_);
+	if (rc != RAYNEO_OK) {
+		DriverLog("[provider] Rayneo_%sImu failed: %d", want_imu ? "Enable" : "Disable", (int)rc);
+		return;
+	}
+	imu_enabled_ = want_imu;
+	if (want_imu) resume_requested_.store(true);
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Clear the motion state left over from before the IMU was idled. Event thread only.
+//-----------------------------------------------------------------------------
+void MyDeviceProvider::ApplyPendingResume()
+{
+	if (!resume_requested_.exchange(false)) return;
+	pipeline_->ResumeAfterIdle();
+	external_fusion_.Reset();
+}
+
+void MyDeviceProvider::ReloadSettings()
+{
+	// vrserver signals a change in any section; reload is cheap and idempotent, so no filtering
+	settings_.Load();
+	if (my_hmd_device_) my_hmd_device_->MyApplySettings();
+}
+
+void MyDeviceProvider::ApplyPendingSettings()
+{
+	const uint64_t generation = settings_.Generation();
+	if (generation == applied_settings_generation_) return;
+	applied_settings_generation_ = generation;
+
+	TrackingPipelineConfig config = settings_.PipelineConfig();
+	// A fusion engine picked through RequestFusionFilter() survives reloads that leave fusion_filter alone
+	const int settings_fusion = static_cast<int>(config.fusion_type);
+	if (settings_fusion == applied_settings_fusion_type_) {
+		config.fusion_type = pipeline_->FusionFilter().Type();
+	}
+	applied_settings_fusion_type_ = settings_fusion;
+	pipeline_->SetConfig(config);
+	external_fusion_.SetParams(settings_.ExternalPoseFusionSettings());
+	DriverLog("[provider] Settings reloaded: fusion=%s gyro_scale=%.3f position=%s", pipeline_->FusionFilter().Name(),
+		config.gyro_scale, PositionModeName(config.position.mode));
+}
+
+void MyDeviceProvider::ApplyPendingRecenter()
+{
+	if (!recenter_requested_.exchange(false)) return;
+	pipeline_->Recenter();
+	external_fusion_.Reset();
+}
+
+void MyDeviceProvider::PublishPoseSnapshot(uint32_t sample_tick, int64_t sample_host_time_ns, int64_t receive_host_time_ns)
+{
+	// Built in place: the pipeline fills the pose, the link flags carry over from PublishLinkState()
+	pipeline_->BuildSnapshot(published_pose_);
+	published_pose_.sample_tick = sample_tick;
+	published_pose_.sample_host_time_ns = sample_host_time_ns;
+	published_pose_.receive_host_time_ns = receive_host_time_ns;
+	tracking_->Publish(published_pose_);
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Republish the last pose with new link flags, so the HMD's single snapshot read covers
+// connection and sleep too. Supervisor thread only (the pose's sole writer).
+//-----------------------------------------------------------------------------
+void MyDeviceProvider::PublishLinkState(bool connected, bool sleeping)
+{
+	published_pose_.connected = connected;
+	published_pose_.sleeping = sleeping;
+	tracking_->Publish(published_pose_);
+}
 
 void MyDeviceProvider::StopRayneo()
 {
-	Rayneo_DisableImu(rayneo_ctx_);
-	// Rayneo_DisplaySet2D(rayneo_ctx_);
+	// The supervisor (StopStartupThreads) has already left the event loop and released the device
+	{
+		std::lock_guard<std::mutex> lock(power_mutex_);
+		if (imu_available_) Rayneo_DisableImu(rayneo_ctx_);
+		imu_available_ = false;
+		imu_enabled_ = false;
+	}
+	// Back to 2D already happened on the supervisor thread (RestoreDisplay2D), before the device was released
 
-	rayneo_event_thread_running_.store(false);
-	if (rayneo_event_thread_.joinable()) {
-		rayneo_event_thread_.join();
+	{
+		uint64_t h[kImuBatchHistogramBins];
+		GetImuBatchHistogram(h);
+		DriverLog("[provider] Event batch sizes: 1:%llu 2:%llu 3-4:%llu 5-8:%llu 9-16:%llu 17-32:%llu 33-64:%llu",
+			(unsigned long long)h[0], (unsigned long long)h[1], (unsigned long long)h[2], (unsigned long long)h[3],
+			(unsigned long long)h[4], (unsigned long long)h[5], (unsigned long long)h[6]);
 	}
 	if (rayneo_ctx_) {
 		if (rayneo_started_) {
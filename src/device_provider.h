@@ -7,7 +7,27 @@
 #include "openvr_driver.h"
 #include "rayneo_api.h"
 #include "driverlog.h"
+#include "pose_snapshot.h"
+#include "imu_clock.h"
+#include "tracking_pipeline.h"
+#include "imu_recorder.h"
+#include "driver_stats.h"
+#include "display_registry.h"
+#include "external_pose_fusion.h"
+#include "external_pose_source.h"
+#include "driver_settings.h"
+#include "input_event_processor.h"
+#include "power_state.h"
+#include "tracking_state.h"
+#include "rayneo_unit.h"
+#include "tracker_device_driver.h"
+#include <atomic>
+#include <condition_variable>
 #include <mutex>
+#include <vector>
+#include <optional>
+#include <string>
+#include <thread>
 
 // Forward declaration for HMD driver to avoid circular include complexities
 class MyHMDControllerDeviceDriver; // already included but keep forward for clarity
@@ -17,9 +37,10 @@ class MyDeviceProvider : public vr::IServerTrackedDeviceProvider
 {
 public:
 	MyDeviceProvider() {
-		// Initialize RayNeo context before creating devices (if we need early info).
-		// InitRayneo();
 	};
+	// Event-thread batch size histogram bins: 1, 2, 3-4, 5-8, 9-16, 17-32, 33-64
+	static constexpr size_t kImuBatchHistogramBins = 7;
+
 	vr::EVRInitError Init( vr::IVRDriverContext *pDriverContext ) override;
 	const char *const *GetInterfaceVersions() override;
 
@@ -33,106 +54,175 @@ public:
 
 private:
 	std::unique_ptr<MyHMDControllerDeviceDriver> my_hmd_device_;
+	std::string hmd_serial_; // resolved in Init before the HMD is added, then fixed
 
-	// RayNeo context moved from device driver to provider
+	// RayNeo context moved from device driver to provider. The supervisor thread owns it: it
+	// connects, runs the event loop (it *is* the IMU/event thread) and reconnects with backoff
+	// after a detach, until shutdown.
 	RAYNEO_Context rayneo_ctx_ = nullptr;
 	bool rayneo_started_ = false;
-	std::thread rayneo_event_thread_;
-	std::atomic<bool> rayneo_event_thread_running_{false};
-
-	// IMU orientation state (quaternion, world space) updated from RayNeo IMU samples
-	std::mutex imu_mutex_;
-	float imu_q_w_ = 1.0f;
-	float imu_q_x_ = 0.0f;
-	float imu_q_y_ = 0.0f;
-	float imu_q_z_ = 0.0f;
-	uint32_t last_imu_tick_ = 0; // last sample tick for dt computation (assumed ms units)
-
-	// EXPERIMENTAL 6DOF: Position tracking via accelerometer double integration
-	// WARNING: High drift, resets on recenter. Not suitable for production.
-	float velocity_x_ = 0.0f;
-	float velocity_y_ = 0.0f;
-	float velocity_z_ = 0.0f;
-	float position_x_ = 0.0f;
-	float position_y_ = 1.5f; // Start at standing height
-	float position_z_ = 0.0f;
-	bool use_experimental_6dof_ = false; // Enable/disable accelerometer position tracking
-
-	// Sensitivity scaling for gyro integration (runtime tunable via env var)
-	float gyro_scale_ = 0.2f; // default reduces sensitivity to ~20%
-
-	// Sleep state (set on RAYNEO_NOTIFY_SLEEP/WAKE) and recenter anchor
-	std::atomic<bool> sleeping_{false};
-	float recenter_q_w_ = 1.f;
-	float recenter_q_x_ = 0.f;
-	float recenter_q_y_ = 0.f;
-	float recenter_q_z_ = 0.f;
-	// Distinct button flags derived from RayNeo notifications
-	std::atomic<bool> button_system_click_pending_{false};
-	std::atomic<bool> button_trigger_click_pending_{false};
-	std::atomic<bool> button_grip_click_pending_{false};
-	std::atomic<bool> button_appmenu_click_pending_{false};
+	bool display_switched_to_3d_ = false; // guarded by power_mutex_: we put the glasses in 3D; back to 2D on shutdown
+
+	// Secondary glasses (extra_unit_count, USB index 1..N), each on its own context and thread.
+	// trackers_[i] stays null until extra_units_[i] reports device info; main thread only.
+	std::vector<std::unique_ptr<RayneoUnit>> extra_units_;
+	std::vector<std::unique_ptr<MyTrackerDeviceDriver>> trackers_;
+
+	// Startup runs USB bring-up and display discovery in parallel with Init returning
+	std::thread rayneo_supervisor_thread_;
+	std::thread display_discovery_thread_;
+	std::atomic<bool> shutting_down_{false};
+	std::mutex startup_mutex_;
+	std::condition_variable startup_cv_;
+	std::chrono::milliseconds display_discovery_timeout_{15000};
+	bool display_3d_requested_ = false; // guarded by startup_mutex_: a connect asked the discovery thread for 3D
+	DisplayRegistry display_registry_;
+
+	// Display layout inputs, arriving from the discovery and RayNeo event threads
+	std::mutex display_config_mutex_;
+	std::optional<DisplayEdidInfo> display_edid_;
+	int glasses_fps_ = 0;
+	std::optional<MyHMDDisplayDriverConfiguration> applied_display_config_;
+
+	// Batched drain: one blocking poll, then every queued event with zero timeout
+	static constexpr size_t kMaxEventBatch = 64;
+	RAYNEO_Event event_batch_[kMaxEventBatch] = {};
+	bool batched_drain_ = true;
+	// The batch's valid IMU samples, integrated in one TrackingPipeline::ProcessBatch call
+	TrackingImuSample imu_batch_[kMaxEventBatch];
+	ImuQuat imu_batch_orientation_[kMaxEventBatch];
+
+	// driver_rayneo section, cached (loaded in Init, reloaded from RunFrame on settings events)
+	DriverSettings settings_;
+	uint64_t applied_settings_generation_ = 0; // event thread only
+	int applied_settings_fusion_type_ = -1;    // event thread only
+
+	// Bias learning, fusion, prediction rates and position (created in Init, event thread only)
+	TrackingPipelineConfig pipeline_config_;
+	std::unique_ptr<TrackingPipeline> pipeline_;
+	std::atomic<int> requested_fusion_type_{-1};
+
+	// Mirrors of the pipeline's bias estimates for other threads (persistence, diagnostics)
+	std::atomic<float> fusion_bias_[3] = {0.f, 0.f, 0.f};
+	std::atomic<float> learned_bias_[3] = {0.f, 0.f, 0.f};
+	std::atomic<float> learned_bias_seconds_{0.f};
+
+	// Persisted calibration cache, keyed by the device identity from RAYNEO_EVENT_DEVICE_INFO
+	std::mutex calibration_mutex_;
+	std::string calibration_key_;
+	float calibration_saved_seconds_ = 0.f;
+	std::chrono::steady_clock::time_point calibration_last_save_{};
+	ImuClockSync imu_clock_;
+
+	// External tracker input (settings external_pose_*): opened in Init, event thread afterwards
+	ExternalPoseSource external_source_;
+	ExternalPoseFusion external_fusion_;
+	static constexpr size_t kMaxExternalBatch = 16;
+	ExternalPoseRecord external_batch_[kMaxExternalBatch];
+	int64_t external_batch_receive_ns_[kMaxExternalBatch] = {};
+
+	// Pending recenter. The anchor lives in the pipeline; Recenter() just raises recenter_requested_.
+	std::atomic<bool> recenter_requested_{false};
+
+	// Standby and glasses sleep idle the IMU (tracking_->power); power_mutex_ serialises the
+	// enable/disable calls (vrserver main thread, event thread). resume_requested_ is consumed by the event thread.
+	std::mutex power_mutex_;
+	bool imu_available_ = false; // guarded by power_mutex_: context started, IMU under our control
+	bool imu_enabled_ = false;   // guarded by power_mutex_
+	std::atomic<bool> resume_requested_{false};
+	// Button clicks from RayNeo notifications, stamped on receipt (event thread in, RunFrame out)
+	InputEventProcessor input_events_;
+
+	std::atomic<uint64_t> imu_batch_histogram_[kImuBatchHistogramBins] = {};
+
+	// Opt-in raw IMU + fused orientation capture (settings "record_imu" or DebugRequest "record")
+	ImuRecorder recorder_;
+
+	// Hot-path instrumentation, served through the HMD's DebugRequest("stats")
+	DriverStats stats_;
+
+	// Raised (Windows) from Init to Cleanup so pose pacing and event waits aren't rounded to 15.6 ms
+	TimerResolution timer_resolution_;
+
+	// Latest fused pose plus link state, shared with the HMD. Published once per IMU batch and on
+	// every connect/detach/sleep/wake by the supervisor (= event) thread, the only writer.
+	std::shared_ptr<TrackingState> tracking_ = std::make_shared<TrackingState>();
+	PoseSnapshot published_pose_; // supervisor thread only: what was last published, link flags included
 
 public:
-	// Apply current orientation relative to recenter anchor
-	void GetImuOrientation(float &w, float &x, float &y, float &z)
-	{
-		std::lock_guard<std::mutex> lock(imu_mutex_);
-		// Compute relative quaternion q_rel = q_anchor^{-1} * q_current
-		float aw = recenter_q_w_, ax = recenter_q_x_, ay = recenter_q_y_, az = recenter_q_z_;
-		// Inverse of unit quaternion is conjugate
-		float iw = aw; float ix = -ax; float iy = -ay; float iz = -az;
-		// Multiply: iw,ix,iy,iz * imu_q_w_,imu_q_x_,imu_q_y_,imu_q_z_
-		w = iw*imu_q_w_ - ix*imu_q_x_ - iy*imu_q_y_ - iz*imu_q_z_;
-		x = iw*imu_q_x_ + ix*imu_q_w_ + iy*imu_q_z_ - iz*imu_q_y_;
-		y = iw*imu_q_y_ - ix*imu_q_z_ + iy*imu_q_w_ + iz*imu_q_x_;
-		z = iw*imu_q_z_ + ix*imu_q_y_ - iy*imu_q_x_ + iz*imu_q_w_;
-	}
-
-	// Get experimental 6DOF position (WARNING: high drift)
-	void GetPosition(double &x, double &y, double &z)
-	{
-		std::lock_guard<std::mutex> lock(imu_mutex_);
-		if (use_experimental_6dof_) {
-			x = static_cast<double>(position_x_);
-			y = static_cast<double>(position_y_);
-			z = static_cast<double>(position_z_);
-		} else {
-			x = 0.0;
-			y = 3;
-			z = 0.0;
-		}
-	}
-
-	bool IsSleeping() const { return sleeping_.load(); }
-	bool ConsumeButtonNotifyPending() { return button_system_click_pending_.exchange(false); }
-	bool ConsumeTriggerClickPending() { return button_trigger_click_pending_.exchange(false); }
-	bool ConsumeGripClickPending() { return button_grip_click_pending_.exchange(false); }
-	bool ConsumeAppMenuClickPending() { return button_appmenu_click_pending_.exchange(false); }
-
-	// Recenter: store current orientation as anchor and reset position
+	// How many events each wakeup of the event thread drained
+	void GetImuBatchHistogram(uint64_t out[kImuBatchHistogramBins]) const;
+	void ResetImuBatchHistogram();
+
+	// Cached driver settings; fields are atomics, safe to read from any thread
+	const DriverSettings &Settings() const { return settings_; }
+	// driver_rayneo/serial_number, else the serial derived from the glasses on an earlier connect
+	const std::string &HmdSerialNumber() const { return hmd_serial_; }
+
+	// Instrumentation: the pose thread records into Stats(); any thread may format or reset
+	DriverStats &Stats() { return stats_; }
+	std::string FormatStats() const;
+	void ResetStats();
+
+	// IMU session recording into rotating capture files (see imu_capture.h)
+	bool StartRecording();
+	void StopRecording();
+	ImuRecorderStatus RecordingStatus() const { return recorder_.Status(); }
+
+	// Select a fusion engine at runtime; takes effect on the event thread before the next sample.
+	void RequestFusionFilter(ImuFusionType type);
+	// Latest gyro bias estimate from the fusion engine (rad/s, body frame)
+	void GetFusionGyroBias(float out[3]) const;
+	// Bias learned while the head was still (raw rad/s, body frame); persisted per device
+	void GetLearnedGyroBias(float out[3]) const;
+
+	void SetStandby(bool standby) { SetPowerReason(kPowerReasonStandby, standby); }
+	// Consumed by the HMD's RunFrame, the only caller of Process()
+	InputEventProcessor &InputEvents() { return input_events_; }
+
+	// Recenter: store current orientation as anchor and reset position.
+	// Applied by the event thread before it integrates the next IMU sample.
 	void Recenter()
 	{
-		std::lock_guard<std::mutex> lock(imu_mutex_);
-		recenter_q_w_ = imu_q_w_;
-		recenter_q_x_ = imu_q_x_;
-		recenter_q_y_ = imu_q_y_;
-		recenter_q_z_ = imu_q_z_;
-		// Reset horizontal position and velocity (Y stays at 1.5m standing height)
-		velocity_x_ = velocity_z_ = 0.0f;
-		position_x_ = 0.0f;
-		// position_y_ = 1.5f; // No need to reset - it's constant (never integrated)
-		position_z_ = 0.0f;
-		DriverLog("[provider] Recenter: orientation and XZ position reset (Y fixed at %.1fm)", position_y_);
+		recenter_requested_.store(true);
+		for (auto &unit : extra_units_) unit->Recenter();
+		DriverLog("[provider] Recenter requested: orientation and position offset reset (eye height %.2fm)", settings_.standing_height.load());
 	}
 
-
-	void InitRayneo();
 private:
+	bool ConnectRayneo();
+	void DisconnectRayneo();
+	void RayneoSupervisorLoop();
+	// Returns once the device detaches or the driver shuts down
 	void RayneoEventLoop();
-	void StartRayneoEventThread();
+	void IntegrateImuBatch(size_t count, int64_t receive_ns);
+	void IntegrateExternalPoses(int64_t receive_ns);
+	bool DispatchRayneoEvent(const RAYNEO_Event &evt, int64_t receive_ns);
+	void RecordImuBatchSize(size_t count);
+	void DisplayDiscoveryLoop();
+	DisplayRegistry::Predicate MatchDisplay3D(bool require_desktop = false) const;
+	void RequestDisplay3D();
+	bool ServeDisplay3DRequest();
+	std::optional<DisplayEdidInfo> WaitForDisplayServing3D(const DisplayRegistry::Predicate &match, std::chrono::steady_clock::time_point deadline);
+	void RestoreDisplay2D();
+	void StopStartupThreads();
+	void StartExtraUnits();
+	void RegisterExtraUnits();
+	void StopExtraUnits();
+	void ApplyDisplayConfiguration();
 	void StopRayneo();
+	void ApplyPendingRecenter();
+	void ApplyPendingFusionFilter();
+	void SetPowerReason(uint32_t reason, bool set);
+	void ApplyPowerState();
+	void ApplyPendingResume();
+	void ReloadSettings();
+	void ApplyPendingSettings();
+	std::string ResolveHmdSerial() const;
+	void RememberHmdSerial(int board_id, const char *date);
+	std::string AssignTrackerSerial(const RayneoUnit &unit) const;
+	void LoadCalibration(int board_id, const char *date);
+	void SaveCalibration(bool force);
+	void PublishPoseSnapshot(uint32_t sample_tick, int64_t sample_host_time_ns, int64_t receive_host_time_ns);
+	void PublishLinkState(bool connected, bool sleeping);
 };
-
-// Helper accessor (defined in device_provider.cpp) for other components (e.g., HMD driver)
-MyDeviceProvider* GetMyDeviceProviderInstance();
\ No newline at end of file
@@ -8,12 +8,30 @@
 #endif
 
 #if defined(__unix__) && !defined(__APPLE__)
-// X11 + RandR for monitor geometry (best effort). Linking expectations: X11 and Xrandr libraries available.
+// sysfs DRM connectors are the primary source (no display server needed, so this works headless
+// and under Wayland). X11 + RandR supplies desktop geometry when an X server is reachable.
+// Linking expectations: X11 and Xrandr libraries available.
 #include <X11/Xlib.h>
 #include <X11/extensions/Xrandr.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <map>
+// KMS geometry needs only the kernel uapi header, not libdrm
+#if __has_include(<drm/drm.h>)
+#include <drm/drm.h>
+#define RAYNEO_HAVE_KMS 1
+#endif
 #endif
 
 #include "display_edid_finder.h"
+#include "edid_parser.h"
 #include <array>
 #include <cstring>
 #include <sstream>
@@ -22,59 +40,6 @@
 
 namespace {
 
-// Common EDID parsing utilities (used on all platforms that retrieve EDID bytes)
-uint16_t DecodeManufacturerId(uint16_t raw) {
-    uint16_t be = (raw >> 8) | ((raw & 0xFF) << 8);
-    char c1 = ((be >> 10) & 0x1F) + 64; (void)c1;
-    char c2 = ((be >> 5) & 0x1F) + 64; (void)c2;
-    char c3 = (be & 0x1F) + 64; (void)c3;
-    return be;
-}
-
-std::string ExtractMonitorName(const uint8_t* edid, size_t len) {
-    if (len < 128) return {};
-    for (size_t i = 54; i + 18 <= 126; i += 18) {
-        const uint8_t* block = edid + i;
-        if (block[0] == 0x00 && block[1] == 0x00 && block[2] == 0x00 && block[3] == 0xFC) {
-            char name[14] = {0};
-            size_t copyLen = 13;
-            for (size_t j = 5, k = 0; j < 18 && k < copyLen; ++j) {
-                char c = static_cast<char>(block[j]);
-                if (c == '\n' || c == '\r') break;
-                name[k++] = c;
-            }
-            std::string s(name);
-            while (!s.empty() && s.back() == ' ') s.pop_back();
-            return s;
-        }
-    }
-    return {};
-}
-
-DisplayEdidInfo ParseEdid(const std::string& instanceId, const std::vector<uint8_t>& edid) {
-    DisplayEdidInfo info; info.device_instance_id = instanceId;
-    if (edid.size() >= 128) {
-        info.manufacturer_id = DecodeManufacturerId(static_cast<uint16_t>((edid[8] << 8) | edid[9]));
-        info.product_code = static_cast<uint16_t>(edid[10] | (edid[11] << 8));
-        info.serial_number = (edid[12]) | (edid[13] << 8) | (edid[14] << 16) | (edid[15] << 24);
-        info.week_of_manufacture = edid[16];
-        info.year_of_manufacture = 1990 + edid[17];
-        info.monitor_name = ExtractMonitorName(edid.data(), edid.size());
-
-        if (edid.size() >= 72) {
-            const uint8_t* dt = &edid[54];
-            bool is_detailed_timing = !(dt[0] == 0x00 && dt[1] == 0x00);
-            if (is_detailed_timing) {
-                uint16_t h_active = static_cast<uint16_t>(dt[2] | ((dt[4] & 0xF0) << 4));
-                uint16_t v_active = static_cast<uint16_t>(dt[5] | ((dt[7] & 0xF0) << 4));
-                info.preferred_width = h_active;
-                info.preferred_height = v_active;
-            }
-        }
-    }
-    return info;
-}
-
 #ifdef _WIN32
 
 bool ReadRegistryBinary(HKEY hKey, const char* valueName, std::vector<uint8_t>& out) {
@@ -108,13 +73,139 @@ std::vector<DisplayEdidInfo> EnumerateEdidsWindows() {
 
 #endif // _WIN32
 
-} // namespace
+#if defined(__unix__) && !defined(__APPLE__)
 
-std::vector<DisplayEdidInfo> DisplayEdidFinder::EnumerateAll() {
-#ifdef _WIN32
-    return EnumerateEdidsWindows();
-#elif defined(__unix__) && !defined(__APPLE__)
+bool HasEdidHeader(const std::vector<uint8_t>& edid) {
+    static const uint8_t kHeader[8] = {0x00, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0x00};
+    return edid.size() >= 128 && memcmp(edid.data(), kHeader, sizeof(kHeader)) == 0;
+}
+
+bool ReadFileBytes(const std::string& path, std::vector<uint8_t>& out) {
+    std::ifstream f(path, std::ios::binary);
+    if (!f) return false;
+    out.assign(std::istreambuf_iterator<char>(f), std::istreambuf_iterator<char>());
+    return true;
+}
+
+std::string ReadFileLine(const std::string& path) {
+    std::ifstream f(path);
+    std::string line;
+    if (f) std::getline(f, line);
+    return line;
+}
+
+struct DrmConnectorEntry {
+    DisplayEdidInfo info;
+    std::string card;      // e.g. card0
+    std::string connector; // e.g. HDMI-A-1
+};
+
+// Connected connectors with a valid EDID, from /sys/class/drm/card*-*
+std::vector<DrmConnectorEntry> EnumerateDrmConnectors() {
+    std::vector<DrmConnectorEntry> result;
+    DIR* dir = opendir("/sys/class/drm");
+    if (!dir) return result;
+    while (dirent* e = readdir(dir)) {
+        // Connector entries are cardN-<connector>; plain cardN / renderDN are the devices themselves
+        const std::string name = e->d_name;
+        if (name.compare(0, 4, "card") != 0) continue;
+        const size_t dash = name.find('-');
+        if (dash == std::string::npos) continue;
+
+        const std::string base = "/sys/class/drm/" + name;
+        if (ReadFileLine(base + "/status") != "connected") continue;
+        // The attribute returns the base block and every extension block in a single read
+        std::vector<uint8_t> edid;
+        if (!ReadFileBytes(base + "/edid", edid) || !HasEdidHeader(edid)) continue;
+
+        DrmConnectorEntry entry;
+        entry.card = name.substr(0, dash);
+        entry.connector = name.substr(dash + 1);
+        entry.info = ParseEdid("DRM:" + name, edid);
+        result.push_back(std::move(entry));
+    }
+    closedir(dir);
+    std::sort(result.begin(), result.end(), [](const DrmConnectorEntry& a, const DrmConnectorEntry& b) {
+        return a.info.device_instance_id < b.info.device_instance_id;
+    });
+    return result;
+}
+
+#ifdef RAYNEO_HAVE_KMS
+// Same names the kernel uses for the sysfs connector directories (drm_connector_enum_list)
+const char* DrmConnectorTypeName(uint32_t type) {
+    static const char* const kNames[] = {
+        "Unknown", "VGA", "DVI-I", "DVI-D", "DVI-A", "Composite", "SVIDEO", "LVDS", "Component", "DIN",
+        "DP", "HDMI-A", "HDMI-B", "TV", "eDP", "Virtual", "DSI", "DPI", "Writeback", "SPI", "USB"};
+    return type < sizeof(kNames) / sizeof(kNames[0]) ? kNames[type] : "Unknown";
+}
+
+int DrmIoctl(int fd, unsigned long request, void* arg) {
+    int r;
+    do { r = ioctl(fd, request, arg); } while (r == -1 && (errno == EINTR || errno == EAGAIN));
+    return r;
+}
+
+struct KmsGeometry { int x = 0, y = 0, width = 0, height = 0; double refresh_hz = 0.0; };
+
+// Scanout rectangle of every lit connector on one card, keyed by connector name.
+// Under X the CRTC offset is the desktop position; Wayland compositors scan each output out of its
+// own buffer, so there it is 0,0 and only the size is meaningful.
+std::map<std::string, KmsGeometry> ReadKmsGeometry(const std::string& card) {
+    std::map<std::string, KmsGeometry> out;
+    const std::string path = "/dev/dri/" + card;
+    int fd = open(path.c_str(), O_RDWR | O_CLOEXEC);
+    if (fd < 0) fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return out;
+
+    drm_mode_card_res res{};
+    if (DrmIoctl(fd, DRM_IOCTL_MODE_GETRESOURCES, &res) == 0 && res.count_connectors > 0) {
+        std::vector<uint32_t> connectors(res.count_connectors);
+        drm_mode_card_res ids{};
+        ids.count_connectors = res.count_connectors;
+        ids.connector_id_ptr = reinterpret_cast<uintptr_t>(connectors.data());
+        if (DrmIoctl(fd, DRM_IOCTL_MODE_GETRESOURCES, &ids) == 0) {
+            connectors.resize(std::min(ids.count_connectors, res.count_connectors));
+            for (uint32_t id : connectors) {
+                drm_mode_get_connector conn{};
+                drm_mode_modeinfo mode{};
+                conn.connector_id = id;
+                // Offering a mode slot keeps this a cached query; count_modes == 0 forces a reprobe
+                conn.count_modes = 1;
+                conn.modes_ptr = reinterpret_cast<uintptr_t>(&mode);
+                if (DrmIoctl(fd, DRM_IOCTL_MODE_GETCONNECTOR, &conn) != 0 || !conn.encoder_id) continue;
+
+                drm_mode_get_encoder enc{};
+                enc.encoder_id = conn.encoder_id;
+                if (DrmIoctl(fd, DRM_IOCTL_MODE_GETENCODER, &enc) != 0 || !enc.crtc_id) continue;
+
+                drm_mode_crtc crtc{};
+                crtc.crtc_id = enc.crtc_id;
+                if (DrmIoctl(fd, DRM_IOCTL_MODE_GETCRTC, &crtc) != 0 || !crtc.mode_valid) continue;
+
+                KmsGeometry g;
+                g.x = static_cast<int>(crtc.x);
+                g.y = static_cast<int>(crtc.y);
+                g.width = crtc.mode.hdisplay;
+                g.height = crtc.mode.vdisplay;
+                if (crtc.mode.htotal && crtc.mode.vtotal) {
+                    g.refresh_hz = crtc.mode.clock * 1000.0 / (double(crtc.mode.htotal) * crtc.mode.vtotal);
+                }
+                out[std::string(DrmConnectorTypeName(conn.connector_type)) + "-" + std::to_string(conn.connector_type_id)] = g;
+            }
+        }
+    }
+    close(fd);
+    return out;
+}
+#endif // RAYNEO_HAVE_KMS
+
+// Connected RandR outputs with their EDID and CRTC geometry
+std::vector<DisplayEdidInfo> EnumerateEdidsX11() {
     std::vector<DisplayEdidInfo> result;
+    // Without DISPLAY there is nothing to connect to; skip the attempt on headless / pure Wayland boxes
+    const char* display_env = std::getenv("DISPLAY");
+    if (!display_env || !*display_env) return result;
     Display *dpy = XOpenDisplay(nullptr);
     if (!dpy) return result;
     Window root = DefaultRootWindow(dpy);
@@ -135,9 +226,11 @@ std::vector<DisplayEdidInfo> DisplayEdidFinder::EnumerateAll() {
             // Try EDID property
             if (edidAtom != None) {
                 Atom actualType; int actualFormat; unsigned long nItems; unsigned long bytesAfter; unsigned char *prop = nullptr;
-                int status = XRRGetOutputProperty(dpy, output, edidAtom, 0, 128, False, False, AnyPropertyType,
+                // Length is in 32-bit units: ask for the largest possible EDID (256 blocks) so the
+                // extension blocks come back in the same request
+                int status = XRRGetOutputProperty(dpy, output, edidAtom, 0, (256 * 128) / 4, False, False, AnyPropertyType,
                                                   &actualType, &actualFormat, &nItems, &bytesAfter, &prop);
-                if (status == Success && prop && nItems >= 128) {
+                if (status == Success && prop && actualFormat == 8 && nItems >= 128) {
                     std::vector<uint8_t> edid(prop, prop + nItems);
                     // Build synthetic instance id from output name
                     std::string instanceId = std::string("X11:") + (outInfo->name ? outInfo->name : "output");
@@ -149,6 +242,13 @@ std::vector<DisplayEdidInfo> DisplayEdidFinder::EnumerateAll() {
                         info.desktop_y = crtc->y;
                         info.desktop_width = crtc->width;
                         info.desktop_height = crtc->height;
+                        for (int m = 0; m < res->nmode; ++m) {
+                            const XRRModeInfo &mode = res->modes[m];
+                            if (mode.id != crtc->mode || !mode.hTotal || !mode.vTotal) continue;
+                            info.current_refresh_hz = double(mode.dotClock) / (double(mode.hTotal) * mode.vTotal);
+                            if (mode.modeFlags & RR_Interlace) info.current_refresh_hz *= 2.0;
+                            break;
+                        }
                         XRRFreeCrtcInfo(crtc);
                     }
                     result.push_back(info);
@@ -161,6 +261,63 @@ std::vector<DisplayEdidInfo> DisplayEdidFinder::EnumerateAll() {
     XRRFreeScreenResources(res);
     XCloseDisplay(dpy);
     return result;
+}
+
+std::vector<DisplayEdidInfo> EnumerateEdidsLinux() {
+    std::vector<DrmConnectorEntry> drm = EnumerateDrmConnectors();
+    std::vector<DisplayEdidInfo> x11 = EnumerateEdidsX11();
+    std::vector<bool> x11_used(x11.size(), false);
+#ifdef RAYNEO_HAVE_KMS
+    std::map<std::string, std::map<std::string, KmsGeometry>> kms; // per card, read on first use
+#endif
+
+    std::vector<DisplayEdidInfo> result;
+    for (auto &entry : drm) {
+        DisplayEdidInfo &info = entry.info;
+        // The X desktop position is what window placement uses; pair outputs by identical EDID bytes
+        // rather than by resolution, which is ambiguous with several similar monitors
+        for (size_t i = 0; i < x11.size(); ++i) {
+            if (x11_used[i] || x11[i].raw_edid != info.raw_edid) continue;
+            x11_used[i] = true;
+            info.desktop_x = x11[i].desktop_x;
+            info.desktop_y = x11[i].desktop_y;
+            info.desktop_width = x11[i].desktop_width;
+            info.desktop_height = x11[i].desktop_height;
+            info.current_refresh_hz = x11[i].current_refresh_hz;
+            break;
+        }
+#ifdef RAYNEO_HAVE_KMS
+        if (info.desktop_width <= 0) {
+            auto card = kms.find(entry.card);
+            if (card == kms.end()) card = kms.emplace(entry.card, ReadKmsGeometry(entry.card)).first;
+            auto it = card->second.find(entry.connector);
+            if (it != card->second.end()) {
+                info.desktop_x = it->second.x;
+                info.desktop_y = it->second.y;
+                info.desktop_width = it->second.width;
+                info.desktop_height = it->second.height;
+                info.current_refresh_hz = it->second.refresh_hz;
+            }
+        }
+#endif
+        result.push_back(std::move(info));
+    }
+    // Outputs sysfs could not see (no EDID attribute, sysfs not mounted in a container)
+    for (size_t i = 0; i < x11.size(); ++i) {
+        if (!x11_used[i]) result.push_back(std::move(x11[i]));
+    }
+    return result;
+}
+
+#endif // __unix__
+
+} // namespace
+
+std::vector<DisplayEdidInfo> DisplayEdidFinder::EnumerateAll() {
+#ifdef _WIN32
+    return EnumerateEdidsWindows();
+#elif defined(__unix__) && !defined(__APPLE__)
+    return EnumerateEdidsLinux();
 #else
     return {};
 #endif
@@ -198,10 +355,8 @@ bool DisplayEdidFinder::PopulateDesktopCoordinates(DisplayEdidInfo &info) {
         }
     }
     
-    // Wait up to 5 seconds for Windows to recognize the display after mode switch
-    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
-    
-    while (std::chrono::steady_clock::now() < deadline) {
+    // Single pass: callers that need to wait for the output after a mode switch retry themselves
+    {
         DISPLAY_DEVICEA adapter{}; adapter.cb = sizeof(adapter);
         for (DWORD i = 0; EnumDisplayDevicesA(nullptr, i, &adapter, 0); ++i) {
             // Check if adapter is active
@@ -239,49 +394,31 @@ bool DisplayEdidFinder::PopulateDesktopCoordinates(DisplayEdidInfo &info) {
                         info.desktop_y = dm.dmPosition.y;
                         info.desktop_width = dm.dmPelsWidth;
                         info.desktop_height = dm.dmPelsHeight;
+                        // Integer Hz (59 for 59.94); 0 and 1 mean "hardware default"
+                        if (dm.dmDisplayFrequency > 1) info.current_refresh_hz = dm.dmDisplayFrequency;
                         return true;
                     }
                 }
             }
         }
-        // Not found yet, wait a bit and retry
-        std::this_thread::sleep_for(std::chrono::milliseconds(250));
     }
     
     return false;
-// ---------------- Linux (X11) implementation ----------------
+// ---------------- Linux implementation ----------------
 #elif defined(__unix__) && !defined(__APPLE__)
-    Display *dpy = XOpenDisplay(nullptr);
-    if (!dpy) { return false; }
-    Window root = DefaultRootWindow(dpy);
-    int numMonitors = 0;
-    XRRMonitorInfo *monitors = XRRGetMonitors(dpy, root, true, &numMonitors);
-    bool found = false;
-    if (monitors) {
-        // We cannot directly match EDID product_code to XRRMonitorInfo easily without reading EDID via XRR.
-        // Simplify: choose primary (first) monitor if product_code matches any EDID atoms (future improvement).
-        // For now, pick the first monitor as heuristic when resolution matches preferred_width/height.
-        for (int i = 0; i < numMonitors; ++i) {
-            const XRRMonitorInfo &m = monitors[i];
-            // Use preferred_width/height hint if set to choose matching monitor.
-            if (info.preferred_width && info.preferred_height) {
-                if ((int)info.preferred_width == m.width && (int)info.preferred_height == m.height) {
-                    info.desktop_x = m.x; info.desktop_y = m.y; info.desktop_width = m.width; info.desktop_height = m.height; found = true; break;
-                }
-            }
-        }
-        if (!found && numMonitors > 0) {
-            // fallback: first monitor
-            info.desktop_x = monitors[0].x;
-            info.desktop_y = monitors[0].y;
-            info.desktop_width = monitors[0].width;
-            info.desktop_height = monitors[0].height;
-            found = true;
-        }
-        XRRFreeMonitors(monitors);
+    // Geometry comes with the enumeration; find the same connector again and take its current rectangle
+    for (const auto &d : EnumerateAll()) {
+        bool same = !info.device_instance_id.empty() && d.device_instance_id == info.device_instance_id;
+        if (!same && !info.raw_edid.empty()) same = d.raw_edid == info.raw_edid;
+        if (!same || d.desktop_width <= 0 || d.desktop_height <= 0) continue;
+        info.desktop_x = d.desktop_x;
+        info.desktop_y = d.desktop_y;
+        info.desktop_width = d.desktop_width;
+        info.desktop_height = d.desktop_height;
+        info.current_refresh_hz = d.current_refresh_hz;
+        return true;
     }
-    XCloseDisplay(dpy);
-    return found;
+    return false;
 #else
     (void)info; return false;
 #endif
@@ -1,4 +1,5 @@
-// Utility to locate a physical (or logical) Windows display by parsing EDID from registry
+// Utility to locate a physical (or logical) display by parsing its EDID
+// (Windows: registry; Linux: sysfs DRM connectors, with X11 RandR as fallback)
 #pragma once
 
 #include <optional>
@@ -6,8 +7,10 @@
 #include <vector>
 #include <cstdint>
 
+#include "edid_parser.h"
+
 struct DisplayEdidInfo {
-    std::string device_instance_id;   // Full device instance path (eg. DISPLAY\\ABC1234#5&...)
+    std::string device_instance_id;   // Full device instance path (eg. DISPLAY\\ABC1234#5&...; DRM:card0-HDMI-A-1 / X11:HDMI-1 on Linux)
     std::string monitor_name;         // Friendly name if discovered (from EDID descriptor 0xFC)
     uint16_t manufacturer_id = 0;     // PNP ID encoded as 16-bit (3 letters packed)
     uint16_t product_code = 0;        // Model number from EDID ("Model: 981" means product_code == 981)
@@ -17,12 +20,18 @@ struct DisplayEdidInfo {
     // Parsed preferred timing (first detailed timing block) if present
     uint32_t preferred_width = 0;   // horizontal active pixels
     uint32_t preferred_height = 0;  // vertical active lines
+    double preferred_refresh_hz = 0.0; // exact, from pixel clock and totals (0 if unknown)
+
+    std::vector<EdidTiming> timings; // every decoded timing, preferred first
+
+    std::vector<uint8_t> raw_edid;  // Full EDID as read, including extension blocks
 
     // Desktop coordinates (filled by helper when requested)
     int desktop_x = 0;
     int desktop_y = 0;
     int desktop_width = 0;
     int desktop_height = 0;
+    double current_refresh_hz = 0.0; // refresh of the mode currently driven, 0 if the platform did not report it
 };
 
 // Class offers a single static method for now; could be extended later.
@@ -36,6 +45,7 @@ public:
     static std::vector<DisplayEdidInfo> EnumerateAll();
 
     // Populate desktop position (monitor origin and current mode size) for a previously found EDID entry.
-    // Returns true if successfully resolved under Windows.
+    // Returns true if successfully resolved. On Linux the entry is matched back to its connector by
+    // instance id / EDID identity; an unmatched entry is left untouched rather than guessed.
     static bool PopulateDesktopCoordinates(DisplayEdidInfo &info);
 };
@@ -0,0 +1,77 @@
+#include "display_profile.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+constexpr float kDegToRad = 3.14159265358979f / 180.f;
+constexpr float kRadToDeg = 180.f / 3.14159265358979f;
+} // namespace
+
+void FovFromDiagonal( float diagonal_deg, float aspect, float &horizontal_deg, float &vertical_deg )
+{
+	if ( !( aspect > 0.f ) )
+		aspect = 16.f / 9.f;
+	// Split the half-diagonal tangent along the panel's diagonal direction
+	const float t = std::tan( 0.5f * diagonal_deg * kDegToRad );
+	const float norm = std::sqrt( aspect * aspect + 1.f );
+	horizontal_deg = 2.f * std::atan( t * aspect / norm ) * kRadToDeg;
+	vertical_deg = 2.f * std::atan( t / norm ) * kRadToDeg;
+}
+
+DisplayProfile SanitizeDisplayProfile( const DisplayProfile &profile )
+{
+	DisplayProfile p = profile;
+	const DisplayProfile defaults;
+	if ( !std::isfinite( p.fov_horizontal_deg ) )
+		p.fov_horizontal_deg = defaults.fov_horizontal_deg;
+	if ( !std::isfinite( p.fov_vertical_deg ) )
+		p.fov_vertical_deg = defaults.fov_vertical_deg;
+	if ( !std::isfinite( p.render_scale ) )
+		p.render_scale = defaults.render_scale;
+	if ( !std::isfinite( p.convergence_shift ) )
+		p.convergence_shift = 0.f;
+
+	p.fov_horizontal_deg = std::clamp( p.fov_horizontal_deg, 1.f, 170.f );
+	p.fov_vertical_deg = std::clamp( p.fov_vertical_deg, 1.f, 170.f );
+	p.render_scale = std::clamp( p.render_scale, 0.25f, 4.f );
+	const float half = std::tan( 0.5f * p.fov_horizontal_deg * kDegToRad );
+	p.convergence_shift = std::clamp( p.convergence_shift, -0.9f * half, 0.9f * half );
+	return p;
+}
+
+EyeProjection ComputeEyeProjection( const DisplayProfile &profile, int eye )
+{
+	const DisplayProfile p = SanitizeDisplayProfile( profile );
+	const float h = std::tan( 0.5f * p.fov_horizontal_deg * kDegToRad );
+	const float v = std::tan( 0.5f * p.fov_vertical_deg * kDegToRad );
+	// The nose is to the right of the left eye and to the left of the right eye
+	const float shift = eye == 0 ? p.convergence_shift : -p.convergence_shift;
+
+	EyeProjection proj;
+	proj.left = -h + shift;
+	proj.right = h + shift;
+	proj.top = -v;
+	proj.bottom = v;
+	return proj;
+}
+
+void ComputeRenderTargetSize( const DisplayProfile &profile, uint32_t eye_viewport_width, uint32_t eye_viewport_height,
+	uint32_t &render_width, uint32_t &render_height )
+{
+	const DisplayProfile p = SanitizeDisplayProfile( profile );
+	const float h = std::tan( 0.5f * p.fov_horizontal_deg * kDegToRad );
+	const float v = std::tan( 0.5f * p.fov_vertical_deg * kDegToRad );
+
+	// Panel density at the centre (pixels per tangent unit) times the frustum's tangent span
+	const EyeProjection proj = ComputeEyeProjection( p, 0 );
+	const float density_x = eye_viewport_width / ( 2.f * h );
+	const float density_y = eye_viewport_height / ( 2.f * v );
+	const float w = density_x * ( proj.right - proj.left ) * p.render_scale;
+	const float hgt = density_y * ( proj.bottom - proj.top ) * p.render_scale;
+
+	// Even sizes keep the compositor's half-resolution passes exact
+	render_width = std::max< uint32_t >( 2, uint32_t( std::lround( w * 0.5f ) ) * 2 );
+	render_height = std::max< uint32_t >( 2, uint32_t( std::lround( hgt * 0.5f ) ) * 2 );
+}
@@ -0,0 +1,46 @@
+// Per-eye field of view, projection and render target sizing for the RayNeo optics.
+#pragma once
+
+#include <cstdint>
+
+struct DisplayProfile
+{
+	// Full per-eye field of view (degrees). Defaults are the nominal 46 degree diagonal split 16:9.
+	float fov_horizontal_deg = 40.6f;
+	float fov_vertical_deg = 23.5f;
+
+	// Shifts each eye's frustum toward the nose by this many tangent units (0 = symmetric).
+	// Positive values converge the virtual screen closer than infinity.
+	float convergence_shift = 0.f;
+
+	// Render target resolution relative to the panel pixel density at the lens centre
+	float render_scale = 1.f;
+};
+
+// Tangents of the frustum half angles in OpenVR's GetProjectionRaw convention (top negative)
+struct EyeProjection
+{
+	float left = -1.f;
+	float right = 1.f;
+	float top = -1.f;
+	float bottom = 1.f;
+};
+
+// Horizontal / vertical FOV for a diagonal FOV and panel aspect (width / height)
+void FovFromDiagonal( float diagonal_deg, float aspect, float &horizontal_deg, float &vertical_deg );
+
+// Clamps the FOV to (1, 170) degrees, the scale to [0.25, 4] and the shift to keep the frustum non-empty
+DisplayProfile SanitizeDisplayProfile( const DisplayProfile &profile );
+
+// eye: 0 left, 1 right
+EyeProjection ComputeEyeProjection( const DisplayProfile &profile, int eye );
+
+//-----------------------------------------------------------------------------
+// Purpose: Per-eye render target that matches the panel's pixel density at the lens centre.
+// The panel spans the profile FOV across eye_viewport pixels; the frustum from
+// ComputeEyeProjection spans the same tangent range (shifted for convergence), so the target is the
+// viewport scaled by the tangent span ratio and render_scale. The lens model is normalised to unit
+// magnification at the centre, so it does not enter here.
+//-----------------------------------------------------------------------------
+void ComputeRenderTargetSize( const DisplayProfile &profile, uint32_t eye_viewport_width, uint32_t eye_viewport_height,
+	uint32_t &render_width, uint32_t &render_height );
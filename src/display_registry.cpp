@@ -0,0 +1,367 @@
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#include <dbt.h>
+#endif
+
+#if defined(__unix__) && !defined(__APPLE__)
+#include <X11/Xlib.h>
+#include <X11/extensions/Xrandr.h>
+#include <fcntl.h>
+#include <linux/netlink.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <cstdlib>
+#include <cstring>
+#endif
+
+#include "display_registry.h"
+#include "thread_policy.h"
+
+#include <algorithm>
+
+namespace {
+
+#ifdef _WIN32
+// GUID_DEVINTERFACE_MONITOR (ntddvdeo.h), spelled out to avoid pulling in the DDK header
+const GUID kMonitorInterfaceGuid = {0xe6f07b5f, 0xee97, 0x4a90, {0xb0, 0x76, 0x33, 0xf5, 0x7b, 0xf4, 0xea, 0xa7}};
+
+constexpr UINT kWmRefreshNow = WM_APP + 1;
+constexpr UINT_PTR kDebounceTimer = 1;
+
+// Per-window state reached through GWLP_USERDATA
+struct NotifyWindowState {
+    bool refresh_due = false;
+    UINT debounce_ms = 100;
+};
+
+LRESULT CALLBACK NotifyWindowProc(HWND hwnd, UINT msg, WPARAM wp, LPARAM lp) {
+    auto *state = reinterpret_cast<NotifyWindowState *>(GetWindowLongPtrA(hwnd, GWLP_USERDATA));
+    switch (msg) {
+    case WM_DEVICECHANGE:
+        if (wp == DBT_DEVICEARRIVAL || wp == DBT_DEVICEREMOVECOMPLETE || wp == DBT_DEVNODES_CHANGED) {
+            // Restarting the timer coalesces a burst of notifications into one refresh
+            SetTimer(hwnd, kDebounceTimer, state ? state->debounce_ms : 100, nullptr);
+        }
+        return TRUE;
+    case WM_DISPLAYCHANGE:
+        SetTimer(hwnd, kDebounceTimer, state ? state->debounce_ms : 100, nullptr);
+        return 0;
+    case kWmRefreshNow:
+        if (state) state->refresh_due = true;
+        return 0;
+    case WM_TIMER:
+        if (wp == kDebounceTimer) {
+            KillTimer(hwnd, kDebounceTimer);
+            if (state) state->refresh_due = true;
+        }
+        return 0;
+    case WM_CLOSE:
+        DestroyWindow(hwnd);
+        return 0;
+    case WM_DESTROY:
+        PostQuitMessage(0);
+        return 0;
+    default:
+        break;
+    }
+    return DefWindowProcA(hwnd, msg, wp, lp);
+}
+#endif
+
+} // namespace
+
+DisplayRegistry::Predicate DisplayRegistry::MatchEdid(uint16_t product_code, std::optional<uint32_t> serial_number, bool require_desktop) {
+    return [=](const DisplayEdidInfo &d) {
+        if (d.product_code != product_code) return false;
+        if (serial_number && d.serial_number != *serial_number) return false;
+        if (require_desktop && (d.desktop_width <= 0 || d.desktop_height <= 0)) return false;
+        return true;
+    };
+}
+
+void DisplayRegistry::Start() {
+    if (running_.exchange(true)) return;
+    refresh_requested_.store(false);
+#if defined(__unix__) && !defined(__APPLE__)
+    if (pipe(wake_pipe_) == 0) {
+        fcntl(wake_pipe_[0], F_SETFL, O_NONBLOCK);
+        fcntl(wake_pipe_[1], F_SETFL, O_NONBLOCK);
+    } else {
+        wake_pipe_[0] = wake_pipe_[1] = -1;
+    }
+#endif
+    worker_ = std::thread(&DisplayRegistry::WorkerLoop, this);
+}
+
+void DisplayRegistry::Stop() {
+    if (!running_.exchange(false)) return;
+    {
+        // Taking the lock orders the flag change before any waiter re-checks it
+        std::lock_guard<std::mutex> lock(mutex_);
+    }
+    refresh_cv_.notify_all();
+    changed_cv_.notify_all();
+#ifdef _WIN32
+    if (HWND hwnd = static_cast<HWND>(notify_window_.load())) PostMessageA(hwnd, WM_CLOSE, 0, 0);
+#elif defined(__unix__) && !defined(__APPLE__)
+    if (wake_pipe_[1] >= 0) {
+        const char c = 'q';
+        (void)!write(wake_pipe_[1], &c, 1);
+    }
+#endif
+    if (worker_.joinable()) worker_.join();
+#if defined(__unix__) && !defined(__APPLE__)
+    for (int &fd : wake_pipe_) {
+        if (fd >= 0) close(fd);
+        fd = -1;
+    }
+#endif
+}
+
+void DisplayRegistry::RequestRefresh() {
+    refresh_requested_.store(true);
+    refresh_cv_.notify_all();
+#ifdef _WIN32
+    if (HWND hwnd = static_cast<HWND>(notify_window_.load())) PostMessageA(hwnd, kWmRefreshNow, 0, 0);
+#elif defined(__unix__) && !defined(__APPLE__)
+    if (wake_pipe_[1] >= 0) {
+        const char c = 'r';
+        (void)!write(wake_pipe_[1], &c, 1);
+    }
+#endif
+}
+
+std::vector<DisplayEdidInfo> DisplayRegistry::Snapshot() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return displays_;
+}
+
+std::optional<DisplayEdidInfo> DisplayRegistry::Find(const Predicate &pred) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = std::find_if(displays_.begin(), displays_.end(), pred);
+    if (it == displays_.end()) return std::nullopt;
+    return *it;
+}
+
+std::optional<DisplayEdidInfo> DisplayRegistry::WaitForDisplay(const Predicate &pred, std::chrono::milliseconds timeout) const {
+    const auto deadline = std::chrono::steady_clock::now() + timeout;
+    std::unique_lock<std::mutex> lock(mutex_);
+    for (;;) {
+        auto it = std::find_if(displays_.begin(), displays_.end(), pred);
+        if (it != displays_.end()) return *it;
+        if (!running_.load()) return std::nullopt;
+
+        // Wake on the next cache replacement, not on a timer
+        const uint64_t seen = generation_.load();
+        if (!changed_cv_.wait_until(lock, deadline, [&] { return generation_.load() != seen || !running_.load(); })) {
+            return std::nullopt;
+        }
+    }
+}
+
+bool DisplayRegistry::WaitForEnumeration(std::chrono::milliseconds timeout) const {
+    std::unique_lock<std::mutex> lock(mutex_);
+    changed_cv_.wait_for(lock, timeout, [this] { return generation_.load() != 0 || !running_.load(); });
+    return generation_.load() != 0;
+}
+
+void DisplayRegistry::Refresh() {
+    std::vector<DisplayEdidInfo> all;
+    try {
+        all = DisplayEdidFinder::EnumerateAll();
+#ifdef _WIN32
+        // The registry walk has no geometry; resolve it once here so lookups never have to
+        for (auto &d : all) {
+            if (d.desktop_width <= 0) DisplayEdidFinder::PopulateDesktopCoordinates(d);
+        }
+#endif
+    } catch (...) {
+        return; // keep the previous cache
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        displays_ = std::move(all);
+        generation_.fetch_add(1);
+    }
+    changed_cv_.notify_all();
+}
+
+bool DisplayRegistry::WaitForRefreshRequest(std::chrono::milliseconds timeout) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    refresh_cv_.wait_for(lock, timeout, [this] { return !running_.load() || refresh_requested_.load(); });
+    return refresh_requested_.exchange(false);
+}
+
+void DisplayRegistry::WorkerLoop() {
+    SetCurrentThreadName("rayneo-display");
+    Refresh();
+
+    bool notified = false;
+#ifdef _WIN32
+    notified = RunWindowsNotificationLoop();
+#elif defined(__unix__) && !defined(__APPLE__)
+    notified = RunLinuxNotificationLoop();
+#endif
+    if (notified) return;
+
+    // No notification source: re-enumerate slowly, or immediately when asked to
+    while (running_.load()) {
+        WaitForRefreshRequest(kFallbackPollInterval);
+        if (!running_.load()) break;
+        Refresh();
+    }
+}
+
+#ifdef _WIN32
+bool DisplayRegistry::RunWindowsNotificationLoop() {
+    HINSTANCE instance = GetModuleHandleA(nullptr);
+    WNDCLASSEXA wc{};
+    wc.cbSize = sizeof(wc);
+    wc.lpfnWndProc = NotifyWindowProc;
+    wc.hInstance = instance;
+    wc.lpszClassName = "RayNeoDisplayRegistry";
+    RegisterClassExA(&wc); // fails harmlessly if already registered by a previous Start()
+
+    // A hidden top-level window rather than HWND_MESSAGE: message-only windows miss the
+    // WM_DISPLAYCHANGE broadcast
+    HWND hwnd = CreateWindowExA(0, wc.lpszClassName, "", WS_OVERLAPPED, 0, 0, 0, 0, nullptr, nullptr, instance, nullptr);
+    if (!hwnd) return false;
+
+    NotifyWindowState state;
+    state.debounce_ms = static_cast<UINT>(kDebounce.count());
+    SetWindowLongPtrA(hwnd, GWLP_USERDATA, reinterpret_cast<LONG_PTR>(&state));
+
+    DEV_BROADCAST_DEVICEINTERFACE_A filter{};
+    filter.dbcc_size = sizeof(filter);
+    filter.dbcc_devicetype = DBT_DEVTYP_DEVICEINTERFACE;
+    filter.dbcc_classguid = kMonitorInterfaceGuid;
+    HDEVNOTIFY notify = RegisterDeviceNotificationA(hwnd, &filter, DEVICE_NOTIFY_WINDOW_HANDLE);
+
+    notify_window_.store(hwnd);
+    // Stop() may have run before the handle was published
+    if (!running_.load()) PostMessageA(hwnd, WM_CLOSE, 0, 0);
+
+    MSG msg;
+    while (GetMessageA(&msg, nullptr, 0, 0) > 0) {
+        TranslateMessage(&msg);
+        DispatchMessageA(&msg);
+        if (state.refresh_due) {
+            state.refresh_due = false;
+            Refresh();
+        }
+    }
+
+    notify_window_.store(nullptr);
+    if (notify) UnregisterDeviceNotification(notify);
+    return true;
+}
+#else
+bool DisplayRegistry::RunWindowsNotificationLoop() { return false; }
+#endif
+
+#if defined(__unix__) && !defined(__APPLE__)
+namespace {
+
+// Kernel uevents: the DRM device emits "change" with HOTPLUG=1 whenever a connector's status or
+// EDID changes, with or without a display server running. (sysfs attributes do not raise inotify
+// events, so netlink is the only change source that works headless.)
+int OpenDrmUeventSocket() {
+    int fd = socket(AF_NETLINK, SOCK_DGRAM | SOCK_CLOEXEC | SOCK_NONBLOCK, NETLINK_KOBJECT_UEVENT);
+    if (fd < 0) return -1;
+    sockaddr_nl addr{};
+    addr.nl_family = AF_NETLINK;
+    addr.nl_groups = 1; // kernel broadcast group
+    if (bind(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) != 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+// Drains the socket; true if any message was a DRM hotplug
+bool DrainDrmUevents(int fd) {
+    bool hotplug = false;
+    char buf[4096];
+    for (;;) {
+        const ssize_t n = recv(fd, buf, sizeof(buf) - 1, 0);
+        if (n <= 0) break;
+        buf[n] = '\0';
+        // Payload is "action@devpath\0KEY=VALUE\0..."
+        bool drm = false, hp = false;
+        for (const char *p = buf; p < buf + n; p += strlen(p) + 1) {
+            if (strcmp(p, "SUBSYSTEM=drm") == 0) drm = true;
+            else if (strcmp(p, "HOTPLUG=1") == 0) hp = true;
+        }
+        hotplug = hotplug || (drm && hp);
+    }
+    return hotplug;
+}
+
+} // namespace
+
+bool DisplayRegistry::RunLinuxNotificationLoop() {
+    if (wake_pipe_[0] < 0) return false;
+
+    const int uevent_fd = OpenDrmUeventSocket();
+
+    Display *dpy = nullptr;
+    int event_base = 0, error_base = 0;
+    const char *display_env = std::getenv("DISPLAY");
+    if (display_env && *display_env) dpy = XOpenDisplay(nullptr);
+    if (dpy && !XRRQueryExtension(dpy, &event_base, &error_base)) {
+        XCloseDisplay(dpy);
+        dpy = nullptr;
+    }
+    if (uevent_fd < 0 && !dpy) return false;
+    if (dpy) {
+        // RandR also reports layout changes (desktop moves, mode switches) that no uevent covers
+        XRRSelectInput(dpy, DefaultRootWindow(dpy), RRScreenChangeNotifyMask | RRCrtcChangeNotifyMask | RROutputChangeNotifyMask);
+        XFlush(dpy);
+    }
+
+    bool pending = false;
+    auto due = std::chrono::steady_clock::now();
+    auto schedule = [&](std::chrono::milliseconds delay) {
+        if (!pending) {
+            pending = true;
+            due = std::chrono::steady_clock::now() + delay;
+        }
+    };
+    while (running_.load()) {
+        int timeout_ms = -1;
+        if (pending) {
+            const auto left = std::chrono::duration_cast<std::chrono::milliseconds>(due - std::chrono::steady_clock::now()).count();
+            timeout_ms = left > 0 ? static_cast<int>(left) : 0;
+        }
+        pollfd fds[3] = {{wake_pipe_[0], POLLIN, 0}, {uevent_fd, POLLIN, 0}, {dpy ? ConnectionNumber(dpy) : -1, POLLIN, 0}};
+        poll(fds, 3, timeout_ms);
+
+        if (fds[0].revents & POLLIN) {
+            char buf[16];
+            while (read(wake_pipe_[0], buf, sizeof(buf)) > 0) {}
+            if (refresh_requested_.exchange(false)) {
+                pending = false;
+                schedule(std::chrono::milliseconds(0));
+            }
+        }
+        if (uevent_fd >= 0 && (fds[1].revents & POLLIN) && DrainDrmUevents(uevent_fd)) schedule(kDebounce);
+        while (dpy && XPending(dpy)) {
+            XEvent ev;
+            XNextEvent(dpy, &ev);
+            if (ev.type == event_base + RRScreenChangeNotify) XRRUpdateConfiguration(&ev);
+            if (ev.type == event_base + RRScreenChangeNotify || ev.type == event_base + RRNotify) schedule(kDebounce);
+        }
+        if (pending && std::chrono::steady_clock::now() >= due) {
+            pending = false;
+            Refresh();
+        }
+    }
+    if (dpy) XCloseDisplay(dpy);
+    if (uevent_fd >= 0) close(uevent_fd);
+    return true;
+}
+#else
+bool DisplayRegistry::RunLinuxNotificationLoop() { return false; }
+#endif
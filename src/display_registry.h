@@ -0,0 +1,80 @@
+// Cached view of the attached displays, refreshed from OS hotplug notifications instead of polling
+#pragma once
+
+#include "display_edid_finder.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+
+// Enumerates once on Start(), then re-enumerates only when the OS reports a display change:
+//   Windows: WM_DEVICECHANGE (RegisterDeviceNotification on the monitor interface) and WM_DISPLAYCHANGE
+//   Linux:   DRM hotplug uevents (netlink, no display server needed) plus, when an X server is
+//            reachable, RandR RRScreenChangeNotify / RRNotify (output, CRTC) events
+// Bursts of notifications are coalesced into one refresh. Without a notification source (no
+// netlink / X server, window creation failed) the registry falls back to a slow periodic refresh.
+class DisplayRegistry {
+public:
+    using Predicate = std::function<bool(const DisplayEdidInfo &)>;
+
+    DisplayRegistry() = default;
+    ~DisplayRegistry() { Stop(); }
+
+    DisplayRegistry(const DisplayRegistry &) = delete;
+    DisplayRegistry &operator=(const DisplayRegistry &) = delete;
+
+    void Start();
+    void Stop();
+
+    // Current cache (entries carry desktop coordinates whenever the platform could resolve them)
+    std::vector<DisplayEdidInfo> Snapshot() const;
+    // Increments every time the cache content is replaced
+    uint64_t Generation() const { return generation_.load(); }
+
+    std::optional<DisplayEdidInfo> Find(const Predicate &pred) const;
+
+    // Blocks until a display matching pred is in the cache, the timeout expires or Stop() is called.
+    std::optional<DisplayEdidInfo> WaitForDisplay(const Predicate &pred, std::chrono::milliseconds timeout) const;
+
+    // Blocks until the first enumeration after Start() has completed, the timeout expires or
+    // Stop() is called; returns whether the cache is populated. Lets "not listed" mean "absent".
+    bool WaitForEnumeration(std::chrono::milliseconds timeout) const;
+
+    // Ask the worker for an immediate re-enumeration (e.g. right after requesting a mode switch)
+    void RequestRefresh();
+
+    // Predicate helper matching the finder's product / serial filter
+    static Predicate MatchEdid(uint16_t product_code, std::optional<uint32_t> serial_number = std::nullopt, bool require_desktop = false);
+
+private:
+    void WorkerLoop();
+    void Refresh();
+    bool WaitForRefreshRequest(std::chrono::milliseconds timeout);
+
+    // Platform notification loops; return false if no notification source could be set up
+    bool RunWindowsNotificationLoop();
+    bool RunLinuxNotificationLoop();
+
+    mutable std::mutex mutex_;
+    mutable std::condition_variable changed_cv_;
+    std::vector<DisplayEdidInfo> displays_;
+    std::atomic<uint64_t> generation_{0};
+
+    std::thread worker_;
+    std::atomic<bool> running_{false};
+    std::atomic<bool> refresh_requested_{false};
+    std::condition_variable refresh_cv_;
+
+    // Platform handles used to wake the worker from Stop()/RequestRefresh()
+    std::atomic<void *> notify_window_{nullptr}; // HWND
+    int wake_pipe_[2] = {-1, -1};
+
+    static constexpr std::chrono::milliseconds kDebounce{100};
+    static constexpr std::chrono::milliseconds kFallbackPollInterval{1000};
+};
@@ -0,0 +1,254 @@
+#include "driver_settings.h"
+
+#include "openvr_driver.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+// Missing keys (no default.vrsettings, older install) keep the compiled-in default
+void ReadFloat( const char *key, std::atomic< float > &value, float lo, float hi )
+{
+	vr::EVRSettingsError err = vr::VRSettingsError_None;
+	const float v = vr::VRSettings()->GetFloat( kRayneoSettingsSection, key, &err );
+	if ( err == vr::VRSettingsError_None && std::isfinite( v ) )
+		value.store( std::clamp( v, lo, hi ), std::memory_order_relaxed );
+}
+
+void ReadInt( const char *key, std::atomic< int > &value, int lo, int hi )
+{
+	vr::EVRSettingsError err = vr::VRSettingsError_None;
+	const int32_t v = vr::VRSettings()->GetInt32( kRayneoSettingsSection, key, &err );
+	if ( err == vr::VRSettingsError_None )
+		value.store( std::clamp< int >( v, lo, hi ), std::memory_order_relaxed );
+}
+
+void ReadBool( const char *key, std::atomic< bool > &value )
+{
+	vr::EVRSettingsError err = vr::VRSettingsError_None;
+	const bool v = vr::VRSettings()->GetBool( kRayneoSettingsSection, key, &err );
+	if ( err == vr::VRSettingsError_None )
+		value.store( v, std::memory_order_relaxed );
+}
+
+bool ReadString( const char *key, std::string &value )
+{
+	char buf[ 1024 ] = {};
+	vr::EVRSettingsError err = vr::VRSettingsError_None;
+	vr::VRSettings()->GetString( kRayneoSettingsSection, key, buf, sizeof( buf ), &err );
+	if ( err != vr::VRSettingsError_None )
+		return false;
+	value = buf;
+	return true;
+}
+} // namespace
+
+void DriverSettings::Load()
+{
+	std::string fusion;
+	ImuFusionType type;
+	if ( ReadString( "fusion_filter", fusion ) && ParseImuFusionType( fusion.c_str(), type ) )
+		fusion_type.store( static_cast< int >( type ), std::memory_order_relaxed );
+	ReadBool( "learn_gyro_bias", learn_gyro_bias );
+	ReadFloat( "gyro_scale", gyro_scale, 0.f, 10.f );
+	ReadFloat( "fusion_max_step", fusion_max_step, 0.01f, 3.14f );
+	ReadFloat( "fusion_accel_gate_g", fusion_accel_gate_g, 0.f, 2.f );
+	ReadFloat( "complementary_time_constant", complementary_time_constant, 0.01f, 100.f );
+	ReadFloat( "mahony_kp", mahony_kp, 0.f, 50.f );
+	ReadFloat( "mahony_ki", mahony_ki, 0.f, 10.f );
+	ReadFloat( "madgwick_beta", madgwick_beta, 0.f, 10.f );
+	ReadFloat( "madgwick_zeta", madgwick_zeta, 0.f, 1.f );
+	ReadFloat( "max_sample_gap_s", max_sample_gap_s, 0.001f, 2.f );
+	ReadFloat( "angular_velocity_time_constant", angular_velocity_time_constant, 0.f, 1.f );
+	ReadFloat( "angular_acceleration_time_constant", angular_acceleration_time_constant, 0.f, 1.f );
+
+	{
+		std::string mode_name;
+		PositionMode mode;
+		std::atomic< bool > legacy_6dof{ false };
+		ReadBool( "experimental_6dof", legacy_6dof );
+		if ( ReadString( "position_mode", mode_name ) && ParsePositionMode( mode_name.c_str(), mode ) )
+			position_mode.store( static_cast< int >( mode ), std::memory_order_relaxed );
+		if ( legacy_6dof.load( std::memory_order_relaxed ) && position_mode.load( std::memory_order_relaxed ) == static_cast< int >( PositionMode::Fixed ) )
+			position_mode.store( static_cast< int >( PositionMode::Inertial ), std::memory_order_relaxed );
+	}
+	ReadFloat( "standing_height", standing_height, 0.f, 3.f );
+	ReadFloat( "neck_eye_up_m", neck_eye_up_m, 0.f, 0.3f );
+	ReadFloat( "neck_eye_forward_m", neck_eye_forward_m, 0.f, 0.3f );
+	ReadFloat( "zupt_gyro_threshold", zupt_gyro_threshold, 0.f, 5.f );
+	ReadFloat( "zupt_accel_threshold_g", zupt_accel_threshold_g, 0.f, 1.f );
+	ReadFloat( "zupt_hold_s", zupt_hold_s, 0.f, 2.f );
+	ReadFloat( "position_gravity_time_constant", position_gravity_time_constant, 0.01f, 100.f );
+	ReadFloat( "position_velocity_decay_s", position_velocity_decay_s, 0.f, 100.f );
+	ReadFloat( "position_return_s", position_return_s, 0.f, 600.f );
+	ReadFloat( "position_max_offset_m", position_max_offset_m, 0.f, 5.f );
+
+	ReadBool( "external_pose_enabled", external_pose_enabled );
+	ReadInt( "external_pose_udp_port", external_pose_udp_port, 0, 65535 );
+	ReadBool( "external_pose_use_yaw", external_pose_use_yaw );
+	ReadBool( "external_pose_use_position", external_pose_use_position );
+	ReadFloat( "external_pose_yaw_time_constant", external_pose_yaw_time_constant, 0.f, 100.f );
+	ReadFloat( "external_pose_position_time_constant", external_pose_position_time_constant, 0.f, 100.f );
+	ReadInt( "external_pose_latency_ms", external_pose_latency_ms, 0, 1000 );
+	ReadInt( "external_pose_max_age_ms", external_pose_max_age_ms, 1, 5000 );
+
+	ReadBool( "pose_event_driven", pose_event_driven );
+	ReadFloat( "pose_max_rate_hz", pose_max_rate_hz, 1.f, 4000.f );
+	ReadFloat( "pose_idle_rate_hz", pose_idle_rate_hz, 0.5f, 1000.f );
+	ReadFloat( "pose_standby_rate_hz", pose_standby_rate_hz, 0.1f, 100.f );
+	ReadInt( "pose_fixed_period_ms", pose_fixed_period_ms, 1, 1000 );
+	ReadFloat( "prediction_seconds", prediction_seconds, 0.f, 0.1f );
+	ReadBool( "prediction_adaptive", prediction_adaptive );
+
+	ReadFloat( "seconds_from_vsync_to_photons", seconds_from_vsync_to_photons, 0.f, 0.5f );
+	ReadBool( "timing_adaptive", timing_adaptive );
+	ReadFloat( "timing_smoothing_s", timing_smoothing_s, 0.f, 60.f );
+	ReadFloat( "head_to_eye_depth_m", head_to_eye_depth_m, 0.f, 0.2f );
+	ReadInt( "display_edid_product", display_edid_product, 0, 0xFFFF );
+	ReadInt( "display_edid_serial", display_edid_serial, -1, INT32_MAX );
+	ReadInt( "display_discovery_timeout_ms", display_discovery_timeout_ms, 0, 600000 );
+	ReadBool( "display_auto_3d", display_auto_3d );
+	ReadBool( "display_restore_2d", display_restore_2d );
+	ReadInt( "display_mode_switch_timeout_ms", display_mode_switch_timeout_ms, 0, 60000 );
+
+	ReadInt( "usb_vid", usb_vid, 0, 0xFFFF );
+	ReadInt( "usb_pid", usb_pid, 0, 0xFFFF );
+	ReadInt( "extra_unit_count", extra_unit_count, 0, 7 );
+	ReadInt( "reconnect_initial_backoff_ms", reconnect_initial_backoff_ms, 10, 60000 );
+	ReadInt( "reconnect_max_backoff_ms", reconnect_max_backoff_ms, 10, 600000 );
+
+	ReadInt( "button_hold_ms", button_hold_ms, 10, 5000 );
+	ReadInt( "double_click_ms", double_click_ms, 50, 2000 );
+
+	ReadFloat( "haptics_max_pulses_per_second", haptics_max_pulses_per_second, 0.f, 1000.f );
+	ReadBool( "haptics_audio_cue", haptics_audio_cue );
+
+	{
+		std::string priority_name;
+		ThreadPriority priority;
+		if ( ReadString( "event_thread_priority", priority_name ) && ParseThreadPriority( priority_name.c_str(), priority ) )
+			event_thread_priority.store( static_cast< int >( priority ), std::memory_order_relaxed );
+		if ( ReadString( "pose_thread_priority", priority_name ) && ParseThreadPriority( priority_name.c_str(), priority ) )
+			pose_thread_priority.store( static_cast< int >( priority ), std::memory_order_relaxed );
+	}
+	ReadInt( "event_thread_affinity", event_thread_affinity, 0, INT32_MAX );
+	ReadInt( "pose_thread_affinity", pose_thread_affinity, 0, INT32_MAX );
+	ReadInt( "timer_resolution_ms", timer_resolution_ms, 0, 16 );
+
+	ReadBool( "record_imu", record_imu );
+	{
+		std::string directory, model, serial, ring, udp_address;
+		const bool have_directory = ReadString( "record_directory", directory );
+		const bool have_model = ReadString( "model_number", model ) && !model.empty();
+		const bool have_serial = ReadString( "serial_number", serial ); // empty: derive from the glasses
+		const bool have_ring = ReadString( "external_pose_ring_name", ring );
+		const bool have_udp_address = ReadString( "external_pose_udp_address", udp_address ) && !udp_address.empty();
+		std::lock_guard< std::mutex > lock( strings_mutex_ );
+		if ( have_directory )
+			record_directory_ = directory;
+		if ( have_ring )
+			external_pose_ring_name_ = ring;
+		if ( have_udp_address )
+			external_pose_udp_address_ = udp_address;
+		if ( have_model )
+			model_number_ = model;
+		if ( have_serial )
+			serial_number_ = serial;
+	}
+
+	generation_.fetch_add( 1, std::memory_order_release );
+}
+
+std::string DriverSettings::RecordDirectory() const
+{
+	std::lock_guard< std::mutex > lock( strings_mutex_ );
+	return record_directory_;
+}
+
+std::string DriverSettings::ModelNumber() const
+{
+	std::lock_guard< std::mutex > lock( strings_mutex_ );
+	return model_number_;
+}
+
+std::string DriverSettings::SerialNumber() const
+{
+	std::lock_guard< std::mutex > lock( strings_mutex_ );
+	return serial_number_;
+}
+
+TrackingPipelineConfig DriverSettings::PipelineConfig() const
+{
+	constexpr auto r = std::memory_order_relaxed;
+	TrackingPipelineConfig c;
+	c.fusion_type = static_cast< ImuFusionType >( fusion_type.load( r ) );
+	c.fusion_params.max_step = fusion_max_step.load( r );
+	c.fusion_params.accel_gate_g = fusion_accel_gate_g.load( r );
+	c.fusion_params.complementary_time_constant = complementary_time_constant.load( r );
+	c.fusion_params.mahony_kp = mahony_kp.load( r );
+	c.fusion_params.mahony_ki = mahony_ki.load( r );
+	c.fusion_params.madgwick_beta = madgwick_beta.load( r );
+	c.fusion_params.madgwick_zeta = madgwick_zeta.load( r );
+	c.learn_gyro_bias = learn_gyro_bias.load( r );
+	c.gyro_scale = gyro_scale.load( r );
+	c.max_dt = max_sample_gap_s.load( r );
+	c.ang_vel_time_constant = angular_velocity_time_constant.load( r );
+	c.ang_acc_time_constant = angular_acceleration_time_constant.load( r );
+	c.position.mode = static_cast< PositionMode >( position_mode.load( r ) );
+	c.position.standing_height = standing_height.load( r );
+	c.position.neck_eye_up = neck_eye_up_m.load( r );
+	c.position.neck_eye_forward = neck_eye_forward_m.load( r );
+	c.position.zupt_gyro_threshold = zupt_gyro_threshold.load( r );
+	c.position.zupt_accel_threshold = zupt_accel_threshold_g.load( r );
+	c.position.zupt_hold_time = zupt_hold_s.load( r );
+	c.position.gravity_time_constant = position_gravity_time_constant.load( r );
+	c.position.velocity_decay_time = position_velocity_decay_s.load( r );
+	c.position.return_time = position_return_s.load( r );
+	c.position.max_offset = position_max_offset_m.load( r );
+	return c;
+}
+
+ExternalPoseSourceConfig DriverSettings::ExternalPoseSourceSettings() const
+{
+	ExternalPoseSourceConfig c;
+	c.udp_port = external_pose_udp_port.load( std::memory_order_relaxed );
+	std::lock_guard< std::mutex > lock( strings_mutex_ );
+	c.ring_name = external_pose_ring_name_;
+	c.udp_address = external_pose_udp_address_;
+	return c;
+}
+
+ExternalPoseFusionParams DriverSettings::ExternalPoseFusionSettings() const
+{
+	constexpr auto r = std::memory_order_relaxed;
+	ExternalPoseFusionParams p;
+	p.use_yaw = external_pose_use_yaw.load( r );
+	p.use_position = external_pose_use_position.load( r );
+	p.yaw_time_constant = external_pose_yaw_time_constant.load( r );
+	p.position_time_constant = external_pose_position_time_constant.load( r );
+	p.latency = external_pose_latency_ms.load( r ) * 0.001f;
+	p.max_age = external_pose_max_age_ms.load( r ) * 0.001f;
+	return p;
+}
+
+ThreadPolicy DriverSettings::EventThreadPolicy() const
+{
+	constexpr auto r = std::memory_order_relaxed;
+	ThreadPolicy p;
+	p.priority = static_cast< ThreadPriority >( event_thread_priority.load( r ) );
+	// The IMU feeds the pose thread, so it preempts it
+	p.realtime_priority = 11;
+	p.affinity_mask = static_cast< uint64_t >( event_thread_affinity.load( r ) );
+	return p;
+}
+
+ThreadPolicy DriverSettings::PoseThreadPolicy() const
+{
+	constexpr auto r = std::memory_order_relaxed;
+	ThreadPolicy p;
+	p.priority = static_cast< ThreadPriority >( pose_thread_priority.load( r ) );
+	p.realtime_priority = 10;
+	p.affinity_mask = static_cast< uint64_t >( pose_thread_affinity.load( r ) );
+	return p;
+}
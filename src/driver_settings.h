@@ -0,0 +1,143 @@
+// Typed, cached view of the driver_rayneo settings section (defaults: resources/settings/default.vrsettings)
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+
+#include "external_pose_fusion.h"
+#include "thread_policy.h"
+#include "tracking_pipeline.h"
+
+// Section for everything driver-specific; per-device calibration lives in rayneo_calibration
+inline constexpr const char *kRayneoSettingsSection = "driver_rayneo";
+
+//-----------------------------------------------------------------------------
+// Purpose: Every tunable the driver reads, loaded with Load() on the vrserver main thread (startup
+// and the settings-changed events handled in RunFrame) and cached in atomics, so the IMU and pose
+// threads never call VRSettings(). Readers load individual fields with relaxed ordering; a reload
+// bumps Generation() so consumers that derive state (the tracking pipeline) know to rebuild it.
+//
+// Hot: picked up on the next use. Startup: read once at Init (or Activate) and kept.
+//-----------------------------------------------------------------------------
+class DriverSettings
+{
+public:
+	void Load();
+	uint64_t Generation() const { return generation_.load( std::memory_order_acquire ); }
+
+	// Tracking (hot; applied by the event thread between IMU batches)
+	std::atomic< int > fusion_type{ static_cast< int >( ImuFusionType::Mahony ) };
+	std::atomic< bool > learn_gyro_bias{ true };
+	std::atomic< float > gyro_scale{ 1.0f };
+	std::atomic< float > fusion_max_step{ 0.35f };
+	std::atomic< float > fusion_accel_gate_g{ 0.15f };
+	std::atomic< float > complementary_time_constant{ 2.0f };
+	std::atomic< float > mahony_kp{ 0.5f };
+	std::atomic< float > mahony_ki{ 0.02f };
+	std::atomic< float > madgwick_beta{ 0.04f };
+	std::atomic< float > madgwick_zeta{ 0.005f };
+	std::atomic< float > max_sample_gap_s{ 0.1f };
+	std::atomic< float > angular_velocity_time_constant{ 0.004f };
+	std::atomic< float > angular_acceleration_time_constant{ 0.020f };
+
+	// Position engine (hot). experimental_6dof is the old switch, read as position_mode "inertial".
+	std::atomic< int > position_mode{ static_cast< int >( PositionMode::Fixed ) };
+	std::atomic< float > standing_height{ 1.5f };
+	std::atomic< float > neck_eye_up_m{ 0.075f };
+	std::atomic< float > neck_eye_forward_m{ 0.08f };
+	std::atomic< float > zupt_gyro_threshold{ 0.1f };
+	std::atomic< float > zupt_accel_threshold_g{ 0.03f };
+	std::atomic< float > zupt_hold_s{ 0.05f };
+	std::atomic< float > position_gravity_time_constant{ 1.0f };
+	std::atomic< float > position_velocity_decay_s{ 0.5f };
+	std::atomic< float > position_return_s{ 5.0f };
+	std::atomic< float > position_max_offset_m{ 0.3f };
+
+	// External tracker input: transport is startup (ExternalPoseSourceSettings), fusion is hot
+	std::atomic< bool > external_pose_enabled{ false };
+	std::atomic< int > external_pose_udp_port{ 28770 };
+	std::atomic< bool > external_pose_use_yaw{ true };
+	std::atomic< bool > external_pose_use_position{ true };
+	std::atomic< float > external_pose_yaw_time_constant{ 1.0f };
+	std::atomic< float > external_pose_position_time_constant{ 0.25f };
+	std::atomic< int > external_pose_latency_ms{ 30 };
+	std::atomic< int > external_pose_max_age_ms{ 500 };
+
+	// Pose publishing (hot)
+	std::atomic< bool > pose_event_driven{ true };
+	std::atomic< float > pose_max_rate_hz{ 1000.f };
+	std::atomic< float > pose_idle_rate_hz{ 10.f };
+	std::atomic< float > pose_standby_rate_hz{ 1.f }; // vrserver standby or glasses asleep
+	std::atomic< int > pose_fixed_period_ms{ 5 };
+	std::atomic< float > prediction_seconds{ 0.f };
+	// Also cover the measured IMU-to-pose age (frame_timing.h) with the in-driver prediction
+	std::atomic< bool > prediction_adaptive{ false };
+
+	// Display (vsync-to-photons and eye depth are hot; the rest is startup)
+	std::atomic< float > seconds_from_vsync_to_photons{ 0.11f };
+	// Add the compositor's measured queueing / late presents to seconds_from_vsync_to_photons
+	std::atomic< bool > timing_adaptive{ true };
+	std::atomic< float > timing_smoothing_s{ 2.0f };
+	std::atomic< float > head_to_eye_depth_m{ 0.02f };
+	std::atomic< int > display_edid_product{ 980 };
+	std::atomic< int > display_edid_serial{ 17 };
+	std::atomic< int > display_discovery_timeout_ms{ 15000 };
+	// 2D/3D mode management on connect: switch to 3D unless the 3D output is already attached,
+	// wait this long for it to appear, and switch back to 2D on shutdown if the driver switched
+	std::atomic< bool > display_auto_3d{ true };
+	std::atomic< bool > display_restore_2d{ true };
+	std::atomic< int > display_mode_switch_timeout_ms{ 5000 };
+
+	// USB device (startup)
+	std::atomic< int > usb_vid{ 0x1BBB };
+	std::atomic< int > usb_pid{ 0xAF50 };
+
+	// Additional glasses on the same VID/PID (USB index 1..N), exposed as generic trackers (startup)
+	std::atomic< int > extra_unit_count{ 0 };
+
+	// Reconnect backoff after a detach or a failed Rayneo_Start (hot): doubles from initial up to max
+	std::atomic< int > reconnect_initial_backoff_ms{ 250 };
+	std::atomic< int > reconnect_max_backoff_ms{ 5000 };
+
+	// Input (hot): how long a notification-driven click holds the button, brightness double-click window
+	std::atomic< int > button_hold_ms{ 100 };
+	std::atomic< int > double_click_ms{ 400 };
+
+	// Haptics (hot): pulse budget, and whether to render pulses as a tone (Windows only)
+	std::atomic< float > haptics_max_pulses_per_second{ 20.f };
+	std::atomic< bool > haptics_audio_cue{ false };
+
+	// Thread scheduling (startup): "normal", "high" or "realtime" and a CPU mask (0: any core) for
+	// the IMU event threads and the pose threads; Windows timer resolution in ms (0: system default)
+	std::atomic< int > event_thread_priority{ static_cast< int >( ThreadPriority::Realtime ) };
+	std::atomic< int > event_thread_affinity{ 0 };
+	std::atomic< int > pose_thread_priority{ static_cast< int >( ThreadPriority::Realtime ) };
+	std::atomic< int > pose_thread_affinity{ 0 };
+	std::atomic< int > timer_resolution_ms{ 1 };
+
+	// Recording (startup; record_directory also applies to the next DebugRequest "record start")
+	std::atomic< bool > record_imu{ false };
+
+	std::string RecordDirectory() const;
+	std::string ModelNumber() const;
+	std::string SerialNumber() const;
+
+	// Tracking fields gathered into the pipeline's config
+	TrackingPipelineConfig PipelineConfig() const;
+	ExternalPoseSourceConfig ExternalPoseSourceSettings() const;
+	ExternalPoseFusionParams ExternalPoseFusionSettings() const;
+	ThreadPolicy EventThreadPolicy() const;
+	ThreadPolicy PoseThreadPolicy() const;
+
+private:
+	mutable std::mutex strings_mutex_;
+	std::string record_directory_;
+	std::string external_pose_ring_name_ = "RayNeoExternalPose";
+	std::string external_pose_udp_address_ = "127.0.0.1";
+	std::string model_number_ = "SimpleHMD";
+	std::string serial_number_; // empty: derived from the glasses (MyDeviceProvider::ResolveHmdSerial)
+
+	std::atomic< uint64_t > generation_{ 0 };
+};
@@ -0,0 +1,161 @@
+#include "driver_stats.h"
+
+#include <bit>
+#include <cstdio>
+
+size_t LatencyHistogram::BucketIndex( uint64_t v )
+{
+	if ( v < kSubBuckets )
+		return static_cast< size_t >( v );
+
+	// Position of the highest set bit picks the octave, the next kSubBucketBits bits the sub-bucket
+	int exponent = 63 - std::countl_zero( v );
+	if ( exponent > kMaxExponent )
+		return kBucketCount - 1;
+	const int shift = exponent - kSubBucketBits;
+	const uint64_t sub = ( v >> shift ) & ( kSubBuckets - 1 );
+	return static_cast< size_t >( ( shift + 1 ) * kSubBuckets + sub );
+}
+
+uint64_t LatencyHistogram::BucketUpperBound( size_t index )
+{
+	if ( index < static_cast< size_t >( kSubBuckets ) )
+		return index;
+	const int shift = static_cast< int >( index / kSubBuckets ) - 1;
+	const uint64_t sub = index % kSubBuckets;
+	return ( ( kSubBuckets + sub + 1 ) << shift ) - 1;
+}
+
+void LatencyHistogram::Record( int64_t value_ns )
+{
+	if ( reset_requested_.load( std::memory_order_relaxed ) && reset_requested_.exchange( false, std::memory_order_acquire ) )
+	{
+		for ( auto &b : buckets_ )
+			b.store( 0, std::memory_order_relaxed );
+		count_.store( 0, std::memory_order_relaxed );
+		sum_.store( 0, std::memory_order_relaxed );
+		max_.store( 0, std::memory_order_relaxed );
+	}
+
+	const uint64_t v = value_ns > 0 ? static_cast< uint64_t >( value_ns ) : 0;
+	auto &bucket = buckets_[ BucketIndex( v ) ];
+	bucket.store( bucket.load( std::memory_order_relaxed ) + 1, std::memory_order_relaxed );
+	count_.store( count_.load( std::memory_order_relaxed ) + 1, std::memory_order_relaxed );
+	sum_.store( sum_.load( std::memory_order_relaxed ) + v, std::memory_order_relaxed );
+	if ( static_cast< int64_t >( v ) > max_.load( std::memory_order_relaxed ) )
+		max_.store( static_cast< int64_t >( v ), std::memory_order_relaxed );
+}
+
+double LatencyHistogram::Mean() const
+{
+	const uint64_t n = count_.load( std::memory_order_relaxed );
+	return n ? static_cast< double >( sum_.load( std::memory_order_relaxed ) ) / static_cast< double >( n ) : 0.0;
+}
+
+int64_t LatencyHistogram::Percentile( double p ) const
+{
+	// Snapshot the buckets first; the writer may still be adding to them
+	uint64_t total = 0;
+	std::array< uint64_t, kBucketCount > counts;
+	for ( size_t i = 0; i < counts.size(); ++i )
+	{
+		counts[ i ] = buckets_[ i ].load( std::memory_order_relaxed );
+		total += counts[ i ];
+	}
+	if ( total == 0 )
+		return 0;
+
+	if ( p < 0.0 )
+		p = 0.0;
+	if ( p > 1.0 )
+		p = 1.0;
+	uint64_t rank = static_cast< uint64_t >( p * static_cast< double >( total ) + 0.5 );
+	if ( rank < 1 )
+		rank = 1;
+
+	uint64_t seen = 0;
+	for ( size_t i = 0; i < counts.size(); ++i )
+	{
+		seen += counts[ i ];
+		if ( seen >= rank )
+		{
+			const int64_t upper = static_cast< int64_t >( BucketUpperBound( i ) );
+			const int64_t max = max_.load( std::memory_order_relaxed );
+			return upper < max ? upper : max;
+		}
+	}
+	return max_.load( std::memory_order_relaxed );
+}
+
+void DriverStats::RequestReset()
+{
+	imu_tick_to_receive.RequestReset();
+	poll_wait.RequestReset();
+	integrate_sample.RequestReset();
+	imu_samples.RequestReset();
+	imu_invalid_samples.RequestReset();
+	other_events.RequestReset();
+	reconnects.RequestReset();
+	external_poses.RequestReset();
+	external_poses_rejected.RequestReset();
+	snapshot_to_pose_update.RequestReset();
+	pose_publish_interval.RequestReset();
+	pose_updates.RequestReset();
+	run_frame.RequestReset();
+	since = std::chrono::steady_clock::now();
+}
+
+static void AppendHistogram( std::string &out, const char *name, const LatencyHistogram &h )
+{
+	char line[ 256 ];
+	snprintf( line, sizeof( line ), "%-24s n=%-9llu mean=%9.1fus p50=%9.1fus p90=%9.1fus p99=%9.1fus p99.9=%9.1fus max=%9.1fus\n",
+		name, (unsigned long long)h.Count(), h.Mean() / 1000.0,
+		h.Percentile( 0.50 ) / 1000.0, h.Percentile( 0.90 ) / 1000.0, h.Percentile( 0.99 ) / 1000.0,
+		h.Percentile( 0.999 ) / 1000.0, h.Max() / 1000.0 );
+	out += line;
+}
+
+std::string DriverStats::Format( const uint64_t *batch_histogram, size_t batch_bins ) const
+{
+	std::string out;
+	char line[ 256 ];
+
+	const double elapsed = std::chrono::duration< double >( std::chrono::steady_clock::now() - since ).count();
+	const double pose_interval_us = pose_publish_interval.Mean() / 1000.0;
+	snprintf( line, sizeof( line ), "window=%.1fs imu_samples=%llu invalid=%llu other_events=%llu reconnects=%llu pose_updates=%llu pose_rate=%.1fHz\n",
+		elapsed, (unsigned long long)imu_samples.Value(), (unsigned long long)imu_invalid_samples.Value(),
+		(unsigned long long)other_events.Value(), (unsigned long long)reconnects.Value(), (unsigned long long)pose_updates.Value(),
+		pose_interval_us > 0.0 ? 1e6 / pose_interval_us : 0.0 );
+	out += line;
+
+	if ( external_poses.Value() || external_poses_rejected.Value() )
+	{
+		snprintf( line, sizeof( line ), "external_poses=%llu rejected=%llu\n", (unsigned long long)external_poses.Value(),
+			(unsigned long long)external_poses_rejected.Value() );
+		out += line;
+	}
+
+	AppendHistogram( out, "imu_tick_to_receive", imu_tick_to_receive );
+	AppendHistogram( out, "poll_wait", poll_wait );
+	AppendHistogram( out, "integrate_sample", integrate_sample );
+	AppendHistogram( out, "snapshot_to_pose_update", snapshot_to_pose_update );
+	AppendHistogram( out, "pose_publish_interval", pose_publish_interval );
+	AppendHistogram( out, "run_frame", run_frame );
+
+	if ( batch_histogram && batch_bins )
+	{
+		out += "event_batch_sizes";
+		for ( size_t i = 0; i < batch_bins; ++i )
+		{
+			const unsigned lo = i == 0 ? 1u : ( 1u << ( i - 1 ) ) + 1u;
+			const unsigned hi = 1u << i;
+			if ( lo == hi )
+				snprintf( line, sizeof( line ), " %u:%llu", lo, (unsigned long long)batch_histogram[ i ] );
+			else
+				snprintf( line, sizeof( line ), " %u-%u:%llu", lo, hi, (unsigned long long)batch_histogram[ i ] );
+			out += line;
+		}
+		out += "\n";
+	}
+	return out;
+}
@@ -0,0 +1,105 @@
+// Low-overhead hot-path instrumentation: counters and HDR-style latency histograms, served as
+// text through DebugRequest("stats").
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+inline int64_t StatsNowNs()
+{
+	return std::chrono::duration_cast< std::chrono::nanoseconds >( std::chrono::steady_clock::now().time_since_epoch() ).count();
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Log-linear latency histogram (nanoseconds). Values below 2^kSubBucketBits land in
+// exact buckets; above that every power of two is split into 2^kSubBucketBits linear
+// sub-buckets, so any percentile is reported within ~6% of the true value up to ~9 minutes.
+//
+// Each histogram has exactly one writer thread, which uses plain relaxed load/store instead of
+// locked read-modify-writes. Any thread may read or ask for a reset; the reset is carried out
+// by the writer on its next Record() so it never races with an increment.
+//-----------------------------------------------------------------------------
+class LatencyHistogram
+{
+public:
+	static constexpr int kSubBucketBits = 4;
+	static constexpr int kSubBuckets = 1 << kSubBucketBits;
+	static constexpr int kMaxExponent = 40; // 2^40 ns ~ 18 minutes
+	static constexpr int kBucketCount = ( kMaxExponent - kSubBucketBits + 2 ) * kSubBuckets;
+
+	void Record( int64_t value_ns );
+
+	// Readers: any thread
+	void RequestReset() { reset_requested_.store( true, std::memory_order_release ); }
+	uint64_t Count() const { return count_.load( std::memory_order_relaxed ); }
+	int64_t Max() const { return max_.load( std::memory_order_relaxed ); }
+	double Mean() const;
+	// p in [0, 1]; returns the upper edge of the bucket holding that quantile
+	int64_t Percentile( double p ) const;
+
+private:
+	static size_t BucketIndex( uint64_t v );
+	static uint64_t BucketUpperBound( size_t index );
+
+	std::array< std::atomic< uint64_t >, kBucketCount > buckets_{};
+	std::atomic< uint64_t > count_{ 0 };
+	std::atomic< uint64_t > sum_{ 0 };
+	std::atomic< int64_t > max_{ 0 };
+	std::atomic< bool > reset_requested_{ false };
+};
+
+//-----------------------------------------------------------------------------
+// Purpose: Single-writer event counter with the same deferred reset as LatencyHistogram.
+//-----------------------------------------------------------------------------
+class StatsCounter
+{
+public:
+	void Add( uint64_t n = 1 )
+	{
+		if ( reset_requested_.load( std::memory_order_relaxed ) && reset_requested_.exchange( false, std::memory_order_acquire ) )
+			value_.store( 0, std::memory_order_relaxed );
+		value_.store( value_.load( std::memory_order_relaxed ) + n, std::memory_order_relaxed );
+	}
+	uint64_t Value() const { return value_.load( std::memory_order_relaxed ); }
+	void RequestReset() { reset_requested_.store( true, std::memory_order_release ); }
+
+private:
+	std::atomic< uint64_t > value_{ 0 };
+	std::atomic< bool > reset_requested_{ false };
+};
+
+//-----------------------------------------------------------------------------
+// Purpose: Everything the driver measures on its hot paths, grouped by the thread that writes it.
+//-----------------------------------------------------------------------------
+struct DriverStats
+{
+	// RayNeo event thread
+	LatencyHistogram imu_tick_to_receive; // host arrival minus estimated sample time
+	LatencyHistogram poll_wait;           // time blocked inside Rayneo_PollEvent
+	LatencyHistogram integrate_sample;    // IntegrateImuBatch cost per sample (batch average)
+	StatsCounter imu_samples;
+	StatsCounter imu_invalid_samples;
+	StatsCounter other_events;
+	StatsCounter reconnects; // successful reconnects after a detach
+	StatsCounter external_poses;          // external tracker measurements fused
+	StatsCounter external_poses_rejected; // unalignable (too old, before the IMU history) or unused
+
+	// Pose thread
+	LatencyHistogram snapshot_to_pose_update; // snapshot arrival until TrackedDevicePoseUpdated returned
+	LatencyHistogram pose_publish_interval;   // between consecutive TrackedDevicePoseUpdated calls
+	StatsCounter pose_updates;
+
+	// vrserver main thread
+	LatencyHistogram run_frame; // MyDeviceProvider::RunFrame duration
+
+	std::chrono::steady_clock::time_point since = std::chrono::steady_clock::now();
+
+	void RequestReset();
+
+	// Human-readable multi-line report; batch_histogram is the event thread's batch size histogram
+	std::string Format( const uint64_t *batch_histogram, size_t batch_bins ) const;
+};
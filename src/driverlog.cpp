@@ -1,39 +1,217 @@
 //============ Copyright (c) Valve Corporation, All rights reserved. ============
 #include "driverlog.h"
+#include "thread_policy.h"
 
 #include <stdarg.h>
 #include <stdio.h>
 
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
 #if !defined( WIN32 )
 #define vsnprintf_s vsnprintf
 #endif
 
-static void DriverLogVarArgs( const char *pMsgFormat, va_list args )
+static constexpr char kLogPrefix[] = "[rayneo] ";
+
+static void DriverLogFormat( char *buf, size_t size, const char *pMsgFormat, va_list args )
 {
-	char buf[ 1024 ];
 #if defined( WIN32 )
-	int len = sprintf_s( buf, sizeof( buf ), "[rayneo] " );
-	if ( len > 0 && (size_t)len < sizeof( buf ) )
+	int len = sprintf_s( buf, size, kLogPrefix );
+	if ( len > 0 && (size_t)len < size )
 	{
-		vsnprintf_s( buf + len, sizeof( buf ) - len, _TRUNCATE, pMsgFormat, args );
+		vsnprintf_s( buf + len, size - len, _TRUNCATE, pMsgFormat, args );
 	}
 	else
 	{
-		vsnprintf_s( buf, sizeof( buf ), _TRUNCATE, pMsgFormat, args );
+		vsnprintf_s( buf, size, _TRUNCATE, pMsgFormat, args );
 	}
 #else
-	int len = snprintf( buf, sizeof( buf ), "[rayneo] " );
-	if ( len > 0 && (size_t)len < sizeof( buf ) )
+	int len = snprintf( buf, size, "%s", kLogPrefix );
+	if ( len > 0 && (size_t)len < size )
 	{
-		vsnprintf( buf + len, sizeof( buf ) - len, pMsgFormat, args );
+		vsnprintf( buf + len, size - len, pMsgFormat, args );
 	}
 	else
 	{
-		vsnprintf( buf, sizeof( buf ), pMsgFormat, args );
+		vsnprintf( buf, size, pMsgFormat, args );
 	}
 #endif
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Bounded multi-producer / single-consumer ring of fixed-size log records.
+// Each slot carries a sequence number (Vyukov-style): a producer claims a slot with one CAS on
+// the enqueue cursor, formats straight into it and publishes it by bumping the sequence. No
+// producer ever blocks or allocates; when the ring is full the line is counted and dropped.
+//-----------------------------------------------------------------------------
+namespace
+{
+	constexpr size_t kRecordSize = 512;
+	constexpr size_t kRingSize = 256; // power of two
+	constexpr size_t kRingMask = kRingSize - 1;
+
+	// Rate limiter: at most kRateBurst lines in flight per kRateWindow
+	constexpr uint32_t kRateBurst = 200;
+	constexpr auto kRateWindow = std::chrono::seconds( 1 );
+
+	constexpr auto kFlushInterval = std::chrono::milliseconds( 20 );
+
+	struct LogRecord
+	{
+		std::atomic< size_t > sequence{ 0 };
+		char text[ kRecordSize ];
+	};
+
+	struct AsyncLogState
+	{
+		std::array< LogRecord, kRingSize > ring;
+		alignas( 64 ) std::atomic< size_t > enqueue_pos{ 0 };
+		alignas( 64 ) size_t dequeue_pos = 0; // flusher thread only (see DrainRing)
+
+		std::atomic< bool > running{ false };
+		std::thread flusher;
+		std::mutex wake_mutex;
+		std::condition_variable wake_cv;
+
+		std::atomic< int64_t > rate_window_start{ 0 };
+		std::atomic< uint32_t > rate_window_count{ 0 };
 
+		std::atomic< uint64_t > written{ 0 };
+		std::atomic< uint64_t > dropped_full{ 0 };
+		std::atomic< uint64_t > dropped_rate{ 0 };
+
+		AsyncLogState()
+		{
+			for ( size_t i = 0; i < kRingSize; ++i )
+				ring[ i ].sequence.store( i, std::memory_order_relaxed );
+		}
+	};
+
+	AsyncLogState g_log;
+
+	bool RateLimitAllows()
+	{
+		const int64_t now = std::chrono::duration_cast< std::chrono::nanoseconds >( std::chrono::steady_clock::now().time_since_epoch() ).count();
+		int64_t start = g_log.rate_window_start.load( std::memory_order_relaxed );
+		if ( now - start >= std::chrono::duration_cast< std::chrono::nanoseconds >( kRateWindow ).count() )
+		{
+			// Whoever wins the CAS opens the new window; losers just count into it
+			if ( g_log.rate_window_start.compare_exchange_strong( start, now, std::memory_order_relaxed ) )
+				g_log.rate_window_count.store( 0, std::memory_order_relaxed );
+		}
+		return g_log.rate_window_count.fetch_add( 1, std::memory_order_relaxed ) < kRateBurst;
+	}
+
+	bool TryEnqueue( const char *pMsgFormat, va_list args )
+	{
+		size_t pos = g_log.enqueue_pos.load( std::memory_order_relaxed );
+		for ( ;; )
+		{
+			LogRecord &rec = g_log.ring[ pos & kRingMask ];
+			const size_t seq = rec.sequence.load( std::memory_order_acquire );
+			const intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+			if ( diff == 0 )
+			{
+				if ( g_log.enqueue_pos.compare_exchange_weak( pos, pos + 1, std::memory_order_relaxed ) )
+				{
+					DriverLogFormat( rec.text, sizeof( rec.text ), pMsgFormat, args );
+					rec.sequence.store( pos + 1, std::memory_order_release );
+
+					// Wake the flusher once per half ring so a burst cannot overrun it between
+					// ticks; every other line is picked up on the next tick without a syscall
+					if ( ( pos & ( kRingSize / 2 - 1 ) ) == 0 )
+						g_log.wake_cv.notify_one();
+					return true;
+				}
+			}
+			else if ( diff < 0 )
+			{
+				return false; // full
+			}
+			else
+			{
+				pos = g_log.enqueue_pos.load( std::memory_order_relaxed );
+			}
+		}
+	}
+
+	// Flusher thread only (or DriverLogStopAsync once the flusher has exited)
+	size_t DrainRing()
+	{
+		size_t count = 0;
+		for ( ;; )
+		{
+			LogRecord &rec = g_log.ring[ g_log.dequeue_pos & kRingMask ];
+			const size_t seq = rec.sequence.load( std::memory_order_acquire );
+			if ( seq != g_log.dequeue_pos + 1 )
+				break; // empty, or the producer is still formatting this slot
+
+			vr::VRDriverLog()->Log( rec.text );
+			rec.sequence.store( g_log.dequeue_pos + kRingSize, std::memory_order_release );
+			++g_log.dequeue_pos;
+			++count;
+		}
+		g_log.written.fetch_add( count, std::memory_order_relaxed );
+		return count;
+	}
+
+	void ReportDrops( uint64_t &reported_full, uint64_t &reported_rate )
+	{
+		const uint64_t full = g_log.dropped_full.load( std::memory_order_relaxed );
+		const uint64_t rate = g_log.dropped_rate.load( std::memory_order_relaxed );
+		if ( full == reported_full && rate == reported_rate )
+			return;
+
+		char buf[ 160 ];
+		snprintf( buf, sizeof( buf ), "%s[log] Dropped %llu line(s): %llu ring full, %llu rate limited", kLogPrefix,
+			(unsigned long long)( ( full - reported_full ) + ( rate - reported_rate ) ),
+			(unsigned long long)( full - reported_full ), (unsigned long long)( rate - reported_rate ) );
+		vr::VRDriverLog()->Log( buf );
+		reported_full = full;
+		reported_rate = rate;
+	}
+
+	void FlusherLoop()
+	{
+		SetCurrentThreadName( "rayneo-log" );
+		uint64_t reported_full = 0;
+		uint64_t reported_rate = 0;
+		while ( g_log.running.load( std::memory_order_acquire ) )
+		{
+			DrainRing();
+			ReportDrops( reported_full, reported_rate );
+
+			std::unique_lock< std::mutex > lock( g_log.wake_mutex );
+			g_log.wake_cv.wait_for( lock, kFlushInterval );
+		}
+		DrainRing();
+		ReportDrops( reported_full, reported_rate );
+	}
+}
+
+static void DriverLogVarArgs( const char *pMsgFormat, va_list args )
+{
+	if ( g_log.running.load( std::memory_order_acquire ) )
+	{
+		if ( !RateLimitAllows() )
+		{
+			g_log.dropped_rate.fetch_add( 1, std::memory_order_relaxed );
+			return;
+		}
+		if ( !TryEnqueue( pMsgFormat, args ) )
+			g_log.dropped_full.fetch_add( 1, std::memory_order_relaxed );
+		return;
+	}
+
+	char buf[ 1024 ];
+	DriverLogFormat( buf, sizeof( buf ), pMsgFormat, args );
 	vr::VRDriverLog()->Log( buf );
+	g_log.written.fetch_add( 1, std::memory_order_relaxed );
 }
 
 
@@ -59,3 +237,42 @@ void DebugDriverLog( const char *pMsgFormat, ... )
 	va_end( args );
 #endif
 }
+
+
+void DriverLogStartAsync()
+{
+	if ( g_log.running.exchange( true, std::memory_order_acq_rel ) )
+		return;
+	g_log.flusher = std::thread( FlusherLoop );
+}
+
+
+void DriverLogStopAsync()
+{
+	if ( !g_log.running.exchange( false, std::memory_order_acq_rel ) )
+		return;
+	g_log.wake_cv.notify_one();
+	if ( g_log.flusher.joinable() )
+		g_log.flusher.join();
+
+	// A producer that saw running just before the exchange may have enqueued after the flusher's
+	// last drain: write those lines here, giving slots still being formatted a moment to land
+	const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds( 50 );
+	for ( ;; )
+	{
+		DrainRing();
+		if ( g_log.dequeue_pos == g_log.enqueue_pos.load( std::memory_order_acquire ) || std::chrono::steady_clock::now() >= deadline )
+			break;
+		std::this_thread::yield();
+	}
+}
+
+
+DriverLogStats DriverLogGetStats()
+{
+	DriverLogStats stats;
+	stats.written = g_log.written.load( std::memory_order_relaxed );
+	stats.dropped_full = g_log.dropped_full.load( std::memory_order_relaxed );
+	stats.dropped_rate = g_log.dropped_rate.load( std::memory_order_relaxed );
+	return stats;
+}
@@ -1,9 +1,25 @@
 //============ Copyright (c) Valve Corporation, All rights reserved. ============
 #pragma once
 
+#include <cstdint>
 #include <string>
 #include <openvr_driver.h>
 
 extern void DriverLog( const char *pchFormat, ... );
 
-extern void DebugDriverLog( const char *pchFormat, ... );
\ No newline at end of file
+extern void DebugDriverLog( const char *pchFormat, ... );
+
+// Once started, DriverLog only formats into a ring slot and returns; a background thread hands
+// the lines to IVRDriverLog. Before DriverLogStartAsync and after DriverLogStopAsync logging is
+// synchronous, so startup and shutdown messages are never lost.
+extern void DriverLogStartAsync();
+extern void DriverLogStopAsync();
+
+struct DriverLogStats
+{
+	uint64_t written = 0;      // lines handed to IVRDriverLog
+	uint64_t dropped_full = 0; // lines discarded because the ring was full
+	uint64_t dropped_rate = 0; // lines discarded by the rate limiter
+};
+
+extern DriverLogStats DriverLogGetStats();
@@ -0,0 +1,240 @@
+#include "edid_parser.h"
+#include "display_edid_finder.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+constexpr size_t kBlockSize = 128;
+
+bool BlockChecksumOk(const uint8_t* block) {
+    uint8_t sum = 0;
+    for (size_t i = 0; i < kBlockSize; ++i) sum = static_cast<uint8_t>(sum + block[i]);
+    return sum == 0;
+}
+
+// 18-byte detailed timing descriptor; false for display descriptors (pixel clock 0)
+bool DecodeDtd(const uint8_t* d, EdidTimingSource source, EdidTiming& t) {
+    const uint32_t clock_10khz = d[0] | (d[1] << 8);
+    if (clock_10khz == 0) return false;
+    t = EdidTiming{};
+    t.source = source;
+    t.pixel_clock_khz = clock_10khz * 10;
+    t.h_active = static_cast<uint16_t>(d[2] | ((d[4] & 0xF0) << 4));
+    t.h_blank = static_cast<uint16_t>(d[3] | ((d[4] & 0x0F) << 8));
+    t.v_active = static_cast<uint16_t>(d[5] | ((d[7] & 0xF0) << 4));
+    t.v_blank = static_cast<uint16_t>(d[6] | ((d[7] & 0x0F) << 8));
+    t.h_front_porch = static_cast<uint16_t>(d[8] | ((d[11] & 0xC0) << 2));
+    t.h_sync_width = static_cast<uint16_t>(d[9] | ((d[11] & 0x30) << 4));
+    t.v_front_porch = static_cast<uint16_t>((d[10] >> 4) | ((d[11] & 0x0C) << 2));
+    t.v_sync_width = static_cast<uint16_t>((d[10] & 0x0F) | ((d[11] & 0x03) << 4));
+    t.interlaced = (d[17] & 0x80) != 0;
+    return t.h_active != 0 && t.v_active != 0;
+}
+
+// Progressive CTA-861 formats likely to show up on glasses and monitors. Porches are not needed
+// for the refresh rate, so only the totals are kept.
+struct VicFormat { uint8_t vic; uint16_t h_active, v_active, h_total, v_total; uint32_t clock_khz; };
+constexpr VicFormat kVicFormats[] = {
+    {1, 640, 480, 800, 525, 25175},
+    {2, 720, 480, 858, 525, 27000},
+    {3, 720, 480, 858, 525, 27000},
+    {4, 1280, 720, 1650, 750, 74250},
+    {16, 1920, 1080, 2200, 1125, 148500},
+    {17, 720, 576, 864, 625, 27000},
+    {18, 720, 576, 864, 625, 27000},
+    {19, 1280, 720, 1980, 750, 74250},
+    {31, 1920, 1080, 2640, 1125, 148500},
+    {32, 1920, 1080, 2750, 1125, 74250},
+    {33, 1920, 1080, 2640, 1125, 74250},
+    {34, 1920, 1080, 2200, 1125, 74250},
+    {41, 1280, 720, 1980, 750, 148500},
+    {47, 1280, 720, 1650, 750, 148500},
+    {60, 1280, 720, 3300, 750, 59400},
+    {61, 1280, 720, 3960, 750, 74250},
+    {62, 1280, 720, 3300, 750, 74250},
+    {63, 1920, 1080, 2200, 1125, 297000},
+    {64, 1920, 1080, 2640, 1125, 297000},
+    {93, 3840, 2160, 5500, 2250, 297000},
+    {94, 3840, 2160, 5280, 2250, 297000},
+    {95, 3840, 2160, 4400, 2250, 297000},
+    {96, 3840, 2160, 5280, 2250, 594000},
+    {97, 3840, 2160, 4400, 2250, 594000},
+};
+
+bool ExpandVic(uint8_t vic, EdidTiming& t) {
+    for (const auto& f : kVicFormats) {
+        if (f.vic != vic) continue;
+        t = EdidTiming{};
+        t.source = EdidTimingSource::CtaVic;
+        t.pixel_clock_khz = f.clock_khz;
+        t.h_active = f.h_active;
+        t.h_blank = static_cast<uint16_t>(f.h_total - f.h_active);
+        t.v_active = f.v_active;
+        t.v_blank = static_cast<uint16_t>(f.v_total - f.v_active);
+        return true;
+    }
+    return false;
+}
+
+void ParseCtaExtension(const uint8_t* block, std::vector<EdidTiming>& out) {
+    const uint8_t dtd_offset = block[2];
+    if (dtd_offset < 4 || dtd_offset > kBlockSize - 1) return;
+
+    // Data block collection: bytes 4 .. dtd_offset-1
+    for (size_t i = 4; i < dtd_offset;) {
+        const uint8_t tag = block[i] >> 5;
+        const uint8_t len = block[i] & 0x1F;
+        if (i + 1 + len > dtd_offset) break;
+        if (tag == 2) { // video data block
+            for (size_t j = 0; j < len; ++j) {
+                const uint8_t svd = block[i + 1 + j];
+                // 129..192 are VICs 1..64 with the native flag; everything else is the VIC itself
+                const uint8_t vic = (svd >= 129 && svd <= 192) ? static_cast<uint8_t>(svd & 0x7F) : svd;
+                EdidTiming t;
+                if (ExpandVic(vic, t)) out.push_back(t);
+            }
+        }
+        i += 1 + len;
+    }
+
+    for (size_t i = dtd_offset; i + 18 <= kBlockSize - 1; i += 18) {
+        EdidTiming t;
+        if (!DecodeDtd(block + i, EdidTimingSource::CtaDtd, t)) break;
+        out.push_back(t);
+    }
+}
+
+uint16_t Le16Plus1(const uint8_t* p, uint16_t mask = 0xFFFF) {
+    return static_cast<uint16_t>(((p[0] | (p[1] << 8)) & mask) + 1);
+}
+
+// DisplayID Type I (tag 0x03, 10 kHz clock units) and Type VII (tag 0x22, 1 kHz units)
+// detailed timings; both store every field as value - 1
+void ParseDisplayIdExtension(const uint8_t* block, std::vector<EdidTiming>& out) {
+    // Section header follows the extension tag: version, payload bytes, product type, extension count
+    const size_t payload = block[2];
+    const size_t end = std::min<size_t>(5 + payload, kBlockSize - 1);
+    for (size_t i = 5; i + 3 <= end;) {
+        const uint8_t tag = block[i];
+        const uint8_t len = block[i + 2];
+        if (tag == 0 || i + 3 + len > end) break;
+        if (tag == 0x03 || tag == 0x22) {
+            const uint32_t clock_unit_khz = tag == 0x03 ? 10 : 1;
+            for (size_t j = 0; j + 20 <= len; j += 20) {
+                const uint8_t* d = block + i + 3 + j;
+                EdidTiming t;
+                t.source = EdidTimingSource::DisplayId;
+                t.pixel_clock_khz = ((d[0] | (d[1] << 8) | (d[2] << 16)) + 1) * clock_unit_khz;
+                t.preferred = (d[3] & 0x80) != 0;
+                t.interlaced = (d[3] & 0x10) != 0;
+                t.h_active = Le16Plus1(d + 4);
+                t.h_blank = Le16Plus1(d + 6);
+                t.h_front_porch = Le16Plus1(d + 8, 0x7FFF); // bit 15 is sync polarity
+                t.h_sync_width = Le16Plus1(d + 10);
+                t.v_active = Le16Plus1(d + 12);
+                t.v_blank = Le16Plus1(d + 14);
+                t.v_front_porch = Le16Plus1(d + 16, 0x7FFF);
+                t.v_sync_width = Le16Plus1(d + 18);
+                out.push_back(t);
+            }
+        }
+        i += 3 + len;
+    }
+}
+
+bool SameMode(const EdidTiming& a, const EdidTiming& b) {
+    return a.h_active == b.h_active && a.v_active == b.v_active && a.interlaced == b.interlaced &&
+           std::fabs(a.RefreshHz() - b.RefreshHz()) < 0.01;
+}
+
+} // namespace
+
+uint16_t DecodeManufacturerId(uint16_t raw) {
+    uint16_t be = (raw >> 8) | ((raw & 0xFF) << 8);
+    char c1 = ((be >> 10) & 0x1F) + 64; (void)c1;
+    char c2 = ((be >> 5) & 0x1F) + 64; (void)c2;
+    char c3 = (be & 0x1F) + 64; (void)c3;
+    return be;
+}
+
+std::string ExtractMonitorName(const uint8_t* edid, size_t len) {
+    if (len < 128) return {};
+    for (size_t i = 54; i + 18 <= 126; i += 18) {
+        const uint8_t* block = edid + i;
+        if (block[0] == 0x00 && block[1] == 0x00 && block[2] == 0x00 && block[3] == 0xFC) {
+            char name[14] = {0};
+            size_t copyLen = 13;
+            for (size_t j = 5, k = 0; j < 18 && k < copyLen; ++j) {
+                char c = static_cast<char>(block[j]);
+                if (c == '\n' || c == '\r') break;
+                name[k++] = c;
+            }
+            std::string s(name);
+            while (!s.empty() && s.back() == ' ') s.pop_back();
+            return s;
+        }
+    }
+    return {};
+}
+
+std::vector<EdidTiming> ParseEdidTimings(const uint8_t* edid, size_t len) {
+    std::vector<EdidTiming> all;
+    if (!edid || len < kBlockSize) return all;
+
+    // Base block: up to four DTDs; the first one is the preferred timing (mandatory since EDID 1.4)
+    for (size_t i = 54; i + 18 <= 126; i += 18) {
+        EdidTiming t;
+        if (!DecodeDtd(edid + i, EdidTimingSource::BaseDtd, t)) continue;
+        t.preferred = all.empty();
+        all.push_back(t);
+    }
+
+    for (size_t off = kBlockSize; off + kBlockSize <= len; off += kBlockSize) {
+        const uint8_t* block = edid + off;
+        if (!BlockChecksumOk(block)) continue;
+        if (block[0] == 0x02) ParseCtaExtension(block, all);
+        else if (block[0] == 0x70) ParseDisplayIdExtension(block, all);
+    }
+
+    std::stable_partition(all.begin(), all.end(), [](const EdidTiming& t) { return t.preferred; });
+    std::vector<EdidTiming> unique;
+    for (const auto& t : all) {
+        if (std::none_of(unique.begin(), unique.end(), [&](const EdidTiming& u) { return SameMode(u, t); })) {
+            unique.push_back(t);
+        }
+    }
+    return unique;
+}
+
+DisplayEdidInfo ParseEdid(const std::string& instanceId, const std::vector<uint8_t>& edid) {
+    DisplayEdidInfo info; info.device_instance_id = instanceId;
+    info.raw_edid = edid;
+    if (edid.size() >= 128) {
+        info.manufacturer_id = DecodeManufacturerId(static_cast<uint16_t>((edid[8] << 8) | edid[9]));
+        info.product_code = static_cast<uint16_t>(edid[10] | (edid[11] << 8));
+        info.serial_number = (edid[12]) | (edid[13] << 8) | (edid[14] << 16) | (edid[15] << 24);
+        info.week_of_manufacture = edid[16];
+        info.year_of_manufacture = 1990 + edid[17];
+        info.monitor_name = ExtractMonitorName(edid.data(), edid.size());
+
+        info.timings = ParseEdidTimings(edid.data(), edid.size());
+        if (!info.timings.empty()) {
+            const EdidTiming& preferred = info.timings.front();
+            info.preferred_width = preferred.h_active;
+            info.preferred_height = preferred.v_active;
+            info.preferred_refresh_hz = preferred.RefreshHz();
+        }
+    }
+    return info;
+}
+
+const EdidTiming* FindEdidTiming(const std::vector<EdidTiming>& timings, uint32_t width, uint32_t height, double target_hz) {
+    const EdidTiming* best = nullptr;
+    for (const auto& t : timings) {
+        if (t.h_active != width || t.v_active != height || t.interlaced) continue;
+        if (!best || std::fabs(t.RefreshHz() - target_hz) < std::fabs(best->RefreshHz() - target_hz)) best = &t;
+    }
+    return best;
+}
@@ -0,0 +1,56 @@
+// EDID 1.x decoding: identity, monitor name and every detailed timing (base block DTDs,
+// CTA-861 extension DTDs and VICs, DisplayID Type I / Type VII timings)
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+struct DisplayEdidInfo;
+
+enum class EdidTimingSource : uint8_t {
+    BaseDtd,      // detailed timing descriptor in the 128-byte base block
+    CtaDtd,       // detailed timing descriptor in a CTA-861 extension
+    CtaVic,       // CTA-861 short video descriptor, expanded from the VIC table
+    DisplayId,    // DisplayID Type I (1.x) or Type VII (2.x) detailed timing
+};
+
+struct EdidTiming {
+    uint32_t pixel_clock_khz = 0;
+    uint16_t h_active = 0;
+    uint16_t h_blank = 0;
+    uint16_t h_front_porch = 0; // 0 when the source does not carry porches (VIC table)
+    uint16_t h_sync_width = 0;
+    uint16_t v_active = 0;      // lines per field when interlaced
+    uint16_t v_blank = 0;
+    uint16_t v_front_porch = 0;
+    uint16_t v_sync_width = 0;
+    bool interlaced = false;
+    bool preferred = false;     // the sink's preferred / native mode
+    EdidTimingSource source = EdidTimingSource::BaseDtd;
+
+    uint32_t HTotal() const { return uint32_t(h_active) + h_blank; }
+    uint32_t VTotal() const { return uint32_t(v_active) + v_blank; }
+    // Exact vertical refresh (field rate when interlaced) from pixel clock and totals; 0 if unknown
+    double RefreshHz() const {
+        const double total = double(HTotal()) * double(VTotal());
+        return total > 0.0 ? pixel_clock_khz * 1000.0 / total : 0.0;
+    }
+};
+
+// Packs the big-endian PNP id from EDID bytes 8..9
+uint16_t DecodeManufacturerId(uint16_t raw);
+
+// Display product name descriptor (0xFC) from the base block, trailing spaces trimmed
+std::string ExtractMonitorName(const uint8_t* edid, size_t len);
+
+// All timings in the blob, preferred first, duplicates (same size and refresh) removed.
+// Extension blocks with a bad checksum are skipped.
+std::vector<EdidTiming> ParseEdidTimings(const uint8_t* edid, size_t len);
+
+// Identity, name, preferred mode and full timing list
+DisplayEdidInfo ParseEdid(const std::string& instanceId, const std::vector<uint8_t>& edid);
+
+// Timing with the given active size whose refresh is nearest to target_hz; nullptr if none
+const EdidTiming* FindEdidTiming(const std::vector<EdidTiming>& timings, uint32_t width, uint32_t height, double target_hz);
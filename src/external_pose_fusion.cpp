@@ -0,0 +1,153 @@
+#include "external_pose_fusion.h"
+
+#include <cmath>
+
+namespace
+{
+	constexpr float kPi = 3.14159265358979323846f;
+
+	ImuQuat YawRotation( float radians )
+	{
+		return { std::cos( radians * 0.5f ), 0.f, std::sin( radians * 0.5f ), 0.f };
+	}
+
+	// Blend factor for a measurement dt seconds after the previous one; snaps after a gap
+	float Gain( int64_t time_ns, int64_t last_ns, float time_constant, float resync_gap )
+	{
+		if ( last_ns == 0 || time_constant <= 0.f )
+			return 1.f;
+		const float dt = static_cast< float >( time_ns - last_ns ) * 1e-9f;
+		if ( dt > resync_gap )
+			return 1.f;
+		if ( !( dt > 0.f ) )
+			return 0.f; // out of order: already covered by a newer measurement
+		return dt / ( time_constant + dt );
+	}
+}
+
+void ExternalPoseFusion::RecordEstimate( const PoseSnapshot &snap )
+{
+	if ( !snap.valid )
+		return;
+	if ( history_count_ > 0 )
+	{
+		const Estimate &newest = history_[ ( history_head_ + kHistory - 1 ) % kHistory ];
+		if ( snap.sample_host_time_ns <= newest.time_ns )
+			return;
+	}
+
+	Estimate &e = history_[ history_head_ ];
+	e.time_ns = snap.sample_host_time_ns;
+	e.orientation = { snap.q_w, snap.q_x, snap.q_y, snap.q_z };
+	e.yaw_total = yaw_total_;
+	for ( int i = 0; i < 3; ++i )
+	{
+		e.position[ i ] = snap.position[ i ];
+		e.position_total[ i ] = position_total_[ i ];
+	}
+	history_head_ = ( history_head_ + 1 ) % kHistory;
+	if ( history_count_ < kHistory )
+		++history_count_;
+}
+
+bool ExternalPoseFusion::Lookup( int64_t time_ns, Estimate &out ) const
+{
+	if ( history_count_ == 0 )
+		return false;
+
+	// Newest first: measurements are normally only a few dozen estimates old
+	size_t newer = ( history_head_ + kHistory - 1 ) % kHistory;
+	if ( time_ns >= history_[ newer ].time_ns )
+	{
+		out = history_[ newer ];
+		return true;
+	}
+	for ( size_t n = 1; n < history_count_; ++n )
+	{
+		const size_t older = ( history_head_ + kHistory - 1 - n ) % kHistory;
+		const Estimate &a = history_[ older ];
+		if ( a.time_ns <= time_ns )
+		{
+			// Interpolate between the two estimates around the measurement time
+			const Estimate &b = history_[ newer ];
+			const float f = static_cast< float >( time_ns - a.time_ns ) / static_cast< float >( b.time_ns - a.time_ns );
+			ImuQuat qb = b.orientation;
+			if ( QuatDot( a.orientation, qb ) < 0.f )
+				qb = { -qb.w, -qb.x, -qb.y, -qb.z };
+			out = a;
+			out.time_ns = time_ns;
+			out.orientation = QuatNormalizeFast( { a.orientation.w + f * ( qb.w - a.orientation.w ), a.orientation.x + f * ( qb.x - a.orientation.x ),
+				a.orientation.y + f * ( qb.y - a.orientation.y ), a.orientation.z + f * ( qb.z - a.orientation.z ) } );
+			for ( int i = 0; i < 3; ++i )
+				out.position[ i ] = a.position[ i ] + f * ( b.position[ i ] - a.position[ i ] );
+			return true;
+		}
+		newer = older;
+	}
+	return false; // older than the whole history
+}
+
+bool ExternalPoseFusion::Fuse( const ExternalPoseRecord &rec, int64_t receive_ns, ExternalPoseCorrection &out )
+{
+	out = {};
+	const int64_t time_ns = rec.host_time_ns != 0 ? rec.host_time_ns : receive_ns - static_cast< int64_t >( params_.latency * 1e9f );
+	Estimate est;
+	if ( receive_ns - time_ns > static_cast< int64_t >( params_.max_age * 1e9f ) || !Lookup( time_ns, est ) )
+	{
+		++rejected_;
+		return false;
+	}
+
+	if ( params_.use_yaw && ( rec.flags & kExternalPoseHasOrientation ) )
+	{
+		const ImuQuat ext = QuatNormalizeFast( { rec.orientation[ 0 ], rec.orientation[ 1 ], rec.orientation[ 2 ], rec.orientation[ 3 ] } );
+		// The estimate as it would read with every correction applied since it was recorded
+		const ImuQuat then = QuatMultiply( YawRotation( yaw_total_ - est.yaw_total ), est.orientation );
+		// Remaining error, left-multiplied (driver space); only its twist about Y is unobservable to the IMU
+		const ImuQuat e = QuatMultiply( ext, QuatConjugate( then ) );
+		float yaw = 2.f * std::atan2( e.y, e.w );
+		if ( yaw > kPi )
+			yaw -= 2.f * kPi;
+		else if ( yaw < -kPi )
+			yaw += 2.f * kPi;
+		last_yaw_error_ = yaw;
+
+		out.yaw = Gain( time_ns, last_yaw_time_ns_, params_.yaw_time_constant, params_.resync_gap ) * yaw;
+		out.has_yaw = true;
+		yaw_total_ += out.yaw;
+		last_yaw_time_ns_ = time_ns;
+	}
+
+	if ( params_.use_position && ( rec.flags & kExternalPoseHasPosition ) )
+	{
+		const float k = Gain( time_ns, last_position_time_ns_, params_.position_time_constant, params_.resync_gap );
+		float err2 = 0.f;
+		for ( int i = 0; i < 3; ++i )
+		{
+			const float then = est.position[ i ] + ( position_total_[ i ] - est.position_total[ i ] );
+			const float err = rec.position[ i ] - then;
+			err2 += err * err;
+			out.position[ i ] = k * err;
+			position_total_[ i ] += out.position[ i ];
+		}
+		last_position_error_ = std::sqrt( err2 );
+		out.has_position = true;
+		last_position_time_ns_ = time_ns;
+	}
+
+	if ( !out.has_yaw && !out.has_position )
+	{
+		++rejected_;
+		return false;
+	}
+	++accepted_;
+	return true;
+}
+
+void ExternalPoseFusion::Reset()
+{
+	history_count_ = 0;
+	history_head_ = 0;
+	last_yaw_time_ns_ = 0;
+	last_position_time_ns_ = 0;
+}
@@ -0,0 +1,97 @@
+// Time alignment and correction gains for external tracker poses (see external_pose_source.h).
+// Headless like TrackingPipeline; the driver applies the corrections it computes to the pipeline.
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "external_pose_source.h"
+#include "imu_math.h"
+#include "pose_snapshot.h"
+
+struct ExternalPoseFusionParams
+{
+	bool use_yaw = true;
+	bool use_position = true;
+	// Time constants (seconds) of the pull toward the external yaw / position; first sample snaps
+	float yaw_time_constant = 1.0f;
+	float position_time_constant = 0.25f;
+	// Measurement age to assume for unstamped records (host_time_ns == 0), and the oldest
+	// measurement still worth aligning (seconds)
+	float latency = 0.03f;
+	float max_age = 0.5f;
+	// Gap (seconds) after which the next measurement snaps instead of blending
+	float resync_gap = 1.0f;
+};
+
+// What one external measurement asks of the pipeline
+struct ExternalPoseCorrection
+{
+	float yaw = 0.f;                            // radians about driver-space Y, left-multiplied
+	float position[ 3 ] = { 0.f, 0.f, 0.f };   // meters, driver space
+	bool has_yaw = false;
+	bool has_position = false;
+};
+
+//-----------------------------------------------------------------------------
+// Purpose: Latency compensation. The tracker reports where the head was when its camera saw
+// it, tens of milliseconds ago; comparing that with the current IMU pose would fight every
+// head turn. So each published IMU snapshot is remembered together with its sample time (the
+// IMU tick mapped onto the host clock) and the corrections applied so far. A measurement is
+// compared with the IMU estimate interpolated at its own timestamp, re-expressed through the
+// corrections applied since, and only the remaining error is blended in.
+// Constant time per call (the history is a fixed ring), single threaded.
+//-----------------------------------------------------------------------------
+class ExternalPoseFusion
+{
+public:
+	explicit ExternalPoseFusion( const ExternalPoseFusionParams &params = {} ) : params_( params ) {}
+
+	void SetParams( const ExternalPoseFusionParams &params ) { params_ = params; }
+
+	// After every published snapshot (snap.sample_host_time_ns is the alignment key)
+	void RecordEstimate( const PoseSnapshot &snap );
+
+	// Returns false if the record cannot be aligned (too old, no history yet, nothing used);
+	// otherwise out holds the correction to apply now
+	bool Fuse( const ExternalPoseRecord &rec, int64_t receive_ns, ExternalPoseCorrection &out );
+
+	// Recenter or a long IMU gap: history no longer describes the current frame
+	void Reset();
+
+	uint64_t Accepted() const { return accepted_; }
+	uint64_t Rejected() const { return rejected_; }
+	// Last yaw / position error seen before blending (diagnostics)
+	float LastYawError() const { return last_yaw_error_; }
+	float LastPositionError() const { return last_position_error_; }
+
+private:
+	struct Estimate
+	{
+		int64_t time_ns;
+		ImuQuat orientation;
+		float position[ 3 ];
+		// Corrections applied up to this estimate
+		float yaw_total;
+		float position_total[ 3 ];
+	};
+
+	bool Lookup( int64_t time_ns, Estimate &out ) const;
+
+	ExternalPoseFusionParams params_;
+
+	static constexpr size_t kHistory = 512; // > 0.5 s at the IMU's 1 kHz batch rate
+	Estimate history_[ kHistory ];
+	size_t history_count_ = 0;
+	size_t history_head_ = 0; // next write
+
+	float yaw_total_ = 0.f;
+	float position_total_[ 3 ] = { 0.f, 0.f, 0.f };
+	int64_t last_yaw_time_ns_ = 0;
+	int64_t last_position_time_ns_ = 0;
+
+	uint64_t accepted_ = 0;
+	uint64_t rejected_ = 0;
+	float last_yaw_error_ = 0.f;
+	float last_position_error_ = 0.f;
+};
@@ -0,0 +1,294 @@
+#ifdef _WIN32
+#define NOMINMAX
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#include <windows.h>
+#else
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "external_pose_source.h"
+
+#include "driverlog.h"
+
+#include <cstring>
+
+namespace
+{
+	constexpr int64_t kRemapIntervalNs = 1000000000;
+	// A ring that has not advanced for this long may belong to a producer that restarted
+	// and created a new mapping; drop ours so the next attempt picks the new one up
+	constexpr int64_t kRingStaleNs = 2000000000;
+
+	bool ValidRecord( const ExternalPoseRecord &rec )
+	{
+		return rec.magic == kExternalPoseMagic && ( rec.flags & ( kExternalPoseHasPosition | kExternalPoseHasOrientation ) ) != 0;
+	}
+}
+
+void ExternalPoseSource::Open( const ExternalPoseSourceConfig &config )
+{
+	Close();
+	config_ = config;
+	open_ = true;
+	if ( config_.udp_port > 0 )
+		BindUdp();
+	DriverLog( "[external] pose input: ring \"%s\", udp %s:%d%s", config_.ring_name.c_str(), config_.udp_address.c_str(), config_.udp_port,
+		config_.udp_port > 0 && !UdpBound() ? " (bind failed)" : "" );
+}
+
+void ExternalPoseSource::Close()
+{
+	UnmapRing();
+	CloseUdp();
+	open_ = false;
+}
+
+size_t ExternalPoseSource::Poll( ExternalPoseRecord *out, int64_t *receive_ns_out, size_t max, int64_t now_ns )
+{
+	if ( !open_ || max == 0 )
+		return 0;
+
+	if ( !ring_ && !config_.ring_name.empty() && now_ns - last_map_attempt_ns_ >= kRemapIntervalNs )
+	{
+		last_map_attempt_ns_ = now_ns;
+		if ( MapRing() )
+		{
+			last_ring_data_ns_ = now_ns;
+			DriverLog( "[external] mapped pose ring \"%s\" (%u slots)", config_.ring_name.c_str(), capacity_ );
+		}
+	}
+
+	size_t count = 0;
+	if ( ring_ )
+	{
+		count = PollRing( out, receive_ns_out, max, now_ns );
+		if ( count > 0 )
+			last_ring_data_ns_ = now_ns;
+		else if ( now_ns - last_ring_data_ns_ > kRingStaleNs )
+			UnmapRing();
+	}
+	if ( count < max && UdpBound() )
+		count += PollUdp( out + count, receive_ns_out ? receive_ns_out + count : nullptr, max - count, now_ns );
+	return count;
+}
+
+size_t ExternalPoseSource::PollRing( ExternalPoseRecord *out, int64_t *receive_ns_out, size_t max, int64_t now_ns )
+{
+	const uint64_t written = ring_->write_count.load( std::memory_order_acquire );
+	if ( written < read_count_ )
+		read_count_ = written; // producer restarted its count in place
+	if ( written - read_count_ > capacity_ )
+	{
+		overruns_ += written - read_count_ - capacity_;
+		read_count_ = written - capacity_;
+	}
+
+	size_t count = 0;
+	while ( count < max && read_count_ < written )
+	{
+		const ExternalPoseRingSlot &slot = slots_[ read_count_ & ( capacity_ - 1 ) ];
+		const uint32_t before = slot.sequence.load( std::memory_order_acquire );
+		if ( before & 1u )
+			break; // mid-write; picked up on the next poll
+
+		uint64_t words[ sizeof( ExternalPoseRecord ) / sizeof( uint64_t ) ];
+		for ( size_t i = 0; i < sizeof( words ) / sizeof( words[ 0 ] ); ++i )
+			words[ i ] = slot.words[ i ].load( std::memory_order_relaxed );
+		std::atomic_thread_fence( std::memory_order_acquire );
+		if ( slot.sequence.load( std::memory_order_relaxed ) != before )
+		{
+			// Overwritten while we copied: the producer lapped us, skip ahead on the next poll
+			++overruns_;
+			++read_count_;
+			continue;
+		}
+		++read_count_;
+
+		std::memcpy( &out[ count ], words, sizeof( ExternalPoseRecord ) );
+		if ( !ValidRecord( out[ count ] ) )
+		{
+			++malformed_;
+			continue;
+		}
+		if ( receive_ns_out )
+			receive_ns_out[ count ] = now_ns;
+		++count;
+	}
+	return count;
+}
+
+size_t ExternalPoseSource::PollUdp( ExternalPoseRecord *out, int64_t *receive_ns_out, size_t max, int64_t now_ns )
+{
+	size_t count = 0;
+	while ( count < max )
+	{
+		char buffer[ 256 ];
+#ifdef _WIN32
+		const int n = recv( (SOCKET)socket_, buffer, sizeof( buffer ), 0 );
+#else
+		const ssize_t n = recv( (int)socket_, buffer, sizeof( buffer ), MSG_DONTWAIT );
+#endif
+		if ( n < 0 )
+			break; // would block (or a transient error); nothing more queued
+		if ( n != (int)sizeof( ExternalPoseRecord ) )
+		{
+			++malformed_;
+			continue;
+		}
+		std::memcpy( &out[ count ], buffer, sizeof( ExternalPoseRecord ) );
+		if ( !ValidRecord( out[ count ] ) )
+		{
+			++malformed_;
+			continue;
+		}
+		if ( receive_ns_out )
+			receive_ns_out[ count ] = now_ns;
+		++count;
+	}
+	return count;
+}
+
+bool ExternalPoseSource::MapRing()
+{
+#ifdef _WIN32
+	HANDLE mapping = OpenFileMappingA( FILE_MAP_READ, FALSE, config_.ring_name.c_str() );
+	if ( !mapping )
+		return false;
+	void *view = MapViewOfFile( mapping, FILE_MAP_READ, 0, 0, 0 );
+	MEMORY_BASIC_INFORMATION info = {};
+	if ( !view || !VirtualQuery( view, &info, sizeof( info ) ) )
+	{
+		if ( view )
+			UnmapViewOfFile( view );
+		CloseHandle( mapping );
+		return false;
+	}
+	mapping_handle_ = mapping;
+	view_ = view;
+	view_size_ = info.RegionSize;
+#else
+	// POSIX shm names start with a slash; accept the Windows-style bare name too
+	const std::string name = config_.ring_name[ 0 ] == '/' ? config_.ring_name : "/" + config_.ring_name;
+	const int fd = shm_open( name.c_str(), O_RDONLY, 0 );
+	if ( fd < 0 )
+		return false;
+	struct stat st = {};
+	void *view = MAP_FAILED;
+	if ( fstat( fd, &st ) == 0 && st.st_size > 0 )
+		view = mmap( nullptr, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0 );
+	close( fd );
+	if ( view == MAP_FAILED )
+		return false;
+	view_ = view;
+	view_size_ = (size_t)st.st_size;
+#endif
+
+	// Validate before trusting anything the producer wrote
+	const auto *header = static_cast< const ExternalPoseRingHeader * >( view_ );
+	constexpr size_t slots_offset = sizeof( ExternalPoseRingHeader );
+	const bool valid = view_size_ >= slots_offset && header->magic == kExternalPoseMagic && header->version == kExternalPoseVersion &&
+		header->slot_size == sizeof( ExternalPoseRingSlot ) && header->capacity != 0 && ( header->capacity & ( header->capacity - 1 ) ) == 0 &&
+		( view_size_ - slots_offset ) / sizeof( ExternalPoseRingSlot ) >= header->capacity;
+	if ( !valid )
+	{
+		if ( !layout_warned_ )
+			DriverLog( "[external] pose ring \"%s\" has an unexpected layout; ignoring it", config_.ring_name.c_str() );
+		layout_warned_ = true;
+		UnmapRing();
+		return false;
+	}
+	layout_warned_ = false;
+	ring_ = header;
+	slots_ = reinterpret_cast< const ExternalPoseRingSlot * >( static_cast< const char * >( view_ ) + slots_offset );
+	capacity_ = header->capacity;
+	// Only what is published from now on: old entries predate our clock alignment
+	read_count_ = ring_->write_count.load( std::memory_order_acquire );
+	return true;
+}
+
+void ExternalPoseSource::UnmapRing()
+{
+	if ( ring_ )
+		DriverLog( "[external] unmapped pose ring \"%s\"", config_.ring_name.c_str() );
+#ifdef _WIN32
+	if ( view_ )
+		UnmapViewOfFile( view_ );
+	if ( mapping_handle_ )
+		CloseHandle( (HANDLE)mapping_handle_ );
+#else
+	if ( view_ )
+		munmap( view_, view_size_ );
+#endif
+	mapping_handle_ = nullptr;
+	view_ = nullptr;
+	view_size_ = 0;
+	ring_ = nullptr;
+	slots_ = nullptr;
+	capacity_ = 0;
+}
+
+bool ExternalPoseSource::BindUdp()
+{
+#ifdef _WIN32
+	if ( !wsa_started_ )
+	{
+		WSADATA wsa;
+		if ( WSAStartup( MAKEWORD( 2, 2 ), &wsa ) != 0 )
+			return false;
+		wsa_started_ = true;
+	}
+	SOCKET s = socket( AF_INET, SOCK_DGRAM, IPPROTO_UDP );
+	if ( s == INVALID_SOCKET )
+		return false;
+	u_long non_blocking = 1;
+	ioctlsocket( s, FIONBIO, &non_blocking );
+#else
+	const int s = socket( AF_INET, SOCK_DGRAM, IPPROTO_UDP );
+	if ( s < 0 )
+		return false;
+	fcntl( s, F_SETFL, fcntl( s, F_GETFL, 0 ) | O_NONBLOCK );
+#endif
+
+	sockaddr_in addr = {};
+	addr.sin_family = AF_INET;
+	addr.sin_port = htons( (uint16_t)config_.udp_port );
+	if ( inet_pton( AF_INET, config_.udp_address.empty() ? "127.0.0.1" : config_.udp_address.c_str(), &addr.sin_addr ) != 1 ||
+		bind( s, reinterpret_cast< sockaddr * >( &addr ), sizeof( addr ) ) != 0 )
+	{
+#ifdef _WIN32
+		closesocket( s );
+#else
+		close( s );
+#endif
+		return false;
+	}
+	socket_ = (intptr_t)s;
+	return true;
+}
+
+void ExternalPoseSource::CloseUdp()
+{
+	if ( socket_ != kNoSocket )
+	{
+#ifdef _WIN32
+		closesocket( (SOCKET)socket_ );
+#else
+		close( (int)socket_ );
+#endif
+		socket_ = kNoSocket;
+	}
+#ifdef _WIN32
+	if ( wsa_started_ )
+	{
+		WSACleanup();
+		wsa_started_ = false;
+	}
+#endif
+}
@@ -0,0 +1,132 @@
+// Poses from an external tracker (e.g. a cockpit camera), read from a shared-memory ring written
+// by the tracker process, with a UDP socket as fallback for producers that cannot map memory.
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// "RNXP"
+inline constexpr uint32_t kExternalPoseMagic = 0x50584E52u;
+inline constexpr uint32_t kExternalPoseVersion = 1;
+
+enum ExternalPoseFlags : uint32_t
+{
+	kExternalPoseHasPosition = 1u << 0,
+	kExternalPoseHasOrientation = 1u << 1,
+};
+
+//-----------------------------------------------------------------------------
+// Purpose: One measurement, in driver space (meters, Y up, -Z forward; the eye point) and stamped
+// with the host's monotonic clock at the time the tracker measured it, i.e. std::chrono::
+// steady_clock (QueryPerformanceCounter on Windows, CLOCK_MONOTONIC on Linux) in nanoseconds.
+// host_time_ns == 0 means "unstamped": the driver uses the arrival time minus its configured
+// latency (for producers on another machine). The same 48 bytes are a ring slot's payload and
+// a UDP datagram, little endian.
+//-----------------------------------------------------------------------------
+struct ExternalPoseRecord
+{
+	uint32_t magic = kExternalPoseMagic;
+	uint32_t flags = 0; // ExternalPoseFlags
+	int64_t host_time_ns = 0;
+	float position[ 3 ] = { 0.f, 0.f, 0.f };
+	float orientation[ 4 ] = { 1.f, 0.f, 0.f, 0.f }; // w, x, y, z
+	uint32_t reserved = 0;
+};
+static_assert( sizeof( ExternalPoseRecord ) == 48, "wire format" );
+
+//-----------------------------------------------------------------------------
+// Purpose: Shared-memory layout (the producer creates the mapping, the driver only reads it):
+// a 128-byte header, then `capacity` 64-byte slots (a power of two). To publish, the producer
+// takes slot = write_count % capacity, bumps its sequence to odd, writes the record, bumps the
+// sequence to even (release), then increments write_count (release). The driver never writes,
+// so a stalled or crashed producer cannot hold it up.
+//-----------------------------------------------------------------------------
+struct ExternalPoseRingHeader
+{
+	uint32_t magic;
+	uint32_t version;
+	uint32_t capacity;
+	uint32_t slot_size; // sizeof(ExternalPoseRingSlot)
+	alignas( 64 ) std::atomic< uint64_t > write_count;
+};
+static_assert( sizeof( ExternalPoseRingHeader ) == 128, "slots start right after the header" );
+
+struct alignas( 64 ) ExternalPoseRingSlot
+{
+	std::atomic< uint32_t > sequence;
+	uint32_t pad;
+	// ExternalPoseRecord, as relaxed atomic words so the driver's copy of a slot being
+	// rewritten is well defined (it is discarded by the sequence check)
+	std::atomic< uint64_t > words[ sizeof( ExternalPoseRecord ) / sizeof( uint64_t ) ];
+};
+static_assert( sizeof( ExternalPoseRingSlot ) == 64, "wire format" );
+static_assert( std::atomic< uint64_t >::is_always_lock_free && std::atomic< uint32_t >::is_always_lock_free,
+	"atomics shared with another process must be lock free" );
+
+struct ExternalPoseSourceConfig
+{
+	std::string ring_name;   // shared memory object; empty disables the ring
+	std::string udp_address; // local address to bind, e.g. 127.0.0.1
+	int udp_port = 0;        // 0 disables UDP
+};
+
+//-----------------------------------------------------------------------------
+// Purpose: Polled, never blocking: the RayNeo event thread calls Poll() once per IMU batch.
+// The ring is (re)mapped lazily, at most once a second, so the tracker may start, stop and
+// restart at any time. Single threaded (owner serializes every call).
+//-----------------------------------------------------------------------------
+class ExternalPoseSource
+{
+public:
+	ExternalPoseSource() = default;
+	~ExternalPoseSource() { Close(); }
+
+	ExternalPoseSource( const ExternalPoseSource & ) = delete;
+	ExternalPoseSource &operator=( const ExternalPoseSource & ) = delete;
+
+	void Open( const ExternalPoseSourceConfig &config );
+	void Close();
+	bool IsOpen() const { return open_; }
+
+	// Copies up to max new records (ring first, then UDP) into out; receive_ns_out, if given,
+	// gets each record's arrival time. Returns the count.
+	size_t Poll( ExternalPoseRecord *out, int64_t *receive_ns_out, size_t max, int64_t now_ns );
+
+	bool RingMapped() const { return ring_ != nullptr; }
+	bool UdpBound() const { return socket_ != kNoSocket; }
+	// Records lost because the driver fell more than a ring's capacity behind, and malformed ones
+	uint64_t Overruns() const { return overruns_; }
+	uint64_t Malformed() const { return malformed_; }
+
+private:
+	bool MapRing();
+	void UnmapRing();
+	bool BindUdp();
+	void CloseUdp();
+	size_t PollRing( ExternalPoseRecord *out, int64_t *receive_ns_out, size_t max, int64_t now_ns );
+	size_t PollUdp( ExternalPoseRecord *out, int64_t *receive_ns_out, size_t max, int64_t now_ns );
+
+	ExternalPoseSourceConfig config_;
+	bool open_ = false;
+
+	// Ring mapping (platform handles kept opaque so the header stays free of OS includes)
+	void *mapping_handle_ = nullptr;
+	void *view_ = nullptr;
+	size_t view_size_ = 0;
+	const ExternalPoseRingHeader *ring_ = nullptr;
+	const ExternalPoseRingSlot *slots_ = nullptr;
+	uint32_t capacity_ = 0;
+	uint64_t read_count_ = 0;
+	int64_t last_map_attempt_ns_ = 0;
+	int64_t last_ring_data_ns_ = 0;
+	bool layout_warned_ = false;
+
+	static constexpr intptr_t kNoSocket = -1;
+	intptr_t socket_ = kNoSocket;
+	bool wsa_started_ = false;
+
+	uint64_t overruns_ = 0;
+	uint64_t malformed_ = 0;
+};
@@ -0,0 +1,162 @@
+#include "frame_timing.h"
+
+#include <algorithm>
+#include <cstdio>
+
+namespace
+{
+	// Frame indices further apart than this are a gap (compositor restart, pause), not a period
+	constexpr uint32_t kMaxFrameGap = 8;
+	// Older indices within this window were already consumed by an earlier call
+	constexpr uint32_t kSeenWindow = 1024;
+	// Queueing deeper than this is a stall, not the pipeline's steady state
+	constexpr float kMaxQueuedVsyncs = 4.f;
+	constexpr float kMaxVsyncToPhotons = 0.5f;
+
+	float Blend( float filtered, float sample, float dt, float time_constant )
+	{
+		if ( time_constant <= 0.f )
+			return sample;
+		return filtered + ( sample - filtered ) * ( dt / ( time_constant + dt ) );
+	}
+}
+
+void FrameTiming::SetConfig( const FrameTimingConfig &config )
+{
+	std::lock_guard< std::mutex > lock( mutex_ );
+	config_ = config;
+	smoothing_time_.store( config.smoothing_time, std::memory_order_relaxed );
+	UpdateVsyncToPhotons();
+}
+
+void FrameTiming::SetNominalRefresh( float hz )
+{
+	std::lock_guard< std::mutex > lock( mutex_ );
+	if ( hz == nominal_refresh_hz_ )
+		return;
+	nominal_refresh_hz_ = hz;
+	// A new mode invalidates the measured period; the next frames measure it again
+	frame_period_ = 0.f;
+	UpdateVsyncToPhotons();
+}
+
+void FrameTiming::AddCompositorFrames( const CompositorFrameSample *frames, size_t count )
+{
+	std::lock_guard< std::mutex > lock( mutex_ );
+	for ( size_t i = 0; i < count; ++i )
+	{
+		const CompositorFrameSample &f = frames[ i ];
+		if ( have_frame_ && f.frame_index <= last_frame_index_ )
+		{
+			if ( last_frame_index_ - f.frame_index < kSeenWindow )
+				continue;
+			have_frame_ = false; // numbering restarted with the compositor
+		}
+
+		const float nominal = NominalPeriod();
+		float dt = frame_period_ > 0.f ? frame_period_ : nominal;
+		if ( have_frame_ && f.frame_index - last_frame_index_ <= kMaxFrameGap )
+		{
+			const float period = static_cast< float >( ( f.system_time - last_system_time_ ) / ( f.frame_index - last_frame_index_ ) );
+			// Outliers (hitches, a clock step) say nothing about the panel's period
+			if ( period > 0.f && ( nominal <= 0.f || ( period > 0.5f * nominal && period < 1.5f * nominal ) ) )
+			{
+				frame_period_ = frame_period_ > 0.f ? Blend( frame_period_, period, period, config_.smoothing_time ) : period;
+				dt = period;
+			}
+		}
+		have_frame_ = true;
+		last_frame_index_ = f.frame_index;
+		last_system_time_ = f.system_time;
+
+		if ( dt > 0.f )
+		{
+			if ( f.vsyncs_to_first_view > 0 )
+			{
+				const float queued = std::min( static_cast< float >( f.vsyncs_to_first_view - 1 ), kMaxQueuedVsyncs );
+				queued_vsyncs_ = Blend( queued_vsyncs_, queued, dt, config_.smoothing_time );
+			}
+			late_fraction_ = Blend( late_fraction_, f.mispresented > 0 ? 1.f : 0.f, dt, config_.smoothing_time );
+		}
+
+		++frames_;
+		mispresented_ += f.mispresented > 0 ? 1 : 0;
+		dropped_ += f.dropped;
+		reprojected_ += f.reprojection_flags != 0 ? 1 : 0;
+	}
+	UpdateVsyncToPhotons();
+}
+
+void FrameTiming::UpdateVsyncToPhotons()
+{
+	const float period = frame_period_ > 0.f ? frame_period_ : NominalPeriod();
+	const float v = config_.base_vsync_to_photons + ( queued_vsyncs_ + late_fraction_ ) * period;
+	vsync_to_photons_.store( std::clamp( v, 0.f, kMaxVsyncToPhotons ), std::memory_order_relaxed );
+}
+
+void FrameTiming::AddPoseLatency( float seconds, int64_t now_ns )
+{
+	if ( pose_reset_requested_.exchange( false, std::memory_order_relaxed ) )
+		last_pose_ns_ = 0;
+	if ( last_pose_ns_ == 0 )
+	{
+		imu_to_pose_filtered_ = seconds;
+	}
+	else
+	{
+		// Long gaps (standby) count as one time constant at most
+		const float dt = std::min( static_cast< float >( now_ns - last_pose_ns_ ) * 1e-9f, 1.f );
+		imu_to_pose_filtered_ = Blend( imu_to_pose_filtered_, seconds, dt, smoothing_time_.load( std::memory_order_relaxed ) );
+	}
+	last_pose_ns_ = now_ns;
+	imu_to_pose_.store( imu_to_pose_filtered_, std::memory_order_relaxed );
+}
+
+FrameTimingEstimate FrameTiming::Estimate() const
+{
+	std::lock_guard< std::mutex > lock( mutex_ );
+	FrameTimingEstimate e;
+	e.nominal_refresh_hz = nominal_refresh_hz_;
+	e.frame_period = frame_period_ > 0.f ? frame_period_ : NominalPeriod();
+	e.queued_vsyncs = queued_vsyncs_;
+	e.late_fraction = late_fraction_;
+	e.vsync_to_photons = VsyncToPhotons();
+	e.imu_to_pose = ImuToPose();
+	e.frames = frames_;
+	e.mispresented = mispresented_;
+	e.dropped = dropped_;
+	e.reprojected = reprojected_;
+	e.compositor_timing = have_frame_;
+	return e;
+}
+
+std::string FrameTiming::FormatStats() const
+{
+	const FrameTimingEstimate e = Estimate();
+	char line[ 512 ];
+	snprintf( line, sizeof( line ),
+		"timing refresh_hz=%.3f period_ms=%.3f%s queued_vsyncs=%.2f late=%.3f vsync_to_photons_ms=%.2f imu_to_pose_ms=%.2f "
+		"frames=%llu mispresented=%llu dropped=%llu reprojected=%llu\n",
+		e.nominal_refresh_hz, e.frame_period * 1e3f, e.compositor_timing ? "" : " (nominal, no compositor timing)", e.queued_vsyncs,
+		e.late_fraction, e.vsync_to_photons * 1e3f, e.imu_to_pose * 1e3f, (unsigned long long)e.frames, (unsigned long long)e.mispresented,
+		(unsigned long long)e.dropped, (unsigned long long)e.reprojected );
+	return line;
+}
+
+void FrameTiming::Reset()
+{
+	std::lock_guard< std::mutex > lock( mutex_ );
+	have_frame_ = false;
+	last_frame_index_ = 0;
+	last_system_time_ = 0.0;
+	frame_period_ = 0.f;
+	queued_vsyncs_ = 0.f;
+	late_fraction_ = 0.f;
+	frames_ = 0;
+	mispresented_ = 0;
+	dropped_ = 0;
+	reprojected_ = 0;
+	UpdateVsyncToPhotons();
+	imu_to_pose_.store( 0.f, std::memory_order_relaxed );
+	pose_reset_requested_.store( true, std::memory_order_relaxed );
+}
@@ -0,0 +1,103 @@
+// Display latency estimates from the panel refresh and the compositor's frame timing, fed back
+// into the prediction horizon. Headless: the HMD converts vr::Compositor_FrameTiming for it.
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+
+struct FrameTimingConfig
+{
+	// The glasses' own vsync-to-photons latency (scan-out, SBS processing, panel response) with
+	// the compositor presenting on schedule; measured queueing and late presents add to it
+	float base_vsync_to_photons = 0.11f;
+	// Time constant of every smoothed estimate (seconds)
+	float smoothing_time = 2.0f;
+};
+
+// One compositor frame, as vr::Compositor_FrameTiming reports it
+struct CompositorFrameSample
+{
+	uint32_t frame_index = 0;
+	double system_time = 0.0;           // seconds, aligned with the frame's vsync
+	uint32_t vsyncs_to_first_view = 0;  // 0 if the compositor did not report it
+	uint32_t presents = 0;
+	uint32_t mispresented = 0;          // presents in a vsync other than the predicted one
+	uint32_t dropped = 0;
+	uint32_t reprojection_flags = 0;
+};
+
+struct FrameTimingEstimate
+{
+	float nominal_refresh_hz = 0.f;   // from the display layout (EDID timing / glasses fps)
+	float frame_period = 0.f;         // measured between compositor frames, else 1 / nominal
+	float queued_vsyncs = 0.f;        // vsyncs to first view beyond the first (smoothed)
+	float late_fraction = 0.f;        // share of frames shown a vsync later than predicted (smoothed)
+	float vsync_to_photons = 0.f;     // what Prop_SecondsFromVsyncToPhotons should say
+	float imu_to_pose = 0.f;          // IMU sample to pose publish (smoothed)
+	uint64_t frames = 0;
+	uint64_t mispresented = 0;
+	uint64_t dropped = 0;
+	uint64_t reprojected = 0;
+	bool compositor_timing = false;   // at least one compositor frame seen
+};
+
+//-----------------------------------------------------------------------------
+// Purpose: The photon time vrserver predicts to is "next vsync + Prop_SecondsFromVsyncToPhotons",
+// so a static vsync-to-photons guess is right only while the compositor keeps its schedule.
+// Frames that queue an extra vsync before they are first viewed, or land a vsync late, push the
+// real photon time out by whole (measured) frame periods; those are added to the glasses' base
+// latency. Separately, the age of each published IMU sample is tracked on the pose thread and
+// read lock free, so GetPose() can cover it with its own higher order prediction.
+// Compositor side: short lock, vrserver main thread. Pose side: single writer, atomics.
+//-----------------------------------------------------------------------------
+class FrameTiming
+{
+public:
+	void SetConfig( const FrameTimingConfig &config );
+	void SetNominalRefresh( float hz );
+
+	// Newest compositor frames, oldest first; frames already seen are skipped
+	void AddCompositorFrames( const CompositorFrameSample *frames, size_t count );
+
+	// Pose thread: age (seconds) of the sample behind a pose published at now_ns
+	void AddPoseLatency( float seconds, int64_t now_ns );
+
+	// Lock free reads for the pose and main threads
+	float VsyncToPhotons() const { return vsync_to_photons_.load( std::memory_order_relaxed ); }
+	float ImuToPose() const { return imu_to_pose_.load( std::memory_order_relaxed ); }
+
+	FrameTimingEstimate Estimate() const;
+	std::string FormatStats() const;
+	// Forget everything measured (keeps config and nominal refresh)
+	void Reset();
+
+private:
+	void UpdateVsyncToPhotons();
+	float NominalPeriod() const { return nominal_refresh_hz_ > 0.f ? 1.f / nominal_refresh_hz_ : 0.f; }
+
+	mutable std::mutex mutex_;
+	FrameTimingConfig config_;
+	float nominal_refresh_hz_ = 0.f;
+	bool have_frame_ = false;
+	uint32_t last_frame_index_ = 0;
+	double last_system_time_ = 0.0;
+	float frame_period_ = 0.f; // 0 until measured
+	float queued_vsyncs_ = 0.f;
+	float late_fraction_ = 0.f;
+	uint64_t frames_ = 0;
+	uint64_t mispresented_ = 0;
+	uint64_t dropped_ = 0;
+	uint64_t reprojected_ = 0;
+
+	std::atomic< float > vsync_to_photons_{ 0.11f };
+	std::atomic< float > imu_to_pose_{ 0.f };
+	std::atomic< float > smoothing_time_{ 2.0f }; // copy of config_ for the pose thread
+
+	// Pose thread only
+	int64_t last_pose_ns_ = 0;
+	float imu_to_pose_filtered_ = 0.f;
+	std::atomic< bool > pose_reset_requested_{ false };
+};
@@ -0,0 +1,178 @@
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#endif
+
+#include "haptics_output.h"
+#include "thread_policy.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+
+namespace
+{
+	int64_t NowNs()
+	{
+		return std::chrono::duration_cast< std::chrono::nanoseconds >( std::chrono::steady_clock::now().time_since_epoch() ).count();
+	}
+
+	// vrserver sends 0 for "shortest possible pulse"; cap runaway durations from misbehaving apps
+	constexpr float kMinPulseSeconds = 0.005f;
+	constexpr float kMaxPulseSeconds = 2.0f;
+}
+
+void HapticsOutput::Start()
+{
+	std::lock_guard< std::mutex > lock( mutex_ );
+	if ( running_ )
+		return;
+	running_ = true;
+	has_pending_ = false;
+	playing_end_ns_ = 0;
+	tokens_ = 0.f;
+	tokens_updated_ns_ = 0;
+	worker_ = std::thread( &HapticsOutput::WorkerLoop, this );
+}
+
+void HapticsOutput::Stop()
+{
+	{
+		std::lock_guard< std::mutex > lock( mutex_ );
+		if ( !running_ )
+			return;
+		running_ = false;
+		has_pending_ = false;
+	}
+	cv_.notify_all();
+	if ( worker_.joinable() )
+		worker_.join();
+}
+
+void HapticsOutput::Enqueue( const HapticPulse &pulse, const HapticsOutputConfig &config )
+{
+	received_.fetch_add( 1, std::memory_order_relaxed );
+	if ( !( pulse.amplitude > 0.f ) )
+	{
+		silent_.fetch_add( 1, std::memory_order_relaxed );
+		return;
+	}
+
+	HapticPulse p = pulse;
+	p.duration_s = std::clamp( p.duration_s, kMinPulseSeconds, kMaxPulseSeconds );
+	p.amplitude = std::min( p.amplitude, 1.f );
+	const int64_t now_ns = NowNs();
+	const int64_t end_ns = now_ns + static_cast< int64_t >( p.duration_s * 1e9f );
+
+	{
+		std::lock_guard< std::mutex > lock( mutex_ );
+		if ( !running_ )
+			return;
+
+		// Entirely inside the pulse already playing, and no stronger: nothing new to render
+		if ( !has_pending_ && end_ns <= playing_end_ns_ && p.amplitude <= playing_amplitude_ )
+		{
+			coalesced_.fetch_add( 1, std::memory_order_relaxed );
+			return;
+		}
+
+		// The pending pulse hasn't started yet, so both begin "now": keep the longer and stronger
+		if ( has_pending_ )
+		{
+			if ( p.amplitude > pending_.amplitude )
+			{
+				pending_.amplitude = p.amplitude;
+				pending_.frequency_hz = p.frequency_hz;
+			}
+			pending_.duration_s = std::max( pending_.duration_s, p.duration_s );
+			coalesced_.fetch_add( 1, std::memory_order_relaxed );
+			return;
+		}
+
+		// Token bucket: refills at the budget rate, holds at most one second's worth
+		const float budget = std::max( config.max_pulses_per_second, 0.f );
+		if ( tokens_updated_ns_ != 0 )
+			tokens_ = std::min( budget, tokens_ + budget * static_cast< float >( now_ns - tokens_updated_ns_ ) * 1e-9f );
+		else
+			tokens_ = budget;
+		tokens_updated_ns_ = now_ns;
+		if ( tokens_ < 1.f )
+		{
+			dropped_.fetch_add( 1, std::memory_order_relaxed );
+			return;
+		}
+		tokens_ -= 1.f;
+
+		pending_ = p;
+		pending_audio_cue_ = config.audio_cue;
+		has_pending_ = true;
+	}
+	cv_.notify_one();
+}
+
+void HapticsOutput::WorkerLoop()
+{
+	SetCurrentThreadName( "rayneo-haptics" );
+	std::unique_lock< std::mutex > lock( mutex_ );
+	for ( ;; )
+	{
+		cv_.wait( lock, [ this ] { return !running_ || has_pending_; } );
+		if ( !running_ )
+			return;
+
+		const HapticPulse pulse = pending_;
+		const bool audio_cue = pending_audio_cue_;
+		has_pending_ = false;
+		const int64_t start_ns = NowNs();
+		playing_end_ns_ = start_ns + static_cast< int64_t >( pulse.duration_s * 1e9f );
+		playing_amplitude_ = pulse.amplitude;
+
+		lock.unlock();
+		Render( pulse, audio_cue );
+		played_.fetch_add( 1, std::memory_order_relaxed );
+		lock.lock();
+
+		// Stay busy for the rest of the pulse so overlapping requests keep merging into it
+		const auto end = std::chrono::steady_clock::time_point(
+			std::chrono::duration_cast< std::chrono::steady_clock::duration >( std::chrono::nanoseconds( playing_end_ns_ ) ) );
+		cv_.wait_until( lock, end, [ this ] { return !running_; } );
+		playing_amplitude_ = 0.f;
+	}
+}
+
+void HapticsOutput::Render( const HapticPulse &pulse, bool audio_cue )
+{
+	// The RayNeo SDK exposes no vibration motor; the only feedback channel is an optional tone
+#ifdef _WIN32
+	if ( audio_cue )
+	{
+		// Beep() blocks for the tone's length, which is why this runs on the worker
+		const DWORD frequency = static_cast< DWORD >( std::clamp( pulse.frequency_hz > 0.f ? pulse.frequency_hz : 320.f, 37.f, 32767.f ) );
+		Beep( frequency, static_cast< DWORD >( pulse.duration_s * 1000.f ) );
+	}
+#else
+	(void)pulse;
+	(void)audio_cue;
+#endif
+}
+
+HapticsOutputStats HapticsOutput::Stats() const
+{
+	HapticsOutputStats s;
+	s.received = received_.load( std::memory_order_relaxed );
+	s.coalesced = coalesced_.load( std::memory_order_relaxed );
+	s.dropped = dropped_.load( std::memory_order_relaxed );
+	s.silent = silent_.load( std::memory_order_relaxed );
+	s.played = played_.load( std::memory_order_relaxed );
+	return s;
+}
+
+std::string HapticsOutput::FormatStats() const
+{
+	const HapticsOutputStats s = Stats();
+	char line[ 256 ];
+	snprintf( line, sizeof( line ), "haptics received=%llu played=%llu coalesced=%llu dropped=%llu silent=%llu\n",
+		(unsigned long long)s.received, (unsigned long long)s.played, (unsigned long long)s.coalesced,
+		(unsigned long long)s.dropped, (unsigned long long)s.silent );
+	return line;
+}
@@ -0,0 +1,83 @@
+// Haptic output stage: VREvent_Input_HapticVibration is enqueued on the vrserver main thread and
+// played on a worker, coalesced and rate limited.
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+
+struct HapticsOutputConfig
+{
+	// New pulses beyond this rate are dropped; pulses merged into a pending or playing one are free
+	float max_pulses_per_second = 20.f;
+	// The glasses have no actuator. When set, pulses are rendered as a short tone instead (Windows).
+	bool audio_cue = false;
+};
+
+struct HapticPulse
+{
+	float duration_s = 0.f;
+	float frequency_hz = 0.f;
+	float amplitude = 0.f; // 0..1
+};
+
+struct HapticsOutputStats
+{
+	uint64_t received = 0;
+	uint64_t coalesced = 0; // merged into a pending pulse or covered by the one playing
+	uint64_t dropped = 0;   // over the rate budget
+	uint64_t silent = 0;    // zero amplitude
+	uint64_t played = 0;
+};
+
+//-----------------------------------------------------------------------------
+// Purpose: Single pending-pulse slot plus a worker thread. Enqueue() takes a short lock, merges
+// or budgets the pulse and signals the worker; it never logs or calls into vrserver, so it is
+// cheap enough for RunFrame's event loop at any haptic rate. The worker renders each pulse
+// (audio cue or no-op) and stays busy for its duration, which is what later pulses coalesce into.
+//-----------------------------------------------------------------------------
+class HapticsOutput
+{
+public:
+	HapticsOutput() = default;
+	~HapticsOutput() { Stop(); }
+
+	HapticsOutput( const HapticsOutput & ) = delete;
+	HapticsOutput &operator=( const HapticsOutput & ) = delete;
+
+	void Start();
+	void Stop();
+
+	// vrserver main thread
+	void Enqueue( const HapticPulse &pulse, const HapticsOutputConfig &config );
+
+	HapticsOutputStats Stats() const;
+	std::string FormatStats() const;
+
+private:
+	void WorkerLoop();
+	static void Render( const HapticPulse &pulse, bool audio_cue );
+
+	mutable std::mutex mutex_;
+	std::condition_variable cv_;
+	std::thread worker_;
+	bool running_ = false;
+
+	// Guarded by mutex_
+	bool has_pending_ = false;
+	HapticPulse pending_;
+	bool pending_audio_cue_ = false;
+	int64_t playing_end_ns_ = 0;
+	float playing_amplitude_ = 0.f;
+	float tokens_ = 0.f;
+	int64_t tokens_updated_ns_ = 0;
+
+	std::atomic< uint64_t > received_{ 0 };
+	std::atomic< uint64_t > coalesced_{ 0 };
+	std::atomic< uint64_t > dropped_{ 0 };
+	std::atomic< uint64_t > silent_{ 0 };
+	std::atomic< uint64_t > played_{ 0 };
+};
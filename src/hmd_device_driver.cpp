@@ -5,53 +5,130 @@
 #include "vrmath.h"
 #include <string.h>
 #include "display_edid_finder.h"
-#include "device_provider.h" // need full definition for GetImuOrientation
+#include "device_provider.h" // settings, stats and the input queue
+#include "imu_math.h"
+#include "thread_policy.h"
 #include <cmath>
+#include <algorithm>
 
-// Let's create some variables for strings used in getting settings.
-// This is the section where all of the settings we want are stored. A section name can be anything,
-// but if you want to store driver specific settings, it's best to namespace the section with the driver identifier
-// ie "<my_driver>_<section>" to avoid collisions
-static const char *my_hmd_main_settings_section = "driver_simplehmd";
-static const char *my_hmd_display_settings_section = "simplehmd_display";
+MyHMDDisplayDriverConfiguration MyProvisionalDisplayConfiguration()
+{
+	// Hardcoded defaults, replaced once the 3D mode display shows up
+	return MyHMDDisplayDriverConfiguration{ 2560, 370, 1920, 1080, 1920, 1080, 60.0f };
+}
 
-MyHMDControllerDeviceDriver::MyHMDControllerDeviceDriver()
+float MyResolveDisplayFrequency( const DisplayEdidInfo *edid, uint32_t width, uint32_t height, int glasses_fps )
 {
-	// Keep track of whether Activate() has been called
-	is_active_ = false;
+	const bool fps_known = glasses_fps >= 30 && glasses_fps <= 240;
+	// Snap an integer rate to the exact EDID timing at this size if there is one within 1.5 Hz
+	auto refine = [ & ]( double hz ) -> float {
+		if ( edid )
+		{
+			const EdidTiming *t = FindEdidTiming( edid->timings, width, height, hz );
+			if ( t && std::fabs( t->RefreshHz() - hz ) < 1.5 )
+				return static_cast< float >( t->RefreshHz() );
+		}
+		return static_cast< float >( hz );
+	};
 
-	// Wait (up to 5 seconds) for the 3D mode display to appear with EDID (product=980, serial=17).
-	// Switching to 3D reportedly changes the display's identifiers to these values.
-	std::optional<DisplayEdidInfo> edidMatch;
+	if ( edid && edid->current_refresh_hz > 1.0 )
+		return refine( edid->current_refresh_hz );
+	if ( edid && fps_known )
 	{
-		auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
-		while (std::chrono::steady_clock::now() < deadline) {
-			try {
-				edidMatch = DisplayEdidFinder::FindDisplayByEdid(980, 17);
-			} catch(...) {
-				DriverLog("Exception while polling EDID (ignored)");
-			}
-			if (edidMatch) break;
-			std::this_thread::sleep_for(std::chrono::milliseconds(250));
-		}
-		if (edidMatch) {
-			DriverLog("EDID (3D) display detected after wait: instance='%s' product=%u serial=%u name='%s'", edidMatch->device_instance_id.c_str(), edidMatch->product_code, edidMatch->serial_number, edidMatch->monitor_name.c_str());
-		} else {
-			DriverLog("EDID (product=980 serial=17) not present within 5s wait; using fallback settings.");
-		}
+		const EdidTiming *t = FindEdidTiming( edid->timings, width, height, glasses_fps );
+		if ( t && std::fabs( t->RefreshHz() - glasses_fps ) < 1.5 )
+			return static_cast< float >( t->RefreshHz() );
+	}
+	if ( edid && edid->preferred_refresh_hz > 1.0 )
+		return static_cast< float >( edid->preferred_refresh_hz );
+	if ( fps_known )
+		return static_cast< float >( glasses_fps );
+	return 60.0f;
+}
+
+MyHMDDisplayDriverConfiguration MyDisplayConfigurationFromEdid( const DisplayEdidInfo &edid, bool have_desktop_coordinates, int glasses_fps )
+{
+	MyHMDDisplayDriverConfiguration config = MyProvisionalDisplayConfiguration();
+
+	// Resolution from EDID preferred timing
+	if ( edid.preferred_width && edid.preferred_height )
+	{
+		config.window_width = config.render_width = static_cast< int32_t >( edid.preferred_width );
+		config.window_height = config.render_height = static_cast< int32_t >( edid.preferred_height );
+	}
+	if ( have_desktop_coordinates )
+	{
+		config.window_x = edid.desktop_x;
+		config.window_y = edid.desktop_y;
+	}
+	config.display_frequency = MyResolveDisplayFrequency( &edid, static_cast< uint32_t >( config.window_width ),
+		static_cast< uint32_t >( config.window_height ), glasses_fps );
+	return config;
+}
+
+LensDistortionProfile MyLoadLensDistortionProfile()
+{
+	LensDistortionProfile profile;
+	auto read = [ & ]( const char *key, float &value ) {
+		vr::EVRSettingsError err = vr::VRSettingsError_None;
+		const float v = vr::VRSettings()->GetFloat( kRayneoSettingsSection, key, &err );
+		if ( err == vr::VRSettingsError_None && std::isfinite( v ) )
+			value = v;
+	};
+	read( "lens_center_u_left", profile.center_u[ 0 ] );
+	read( "lens_center_v_left", profile.center_v[ 0 ] );
+	read( "lens_center_u_right", profile.center_u[ 1 ] );
+	read( "lens_center_v_right", profile.center_v[ 1 ] );
+	read( "lens_radius_scale", profile.radius_scale );
+	static const char *kChannel[ 3 ] = { "red", "green", "blue" };
+	for ( int c = 0; c < 3; ++c )
+	{
+		char key[ 32 ];
+		snprintf( key, sizeof( key ), "lens_k1_%s", kChannel[ c ] );
+		read( key, profile.channel[ c ].k1 );
+		snprintf( key, sizeof( key ), "lens_k2_%s", kChannel[ c ] );
+		read( key, profile.channel[ c ].k2 );
+		snprintf( key, sizeof( key ), "lens_k3_%s", kChannel[ c ] );
+		read( key, profile.channel[ c ].k3 );
 	}
+	return profile;
+}
 
-	// We have our model number and serial number stored in SteamVR settings. We need to get them and do so here.
-	// Other IVRSettings methods (to get int32, floats, bools) return the data, instead of modifying, but strings are
-	// different.
-	// char model_number[ 1024 ];
-	// vr::VRSettings()->GetString( my_hmd_main_settings_section, "model_number", model_number, sizeof( model_number ) );
-	// my_hmd_model_number_ = model_number;
+DisplayProfile MyLoadDisplayProfile()
+{
+	DisplayProfile profile;
+	auto read = [ & ]( const char *key, float &value ) {
+		vr::EVRSettingsError err = vr::VRSettingsError_None;
+		const float v = vr::VRSettings()->GetFloat( kRayneoSettingsSection, key, &err );
+		if ( err == vr::VRSettingsError_None && std::isfinite( v ) && v != 0.f )
+		{
+			value = v;
+			return true;
+		}
+		return false;
+	};
+	// A diagonal figure (as on spec sheets) is split by the panel aspect; explicit axes win over it
+	float diagonal = 0.f;
+	if ( read( "fov_diagonal_deg", diagonal ) )
+		FovFromDiagonal( diagonal, 16.f / 9.f, profile.fov_horizontal_deg, profile.fov_vertical_deg );
+	read( "fov_horizontal_deg", profile.fov_horizontal_deg );
+	read( "fov_vertical_deg", profile.fov_vertical_deg );
+	read( "projection_convergence_shift", profile.convergence_shift );
+	read( "render_scale", profile.render_scale );
+	return SanitizeDisplayProfile( profile );
+}
 
-	// // Get our serial number depending on our "handedness"
-	// char serial_number[ 1024 ];
-	// vr::VRSettings()->GetString( my_hmd_main_settings_section, "serial_number", serial_number, sizeof( serial_number ) );
-	// my_hmd_serial_number_ = serial_number;
+MyHMDControllerDeviceDriver::MyHMDControllerDeviceDriver( std::shared_ptr< TrackingState > tracking, MyDeviceProvider &provider,
+	const MyHMDDisplayDriverConfiguration &display_configuration )
+	: tracking_( std::move( tracking ) ), provider_( provider )
+{
+	// Keep track of whether Activate() has been called
+	is_active_ = false;
+
+	// Model number comes from the driver_rayneo section (see resources/settings/default.vrsettings),
+	// the serial from the provider (configured, or derived from the glasses on an earlier connect)
+	my_hmd_model_number_ = provider_.Settings().ModelNumber();
+	my_hmd_serial_number_ = provider_.HmdSerialNumber();
 
 	// Here's an example of how to use our logging wrapper around IVRDriverLog
 	// In SteamVR logs (SteamVR Hamburger Menu > Developer Settings > Web console) drivers have a prefix of
@@ -59,49 +136,26 @@ MyHMDControllerDeviceDriver::MyHMDControllerDeviceDriver()
 	DriverLog( "My Dummy HMD Model Number: %s", my_hmd_model_number_.c_str() );
 	DriverLog( "My Dummy HMD Serial Number: %s", my_hmd_serial_number_.c_str() );
 
-	// Display settings derived from EDID if available (preferred timing). Fallback to hardcoded defaults.
-	uint32_t winX = 2560;
-	uint32_t winY = 370;
-	uint32_t width = 1920;
-	uint32_t height = 1080;
-	uint32_t renderW = width;
-	uint32_t renderH = height;
-
-	// Use previously found EDID match (product 980 serial 17) to adjust width/height if preferred mode parsed.
-	if (edidMatch) {
-		// Resolution from EDID preferred timing
-		if (edidMatch->preferred_width && edidMatch->preferred_height) {
-			width = edidMatch->preferred_width;
-			height = edidMatch->preferred_height;
-			renderW = width;
-			renderH = height;
-			DriverLog("RayNeo Using EDID preferred mode %ux%u", width, height);
-		}
-		DisplayEdidInfo tmp = *edidMatch;
-		if (DisplayEdidFinder::PopulateDesktopCoordinates(tmp)) {
-			winX = static_cast<uint32_t>(tmp.desktop_x);
-			winY = static_cast<uint32_t>(tmp.desktop_y);
-			DriverLog("RayNeo Using monitor desktop origin (%d,%d)", tmp.desktop_x, tmp.desktop_y);
-		}
-	}
-	std::this_thread::sleep_for(std::chrono::seconds(2));
-
-	MyHMDDisplayDriverConfiguration display_configuration{
-		static_cast<int32_t>(winX), static_cast<int32_t>(winY),
-		static_cast<int32_t>(width), static_cast<int32_t>(height),
-		static_cast<int32_t>(renderW), static_cast<int32_t>(renderH)
-	};
-	// display_configuration.window_x = vr::VRSettings()->GetInt32( my_hmd_display_settings_section, "window_x" );
-	// display_configuration.window_y = vr::VRSettings()->GetInt32( my_hmd_display_settings_section, "window_y" );
-
-	// display_configuration.window_width = vr::VRSettings()->GetInt32( my_hmd_display_settings_section, "window_width" );
-	// display_configuration.window_height = vr::VRSettings()->GetInt32( my_hmd_display_settings_section, "window_height" );
-
-	// display_configuration.render_width = vr::VRSettings()->GetInt32( my_hmd_display_settings_section, "render_width" );
-	// display_configuration.render_height = vr::VRSettings()->GetInt32( my_hmd_display_settings_section, "render_height" );
+	// The display layout starts out provisional: MyDeviceProvider runs display discovery in parallel
+	// with USB bring-up and calls MyUpdateDisplayConfiguration() once the 3D mode display appears.
 
 	// Instantiate our display component
-	my_display_component_ = std::make_unique< MyHMDDisplayComponent >( display_configuration );
+	const LensDistortionProfile lens_profile = MyLoadLensDistortionProfile();
+	if ( lens_profile.IsIdentity() )
+	{
+		DriverLog( "RayNeo lens profile: none (undistorted)" );
+	}
+	else
+	{
+		DriverLog( "RayNeo lens profile: k1 r/g/b %.4f/%.4f/%.4f, k2 %.4f/%.4f/%.4f, radius %.3f", lens_profile.channel[ 0 ].k1,
+			lens_profile.channel[ 1 ].k1, lens_profile.channel[ 2 ].k1, lens_profile.channel[ 0 ].k2, lens_profile.channel[ 1 ].k2,
+			lens_profile.channel[ 2 ].k2, lens_profile.radius_scale );
+	}
+	const DisplayProfile display_profile = MyLoadDisplayProfile();
+	DriverLog( "RayNeo display profile: FOV %.1f x %.1f deg, convergence shift %.3f, render scale %.2f",
+		display_profile.fov_horizontal_deg, display_profile.fov_vertical_deg, display_profile.convergence_shift, display_profile.render_scale );
+	my_display_component_ = std::make_unique< MyHMDDisplayComponent >( display_configuration, lens_profile, display_profile );
+	frame_timing_.SetNominalRefresh( my_display_component_->GetConfiguration().display_frequency );
 }
 
 //-----------------------------------------------------------------------------
@@ -140,14 +194,11 @@ vr::EVRInitError MyHMDControllerDeviceDriver::Activate( uint32_t unObjectId )
 	vr::VRProperties()->SetFloatProperty( container, vr::Prop_UserIpdMeters_Float, ipd );
 
 	// For HMDs, it's required that a refresh rate is set otherwise VRCompositor will fail to start.
-	vr::VRProperties()->SetFloatProperty( container, vr::Prop_DisplayFrequency_Float, 60.0f );
+	// Starts at the provisional 60 Hz and follows display discovery (EDID timing, glasses fps).
+	vr::VRProperties()->SetFloatProperty( container, vr::Prop_DisplayFrequency_Float, my_display_component_->GetConfiguration().display_frequency );
 
-	// The distance from the user's eyes to the display in meters. This is used for reprojection.
-	// vr::VRProperties()->SetFloatProperty( container, vr::Prop_UserHeadToEyeDepthMeters_Float, 0.f );
-	vr::VRProperties()->SetFloatProperty(container, vr::Prop_UserHeadToEyeDepthMeters_Float, 0.02f);
-
-	// How long from the compositor to submit a frame to the time it takes to display it on the screen.
-	vr::VRProperties()->SetFloatProperty( container, vr::Prop_SecondsFromVsyncToPhotons_Float, 0.11f );
+	// Eye depth (reprojection) and vsync-to-photons latency; both follow settings changes
+	MyApplySettings();
 
 	// avoid "not fullscreen" warnings from vrmonitor
 	vr::VRProperties()->SetBoolProperty( container, vr::Prop_IsOnDesktop_Bool, true );
@@ -208,6 +259,7 @@ vr::EVRInitError MyHMDControllerDeviceDriver::Activate( uint32_t unObjectId )
 		DriverLog("Created haptic, handle=%llu", my_input_handles_[MyComponent_haptic]);
 	}
 
+	haptics_.Start();
 	my_pose_update_thread_ = std::thread( &MyHMDControllerDeviceDriver::MyPoseUpdateThread, this );
 
 	// We've activated everything successfully!
@@ -242,6 +294,58 @@ void MyHMDControllerDeviceDriver::DebugRequest( const char *pchRequest, char *pc
 {
 	if ( unResponseBufferSize >= 1 )
 		pchResponseBuffer[ 0 ] = 0;
+	if ( !pchRequest || unResponseBufferSize < 2 )
+		return;
+
+	std::string response;
+	if ( strcmp( pchRequest, "stats" ) == 0 )
+	{
+		response = provider_.FormatStats();
+	}
+	else if ( strcmp( pchRequest, "stats reset" ) == 0 )
+	{
+		provider_.ResetStats();
+		response = "ok\n";
+	}
+	else if ( strcmp( pchRequest, "record start" ) == 0 || strcmp( pchRequest, "record stop" ) == 0 || strcmp( pchRequest, "record status" ) == 0 )
+	{
+		if ( strcmp( pchRequest, "record start" ) == 0 )
+			provider_.StartRecording();
+		else if ( strcmp( pchRequest, "record stop" ) == 0 )
+			provider_.StopRecording();
+
+		const ImuRecorderStatus status = provider_.RecordingStatus();
+		char line[ 1400 ];
+		snprintf( line, sizeof( line ), "recording=%d records=%llu dropped=%llu bytes=%llu files=%u file=%s%s%s\n",
+			status.recording ? 1 : 0, (unsigned long long)status.records_written, (unsigned long long)status.records_dropped,
+			(unsigned long long)status.bytes_written, status.files, status.current_file.c_str(),
+			status.error.empty() ? "" : " error=", status.error.c_str() );
+		response = line;
+	}
+	else if ( strcmp( pchRequest, "haptics" ) == 0 )
+	{
+		response = haptics_.FormatStats();
+	}
+	else if ( strcmp( pchRequest, "timing" ) == 0 || strcmp( pchRequest, "timing reset" ) == 0 )
+	{
+		if ( strcmp( pchRequest, "timing reset" ) == 0 )
+			frame_timing_.Reset();
+		response = frame_timing_.FormatStats();
+		char line[ 160 ];
+		snprintf( line, sizeof( line ), "timing applied_vsync_to_photons_ms=%.2f adaptive=%d prediction_ms=%.2f\n",
+			applied_vsync_to_photons_.load( std::memory_order_relaxed ) * 1e3f,
+			provider_.Settings().timing_adaptive.load( std::memory_order_relaxed ) ? 1 : 0, last_prediction_seconds_.load( std::memory_order_relaxed ) * 1e3f );
+		response += line;
+	}
+	else
+	{
+		response = "commands: stats, stats reset, record start, record stop, record status, haptics, timing, timing reset\n";
+	}
+
+	// Truncate to the caller's buffer; always NUL-terminated
+	const size_t n = std::min< size_t >( response.size(), unResponseBufferSize - 1 );
+	memcpy( pchResponseBuffer, response.data(), n );
+	pchResponseBuffer[ n ] = 0;
 }
 
 //-----------------------------------------------------------------------------
@@ -259,87 +363,274 @@ vr::DriverPose_t MyHMDControllerDeviceDriver::GetPose()
 	pose.qWorldFromDriverRotation.w = 1.f;
 	pose.qDriverFromHeadRotation.w = 1.f;
 
-	// Obtain orientation from provider's IMU integration if available
-	float qw=1.f, qx=0.f, qy=0.f, qz=0.f;
-	if (auto *prov = GetMyDeviceProviderInstance()) {
-		prov->GetImuOrientation(qw,qx,qy,qz);
-		// Validate quaternion (normalize, fallback to identity if degenerate)
-		float nrm = std::sqrt(qw*qw + qx*qx + qy*qy + qz*qz);
-		if (nrm > 0.00001f && std::isfinite(nrm)) {
-			qw /= nrm; qx /= nrm; qy /= nrm; qz /= nrm;
-		} else {
-			qw = 1.f; qx = qy = qz = 0.f;
+	// One consistent snapshot (a single wait-free SeqLock read) holds orientation, position,
+	// rates and the link state; the power state is one relaxed load next to it
+	PoseSnapshot snap;
+	tracking_->pose.Load( snap );
+	const bool connected = snap.connected;
+	const bool sleeping = snap.sleeping;
+	ImuQuat q{ snap.q_w, snap.q_x, snap.q_y, snap.q_z };
+	last_pose_receive_ns_.store( snap.valid ? snap.receive_host_time_ns : 0, std::memory_order_relaxed );
+	float predicted_seconds = 0.f;
+
+	// Motion-to-photon prediction: hand vrserver the filtered rates plus the real age of the
+	// sample so it can extrapolate to photon time. Optionally integrate forward ourselves.
+	// Idle (standby/sleep): the IMU is off, so don't let vrserver extrapolate the last rates
+	if ( snap.valid && connected && !sleeping && !tracking_->power.IsIdle() )
+	{
+		const int64_t now_ns = std::chrono::duration_cast< std::chrono::nanoseconds >(
+			std::chrono::steady_clock::now().time_since_epoch() ).count();
+		pose.poseTimeOffset = static_cast< double >( snap.sample_host_time_ns - now_ns ) * 1e-9;
+		frame_timing_.AddPoseLatency( static_cast< float >( -pose.poseTimeOffset ), now_ns );
+		for ( int i = 0; i < 3; ++i )
+		{
+			pose.vecAngularVelocity[ i ] = snap.angular_velocity[ i ];
+			pose.vecAngularAcceleration[ i ] = snap.angular_acceleration[ i ];
+			pose.vecVelocity[ i ] = snap.velocity[ i ];
 		}
-	}
-	pose.qRotation.w = qw;
-	pose.qRotation.x = qx;
-	pose.qRotation.y = qy;
-	pose.qRotation.z = qz;
-
-	// Position - experimental 6DOF via accelerometer integration
-	// WARNING: This will drift! Use recenter (double-click brightness) to reset.
-	bool sleeping = false;
-	if (auto *prov = GetMyDeviceProviderInstance()) {
-		sleeping = prov->IsSleeping();
-		if (!sleeping) {
-			// Get experimental position from accelerometer integration
-			prov->GetPosition(pose.vecPosition[0], pose.vecPosition[1], pose.vecPosition[2]);
-		} else {
-			// When sleeping, use fixed position
-			pose.vecPosition[0] = 0.0f;
-			pose.vecPosition[1] = 1.0f;
-			pose.vecPosition[2] = 0.0f;
+
+		// Adaptive: also carry the sample over its measured age with the acceleration model, so
+		// vrserver's linear extrapolation only has to cover pose-to-photons
+		float h = provider_.Settings().prediction_seconds.load( std::memory_order_relaxed );
+		if ( provider_.Settings().prediction_adaptive.load( std::memory_order_relaxed ) )
+			h = std::min( h + frame_timing_.ImuToPose(), kMaxPredictionSeconds );
+		if ( h > 0.f )
+		{
+			// Rotation vector over the horizon (constant angular acceleration model), applied in driver space
+			const float rx = snap.angular_velocity[ 0 ] * h + 0.5f * snap.angular_acceleration[ 0 ] * h * h;
+			const float ry = snap.angular_velocity[ 1 ] * h + 0.5f * snap.angular_acceleration[ 1 ] * h * h;
+			const float rz = snap.angular_velocity[ 2 ] * h + 0.5f * snap.angular_acceleration[ 2 ] * h * h;
+			// q_pred = dq * q
+			q = QuatMultiply( QuatFromRotationVector( rx, ry, rz ), q );
+			// The pose now describes the predicted time, so its offset moves forward by the horizon
+			pose.poseTimeOffset += h;
+			predicted_seconds = h;
 		}
-	} else {
-		// Fallback if provider not available
-		pose.vecPosition[0] = 0.0f;
-		pose.vecPosition[1] = 1.5f;
-		pose.vecPosition[2] = 0.0f;
 	}
+	last_prediction_seconds_.store( predicted_seconds, std::memory_order_relaxed );
+
+	// Validate quaternion (normalize, fallback to identity if degenerate)
+	q = QuatNormalizeFast( q );
 
-	// The pose we provide: when sleeping, mark invalid/out-of-range to hint standby.
-	pose.poseIsValid = !sleeping;
-	if (sleeping) {
-		pose.result = vr::TrackingResult_Running_OutOfRange;
+	// Position from the pipeline's position engine (fixed, neck model or neck model plus the
+	// bounded inertial offset), carried to the same predicted time as the orientation
+	if ( !sleeping )
+	{
+		for ( int i = 0; i < 3; ++i )
+			pose.vecPosition[ i ] = snap.position[ i ] + snap.velocity[ i ] * predicted_seconds;
 	}
+	else
+	{
+		// When sleeping, use fixed position
+		pose.vecPosition[ 0 ] = 0.0f;
+		pose.vecPosition[ 1 ] = 1.0f;
+		pose.vecPosition[ 2 ] = 0.0f;
+	}
+	pose.qRotation.w = q.w;
+	pose.qRotation.x = q.x;
+	pose.qRotation.y = q.y;
+	pose.qRotation.z = q.z;
 
-	// Our device is always connected.
-	// In reality with physical devices, when they get disconnected,
-	// set this to false and icons in SteamVR will be updated to show the device is disconnected
-	pose.deviceIsConnected = true;
+	// Connected tracks the USB link: while the supervisor reconnects, SteamVR shows the HMD as
+	// disconnected and holds the last orientation (a detach republishes it with connected cleared).
+	pose.deviceIsConnected = connected;
 
-	// The state of our tracking. For our virtual device, it's always going to be ok,
-	// but this can get set differently to inform the runtime about the state of the device's tracking
-	// and update the icons to inform the user accordingly.
-	pose.result = vr::TrackingResult_Running_OK;
+	// The pose we provide: when sleeping or detached, mark invalid/out-of-range to hint standby.
+	pose.poseIsValid = connected && !sleeping;
+	pose.result = pose.poseIsValid ? vr::TrackingResult_Running_OK : vr::TrackingResult_Running_OutOfRange;
 
-	// For HMDs we want to apply rotation/motion prediction
-	pose.shouldApplyHeadModel = true;
+	// For HMDs we want to apply rotation/motion prediction; our own neck model replaces vrserver's
+	pose.shouldApplyHeadModel = provider_.Settings().position_mode.load( std::memory_order_relaxed ) == static_cast< int >( PositionMode::Fixed );
 
 	return pose;
 }
 
 void MyHMDControllerDeviceDriver::MyPoseUpdateThread()
 {
+	using clock = std::chrono::steady_clock;
+
+	// Pacing below is only as good as the sleeps: timer based, not rounded to the scheduler tick
+	const ScopedThreadPolicy thread_policy( "rayneo-pose", provider_.Settings().PoseThreadPolicy() );
+	PreciseSleeper sleeper;
+
+	uint64_t last_generation = 0;
+	clock::time_point last_publish{};
+
 	while ( is_active_ )
 	{
-		// Inform the vrserver that our tracked device's pose has updated, giving it the pose returned by our GetPose().
-		vr::VRServerDriverHost()->TrackedDevicePoseUpdated( device_index_, GetPose(), sizeof( vr::DriverPose_t ) );
+		// Rates are re-read every iteration so settings changes apply without a restart
+		const DriverSettings &settings = provider_.Settings();
+		if ( !settings.pose_event_driven.load( std::memory_order_relaxed ) )
+		{
+			// Inform the vrserver that our tracked device's pose has updated, giving it the pose returned by our GetPose().
+			MyPublishPose();
+			sleeper.SleepFor( std::chrono::milliseconds( settings.pose_fixed_period_ms.load( std::memory_order_relaxed ) ) );
+			continue;
+		}
+
+		const auto min_interval = std::chrono::duration_cast< clock::duration >(
+			std::chrono::duration< double >( 1.0 / std::max( settings.pose_max_rate_hz.load( std::memory_order_relaxed ), 1.0f ) ) );
+		const auto idle_interval = std::chrono::duration_cast< clock::duration >(
+			std::chrono::duration< double >( 1.0 / std::max( settings.pose_idle_rate_hz.load( std::memory_order_relaxed ), 0.5f ) ) );
 
-		// Update our pose every five milliseconds.
-		// In reality, you should update the pose whenever you have new data from your device.
-		std::this_thread::sleep_for( std::chrono::milliseconds( 5 ) );
+		if ( tracking_->power.IsIdle() )
+		{
+			// Standby or glasses asleep: park until woken, publishing at the standby rate so
+			// SteamVR still sees the device. Wakes immediately when the power state changes.
+			const auto standby_interval = std::chrono::duration_cast< clock::duration >(
+				std::chrono::duration< double >( 1.0 / std::max( settings.pose_standby_rate_hz.load( std::memory_order_relaxed ), 0.1f ) ) );
+			const auto remaining = last_publish + standby_interval - clock::now();
+			if ( remaining > clock::duration::zero() )
+				tracking_->power.WaitWhileIdle( remaining );
+			last_generation = tracking_->pose_signal.Generation();
+			if ( !tracking_->power.IsIdle() )
+				continue;
+		}
+		else
+		{
+			// Wake on the next fused sample; if none arrives within the idle interval publish anyway.
+			last_generation = tracking_->pose_signal.WaitFor( last_generation, idle_interval );
+
+			// Rate cap: samples arriving before min_interval has elapsed are coalesced into the
+			// next publish, which always reads the newest snapshot.
+			const auto earliest = last_publish + min_interval;
+			if ( clock::now() < earliest )
+			{
+				sleeper.SleepUntil( earliest );
+				last_generation = tracking_->pose_signal.Generation();
+			}
+		}
+
+		if ( !is_active_ )
+			break;
+
+		MyPublishPose();
+		last_publish = clock::now();
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Submit the current pose and account for it in the provider's stats. Pose thread only.
+//-----------------------------------------------------------------------------
+void MyHMDControllerDeviceDriver::MyPublishPose()
+{
+	vr::VRServerDriverHost()->TrackedDevicePoseUpdated( device_index_, GetPose(), sizeof( vr::DriverPose_t ) );
+
+	DriverStats &stats = provider_.Stats();
+	const int64_t now_ns = StatsNowNs();
+	const int64_t receive_ns = last_pose_receive_ns_.load( std::memory_order_relaxed );
+	if ( receive_ns > 0 )
+		stats.snapshot_to_pose_update.Record( now_ns - receive_ns );
+	if ( last_pose_publish_ns_ > 0 )
+		stats.pose_publish_interval.Record( now_ns - last_pose_publish_ns_ );
+	last_pose_publish_ns_ = now_ns;
+	stats.pose_updates.Add();
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Push the settings-backed device properties; called from Activate() and
+// after every settings reload. Pose rates, prediction and button timing read the cache directly.
+//-----------------------------------------------------------------------------
+void MyHMDControllerDeviceDriver::MyApplySettings()
+{
+	if ( !is_active_ )
+		return;
+
+	vr::PropertyContainerHandle_t container = vr::VRProperties()->TrackedDeviceToPropertyContainer( device_index_ );
+
+	// The distance from the user's eyes to the display in meters. This is used for reprojection.
+	vr::VRProperties()->SetFloatProperty( container, vr::Prop_UserHeadToEyeDepthMeters_Float,
+		provider_.Settings().head_to_eye_depth_m.load( std::memory_order_relaxed ) );
+
+	// How long from the compositor to submit a frame to the time it takes to display it on the screen.
+	// The setting is the glasses' own latency; adaptive timing adds what the compositor measures.
+	FrameTimingConfig timing;
+	timing.base_vsync_to_photons = provider_.Settings().seconds_from_vsync_to_photons.load( std::memory_order_relaxed );
+	timing.smoothing_time = provider_.Settings().timing_smoothing_s.load( std::memory_order_relaxed );
+	frame_timing_.SetConfig( timing );
+	MyApplyVsyncToPhotons( provider_.Settings().timing_adaptive.load( std::memory_order_relaxed ) ? frame_timing_.VsyncToPhotons() : timing.base_vsync_to_photons );
+}
+
+void MyHMDControllerDeviceDriver::MyApplyVsyncToPhotons( float seconds )
+{
+	vr::PropertyContainerHandle_t container = vr::VRProperties()->TrackedDeviceToPropertyContainer( device_index_ );
+	vr::VRProperties()->SetFloatProperty( container, vr::Prop_SecondsFromVsyncToPhotons_Float, seconds );
+	applied_vsync_to_photons_.store( seconds, std::memory_order_relaxed );
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Runs every RunFrame: hands the compositor's newest frame timings to frame_timing_ and,
+// with timing_adaptive set, republishes Prop_SecondsFromVsyncToPhotons when the estimate moved.
+// The push is rate limited so vrserver's prediction does not chase every smoothed sample.
+//-----------------------------------------------------------------------------
+void MyHMDControllerDeviceDriver::MyUpdateFrameTiming()
+{
+	vr::Compositor_FrameTiming timings[ kFrameTimingBatch ] = {};
+	for ( auto &t : timings )
+		t.m_nSize = sizeof( vr::Compositor_FrameTiming );
+	if ( vr::VRServerDriverHost()->GetFrameTimings( timings, kFrameTimingBatch ) )
+	{
+		CompositorFrameSample samples[ kFrameTimingBatch ];
+		size_t count = 0;
+		for ( const auto &t : timings )
+		{
+			if ( t.m_flSystemTimeInSeconds <= 0.0 )
+				continue; // slot the compositor had no frame for yet
+			CompositorFrameSample &sample = samples[ count++ ];
+			sample.frame_index = t.m_nFrameIndex;
+			sample.system_time = t.m_flSystemTimeInSeconds;
+			sample.vsyncs_to_first_view = t.m_nNumVSyncsToFirstView;
+			sample.presents = t.m_nNumFramePresents;
+			sample.mispresented = t.m_nNumMisPresented;
+			sample.dropped = t.m_nNumDroppedFrames;
+			sample.reprojection_flags = t.m_nReprojectionFlags;
+		}
+		frame_timing_.AddCompositorFrames( samples, count );
+	}
+
+	if ( !is_active_ || !provider_.Settings().timing_adaptive.load( std::memory_order_relaxed ) )
+		return;
+	const int64_t now_ns = StatsNowNs();
+	const float v = frame_timing_.VsyncToPhotons();
+	if ( now_ns - last_vsync_to_photons_push_ns_ >= kVsyncToPhotonsPushIntervalNs &&
+		std::fabs( v - applied_vsync_to_photons_.load( std::memory_order_relaxed ) ) >= kVsyncToPhotonsPushThreshold )
+	{
+		MyApplyVsyncToPhotons( v );
+		last_vsync_to_photons_push_ns_ = now_ns;
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Called from the provider's display discovery thread.
+//-----------------------------------------------------------------------------
+void MyHMDControllerDeviceDriver::MyUpdateDisplayConfiguration( const MyHMDDisplayDriverConfiguration &display_configuration )
+{
+	my_display_component_->SetConfiguration( display_configuration );
+	const MyHMDDisplayDriverConfiguration applied = my_display_component_->GetConfiguration();
+	frame_timing_.SetNominalRefresh( applied.display_frequency );
+	DriverLog( "RayNeo display layout: window (%d,%d) %dx%d, render %dx%d per eye, %.3f Hz", applied.window_x, applied.window_y,
+		applied.window_width, applied.window_height, applied.render_width, applied.render_height, applied.display_frequency );
+
+	if ( is_active_ )
+	{
+		vr::PropertyContainerHandle_t container = vr::VRProperties()->TrackedDeviceToPropertyContainer( device_index_ );
+		vr::VRProperties()->SetFloatProperty( container, vr::Prop_DisplayFrequency_Float, display_configuration.display_frequency );
+
+		vr::VREvent_Data_t data{};
+		vr::VRServerDriverHost()->VendorSpecificEvent( device_index_, vr::VREvent_TrackedDeviceUpdated, data, 0.0 );
 	}
 }
 
 //-----------------------------------------------------------------------------
 // Purpose: This is called by vrserver when the device should enter standby mode.
 // The device should be put into whatever low power mode it has.
-// We don't really have anything to do here, so let's just log something.
+// The provider idles the IMU and the pose thread drops to the standby rate; the provider's
+// LeaveStandby() brings both back.
 //-----------------------------------------------------------------------------
 void MyHMDControllerDeviceDriver::EnterStandby()
 {
 	DriverLog( "HMD has been put into standby." );
+	provider_.SetStandby( true );
 }
 
 //-----------------------------------------------------------------------------
@@ -354,10 +645,14 @@ void MyHMDControllerDeviceDriver::Deactivate()
 	// of the while loop, if it's running, then call .join() on the thread
 	if ( is_active_.exchange( false ) )
 	{
+		tracking_->power.Wake();
 		my_pose_update_thread_.join();
 	}
+	haptics_.Stop();
 
 	// RayNeo teardown moved to MyDeviceProvider.
+	// Held buttons and a half-finished double click must not leak into the next activation
+	provider_.InputEvents().Reset();
 
 	// unassign our controller index (we don't want to be calling vrserver anymore after Deactivate() has been called
 	device_index_ = vr::k_unTrackedDeviceIndexInvalid;
@@ -377,86 +672,45 @@ void MyHMDControllerDeviceDriver::MyRunFrame()
 	// - fTimeOffset parameter is relative to now (negative=past, positive=future)
 	// - Should include transmission latency from physical hardware
 	// Sleep signaling now handled via pose flags in GetPose()
+	const DriverSettings &settings = provider_.Settings();
+	InputEventTiming timing;
+	timing.hold_ns = int64_t( settings.button_hold_ms.load( std::memory_order_relaxed ) ) * 1'000'000;
+	timing.double_click_ns = int64_t( settings.double_click_ms.load( std::memory_order_relaxed ) ) * 1'000'000;
 
-	// Check for new button presses from RayNeo hardware
-	if (auto *prov = GetMyDeviceProviderInstance()) {
-		// System button - starts press sequence
-		if (prov->ConsumeButtonNotifyPending()) {
-			DriverLog("[HMD] System button event - starting press");
-			button_system_frames_remaining_ = 30;
-		}
-		// Trigger button
-		if (prov->ConsumeTriggerClickPending()) {
-			DriverLog("[HMD] Trigger button event - starting press");
-			button_trigger_frames_remaining_ = 30;
-		}
-		// Grip button
-		if (prov->ConsumeGripClickPending()) {
-			DriverLog("[HMD] Grip button event - starting press");
-			button_grip_frames_remaining_ = 30;
-		}
-		// App menu button - double click detection for recenter
-		if (prov->ConsumeAppMenuClickPending()) {
-			auto now = std::chrono::steady_clock::now();
-			auto time_since_last = std::chrono::duration_cast<std::chrono::milliseconds>(now - last_brightness_click_time_).count();
-			
-			if (brightness_waiting_for_double_ && time_since_last < 1000) {
-				// Double click detected - do recenter
-				DriverLog("[HMD] Brightness DOUBLE CLICK - triggering recenter");
-				prov->Recenter();
-				brightness_waiting_for_double_ = false;
-				brightness_single_click_delay_ = 0; // Cancel any pending single click
-			} else {
-				// First click - start waiting for potential double click
-				DriverLog("[HMD] Brightness click - waiting for potential double click");
-				brightness_waiting_for_double_ = true;
-				brightness_single_click_delay_ = 200; // Wait 10 frames (~50ms) for double click
-				last_brightness_click_time_ = now;
-			}
-		}
-	}
+	// Same clock as the notification timestamps (steady_clock at receipt on the RayNeo event thread)
+	const int64_t now_ns = std::chrono::duration_cast< std::chrono::nanoseconds >(
+		std::chrono::steady_clock::now().time_since_epoch() ).count();
+	provider_.InputEvents().Process( now_ns, timing, input_result_ );
 
-	// Process delayed single click for brightness button
-	if (brightness_single_click_delay_ > 0) {
-		brightness_single_click_delay_--;
-		if (brightness_single_click_delay_ == 0 && brightness_waiting_for_double_) {
-			// No double click came - process as single click (application menu)
-			DriverLog("[HMD] Brightness SINGLE CLICK - application menu");
-			button_appmenu_frames_remaining_ = 30;
-			brightness_waiting_for_double_ = false;
-		}
-	}
-
-	// Update button states based on frame counters
-	// System button
-	if (my_input_handles_[MyComponent_system_click] != vr::k_ulInvalidInputComponentHandle) {
-		bool pressed = (button_system_frames_remaining_ > 0);
-		vr::VRDriverInput()->UpdateBooleanComponent(my_input_handles_[MyComponent_system_click], pressed, 0.0);
-		if (button_system_frames_remaining_ > 0) button_system_frames_remaining_--;
-	}
+	MyUpdateFrameTiming();
 
-	// Trigger button
-	if (my_input_handles_[MyComponent_trigger_click] != vr::k_ulInvalidInputComponentHandle) {
-		bool pressed = (button_trigger_frames_remaining_ > 0);
-		vr::VRDriverInput()->UpdateBooleanComponent(my_input_handles_[MyComponent_trigger_click], pressed, 0.0);
-		if (button_trigger_frames_remaining_ > 0) button_trigger_frames_remaining_--;
+	if ( input_result_.dropped > 0 )
+		DriverLog( "[HMD] %llu button notifications dropped (input queue full)", (unsigned long long)input_result_.dropped );
+	if ( input_result_.recenter )
+	{
+		DriverLog( "[HMD] Brightness DOUBLE CLICK - triggering recenter" );
+		provider_.Recenter();
 	}
 
-	// Grip button
-	if (my_input_handles_[MyComponent_grip_click] != vr::k_ulInvalidInputComponentHandle) {
-		bool pressed = (button_grip_frames_remaining_ > 0);
-		vr::VRDriverInput()->UpdateBooleanComponent(my_input_handles_[MyComponent_grip_click], pressed, 0.0);
-		if (button_grip_frames_remaining_ > 0) button_grip_frames_remaining_--;
-	}
+	// Only transitions are sent, each with its real time relative to now
+	for ( size_t i = 0; i < input_result_.edge_count; ++i )
+	{
+		const InputEdge &edge = input_result_.edges[ i ];
+		MyComponent component = MyComponent_MAX;
+		switch ( edge.button )
+		{
+			case InputButton::System: component = MyComponent_system_click; break;
+			case InputButton::Trigger: component = MyComponent_trigger_click; break;
+			case InputButton::Grip: component = MyComponent_grip_click; break;
+			case InputButton::AppMenu: component = MyComponent_application_menu_click; break;
+			default: break;
+		}
+		if ( component == MyComponent_MAX || my_input_handles_[ component ] == vr::k_ulInvalidInputComponentHandle )
+			continue;
 
-	// App menu button
-	if (my_input_handles_[MyComponent_application_menu_click] != vr::k_ulInvalidInputComponentHandle) {
-		bool pressed = (button_appmenu_frames_remaining_ > 0);
-		vr::VRDriverInput()->UpdateBooleanComponent(my_input_handles_[MyComponent_application_menu_click], pressed, 0.0);
-		if (button_appmenu_frames_remaining_ > 0) button_appmenu_frames_remaining_--;
+		const double time_offset = static_cast< double >( edge.time_ns - now_ns ) * 1e-9;
+		vr::VRDriverInput()->UpdateBooleanComponent( my_input_handles_[ component ], edge.pressed, time_offset );
 	}
-
-	
 }
 
 
@@ -474,16 +728,16 @@ void MyHMDControllerDeviceDriver::MyProcessEvent( const vr::VREvent_t &vrevent )
 			// Verify the event is intended for our haptic component
 			if ( vrevent.data.hapticVibration.componentHandle == my_input_handles_[ MyComponent_haptic ] )
 			{
-				// Extract haptic parameters from the event
-				float duration = vrevent.data.hapticVibration.fDurationSeconds;
-				float frequency = vrevent.data.hapticVibration.fFrequency;
-				float amplitude = vrevent.data.hapticVibration.fAmplitude;
-
-				DriverLog( "Haptic event: Duration=%.2fs, Frequency=%.2fHz, Amplitude=%.2f",
-					duration, frequency, amplitude );
-
-				// TODO: Forward haptic event to RayNeo hardware
-				// For now, just log the event
+				// Enqueue only: the worker coalesces, rate limits and renders (see DebugRequest "haptics")
+				HapticPulse pulse;
+				pulse.duration_s = vrevent.data.hapticVibration.fDurationSeconds;
+				pulse.frequency_hz = vrevent.data.hapticVibration.fFrequency;
+				pulse.amplitude = vrevent.data.hapticVibration.fAmplitude;
+
+				HapticsOutputConfig config;
+				config.max_pulses_per_second = provider_.Settings().haptics_max_pulses_per_second.load( std::memory_order_relaxed );
+				config.audio_cue = provider_.Settings().haptics_audio_cue.load( std::memory_order_relaxed );
+				haptics_.Enqueue( pulse, config );
 			}
 			break;
 		}
@@ -506,9 +760,56 @@ const std::string &MyHMDControllerDeviceDriver::MyGetSerialNumber()
 // DISPLAY DRIVER METHOD DEFINITIONS
 //-----------------------------------------------------------------------------
 
-MyHMDDisplayComponent::MyHMDDisplayComponent( const MyHMDDisplayDriverConfiguration &config )
-	: config_( config )
+MyHMDDisplayComponent::MyHMDDisplayComponent( const MyHMDDisplayDriverConfiguration &config, const LensDistortionProfile &lens_profile, const DisplayProfile &display_profile )
+	: lens_profile_( lens_profile ), display_profile_( display_profile )
+{
+	config_ = ApplyDisplayProfile( config );
+	distortion_ = BuildDistortion( config_ );
+}
+
+MyHMDDisplayDriverConfiguration MyHMDDisplayComponent::ApplyDisplayProfile( const MyHMDDisplayDriverConfiguration &config ) const
+{
+	MyHMDDisplayDriverConfiguration out = config;
+	uint32_t width = 0, height = 0;
+	ComputeRenderTargetSize( display_profile_, static_cast< uint32_t >( std::max( config.window_width / 2, 1 ) ),
+		static_cast< uint32_t >( std::max( config.window_height, 1 ) ), width, height );
+	out.render_width = static_cast< int32_t >( width );
+	out.render_height = static_cast< int32_t >( height );
+	return out;
+}
+
+std::shared_ptr< const LensDistortion > MyHMDDisplayComponent::BuildDistortion( const MyHMDDisplayDriverConfiguration &config ) const
+{
+	auto distortion = std::make_shared< LensDistortion >();
+	const float eye_aspect = config.window_height > 0 ? ( config.window_width * 0.5f ) / float( config.window_height ) : 1.f;
+	distortion->Build( lens_profile_, eye_aspect );
+	return distortion;
+}
+
+std::shared_ptr< const LensDistortion > MyHMDDisplayComponent::GetDistortion() const
+{
+	std::lock_guard< std::mutex > lock( config_mutex_ );
+	return distortion_;
+}
+
+void MyHMDDisplayComponent::SetConfiguration( const MyHMDDisplayDriverConfiguration &config )
 {
+	// Build outside the lock; readers keep using the old grids until the swap
+	const MyHMDDisplayDriverConfiguration previous = GetConfiguration();
+	std::shared_ptr< const LensDistortion > distortion;
+	if ( config.window_width != previous.window_width || config.window_height != previous.window_height )
+		distortion = BuildDistortion( config );
+
+	std::lock_guard< std::mutex > lock( config_mutex_ );
+	config_ = ApplyDisplayProfile( config );
+	if ( distortion )
+		distortion_ = std::move( distortion );
+}
+
+MyHMDDisplayDriverConfiguration MyHMDDisplayComponent::GetConfiguration() const
+{
+	std::lock_guard< std::mutex > lock( config_mutex_ );
+	return config_;
 }
 
 //-----------------------------------------------------------------------------
@@ -532,8 +833,9 @@ bool MyHMDDisplayComponent::IsDisplayRealDisplay()
 //-----------------------------------------------------------------------------
 void MyHMDDisplayComponent::GetRecommendedRenderTargetSize( uint32_t *pnWidth, uint32_t *pnHeight )
 {
-	*pnWidth = config_.render_width;
-	*pnHeight = config_.render_height;
+	const MyHMDDisplayDriverConfiguration config = GetConfiguration();
+	*pnWidth = config.render_width;
+	*pnHeight = config.render_height;
 }
 
 //-----------------------------------------------------------------------------
@@ -541,13 +843,14 @@ void MyHMDDisplayComponent::GetRecommendedRenderTargetSize( uint32_t *pnWidth, u
 //-----------------------------------------------------------------------------
 void MyHMDDisplayComponent::GetEyeOutputViewport( vr::EVREye eEye, uint32_t *pnX, uint32_t *pnY, uint32_t *pnWidth, uint32_t *pnHeight )
 {
+	const MyHMDDisplayDriverConfiguration config = GetConfiguration();
 	*pnY = 0;
 
 	// Each eye will have half the window
-	*pnWidth = config_.window_width / 2;
+	*pnWidth = config.window_width / 2;
 
 	// Each eye will have the full height
-	*pnHeight = config_.window_height;
+	*pnHeight = config.window_height;
 
 	if ( eEye == vr::Eye_Left )
 	{
@@ -557,7 +860,7 @@ void MyHMDDisplayComponent::GetEyeOutputViewport( vr::EVREye eEye, uint32_t *pnX
 	else
 	{
 		// Right eye viewport on the right half of the window
-		*pnX = config_.window_width / 2;
+		*pnX = config.window_width / 2;
 	}
 }
 
@@ -566,10 +869,12 @@ void MyHMDDisplayComponent::GetEyeOutputViewport( vr::EVREye eEye, uint32_t *pnX
 //-----------------------------------------------------------------------------
 void MyHMDDisplayComponent::GetProjectionRaw( vr::EVREye eEye, float *pfLeft, float *pfRight, float *pfTop, float *pfBottom )
 {
-	*pfLeft = -1.0;
-	*pfRight = 1.0;
-	*pfTop = -1.0;
-	*pfBottom = 1.0;
+	// Immutable profile: no lock needed
+	const EyeProjection proj = ComputeEyeProjection( display_profile_, eEye == vr::Eye_Left ? 0 : 1 );
+	*pfLeft = proj.left;
+	*pfRight = proj.right;
+	*pfTop = proj.top;
+	*pfBottom = proj.bottom;
 }
 
 //-----------------------------------------------------------------------------
@@ -577,13 +882,16 @@ void MyHMDDisplayComponent::GetProjectionRaw( vr::EVREye eEye, float *pfLeft, fl
 //-----------------------------------------------------------------------------
 vr::DistortionCoordinates_t MyHMDDisplayComponent::ComputeDistortion( vr::EVREye eEye, float fU, float fV )
 {
+	LensUv uv[ 3 ];
+	GetDistortion()->Distort( eEye == vr::Eye_Left ? 0 : 1, fU, fV, uv );
+
 	vr::DistortionCoordinates_t coordinates{};
-	coordinates.rfBlue[ 0 ] = fU;
-	coordinates.rfBlue[ 1 ] = fV;
-	coordinates.rfGreen[ 0 ] = fU;
-	coordinates.rfGreen[ 1 ] = fV;
-	coordinates.rfRed[ 0 ] = fU;
-	coordinates.rfRed[ 1 ] = fV;
+	coordinates.rfRed[ 0 ] = uv[ 0 ].u;
+	coordinates.rfRed[ 1 ] = uv[ 0 ].v;
+	coordinates.rfGreen[ 0 ] = uv[ 1 ].u;
+	coordinates.rfGreen[ 1 ] = uv[ 1 ].v;
+	coordinates.rfBlue[ 0 ] = uv[ 2 ].u;
+	coordinates.rfBlue[ 1 ] = uv[ 2 ].v;
 	return coordinates;
 }
 
@@ -592,14 +900,20 @@ vr::DistortionCoordinates_t MyHMDDisplayComponent::ComputeDistortion( vr::EVREye
 //-----------------------------------------------------------------------------
 void MyHMDDisplayComponent::GetWindowBounds( int32_t *pnX, int32_t *pnY, uint32_t *pnWidth, uint32_t *pnHeight )
 {
-	*pnX = config_.window_x;
-	*pnY = config_.window_y;
-	*pnWidth = static_cast<uint32_t>(config_.window_width);
-	*pnHeight = static_cast<uint32_t>(config_.window_height);
+	const MyHMDDisplayDriverConfiguration config = GetConfiguration();
+	*pnX = config.window_x;
+	*pnY = config.window_y;
+	*pnWidth = static_cast<uint32_t>(config.window_width);
+	*pnHeight = static_cast<uint32_t>(config.window_height);
 }
 
 bool MyHMDDisplayComponent::ComputeInverseDistortion(vr::HmdVector2_t* pResult, vr::EVREye eEye, uint32_t unChannel, float fU, float fV)
 {
-	//Return false to let SteamVR infer an estimate from ComputeDistortion
-	return false;
+	// Inverse grids are baked alongside the forward ones, so vrcompositor need not search numerically
+	if ( !pResult || unChannel > 2 )
+		return false;
+	const LensUv uv = GetDistortion()->Undistort( eEye == vr::Eye_Left ? 0 : 1, static_cast< int >( unChannel ), fU, fV );
+	pResult->v[ 0 ] = uv.u;
+	pResult->v[ 1 ] = uv.v;
+	return true;
 }
\ No newline at end of file
@@ -6,12 +6,18 @@
 #include <chrono>
 
 #include "openvr_driver.h"
+#include "lens_distortion.h"
+#include "display_profile.h"
+#include "input_event_processor.h"
+#include "haptics_output.h"
+#include "frame_timing.h"
+#include "tracking_state.h"
 #include <atomic>
+#include <memory>
+#include <mutex>
 #include <thread>
 
-// Forward accessor to provider instance (implemented in device_provider.cpp)
-class MyDeviceProvider; // forward
-MyDeviceProvider* GetMyDeviceProviderInstance();
+class MyDeviceProvider;
 
 enum MyComponent
 {
@@ -37,14 +43,33 @@ struct MyHMDDisplayDriverConfiguration
 	int32_t window_width;
 	int32_t window_height;
 
+	// Per-eye recommended render target; MyHMDDisplayComponent derives it from the display profile
 	int32_t render_width;
 	int32_t render_height;
+
+	// Prop_DisplayFrequency_Float; vrcompositor paces frames on it
+	float display_frequency;
 };
 
+struct DisplayEdidInfo;
+
+// Layout used until display discovery reports the glasses (1920x1080 right of a 2560 wide desktop)
+MyHMDDisplayDriverConfiguration MyProvisionalDisplayConfiguration();
+// Layout derived from a discovered display: EDID preferred mode and desktop origin if resolved
+MyHMDDisplayDriverConfiguration MyDisplayConfigurationFromEdid( const DisplayEdidInfo &edid, bool have_desktop_coordinates, int glasses_fps );
+// Refresh for a width x height output: the mode currently driven, else the EDID timing matching the
+// glasses' reported fps, else the EDID preferred timing, else glasses_fps, else 60 Hz. Integer
+// sources (OS mode, glasses_fps) are refined to the exact EDID rate (e.g. 59.94) when one is close.
+float MyResolveDisplayFrequency( const DisplayEdidInfo *edid, uint32_t width, uint32_t height, int glasses_fps );
+// Lens calibration from the driver_rayneo settings section (lens_* keys); identity if absent
+LensDistortionProfile MyLoadLensDistortionProfile();
+// FOV / projection / render scale from the driver_rayneo settings section; nominal optics if absent
+DisplayProfile MyLoadDisplayProfile();
+
 class MyHMDDisplayComponent : public vr::IVRDisplayComponent
 {
 public:
-	explicit MyHMDDisplayComponent( const MyHMDDisplayDriverConfiguration &config );
+	MyHMDDisplayComponent( const MyHMDDisplayDriverConfiguration &config, const LensDistortionProfile &lens_profile, const DisplayProfile &display_profile );
 
 	// ----- Functions to override vr::IVRDisplayComponent -----
 	bool IsDisplayOnDesktop() override;
@@ -56,8 +81,22 @@ public:
 	void GetWindowBounds( int32_t *pnX, int32_t *pnY, uint32_t *pnWidth, uint32_t *pnHeight ) override;
 	bool ComputeInverseDistortion( vr::HmdVector2_t* pResult, vr::EVREye eEye, uint32_t unChannel, float fU, float fV) override;
 
+	// Display discovery finishes after the device was added; vrcompositor may be reading concurrently
+	void SetConfiguration( const MyHMDDisplayDriverConfiguration &config );
+	MyHMDDisplayDriverConfiguration GetConfiguration() const;
+
 private:
+	// Grids depend on the eye viewport aspect, so they are rebuilt when the layout changes
+	std::shared_ptr< const LensDistortion > BuildDistortion( const MyHMDDisplayDriverConfiguration &config ) const;
+	std::shared_ptr< const LensDistortion > GetDistortion() const;
+	// Fills render_width/height from the profile for the config's eye viewport
+	MyHMDDisplayDriverConfiguration ApplyDisplayProfile( const MyHMDDisplayDriverConfiguration &config ) const;
+
+	mutable std::mutex config_mutex_;
 	MyHMDDisplayDriverConfiguration config_;
+	LensDistortionProfile lens_profile_;
+	DisplayProfile display_profile_; // immutable after construction
+	std::shared_ptr< const LensDistortion > distortion_;
 };
 
 //-----------------------------------------------------------------------------
@@ -69,7 +108,10 @@ private:
 class MyHMDControllerDeviceDriver : public vr::ITrackedDeviceServerDriver
 {
 public:
-	MyHMDControllerDeviceDriver();
+	// tracking: the provider's pose/link/power state, shared so the pose thread can't outlive it.
+	// provider: settings, stats, input queue and the debug commands; it owns (and outlives) this device.
+	MyHMDControllerDeviceDriver( std::shared_ptr< TrackingState > tracking, MyDeviceProvider &provider,
+		const MyHMDDisplayDriverConfiguration &display_configuration = MyProvisionalDisplayConfiguration() );
 	vr::EVRInitError Activate( uint32_t unObjectId ) override;
 	void EnterStandby() override;
 	void *GetComponent( const char *pchComponentNameAndVersion ) override;
@@ -82,28 +124,54 @@ public:
 	void MyRunFrame();
 	void MyProcessEvent( const vr::VREvent_t &vrevent );
 	void MyPoseUpdateThread();
+	void MyPublishPose();
+	// Re-apply the settings-backed properties (eye depth, vsync-to-photons) after a reload
+	void MyApplySettings();
+	// Swap in the discovered display layout and tell vrserver to re-read the device
+	void MyUpdateDisplayConfiguration( const MyHMDDisplayDriverConfiguration &display_configuration );
 
 private:
+	// RunFrame: feed the compositor's newest frame timings in, push a changed vsync-to-photons out
+	void MyUpdateFrameTiming();
+	void MyApplyVsyncToPhotons( float seconds );
+
+	const std::shared_ptr< TrackingState > tracking_;
+	MyDeviceProvider &provider_;
+
 	std::unique_ptr< MyHMDDisplayComponent > my_display_component_;
 
 	std::string my_hmd_model_number_ = "SimpleHMD";
-	std::string my_hmd_serial_number_ = "SimpleHMD-123456";
+	std::string my_hmd_serial_number_;
 
 	std::array< vr::VRInputComponentHandle_t, MyComponent_MAX > my_input_handles_{};
 	std::atomic< int > frame_number_;
 	std::atomic< bool > is_active_;
 	std::atomic< uint32_t > device_index_;
 
-	// Button press duration counters (frames to hold button pressed)
-	int button_system_frames_remaining_ = 0;
-	int button_trigger_frames_remaining_ = 0;
-	int button_grip_frames_remaining_ = 0;
-	int button_appmenu_frames_remaining_ = 0;
+	// /output/haptic: fed from MyProcessEvent, running between Activate and Deactivate
+	HapticsOutput haptics_;
+
+	// Edges from the provider's InputEventProcessor, reused every RunFrame (RunFrame thread only)
+	InputEventProcessor::Result input_result_;
+
+	// Latency estimates behind Prop_SecondsFromVsyncToPhotons and the adaptive prediction horizon
+	// (see DebugRequest "timing"); the property value last pushed and when (RunFrame thread)
+	FrameTiming frame_timing_;
+	std::atomic< float > applied_vsync_to_photons_{ -1.f };
+	int64_t last_vsync_to_photons_push_ns_ = 0;
+	std::atomic< float > last_prediction_seconds_{ 0.f }; // in-driver horizon of the last GetPose()
+
+	static constexpr uint32_t kFrameTimingBatch = 8;                     // > compositor frames per RunFrame
+	static constexpr int64_t kVsyncToPhotonsPushIntervalNs = 1000000000;
+	static constexpr float kVsyncToPhotonsPushThreshold = 0.0005f;       // seconds
+	static constexpr float kMaxPredictionSeconds = 0.1f;
+
+	// Pose publishing rates, the legacy fixed-period mode and the optional in-driver prediction
+	// horizon are read from the provider's DriverSettings on every pose thread iteration.
 
-	// Double-click detection for brightness button (recenter)
-	std::chrono::steady_clock::time_point last_brightness_click_time_;
-	bool brightness_waiting_for_double_ = false;
-	int brightness_single_click_delay_ = 0; // Frames to wait before processing single click
+	// Arrival time of the snapshot behind the last GetPose(), for snapshot-to-publish latency
+	std::atomic< int64_t > last_pose_receive_ns_{ 0 };
+	int64_t last_pose_publish_ns_ = 0; // pose thread only
 
 	std::thread my_pose_update_thread_;
 };
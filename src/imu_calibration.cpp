@@ -0,0 +1,103 @@
+#include "imu_calibration.h"
+
+#include <cmath>
+
+bool GyroBiasEstimator::Update( const float gyro[ 3 ], const float accel[ 3 ], float dt )
+{
+	if ( !( dt > 0.f ) )
+		return IsStill();
+
+	if ( !have_means_ )
+	{
+		for ( int i = 0; i < 3; ++i )
+		{
+			gyro_mean_[ i ] = gyro[ i ];
+			accel_mean_[ i ] = accel[ i ];
+		}
+		have_means_ = true;
+		return false;
+	}
+
+	const float a_detect = dt / ( params_.detector_time_constant + dt );
+	bool still = true;
+	bool near_bias = true;
+	for ( int i = 0; i < 3; ++i )
+	{
+		gyro_mean_[ i ] += a_detect * ( gyro[ i ] - gyro_mean_[ i ] );
+		accel_mean_[ i ] += a_detect * ( accel[ i ] - accel_mean_[ i ] );
+
+		if ( std::fabs( gyro[ i ] - gyro_mean_[ i ] ) > params_.still_gyro_noise )
+			still = false;
+		if ( std::fabs( gyro_mean_[ i ] ) > params_.max_bias )
+			still = false;
+		if ( std::fabs( accel[ i ] - accel_mean_[ i ] ) > params_.still_accel_noise )
+			still = false;
+		if ( std::fabs( gyro_mean_[ i ] - bias_[ i ] ) > params_.still_max_rate )
+			near_bias = false;
+	}
+
+	// Until it has backing the estimate is no reference yet; the first still period sets it
+	if ( still && !near_bias && learned_seconds_ >= params_.reference_time )
+	{
+		off_bias_time_ += dt;
+		if ( off_bias_time_ < params_.relearn_time )
+			still = false;
+		else
+			learned_seconds_ = 0.f;
+	}
+	else
+	{
+		off_bias_time_ = 0.f;
+	}
+
+	if ( !still )
+	{
+		still_time_ = 0.f;
+		return false;
+	}
+
+	still_time_ += dt;
+	if ( still_time_ < params_.still_time )
+		return false;
+
+	// Start from the detector's mean, which already averages detector_time_constant of rest (a
+	// single raw sample is as noisy as the gyro), then average every still sample into it with
+	// that head start as its weight; once the estimate has backing, follow it slowly
+	if ( learned_seconds_ <= 0.f )
+	{
+		for ( int i = 0; i < 3; ++i )
+			bias_[ i ] = gyro_mean_[ i ];
+	}
+	const float backing = learned_seconds_ + params_.detector_time_constant + dt;
+	const float tau = backing < params_.learn_time_constant ? backing : params_.learn_time_constant;
+	const float a_learn = dt / tau;
+	for ( int i = 0; i < 3; ++i )
+		bias_[ i ] += a_learn * ( gyro[ i ] - bias_[ i ] );
+	learned_seconds_ += dt;
+	return true;
+}
+
+void GyroBiasEstimator::GetBias( float out[ 3 ] ) const
+{
+	for ( int i = 0; i < 3; ++i )
+		out[ i ] = bias_[ i ];
+}
+
+bool GyroBiasEstimator::SetBias( const float bias[ 3 ], float learned_seconds )
+{
+	for ( int i = 0; i < 3; ++i )
+	{
+		if ( !( std::fabs( bias[ i ] ) <= params_.max_bias ) )
+			return false;
+	}
+	for ( int i = 0; i < 3; ++i )
+		bias_[ i ] = bias[ i ];
+	learned_seconds_ = learned_seconds > 0.f ? learned_seconds : 0.f;
+	off_bias_time_ = 0.f;
+	return true;
+}
+
+void GyroBiasEstimator::Reset()
+{
+	*this = GyroBiasEstimator( params_ );
+}
@@ -0,0 +1,68 @@
+// Online gyroscope bias estimation for the RayNeo IMU (stillness detection + slow averaging).
+#pragma once
+
+struct GyroBiasEstimatorParams
+{
+	// Sample-to-sample noise allowed around the short-term gyro mean while still (rad/s)
+	float still_gyro_noise = 0.03f;
+	// Largest plausible bias (consumer MEMS gyros sit well inside 0.02 rad/s); a steady rate
+	// above this is real motion, not bias (rad/s)
+	float max_bias = 0.02f;
+	// Once the estimate has backing (reference_time), the short-term mean minus the current bias must stay within
+	// this to count as still: a slow, steady turn is as smooth as rest (low variance, constant
+	// gravity) and would otherwise be learned as bias (rad/s)
+	float still_max_rate = 0.005f;
+	// A residual above still_max_rate that stays smooth this long is the bias having moved
+	// (temperature, a stale cache), not a turn: learning restarts from scratch (seconds)
+	float relearn_time = 20.f;
+	// Still time behind the estimate before it is the reference for still_max_rate (seconds)
+	float reference_time = 1.f;
+	// Accelerometer deviation from its short-term mean allowed while still (g)
+	float still_accel_noise = 0.02f;
+	// How long the head must be still before samples feed the bias average (seconds)
+	float still_time = 0.5f;
+	// Time constant of the short-term means used by the detector (seconds)
+	float detector_time_constant = 0.2f;
+	// Time constant of the bias average once still (seconds)
+	float learn_time_constant = 4.0f;
+};
+
+//-----------------------------------------------------------------------------
+// Purpose: Learns per-axis gyro bias whenever the head is stationary.
+// Operates on gyro in rad/s (after the pipeline's gyro_scale) and accelerometer in g.
+// Still means all of: gyro and accelerometer smooth around their short-term means, the gyro mean
+// within max_bias, and, once reference_time backs the estimate, within still_max_rate of it.
+// Constant time, no allocation.
+//-----------------------------------------------------------------------------
+class GyroBiasEstimator
+{
+public:
+	explicit GyroBiasEstimator( const GyroBiasEstimatorParams &params = {} ) : params_( params ) {}
+
+	// Returns true while the detector considers the head still.
+	bool Update( const float gyro[ 3 ], const float accel[ 3 ], float dt );
+
+	void GetBias( float out[ 3 ] ) const;
+	// Seed from a persisted calibration; learned_seconds is how much still time backed it.
+	// Returns false, keeping the current estimate, for a bias beyond max_bias (it can only have
+	// come from motion).
+	bool SetBias( const float bias[ 3 ], float learned_seconds );
+
+	bool IsStill() const { return still_time_ >= params_.still_time; }
+	// Total still time that has gone into the estimate (a rough confidence measure)
+	float LearnedSeconds() const { return learned_seconds_; }
+
+	void SetParams( const GyroBiasEstimatorParams &params ) { params_ = params; }
+	void Reset();
+
+private:
+	GyroBiasEstimatorParams params_;
+
+	float bias_[ 3 ] = { 0.f, 0.f, 0.f };
+	float gyro_mean_[ 3 ] = { 0.f, 0.f, 0.f };
+	float accel_mean_[ 3 ] = { 0.f, 0.f, 0.f };
+	bool have_means_ = false;
+	float still_time_ = 0.f;
+	float off_bias_time_ = 0.f; // smooth, plausible, but away from the estimate (see relearn_time)
+	float learned_seconds_ = 0.f;
+};
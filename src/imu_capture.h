@@ -0,0 +1,105 @@
+// Compact binary capture of RayNeo IMU streams, written by the driver's recorder and replayed by
+// rayneo_tracking_bench. Little-endian, fixed-width records after a fixed-size header.
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+static constexpr char kImuCaptureMagic[ 8 ] = { 'R', 'N', 'I', 'M', 'U', 'C', 'A', 'P' };
+static constexpr uint32_t kImuCaptureVersion = 1;
+
+// Record flags
+static constexpr uint32_t kImuCaptureValid = 1u << 0;        // SDK marked the sample valid
+static constexpr uint32_t kImuCaptureHasReference = 1u << 1; // reference_q holds a pose to compare against
+
+//-----------------------------------------------------------------------------
+// Purpose: File header. record_count may lag the file while a capture is still being written
+// (the recorder rewrites it at checkpoints); readers trust the file size over it.
+//-----------------------------------------------------------------------------
+struct ImuCaptureHeader
+{
+	char magic[ 8 ];
+	uint32_t version;
+	uint32_t header_size;
+	uint32_t record_size;
+	uint32_t flags;
+	int64_t start_host_time_ns; // steady_clock of the first record's receive time, 0 if unknown
+	uint64_t record_count;
+	char source[ 32 ];          // free text, e.g. device key or "synthetic"
+	uint32_t reserved[ 2 ];
+};
+static_assert( sizeof( ImuCaptureHeader ) == 80, "ImuCaptureHeader layout is part of the file format" );
+
+//-----------------------------------------------------------------------------
+// Purpose: One IMU sample plus, optionally, the orientation it should produce: ground truth for
+// synthetic captures, the driver's fused output for recorded sessions.
+//-----------------------------------------------------------------------------
+struct ImuCaptureRecord
+{
+	uint32_t tick;            // device tick (ms)
+	uint32_t flags;
+	float gyro_rad[ 3 ];
+	float gyro_dps[ 3 ];
+	float acc[ 3 ];
+	float reference_q[ 4 ];   // w, x, y, z
+	uint32_t reserved;
+	int64_t receive_host_time_ns;
+};
+static_assert( sizeof( ImuCaptureRecord ) == 72, "ImuCaptureRecord layout is part of the file format" );
+
+inline ImuCaptureHeader MakeImuCaptureHeader( const char *source )
+{
+	ImuCaptureHeader header{};
+	std::memcpy( header.magic, kImuCaptureMagic, sizeof( header.magic ) );
+	header.version = kImuCaptureVersion;
+	header.header_size = sizeof( ImuCaptureHeader );
+	header.record_size = sizeof( ImuCaptureRecord );
+	if ( source )
+		std::strncpy( header.source, source, sizeof( header.source ) - 1 );
+	return header;
+}
+
+inline bool IsValidImuCaptureHeader( const ImuCaptureHeader &header )
+{
+	return std::memcmp( header.magic, kImuCaptureMagic, sizeof( kImuCaptureMagic ) ) == 0 && header.version == kImuCaptureVersion &&
+		header.header_size >= sizeof( ImuCaptureHeader ) && header.record_size >= sizeof( ImuCaptureRecord );
+}
+
+// Loads a whole capture; tolerates a truncated final record and a stale record_count.
+inline bool ReadImuCapture( const char *path, ImuCaptureHeader &header, std::vector< ImuCaptureRecord > &records )
+{
+	records.clear();
+	FILE *f = std::fopen( path, "rb" );
+	if ( !f )
+		return false;
+
+	bool ok = std::fread( &header, sizeof( header ), 1, f ) == 1 && IsValidImuCaptureHeader( header ) &&
+		std::fseek( f, static_cast< long >( header.header_size ), SEEK_SET ) == 0;
+	if ( ok )
+	{
+		// Newer writers may append fields to a record; only the known prefix is read
+		std::vector< unsigned char > buf( header.record_size );
+		while ( std::fread( buf.data(), buf.size(), 1, f ) == 1 )
+		{
+			ImuCaptureRecord rec;
+			std::memcpy( &rec, buf.data(), sizeof( rec ) );
+			records.push_back( rec );
+		}
+	}
+	std::fclose( f );
+	return ok;
+}
+
+inline bool WriteImuCapture( const char *path, ImuCaptureHeader header, const std::vector< ImuCaptureRecord > &records )
+{
+	FILE *f = std::fopen( path, "wb" );
+	if ( !f )
+		return false;
+	header.record_count = records.size();
+	bool ok = std::fwrite( &header, sizeof( header ), 1, f ) == 1;
+	if ( ok && !records.empty() )
+		ok = std::fwrite( records.data(), sizeof( ImuCaptureRecord ), records.size(), f ) == records.size();
+	return std::fclose( f ) == 0 && ok;
+}
@@ -0,0 +1,52 @@
+// Maps RayNeo IMU sample ticks onto the host steady_clock so pose timestamps refer to when a
+// sample was measured rather than when the SDK handed it to us.
+#pragma once
+
+#include <cstdint>
+
+//-----------------------------------------------------------------------------
+// Purpose: Tracks the offset between the device tick (milliseconds) and host time.
+// Transport delay is always positive, so the smallest observed (host - tick) is the best
+// estimate of the true offset. The minimum is allowed to creep upward slowly so clock drift
+// between the glasses and the host does not pin it to a stale value.
+//-----------------------------------------------------------------------------
+class ImuClockSync
+{
+public:
+	// Feed one sample; returns the estimated host time (ns) at which the sample was taken.
+	int64_t Update( uint32_t tick_ms, int64_t receive_host_ns )
+	{
+		// Device restarted (or tick wrapped): start over
+		if ( have_offset_ && tick_ms < last_tick_ms_ )
+			have_offset_ = false;
+		last_tick_ms_ = tick_ms;
+
+		const int64_t tick_ns = static_cast< int64_t >( tick_ms ) * 1000000;
+		const int64_t offset = receive_host_ns - tick_ns;
+		if ( !have_offset_ || offset < offset_ns_ )
+		{
+			offset_ns_ = offset;
+			have_offset_ = true;
+		}
+		else
+		{
+			offset_ns_ += kDriftAllowanceNsPerSample;
+		}
+
+		int64_t sample_ns = tick_ns + offset_ns_;
+		// Never report a sample as newer than its arrival
+		if ( sample_ns > receive_host_ns )
+			sample_ns = receive_host_ns;
+		return sample_ns;
+	}
+
+	void Reset() { have_offset_ = false; }
+
+private:
+	// 0.1 ms per second of creep at 1 kHz: tolerates ~100 ppm of relative clock drift.
+	static constexpr int64_t kDriftAllowanceNsPerSample = 100;
+
+	int64_t offset_ns_ = 0;
+	uint32_t last_tick_ms_ = 0;
+	bool have_offset_ = false;
+};
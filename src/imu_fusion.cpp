@@ -0,0 +1,311 @@
+#include "imu_fusion.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace {
+
+void Cross( const float a[ 3 ], const float b[ 3 ], float out[ 3 ] )
+{
+	out[ 0 ] = a[ 1 ] * b[ 2 ] - a[ 2 ] * b[ 1 ];
+	out[ 1 ] = a[ 2 ] * b[ 0 ] - a[ 0 ] * b[ 2 ];
+	out[ 2 ] = a[ 0 ] * b[ 1 ] - a[ 1 ] * b[ 0 ];
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: State and helpers shared by every filter: orientation, bias, gravity reference.
+//-----------------------------------------------------------------------------
+class FusionFilterBase : public IImuFusionFilter
+{
+public:
+	explicit FusionFilterBase( const ImuFusionParams &params ) : params_( params ) {}
+
+	void GetGyroBias( float out[ 3 ] ) const override { std::memcpy( out, bias_, sizeof( bias_ ) ); }
+	void SetGyroBias( const float bias[ 3 ] ) override { std::memcpy( bias_, bias, sizeof( bias_ ) ); }
+
+	// Filters with accelerometer feedback are inherently sequential; GyroOnly overrides this
+	void UpdateBatch( const float *gyro, const float *accel, const float *dt, size_t n, ImuQuat *orientations_out ) override
+	{
+		for ( size_t i = 0; i < n; ++i )
+		{
+			Update( gyro + 3 * i, accel + 3 * i, dt[ i ] );
+			if ( orientations_out )
+				orientations_out[ i ] = q_;
+		}
+	}
+
+	ImuQuat GetOrientation() const override { return q_; }
+	void SetOrientation( const ImuQuat &q ) override
+	{
+		q_ = QuatNormalizeFast( q );
+		// Re-level against the next trusted accelerometer sample. The snap is a tilt-only shortest
+		// arc, so yaw carries over and an already level orientation barely moves.
+		have_reference_ = false;
+	}
+
+	void SetParams( const ImuFusionParams &params ) override { params_ = params; }
+
+	void Reset() override
+	{
+		q_ = {};
+		bias_[ 0 ] = bias_[ 1 ] = bias_[ 2 ] = 0.f;
+		have_reference_ = false;
+	}
+
+protected:
+	// q = q * dq(omega * dt), with the per-step angle clamped like the original integrator
+	void IntegrateBodyRate( float wx, float wy, float wz, float dt )
+	{
+		const float mag = std::sqrt( wx * wx + wy * wy + wz * wz );
+		float angle = mag * dt;
+		if ( angle > params_.max_step )
+			angle = params_.max_step;
+		if ( !( angle > 0.f ) )
+			return;
+		const float half = angle * 0.5f;
+		const float s = std::sin( half ) / mag;
+		const ImuQuat dq{ std::cos( half ), wx * s, wy * s, wz * s };
+		q_ = QuatNormalizeFast( QuatMultiply( q_, dq ) );
+	}
+
+	// Computes the tilt error e = a_measured x v_predicted (body frame, both unit length).
+	// Returns false when the accelerometer can't be trusted for this sample.
+	bool TiltError( const float accel[ 3 ], float e[ 3 ], float *cos_angle = nullptr )
+	{
+		const float norm = std::sqrt( accel[ 0 ] * accel[ 0 ] + accel[ 1 ] * accel[ 1 ] + accel[ 2 ] * accel[ 2 ] );
+		if ( !( norm > 0.05f ) || std::fabs( norm - 1.f ) > params_.accel_gate_g )
+			return false;
+		const float a[ 3 ] = { accel[ 0 ] / norm, accel[ 1 ] / norm, accel[ 2 ] / norm };
+
+		if ( !have_reference_ )
+		{
+			AlignToGravity( a );
+			e[ 0 ] = e[ 1 ] = e[ 2 ] = 0.f;
+			return false;
+		}
+
+		float v[ 3 ];
+		QuatRotateInverse( q_, reference_, v );
+		Cross( a, v, e );
+		if ( cos_angle )
+			*cos_angle = a[ 0 ] * v[ 0 ] + a[ 1 ] * v[ 1 ] + a[ 2 ] * v[ 2 ];
+		return true;
+	}
+
+	ImuFusionParams params_;
+	ImuQuat q_;
+	float bias_[ 3 ] = { 0.f, 0.f, 0.f };
+
+private:
+	// First trusted sample: pick the world vertical that matches the SDK's accelerometer sign
+	// convention and level the orientation to it (yaw stays at zero).
+	void AlignToGravity( const float a[ 3 ] )
+	{
+		float world[ 3 ];
+		// Where the measured vector points once the current (gyro-only) orientation is applied
+		QuatRotate( q_, a, world );
+		reference_[ 0 ] = 0.f;
+		reference_[ 1 ] = world[ 1 ] >= 0.f ? 1.f : -1.f;
+		reference_[ 2 ] = 0.f;
+		have_reference_ = true;
+
+		// Shortest arc taking the measured direction onto the reference: q = q * r, where r rotates
+		// the current predicted reference v onto a in body frame
+		float v[ 3 ];
+		QuatRotateInverse( q_, reference_, v );
+		float axis[ 3 ];
+		Cross( v, a, axis );
+		const float d = v[ 0 ] * a[ 0 ] + v[ 1 ] * a[ 1 ] + v[ 2 ] * a[ 2 ];
+		ImuQuat r{ 1.f + d, axis[ 0 ], axis[ 1 ], axis[ 2 ] };
+		if ( r.w < 1e-6f )
+			return; // upside down relative to the guess; leave it to the gyro
+		// r maps v onto a; the body needs the inverse applied so that v lines up with a
+		r = QuatNormalizeFast( r );
+		q_ = QuatNormalizeFast( QuatMultiply( q_, QuatConjugate( r ) ) );
+	}
+
+	float reference_[ 3 ] = { 0.f, 1.f, 0.f };
+	bool have_reference_ = false;
+};
+
+//-----------------------------------------------------------------------------
+// Purpose: The original integrator: gyro only, no tilt correction, no bias tracking.
+//-----------------------------------------------------------------------------
+class GyroOnlyFilter final : public FusionFilterBase
+{
+public:
+	using FusionFilterBase::FusionFilterBase;
+
+	ImuFusionType Type() const override { return ImuFusionType::GyroOnly; }
+	const char *Name() const override { return "gyro"; }
+
+	void Update( const float gyro[ 3 ], const float /*accel*/[ 3 ], float dt ) override
+	{
+		IntegrateBodyRate( gyro[ 0 ] - bias_[ 0 ], gyro[ 1 ] - bias_[ 1 ], gyro[ 2 ] - bias_[ 2 ], dt );
+	}
+
+	// Nothing feeds back per sample, so a drained batch is one vectorized integration
+	void UpdateBatch( const float *gyro, const float * /*accel*/, const float *dt, size_t n, ImuQuat *orientations_out ) override
+	{
+		constexpr size_t kChunk = 64;
+		float w[ 3 * kChunk ];
+		for ( size_t done = 0; done < n; )
+		{
+			const size_t m = std::min( kChunk, n - done );
+			for ( size_t i = 0; i < m; ++i )
+				for ( int k = 0; k < 3; ++k )
+					w[ 3 * i + k ] = gyro[ 3 * ( done + i ) + k ] - bias_[ k ];
+			q_ = IntegrateGyroBatch( q_, w, dt + done, m, params_.max_step, orientations_out ? orientations_out + done : nullptr );
+			done += m;
+		}
+	}
+};
+
+//-----------------------------------------------------------------------------
+// Purpose: Gyro integration followed by a small rotation toward the accelerometer tilt.
+//-----------------------------------------------------------------------------
+class ComplementaryFilter final : public FusionFilterBase
+{
+public:
+	using FusionFilterBase::FusionFilterBase;
+
+	ImuFusionType Type() const override { return ImuFusionType::Complementary; }
+	const char *Name() const override { return "complementary"; }
+
+	void Update( const float gyro[ 3 ], const float accel[ 3 ], float dt ) override
+	{
+		IntegrateBodyRate( gyro[ 0 ] - bias_[ 0 ], gyro[ 1 ] - bias_[ 1 ], gyro[ 2 ] - bias_[ 2 ], dt );
+
+		float e[ 3 ];
+		float cos_angle = 1.f;
+		if ( !TiltError( accel, e, &cos_angle ) )
+			return;
+		const float sin_angle = std::sqrt( e[ 0 ] * e[ 0 ] + e[ 1 ] * e[ 1 ] + e[ 2 ] * e[ 2 ] );
+		if ( !( sin_angle > 1e-7f ) )
+			return;
+		// Rotate a fraction of the way: per-sample blend of a first order low-pass
+		const float alpha = dt / ( params_.complementary_time_constant + dt );
+		const float angle = std::atan2( sin_angle, cos_angle ) * alpha;
+		const float s = std::sin( angle * 0.5f ) / sin_angle;
+		q_ = QuatNormalizeFast( QuatMultiply( q_, ImuQuat{ std::cos( angle * 0.5f ), e[ 0 ] * s, e[ 1 ] * s, e[ 2 ] * s } ) );
+	}
+};
+
+//-----------------------------------------------------------------------------
+// Purpose: Mahony explicit complementary filter (PI controller on the tilt error).
+//-----------------------------------------------------------------------------
+class MahonyFilter final : public FusionFilterBase
+{
+public:
+	using FusionFilterBase::FusionFilterBase;
+
+	ImuFusionType Type() const override { return ImuFusionType::Mahony; }
+	const char *Name() const override { return "mahony"; }
+
+	void Update( const float gyro[ 3 ], const float accel[ 3 ], float dt ) override
+	{
+		float wx = gyro[ 0 ] - bias_[ 0 ];
+		float wy = gyro[ 1 ] - bias_[ 1 ];
+		float wz = gyro[ 2 ] - bias_[ 2 ];
+
+		float e[ 3 ];
+		if ( TiltError( accel, e ) )
+		{
+			// Integral term: a persistent error means the gyro reads off by a constant
+			bias_[ 0 ] -= params_.mahony_ki * e[ 0 ] * dt;
+			bias_[ 1 ] -= params_.mahony_ki * e[ 1 ] * dt;
+			bias_[ 2 ] -= params_.mahony_ki * e[ 2 ] * dt;
+			wx += params_.mahony_kp * e[ 0 ];
+			wy += params_.mahony_kp * e[ 1 ];
+			wz += params_.mahony_kp * e[ 2 ];
+		}
+		IntegrateBodyRate( wx, wy, wz, dt );
+	}
+};
+
+//-----------------------------------------------------------------------------
+// Purpose: Madgwick gradient-descent filter. For the single gravity reference the normalized
+// objective gradient reduces to the unit tilt-error axis, so the correction is a fixed-rate
+// (beta) rotation toward the accelerometer; zeta integrates the same axis into the gyro bias.
+//-----------------------------------------------------------------------------
+class MadgwickFilter final : public FusionFilterBase
+{
+public:
+	using FusionFilterBase::FusionFilterBase;
+
+	ImuFusionType Type() const override { return ImuFusionType::Madgwick; }
+	const char *Name() const override { return "madgwick"; }
+
+	void Update( const float gyro[ 3 ], const float accel[ 3 ], float dt ) override
+	{
+		float wx = gyro[ 0 ] - bias_[ 0 ];
+		float wy = gyro[ 1 ] - bias_[ 1 ];
+		float wz = gyro[ 2 ] - bias_[ 2 ];
+
+		float e[ 3 ];
+		if ( TiltError( accel, e ) )
+		{
+			const float n = std::sqrt( e[ 0 ] * e[ 0 ] + e[ 1 ] * e[ 1 ] + e[ 2 ] * e[ 2 ] );
+			if ( n > 1e-7f )
+			{
+				const float inv = 1.f / n;
+				e[ 0 ] *= inv; e[ 1 ] *= inv; e[ 2 ] *= inv;
+				bias_[ 0 ] -= params_.madgwick_zeta * e[ 0 ] * dt;
+				bias_[ 1 ] -= params_.madgwick_zeta * e[ 1 ] * dt;
+				bias_[ 2 ] -= params_.madgwick_zeta * e[ 2 ] * dt;
+				// q_dot = 0.5 q (x) omega - beta * grad/|grad|  ==  0.5 q (x) (omega + 2 beta e)
+				wx += 2.f * params_.madgwick_beta * e[ 0 ];
+				wy += 2.f * params_.madgwick_beta * e[ 1 ];
+				wz += 2.f * params_.madgwick_beta * e[ 2 ];
+			}
+		}
+		IntegrateBodyRate( wx, wy, wz, dt );
+	}
+};
+
+} // namespace
+
+std::unique_ptr< IImuFusionFilter > CreateImuFusionFilter( ImuFusionType type, const ImuFusionParams &params )
+{
+	switch ( type )
+	{
+		case ImuFusionType::GyroOnly:
+			return std::make_unique< GyroOnlyFilter >( params );
+		case ImuFusionType::Complementary:
+			return std::make_unique< ComplementaryFilter >( params );
+		case ImuFusionType::Madgwick:
+			return std::make_unique< MadgwickFilter >( params );
+		case ImuFusionType::Mahony:
+		default:
+			return std::make_unique< MahonyFilter >( params );
+	}
+}
+
+const char *ImuFusionTypeName( ImuFusionType type )
+{
+	switch ( type )
+	{
+		case ImuFusionType::GyroOnly: return "gyro";
+		case ImuFusionType::Complementary: return "complementary";
+		case ImuFusionType::Mahony: return "mahony";
+		case ImuFusionType::Madgwick: return "madgwick";
+	}
+	return "unknown";
+}
+
+bool ParseImuFusionType( const char *name, ImuFusionType &out )
+{
+	if ( !name )
+		return false;
+	static const ImuFusionType kTypes[] = { ImuFusionType::GyroOnly, ImuFusionType::Complementary, ImuFusionType::Mahony, ImuFusionType::Madgwick };
+	for ( ImuFusionType t : kTypes )
+	{
+		if ( std::strcmp( name, ImuFusionTypeName( t ) ) == 0 )
+		{
+			out = t;
+			return true;
+		}
+	}
+	return false;
+}
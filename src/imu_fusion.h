@@ -0,0 +1,73 @@
+// Orientation fusion filters for the RayNeo IMU (gyro integration with accelerometer tilt correction).
+#pragma once
+
+#include <cstddef>
+#include <memory>
+
+#include "imu_math.h"
+
+enum class ImuFusionType
+{
+	GyroOnly,      // legacy: plain gyro integration, no drift correction
+	Complementary, // gyro integration nudged toward the accelerometer tilt
+	Mahony,        // PI feedback on the tilt error (integral term tracks gyro bias)
+	Madgwick,      // normalized gradient-descent correction with gyro bias drift compensation
+};
+
+struct ImuFusionParams
+{
+	// Largest rotation integrated from a single sample (radians); guards against tick glitches
+	float max_step = 0.35f;
+
+	// Accelerometer samples whose magnitude differs from 1 g by more than this are treated as
+	// linear motion and not used for tilt correction
+	float accel_gate_g = 0.15f;
+
+	// Complementary: time constant (seconds) of the pull toward the accelerometer tilt
+	float complementary_time_constant = 2.0f;
+
+	// Mahony proportional / integral gains
+	float mahony_kp = 0.5f;
+	float mahony_ki = 0.02f;
+
+	// Madgwick gradient step (rad/s) and bias drift gain
+	float madgwick_beta = 0.04f;
+	float madgwick_zeta = 0.005f;
+};
+
+//-----------------------------------------------------------------------------
+// Purpose: Common interface for the fusion engines. Update() runs in constant time and never
+// allocates, so it is safe to call from the IMU thread at full sensor rate.
+// Orientation maps the sensor (body) frame into the driver's world frame (Y up).
+//-----------------------------------------------------------------------------
+class IImuFusionFilter
+{
+public:
+	virtual ~IImuFusionFilter() = default;
+
+	virtual ImuFusionType Type() const = 0;
+	virtual const char *Name() const = 0;
+
+	// gyro: body-frame angular rate in rad/s, accel: body-frame specific force in g, dt in seconds
+	virtual void Update( const float gyro[ 3 ], const float accel[ 3 ], float dt ) = 0;
+	// n samples at once (gyro and accel packed float[3] each), same result as n Update() calls;
+	// orientations_out, if given, receives the orientation after every sample
+	virtual void UpdateBatch( const float *gyro, const float *accel, const float *dt, size_t n, ImuQuat *orientations_out ) = 0;
+
+	// Current gyro bias estimate (rad/s, body frame); already subtracted inside Update()
+	virtual void GetGyroBias( float out[ 3 ] ) const = 0;
+	virtual void SetGyroBias( const float bias[ 3 ] ) = 0;
+
+	virtual ImuQuat GetOrientation() const = 0;
+	virtual void SetOrientation( const ImuQuat &q ) = 0;
+
+	virtual void SetParams( const ImuFusionParams &params ) = 0;
+	virtual void Reset() = 0;
+};
+
+std::unique_ptr< IImuFusionFilter > CreateImuFusionFilter( ImuFusionType type, const ImuFusionParams &params = {} );
+
+const char *ImuFusionTypeName( ImuFusionType type );
+
+// Accepts "gyro", "complementary", "mahony" or "madgwick"; returns false if unknown
+bool ParseImuFusionType( const char *name, ImuFusionType &out );
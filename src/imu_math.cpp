@@ -0,0 +1,254 @@
+#include "imu_math.h"
+
+#include <algorithm>
+#include <initializer_list>
+
+namespace
+{
+	// Taylor coefficients of sin(h) through h^11 and cos(h) through h^12. The half step angle is
+	// at most pi/2 (fusion_max_step <= 3.14), where both stay within float rounding.
+	constexpr float kSin3 = -1.f / 6.f, kSin5 = 1.f / 120.f, kSin7 = -1.f / 5040.f, kSin9 = 1.f / 362880.f, kSin11 = -1.f / 39916800.f;
+	constexpr float kCos2 = -1.f / 2.f, kCos4 = 1.f / 24.f, kCos6 = -1.f / 720.f, kCos8 = 1.f / 40320.f, kCos10 = -1.f / 3628800.f,
+		kCos12 = 1.f / 479001600.f;
+
+	// dq(w * dt) for one sample, the same polynomial the vector lanes evaluate
+	ImuQuat StepQuat( const float w[ 3 ], float dt, float max_step )
+	{
+		const float mag = std::sqrt( w[ 0 ] * w[ 0 ] + w[ 1 ] * w[ 1 ] + w[ 2 ] * w[ 2 ] );
+		const float angle = std::min( mag * dt, max_step );
+		if ( !( angle > 0.f ) )
+			return {};
+		const float h = 0.5f * angle, h2 = h * h;
+		const float sin_h = h * ( 1.f + h2 * ( kSin3 + h2 * ( kSin5 + h2 * ( kSin7 + h2 * ( kSin9 + h2 * kSin11 ) ) ) ) );
+		const float cos_h = 1.f + h2 * ( kCos2 + h2 * ( kCos4 + h2 * ( kCos6 + h2 * ( kCos8 + h2 * ( kCos10 + h2 * kCos12 ) ) ) ) );
+		const float s = sin_h / mag;
+		return { cos_h, w[ 0 ] * s, w[ 1 ] * s, w[ 2 ] * s };
+	}
+
+#if defined( IMU_MATH_SSE )
+	// Hamilton product on w, x, y, z lanes (ImuQuat's memory order, so no layout shuffles)
+	inline __m128 QuatMul4( __m128 a, __m128 b )
+	{
+		const __m128 t1 = _mm_shuffle_ps( b, b, _MM_SHUFFLE( 2, 3, 0, 1 ) ); // bx bw bz by
+		const __m128 t2 = _mm_shuffle_ps( b, b, _MM_SHUFFLE( 1, 0, 3, 2 ) ); // by bz bw bx
+		const __m128 t3 = _mm_shuffle_ps( b, b, _MM_SHUFFLE( 0, 1, 2, 3 ) ); // bz by bx bw
+		const __m128 s1 = _mm_setr_ps( -0.f, 0.f, -0.f, 0.f );
+		const __m128 s2 = _mm_setr_ps( -0.f, 0.f, 0.f, -0.f );
+		const __m128 s3 = _mm_setr_ps( -0.f, -0.f, 0.f, 0.f );
+		__m128 p = _mm_mul_ps( _mm_shuffle_ps( a, a, _MM_SHUFFLE( 0, 0, 0, 0 ) ), b );
+		p = _mm_add_ps( p, _mm_mul_ps( _mm_shuffle_ps( a, a, _MM_SHUFFLE( 1, 1, 1, 1 ) ), _mm_xor_ps( t1, s1 ) ) );
+		p = _mm_add_ps( p, _mm_mul_ps( _mm_shuffle_ps( a, a, _MM_SHUFFLE( 2, 2, 2, 2 ) ), _mm_xor_ps( t2, s2 ) ) );
+		p = _mm_add_ps( p, _mm_mul_ps( _mm_shuffle_ps( a, a, _MM_SHUFFLE( 3, 3, 3, 3 ) ), _mm_xor_ps( t3, s3 ) ) );
+		return p;
+	}
+
+	inline __m128 QuatNormalize4( __m128 q )
+	{
+		__m128 d = _mm_mul_ps( q, q );
+		d = _mm_add_ps( d, _mm_shuffle_ps( d, d, _MM_SHUFFLE( 2, 3, 0, 1 ) ) );
+		d = _mm_add_ps( d, _mm_shuffle_ps( d, d, _MM_SHUFFLE( 1, 0, 3, 2 ) ) );
+		const float n2 = _mm_cvtss_f32( d );
+		if ( !( n2 > 1e-20f ) || !std::isfinite( n2 ) )
+			return _mm_setr_ps( 1.f, 0.f, 0.f, 0.f );
+		return _mm_mul_ps( q, _mm_set1_ps( FastInvSqrt( n2 ) ) );
+	}
+
+	// Four samples' step quaternions, one per lane of w, x, y, z
+	inline void StepQuat4( const float *g, const float *dt, float max_step, __m128 &w, __m128 &x, __m128 &y, __m128 &z )
+	{
+		const __m128 gx = _mm_setr_ps( g[ 0 ], g[ 3 ], g[ 6 ], g[ 9 ] );
+		const __m128 gy = _mm_setr_ps( g[ 1 ], g[ 4 ], g[ 7 ], g[ 10 ] );
+		const __m128 gz = _mm_setr_ps( g[ 2 ], g[ 5 ], g[ 8 ], g[ 11 ] );
+		const __m128 mag = _mm_sqrt_ps( _mm_add_ps( _mm_add_ps( _mm_mul_ps( gx, gx ), _mm_mul_ps( gy, gy ) ), _mm_mul_ps( gz, gz ) ) );
+		const __m128 angle = _mm_min_ps( _mm_mul_ps( mag, _mm_loadu_ps( dt ) ), _mm_set1_ps( max_step ) );
+		// Zero rate, non-positive dt and NaN all fail the compare and become the identity
+		const __m128 live = _mm_cmpgt_ps( angle, _mm_setzero_ps() );
+
+		const __m128 h = _mm_mul_ps( angle, _mm_set1_ps( 0.5f ) );
+		const __m128 h2 = _mm_mul_ps( h, h );
+		auto horner = [ & ]( std::initializer_list< float > c ) {
+			const float *k = c.end();
+			__m128 r = _mm_set1_ps( *--k );
+			while ( k != c.begin() )
+				r = _mm_add_ps( _mm_set1_ps( *--k ), _mm_mul_ps( h2, r ) );
+			return r;
+		};
+		const __m128 sin_h = _mm_mul_ps( h, horner( { 1.f, kSin3, kSin5, kSin7, kSin9, kSin11 } ) );
+		const __m128 cos_h = horner( { 1.f, kCos2, kCos4, kCos6, kCos8, kCos10, kCos12 } );
+
+		const __m128 s = _mm_and_ps( live, _mm_div_ps( sin_h, _mm_max_ps( mag, _mm_set1_ps( 1e-30f ) ) ) );
+		w = _mm_or_ps( _mm_and_ps( live, cos_h ), _mm_andnot_ps( live, _mm_set1_ps( 1.f ) ) );
+		x = _mm_mul_ps( gx, s );
+		y = _mm_mul_ps( gy, s );
+		z = _mm_mul_ps( gz, s );
+	}
+#elif defined( IMU_MATH_NEON )
+	alignas( 16 ) const float kSign1[ 4 ] = { -1.f, 1.f, -1.f, 1.f };
+	alignas( 16 ) const float kSign2[ 4 ] = { -1.f, 1.f, 1.f, -1.f };
+	alignas( 16 ) const float kSign3[ 4 ] = { -1.f, -1.f, 1.f, 1.f };
+
+	inline float32x4_t QuatMul4( float32x4_t a, float32x4_t b )
+	{
+		const float32x4_t t1 = vrev64q_f32( b );     // bx bw bz by
+		const float32x4_t t2 = vextq_f32( b, b, 2 ); // by bz bw bx
+		const float32x4_t t3 = vrev64q_f32( t2 );    // bz by bx bw
+		float32x4_t p = vmulq_laneq_f32( b, a, 0 );
+		p = vfmaq_laneq_f32( p, vmulq_f32( t1, vld1q_f32( kSign1 ) ), a, 1 );
+		p = vfmaq_laneq_f32( p, vmulq_f32( t2, vld1q_f32( kSign2 ) ), a, 2 );
+		p = vfmaq_laneq_f32( p, vmulq_f32( t3, vld1q_f32( kSign3 ) ), a, 3 );
+		return p;
+	}
+
+	inline float32x4_t QuatNormalize4( float32x4_t q )
+	{
+		const float n2 = vaddvq_f32( vmulq_f32( q, q ) );
+		if ( !( n2 > 1e-20f ) || !std::isfinite( n2 ) )
+			return vsetq_lane_f32( 1.f, vdupq_n_f32( 0.f ), 0 );
+		return vmulq_n_f32( q, FastInvSqrt( n2 ) );
+	}
+
+	inline float32x4x4_t StepQuat4( const float *g, const float *dt, float max_step )
+	{
+		const float32x4x3_t gv = vld3q_f32( g );
+		const float32x4_t mag = vsqrtq_f32( vfmaq_f32( vfmaq_f32( vmulq_f32( gv.val[ 0 ], gv.val[ 0 ] ), gv.val[ 1 ], gv.val[ 1 ] ), gv.val[ 2 ], gv.val[ 2 ] ) );
+		const float32x4_t angle = vminq_f32( vmulq_f32( mag, vld1q_f32( dt ) ), vdupq_n_f32( max_step ) );
+		const uint32x4_t live = vcgtq_f32( angle, vdupq_n_f32( 0.f ) );
+
+		const float32x4_t h = vmulq_n_f32( angle, 0.5f );
+		const float32x4_t h2 = vmulq_f32( h, h );
+		auto horner = [ & ]( std::initializer_list< float > c ) {
+			const float *k = c.end();
+			float32x4_t r = vdupq_n_f32( *--k );
+			while ( k != c.begin() )
+				r = vfmaq_f32( vdupq_n_f32( *--k ), h2, r );
+			return r;
+		};
+		const float32x4_t sin_h = vmulq_f32( h, horner( { 1.f, kSin3, kSin5, kSin7, kSin9, kSin11 } ) );
+		const float32x4_t cos_h = horner( { 1.f, kCos2, kCos4, kCos6, kCos8, kCos10, kCos12 } );
+
+		const float32x4_t s = vbslq_f32( live, vdivq_f32( sin_h, vmaxq_f32( mag, vdupq_n_f32( 1e-30f ) ) ), vdupq_n_f32( 0.f ) );
+		float32x4x4_t dq;
+		dq.val[ 0 ] = vbslq_f32( live, cos_h, vdupq_n_f32( 1.f ) );
+		dq.val[ 1 ] = vmulq_f32( gv.val[ 0 ], s );
+		dq.val[ 2 ] = vmulq_f32( gv.val[ 1 ], s );
+		dq.val[ 3 ] = vmulq_f32( gv.val[ 2 ], s );
+		return dq;
+	}
+#endif
+}
+
+void QuatRotateBatch( const ImuQuat *q, const float *v, float *out, size_t n )
+{
+	size_t i = 0;
+#if defined( IMU_MATH_SSE )
+	for ( ; i + 4 <= n; i += 4 )
+	{
+		__m128 qw = _mm_loadu_ps( &q[ i ].w ), qx = _mm_loadu_ps( &q[ i + 1 ].w ), qy = _mm_loadu_ps( &q[ i + 2 ].w ), qz = _mm_loadu_ps( &q[ i + 3 ].w );
+		_MM_TRANSPOSE4_PS( qw, qx, qy, qz );
+		const float *p = v + 3 * i;
+		const __m128 vx = _mm_setr_ps( p[ 0 ], p[ 3 ], p[ 6 ], p[ 9 ] );
+		const __m128 vy = _mm_setr_ps( p[ 1 ], p[ 4 ], p[ 7 ], p[ 10 ] );
+		const __m128 vz = _mm_setr_ps( p[ 2 ], p[ 5 ], p[ 8 ], p[ 11 ] );
+
+		// t = 2 * cross(q.xyz, v); v' = v + w * t + cross(q.xyz, t)
+		const __m128 two = _mm_set1_ps( 2.f );
+		const __m128 tx = _mm_mul_ps( two, _mm_sub_ps( _mm_mul_ps( qy, vz ), _mm_mul_ps( qz, vy ) ) );
+		const __m128 ty = _mm_mul_ps( two, _mm_sub_ps( _mm_mul_ps( qz, vx ), _mm_mul_ps( qx, vz ) ) );
+		const __m128 tz = _mm_mul_ps( two, _mm_sub_ps( _mm_mul_ps( qx, vy ), _mm_mul_ps( qy, vx ) ) );
+		float r[ 3 ][ 4 ];
+		_mm_storeu_ps( r[ 0 ], _mm_add_ps( _mm_add_ps( vx, _mm_mul_ps( qw, tx ) ), _mm_sub_ps( _mm_mul_ps( qy, tz ), _mm_mul_ps( qz, ty ) ) ) );
+		_mm_storeu_ps( r[ 1 ], _mm_add_ps( _mm_add_ps( vy, _mm_mul_ps( qw, ty ) ), _mm_sub_ps( _mm_mul_ps( qz, tx ), _mm_mul_ps( qx, tz ) ) ) );
+		_mm_storeu_ps( r[ 2 ], _mm_add_ps( _mm_add_ps( vz, _mm_mul_ps( qw, tz ) ), _mm_sub_ps( _mm_mul_ps( qx, ty ), _mm_mul_ps( qy, tx ) ) ) );
+		float *o = out + 3 * i;
+		for ( int k = 0; k < 4; ++k )
+		{
+			o[ 3 * k + 0 ] = r[ 0 ][ k ];
+			o[ 3 * k + 1 ] = r[ 1 ][ k ];
+			o[ 3 * k + 2 ] = r[ 2 ][ k ];
+		}
+	}
+#elif defined( IMU_MATH_NEON )
+	for ( ; i + 4 <= n; i += 4 )
+	{
+		const float32x4x4_t qv = vld4q_f32( &q[ i ].w ); // w, x, y, z lanes
+		const float32x4x3_t vv = vld3q_f32( v + 3 * i );
+		const float32x4_t qw = qv.val[ 0 ], qx = qv.val[ 1 ], qy = qv.val[ 2 ], qz = qv.val[ 3 ];
+		const float32x4_t vx = vv.val[ 0 ], vy = vv.val[ 1 ], vz = vv.val[ 2 ];
+
+		const float32x4_t tx = vmulq_n_f32( vfmsq_f32( vmulq_f32( qy, vz ), qz, vy ), 2.f );
+		const float32x4_t ty = vmulq_n_f32( vfmsq_f32( vmulq_f32( qz, vx ), qx, vz ), 2.f );
+		const float32x4_t tz = vmulq_n_f32( vfmsq_f32( vmulq_f32( qx, vy ), qy, vx ), 2.f );
+		float32x4x3_t r;
+		r.val[ 0 ] = vaddq_f32( vfmaq_f32( vx, qw, tx ), vfmsq_f32( vmulq_f32( qy, tz ), qz, ty ) );
+		r.val[ 1 ] = vaddq_f32( vfmaq_f32( vy, qw, ty ), vfmsq_f32( vmulq_f32( qz, tx ), qx, tz ) );
+		r.val[ 2 ] = vaddq_f32( vfmaq_f32( vz, qw, tz ), vfmsq_f32( vmulq_f32( qx, ty ), qy, tx ) );
+		vst3q_f32( out + 3 * i, r );
+	}
+#endif
+	for ( ; i < n; ++i )
+		QuatRotate( q[ i ], v + 3 * i, out + 3 * i );
+}
+
+ImuQuat IntegrateGyroBatch( const ImuQuat &q0, const float *gyro, const float *dt, size_t n, float max_step, ImuQuat *orientations_out )
+{
+	size_t i = 0;
+#if defined( IMU_MATH_SSE )
+	__m128 q = _mm_loadu_ps( &q0.w );
+	// Step quaternions are independent, so they are built four at a time; the product chain is serial
+	for ( ; i + 4 <= n; i += 4 )
+	{
+		__m128 d0, d1, d2, d3;
+		StepQuat4( gyro + 3 * i, dt + i, max_step, d0, d1, d2, d3 );
+		_MM_TRANSPOSE4_PS( d0, d1, d2, d3 );
+		const __m128 steps[ 4 ] = { d0, d1, d2, d3 };
+		for ( int k = 0; k < 4; ++k )
+		{
+			q = QuatNormalize4( QuatMul4( q, steps[ k ] ) );
+			if ( orientations_out )
+				_mm_storeu_ps( &orientations_out[ i + k ].w, q );
+		}
+	}
+	for ( ; i < n; ++i )
+	{
+		const ImuQuat d = StepQuat( gyro + 3 * i, dt[ i ], max_step );
+		q = QuatNormalize4( QuatMul4( q, _mm_loadu_ps( &d.w ) ) );
+		if ( orientations_out )
+			_mm_storeu_ps( &orientations_out[ i ].w, q );
+	}
+	ImuQuat result;
+	_mm_storeu_ps( &result.w, q );
+	return result;
+#elif defined( IMU_MATH_NEON )
+	float32x4_t q = vld1q_f32( &q0.w );
+	for ( ; i + 4 <= n; i += 4 )
+	{
+		ImuQuat steps[ 4 ];
+		vst4q_f32( &steps[ 0 ].w, StepQuat4( gyro + 3 * i, dt + i, max_step ) );
+		for ( int k = 0; k < 4; ++k )
+		{
+			q = QuatNormalize4( QuatMul4( q, vld1q_f32( &steps[ k ].w ) ) );
+			if ( orientations_out )
+				vst1q_f32( &orientations_out[ i + k ].w, q );
+		}
+	}
+	for ( ; i < n; ++i )
+	{
+		const ImuQuat d = StepQuat( gyro + 3 * i, dt[ i ], max_step );
+		q = QuatNormalize4( QuatMul4( q, vld1q_f32( &d.w ) ) );
+		if ( orientations_out )
+			vst1q_f32( &orientations_out[ i ].w, q );
+	}
+	ImuQuat result;
+	vst1q_f32( &result.w, q );
+	return result;
+#else
+	ImuQuat q = q0;
+	for ( ; i < n; ++i )
+	{
+		q = QuatNormalizeFast( QuatMultiply( q, StepQuat( gyro + 3 * i, dt[ i ], max_step ) ) );
+		if ( orientations_out )
+			orientations_out[ i ] = q;
+	}
+	return q;
+#endif
+}
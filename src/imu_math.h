@@ -0,0 +1,110 @@
+// Quaternion and vector kernels for the IMU hot path, built on the vendored linalg.h.
+// Scalar ops are constexpr and inline; the batched kernels (imu_math.cpp) use SSE on x86 and
+// NEON on ARM, four samples per step, with a scalar tail and a plain C++ fallback elsewhere.
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+
+#include "linalg.h"
+
+#if defined( __SSE2__ ) || defined( _M_X64 ) || ( defined( _M_IX86_FP ) && _M_IX86_FP >= 2 )
+#define IMU_MATH_SSE 1
+#include <emmintrin.h>
+#elif defined( __aarch64__ ) || defined( _M_ARM64 )
+// AArch64 only: the kernels rely on its vector sqrt/divide and lane-indexed multiply-add
+#define IMU_MATH_NEON 1
+#include <arm_neon.h>
+#endif
+
+// Unit quaternion, w first (the SDK's and the capture format's order)
+struct ImuQuat
+{
+	float w = 1.f;
+	float x = 0.f;
+	float y = 0.f;
+	float z = 0.f;
+};
+static_assert( sizeof( ImuQuat ) == 4 * sizeof( float ), "batched kernels load ImuQuat arrays as packed float4" );
+
+using ImuVec3 = linalg::vec< float, 3 >;
+// linalg's quaternion layout: x, y, z, w
+using ImuVec4 = linalg::vec< float, 4 >;
+
+constexpr ImuVec4 ToLinalg( const ImuQuat &q ) { return { q.x, q.y, q.z, q.w }; }
+constexpr ImuQuat FromLinalg( const ImuVec4 &q ) { return { q.w, q.x, q.y, q.z }; }
+
+constexpr ImuQuat QuatConjugate( const ImuQuat &q ) { return { q.w, -q.x, -q.y, -q.z }; }
+constexpr float QuatDot( const ImuQuat &a, const ImuQuat &b ) { return a.w * b.w + a.x * b.x + a.y * b.y + a.z * b.z; }
+constexpr ImuQuat QuatMultiply( const ImuQuat &a, const ImuQuat &b ) { return FromLinalg( linalg::qmul( ToLinalg( a ), ToLinalg( b ) ) ); }
+
+// v' = q * v * q^-1 for unit q. Two cross products (15 mul) instead of linalg::qrot's three basis columns.
+constexpr ImuVec3 QuatRotate( const ImuQuat &q, const ImuVec3 &v )
+{
+	const ImuVec3 u{ q.x, q.y, q.z };
+	const ImuVec3 t = 2.f * linalg::cross( u, v );
+	return v + q.w * t + linalg::cross( u, t );
+}
+// v' = q^-1 * v * q (world to body for a body-to-world orientation)
+constexpr ImuVec3 QuatRotateInverse( const ImuQuat &q, const ImuVec3 &v ) { return QuatRotate( QuatConjugate( q ), v ); }
+
+inline void QuatRotate( const ImuQuat &q, const float v[ 3 ], float out[ 3 ] )
+{
+	const ImuVec3 r = QuatRotate( q, ImuVec3{ v[ 0 ], v[ 1 ], v[ 2 ] } );
+	out[ 0 ] = r.x;
+	out[ 1 ] = r.y;
+	out[ 2 ] = r.z;
+}
+inline void QuatRotateInverse( const ImuQuat &q, const float v[ 3 ], float out[ 3 ] ) { QuatRotate( QuatConjugate( q ), v, out ); }
+
+//-----------------------------------------------------------------------------
+// Purpose: 1/sqrt(x) for x > 0 from the hardware estimate plus Newton-Raphson refinement
+// (about 23 bits, enough to renormalize a quaternion every sample without drift).
+//-----------------------------------------------------------------------------
+inline float FastInvSqrt( float x )
+{
+#if defined( IMU_MATH_SSE )
+	const float r = _mm_cvtss_f32( _mm_rsqrt_ss( _mm_set_ss( x ) ) ); // 12 bits
+	return r * ( 1.5f - 0.5f * x * r * r );
+#elif defined( IMU_MATH_NEON )
+	const float32x2_t vx = vdup_n_f32( x );
+	float32x2_t r = vrsqrte_f32( vx ); // 8 bits; each vrsqrts step doubles that
+	r = vmul_f32( r, vrsqrts_f32( vmul_f32( vx, r ), r ) );
+	r = vmul_f32( r, vrsqrts_f32( vmul_f32( vx, r ), r ) );
+	return vget_lane_f32( r, 0 );
+#else
+	return 1.f / std::sqrt( x );
+#endif
+}
+
+// Unit quaternion in the direction of q; identity if q is degenerate (zero, NaN, inf)
+inline ImuQuat QuatNormalizeFast( const ImuQuat &q )
+{
+	const float n2 = QuatDot( q, q );
+	if ( !( n2 > 1e-20f ) || !std::isfinite( n2 ) )
+		return {};
+	const float inv = FastInvSqrt( n2 );
+	return { q.w * inv, q.x * inv, q.y * inv, q.z * inv };
+}
+
+// Rotation by the vector r (axis * angle, radians): exact sin/cos, identity below 1e-6 rad
+inline ImuQuat QuatFromRotationVector( float rx, float ry, float rz )
+{
+	const float angle = std::sqrt( rx * rx + ry * ry + rz * rz );
+	if ( !( angle > 1e-6f ) )
+		return {};
+	const float s = std::sin( angle * 0.5f ) / angle;
+	return { std::cos( angle * 0.5f ), rx * s, ry * s, rz * s };
+}
+
+//-----------------------------------------------------------------------------
+// Batched kernels. Vector arrays are n packed float[3]; in and out may be the same array.
+//-----------------------------------------------------------------------------
+
+// out[i] = q[i] * v[i] * q[i]^-1 (each vector by its own unit quaternion)
+void QuatRotateBatch( const ImuQuat *q, const float *v, float *out, size_t n );
+
+// Integrates n body-rate samples (rad/s, bias already removed) onto q: q = normalize(q * dq(w * dt))
+// per sample with the step angle clamped to max_step (<= pi), as the fusion filters' integrator does.
+// Writes the orientation after every sample to orientations_out when given; returns the last one.
+ImuQuat IntegrateGyroBatch( const ImuQuat &q, const float *gyro, const float *dt, size_t n, float max_step, ImuQuat *orientations_out );
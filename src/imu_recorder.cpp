@@ -0,0 +1,234 @@
+#include "imu_recorder.h"
+#include "thread_policy.h"
+
+#include <chrono>
+#include <ctime>
+#include <filesystem>
+#include <system_error>
+
+bool ImuRecorder::Start( const ImuRecorderConfig &config )
+{
+	std::lock_guard< std::mutex > control( control_mutex_ );
+	if ( writer_running_.load() )
+		return true;
+
+	if ( !ring_ )
+		ring_ = std::make_unique< ImuCaptureRecord[] >( kRingSize );
+
+	config_ = config;
+	session_files_.clear();
+	session_bytes_ = 0;
+	{
+		std::lock_guard< std::mutex > lock( status_mutex_ );
+		status_ = {};
+	}
+	dropped_.store( 0, std::memory_order_relaxed );
+
+	std::error_code ec;
+	std::filesystem::create_directories( config_.directory, ec );
+	if ( !OpenNextFile() )
+		return false;
+
+	// Discard anything a previous session left behind; the producer is idle until recording_ flips
+	tail_.store( head_.load( std::memory_order_acquire ), std::memory_order_release );
+
+	writer_running_.store( true );
+	writer_ = std::thread( &ImuRecorder::WriterLoop, this );
+	recording_.store( true, std::memory_order_release );
+	{
+		std::lock_guard< std::mutex > lock( status_mutex_ );
+		status_.recording = true;
+	}
+	return true;
+}
+
+void ImuRecorder::Stop()
+{
+	std::lock_guard< std::mutex > control( control_mutex_ );
+	if ( !writer_running_.load() )
+		return;
+	recording_.store( false, std::memory_order_release );
+	writer_running_.store( false );
+	wake_cv_.notify_one();
+	if ( writer_.joinable() )
+		writer_.join();
+	{
+		std::lock_guard< std::mutex > lock( status_mutex_ );
+		status_.recording = false;
+	}
+}
+
+ImuRecorderStatus ImuRecorder::Status() const
+{
+	std::lock_guard< std::mutex > lock( status_mutex_ );
+	ImuRecorderStatus status = status_;
+	status.records_dropped = dropped_.load( std::memory_order_relaxed );
+	return status;
+}
+
+void ImuRecorder::SetError( const std::string &error )
+{
+	std::lock_guard< std::mutex > lock( status_mutex_ );
+	status_.error = error;
+}
+
+bool ImuRecorder::OpenNextFile()
+{
+	CloseFile();
+
+	char name[ 64 ];
+	const std::time_t now = std::time( nullptr );
+	std::tm tm{};
+#if defined( _WIN32 )
+	localtime_s( &tm, &now );
+#else
+	localtime_r( &now, &tm );
+#endif
+	uint32_t index;
+	{
+		std::lock_guard< std::mutex > lock( status_mutex_ );
+		index = status_.files;
+	}
+	std::strftime( name, sizeof( name ), "rayneo_imu_%Y%m%d_%H%M%S", &tm );
+	const std::string path = ( std::filesystem::path( config_.directory ) / ( std::string( name ) + "_" + std::to_string( index ) + ".cap" ) ).string();
+
+	file_ = std::fopen( path.c_str(), "wb" );
+	if ( !file_ )
+	{
+		SetError( "cannot open " + path );
+		return false;
+	}
+	// Large stdio buffer: the writer issues few, big write() calls
+	std::setvbuf( file_, nullptr, _IOFBF, 1 << 20 );
+
+	header_ = MakeImuCaptureHeader( config_.source.c_str() );
+	if ( std::fwrite( &header_, sizeof( header_ ), 1, file_ ) != 1 )
+	{
+		SetError( "cannot write " + path );
+		std::fclose( file_ );
+		file_ = nullptr;
+		return false;
+	}
+	file_bytes_ = sizeof( header_ );
+	session_files_.emplace_back( path, 0 );
+	{
+		std::lock_guard< std::mutex > lock( status_mutex_ );
+		status_.files = index + 1;
+		status_.current_file = path;
+		status_.bytes_written += sizeof( header_ );
+	}
+	session_bytes_ += sizeof( header_ );
+	return true;
+}
+
+void ImuRecorder::WriteCheckpoint()
+{
+	if ( !file_ )
+		return;
+	// Rewrite the header in place so a crash leaves a file whose record_count is at most one
+	// checkpoint stale (readers go by file size anyway)
+	header_.record_count = ( file_bytes_ - sizeof( header_ ) ) / sizeof( ImuCaptureRecord );
+	const long end = std::ftell( file_ );
+	if ( std::fseek( file_, 0, SEEK_SET ) == 0 )
+	{
+		std::fwrite( &header_, sizeof( header_ ), 1, file_ );
+		std::fseek( file_, end, SEEK_SET );
+	}
+	std::fflush( file_ );
+}
+
+void ImuRecorder::CloseFile()
+{
+	if ( !file_ )
+		return;
+	WriteCheckpoint();
+	std::fclose( file_ );
+	file_ = nullptr;
+	if ( !session_files_.empty() )
+		session_files_.back().second = file_bytes_;
+}
+
+void ImuRecorder::EnforceSizeCap()
+{
+	// Never delete the file being written
+	while ( session_bytes_ > config_.max_total_bytes && session_files_.size() > 1 )
+	{
+		const auto oldest = session_files_.front();
+		session_files_.pop_front();
+		std::error_code ec;
+		std::filesystem::remove( oldest.first, ec );
+		session_bytes_ -= oldest.second;
+	}
+}
+
+void ImuRecorder::WriterLoop()
+{
+	SetCurrentThreadName( "rayneo-record" );
+	ImuCaptureRecord chunk[ kWriteChunk ];
+	auto last_checkpoint = std::chrono::steady_clock::now();
+	const auto checkpoint_interval = std::chrono::milliseconds( config_.checkpoint_ms );
+
+	for ( ;; )
+	{
+		const bool running = writer_running_.load();
+
+		// Drain everything that is ready, one chunk per fwrite
+		for ( ;; )
+		{
+			size_t tail = tail_.load( std::memory_order_relaxed );
+			const size_t head = head_.load( std::memory_order_acquire );
+			size_t n = head - tail;
+			if ( n == 0 )
+				break;
+			if ( n > kWriteChunk )
+				n = kWriteChunk;
+			for ( size_t i = 0; i < n; ++i )
+				chunk[ i ] = ring_[ ( tail + i ) & ( kRingSize - 1 ) ];
+			tail_.store( tail + n, std::memory_order_release );
+
+			if ( !file_ )
+				continue; // a rotation failed; keep draining so the producer never sees a full ring
+			if ( header_.start_host_time_ns == 0 )
+				header_.start_host_time_ns = chunk[ 0 ].receive_host_time_ns;
+
+			const size_t written = std::fwrite( chunk, sizeof( ImuCaptureRecord ), n, file_ );
+			const uint64_t bytes = written * sizeof( ImuCaptureRecord );
+			file_bytes_ += bytes;
+			session_bytes_ += bytes;
+			if ( !session_files_.empty() )
+				session_files_.back().second = file_bytes_;
+			{
+				std::lock_guard< std::mutex > lock( status_mutex_ );
+				status_.records_written += written;
+				status_.bytes_written += bytes;
+			}
+			if ( written != n )
+			{
+				SetError( "write failed" );
+				CloseFile();
+				continue;
+			}
+
+			if ( file_bytes_ >= config_.max_file_bytes )
+			{
+				OpenNextFile();
+				EnforceSizeCap();
+			}
+		}
+
+		const auto now = std::chrono::steady_clock::now();
+		if ( now - last_checkpoint >= checkpoint_interval )
+		{
+			WriteCheckpoint();
+			EnforceSizeCap();
+			last_checkpoint = now;
+		}
+
+		if ( !running )
+			break;
+
+		std::unique_lock< std::mutex > lock( wake_mutex_ );
+		wake_cv_.wait_for( lock, std::chrono::milliseconds( 50 ) );
+	}
+	CloseFile();
+}
@@ -0,0 +1,109 @@
+// Opt-in IMU session recorder: the event thread copies samples into a preallocated ring and a
+// background writer appends them to rotating capture files (imu_capture.h format).
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "imu_capture.h"
+
+struct ImuRecorderConfig
+{
+	std::string directory;                          // created if missing
+	std::string source;                             // stored in every file header
+	uint64_t max_file_bytes = 64ull << 20;          // rotate to a new file beyond this
+	uint64_t max_total_bytes = 512ull << 20;        // delete the oldest files of the session beyond this
+	uint32_t checkpoint_ms = 1000;                  // rewrite the header's record_count this often
+};
+
+struct ImuRecorderStatus
+{
+	bool recording = false;
+	uint64_t records_written = 0;
+	uint64_t records_dropped = 0; // ring full: the writer fell behind
+	uint64_t bytes_written = 0;
+	uint32_t files = 0;
+	std::string current_file;
+	std::string error;
+};
+
+//-----------------------------------------------------------------------------
+// Purpose: Single-producer / single-consumer recorder. Push() is wait-free: one relaxed check,
+// a 72-byte copy and a release store; it never allocates, locks, or touches the file system.
+// All I/O (chunked fwrite, header checkpoints, rotation, size cap) happens on the writer thread.
+//-----------------------------------------------------------------------------
+class ImuRecorder
+{
+public:
+	ImuRecorder() = default;
+	~ImuRecorder() { Stop(); }
+
+	ImuRecorder( const ImuRecorder & ) = delete;
+	ImuRecorder &operator=( const ImuRecorder & ) = delete;
+
+	// Control thread(s). Start returns false (see Status().error) if the first file can't be opened.
+	bool Start( const ImuRecorderConfig &config );
+	void Stop();
+
+	bool IsRecording() const { return recording_.load( std::memory_order_relaxed ); }
+
+	// Producer thread only
+	void Push( const ImuCaptureRecord &record )
+	{
+		// Acquire pairs with Start() so the ring allocation is visible
+		if ( !recording_.load( std::memory_order_acquire ) )
+			return;
+		const size_t head = head_.load( std::memory_order_relaxed );
+		if ( head - tail_.load( std::memory_order_acquire ) >= kRingSize )
+		{
+			dropped_.store( dropped_.load( std::memory_order_relaxed ) + 1, std::memory_order_relaxed );
+			return;
+		}
+		ring_[ head & ( kRingSize - 1 ) ] = record;
+		head_.store( head + 1, std::memory_order_release );
+	}
+
+	ImuRecorderStatus Status() const;
+
+private:
+	// ~16 s at 1 kHz before samples are dropped
+	static constexpr size_t kRingSize = 16384;
+	static constexpr size_t kWriteChunk = 512;
+
+	void WriterLoop();
+	bool OpenNextFile();
+	void CloseFile();
+	void WriteCheckpoint();
+	void EnforceSizeCap();
+	void SetError( const std::string &error );
+
+	std::unique_ptr< ImuCaptureRecord[] > ring_;
+	alignas( 64 ) std::atomic< size_t > head_{ 0 };
+	alignas( 64 ) std::atomic< size_t > tail_{ 0 };
+	alignas( 64 ) std::atomic< uint64_t > dropped_{ 0 };
+
+	std::atomic< bool > recording_{ false };
+	std::mutex control_mutex_; // serializes Start/Stop
+	std::thread writer_;
+	std::atomic< bool > writer_running_{ false };
+	std::mutex wake_mutex_;
+	std::condition_variable wake_cv_;
+
+	// Writer thread state (Status() reads it under status_mutex_)
+	ImuRecorderConfig config_;
+	FILE *file_ = nullptr;
+	ImuCaptureHeader header_{};
+	uint64_t file_bytes_ = 0;
+	std::deque< std::pair< std::string, uint64_t > > session_files_;
+	uint64_t session_bytes_ = 0;
+
+	mutable std::mutex status_mutex_;
+	ImuRecorderStatus status_;
+};
@@ -0,0 +1,113 @@
+#include "input_event_processor.h"
+
+bool InputEventProcessor::Push( InputButton button, int64_t time_ns )
+{
+	const size_t head = head_.load( std::memory_order_relaxed );
+	if ( head - tail_.load( std::memory_order_acquire ) >= kQueueSize )
+	{
+		dropped_.fetch_add( 1, std::memory_order_relaxed );
+		return false;
+	}
+	queue_[ head & ( kQueueSize - 1 ) ] = QueuedClick{ button, time_ns };
+	head_.store( head + 1, std::memory_order_release );
+	return true;
+}
+
+void InputEventProcessor::Process( int64_t now_ns, const InputEventTiming &timing, Result &out )
+{
+	out.edge_count = 0;
+	out.recenter = false;
+	out.dropped = dropped_.exchange( 0, std::memory_order_relaxed );
+
+	// Clicks are queued in arrival order, so everything below happens in time order
+	size_t tail = tail_.load( std::memory_order_relaxed );
+	const size_t head = head_.load( std::memory_order_acquire );
+	for ( ; tail != head; ++tail )
+	{
+		const QueuedClick click = queue_[ tail & ( kQueueSize - 1 ) ];
+		// A notification stamped after now (clock skew between threads) is treated as now
+		const int64_t t = click.time_ns < now_ns ? click.time_ns : now_ns;
+		Advance( t, timing, out );
+		HandleClick( click.button, t, timing, out );
+	}
+	tail_.store( tail, std::memory_order_release );
+
+	Advance( now_ns, timing, out );
+}
+
+void InputEventProcessor::Reset()
+{
+	tail_.store( head_.load( std::memory_order_acquire ), std::memory_order_release );
+	for ( ButtonState &state : state_ )
+		state = ButtonState{};
+	brightness_pending_ = false;
+	brightness_click_ns_ = 0;
+}
+
+void InputEventProcessor::HandleClick( InputButton button, int64_t time_ns, const InputEventTiming &timing, Result &out )
+{
+	if ( button != InputButton::AppMenu )
+	{
+		Press( button, time_ns, timing, out );
+		return;
+	}
+
+	// Advance() already resolved an expired first click, so a pending one is inside the window
+	if ( brightness_pending_ )
+	{
+		brightness_pending_ = false;
+		out.recenter = true;
+		return;
+	}
+	brightness_pending_ = true;
+	brightness_click_ns_ = time_ns;
+}
+
+void InputEventProcessor::Press( InputButton button, int64_t time_ns, const InputEventTiming &timing, Result &out )
+{
+	ButtonState &state = state_[ static_cast< size_t >( button ) ];
+	// A click while still held extends the hold instead of producing a release/press pair
+	if ( !state.pressed )
+	{
+		state.pressed = true;
+		Emit( button, true, time_ns, out );
+	}
+	state.release_ns = time_ns + timing.hold_ns;
+}
+
+void InputEventProcessor::Advance( int64_t up_to_ns, const InputEventTiming &timing, Result &out )
+{
+	for ( ;; )
+	{
+		// Earliest pending deadline: a button release or the end of the double-click window
+		int next = -1;
+		int64_t next_ns = up_to_ns;
+		for ( size_t i = 0; i < static_cast< size_t >( InputButton::Count ); ++i )
+		{
+			if ( state_[ i ].pressed && state_[ i ].release_ns <= next_ns )
+			{
+				next = static_cast< int >( i );
+				next_ns = state_[ i ].release_ns;
+			}
+		}
+		const int64_t single_click_ns = brightness_click_ns_ + timing.double_click_ns;
+		if ( brightness_pending_ && single_click_ns <= next_ns )
+		{
+			// No second click came: the first one is an application menu click, pressed now
+			brightness_pending_ = false;
+			Press( InputButton::AppMenu, single_click_ns, timing, out );
+			continue;
+		}
+		if ( next < 0 )
+			return;
+
+		state_[ next ].pressed = false;
+		Emit( static_cast< InputButton >( next ), false, next_ns, out );
+	}
+}
+
+void InputEventProcessor::Emit( InputButton button, bool pressed, int64_t time_ns, Result &out )
+{
+	if ( out.edge_count < kMaxEdges )
+		out.edges[ out.edge_count++ ] = InputEdge{ button, pressed, time_ns };
+}
@@ -0,0 +1,94 @@
+// Timestamped button pipeline: RayNeo notifications in, press/release edges with exact time offsets out.
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+enum class InputButton : uint8_t
+{
+	System,  // RAYNEO_NOTIFY_BUTTON
+	Trigger, // volume up
+	Grip,    // volume down
+	AppMenu, // brightness single click (a double click recenters instead)
+	Count,
+};
+
+struct InputEventTiming
+{
+	// How long a notification-driven click holds the button down (the glasses only report clicks)
+	int64_t hold_ns = 100'000'000;
+	// Two brightness clicks closer than this are a double click; a single click is only reported
+	// once the window has passed without a second one
+	int64_t double_click_ns = 400'000'000;
+};
+
+// One boolean component transition, stamped with the host time it logically happened
+struct InputEdge
+{
+	InputButton button;
+	bool pressed;
+	int64_t time_ns; // steady_clock nanoseconds, same base as the IMU receive timestamps
+};
+
+//-----------------------------------------------------------------------------
+// Purpose: Converts click notifications into press/release edges in wall-clock time.
+// Push() is wait-free and called from the RayNeo event thread with the time the notification
+// was pulled from the SDK. Process() runs on the vrserver main thread (RunFrame): it drains the
+// queue, resolves brightness double clicks and returns only the edges that are due, so callers
+// send UpdateBooleanComponent() on change with fTimeOffset = ( edge.time_ns - now_ns ) * 1e-9.
+//-----------------------------------------------------------------------------
+class InputEventProcessor
+{
+public:
+	// Clicks arrive a few per second at most; 64 covers seconds of RunFrame stalls
+	static constexpr size_t kQueueSize = 64;
+	// Every queued click yields at most a press and a release, plus one release per held button
+	// and the pending brightness click
+	static constexpr size_t kMaxEdges = 2 * kQueueSize + 2 * static_cast< size_t >( InputButton::Count );
+
+	struct Result
+	{
+		InputEdge edges[ kMaxEdges ];
+		size_t edge_count = 0;
+		bool recenter = false; // a brightness double click completed during this call
+		uint64_t dropped = 0;  // notifications lost to a full queue since the last call
+	};
+
+	// Producer (event thread) only. Returns false if the queue is full.
+	bool Push( InputButton button, int64_t time_ns );
+
+	// Consumer (RunFrame) only
+	void Process( int64_t now_ns, const InputEventTiming &timing, Result &out );
+	bool IsPressed( InputButton button ) const { return state_[ static_cast< size_t >( button ) ].pressed; }
+	// Drop held buttons and partial double clicks (e.g. on Deactivate); no edges are reported
+	void Reset();
+
+private:
+	struct QueuedClick
+	{
+		InputButton button;
+		int64_t time_ns;
+	};
+
+	struct ButtonState
+	{
+		bool pressed = false;
+		int64_t release_ns = 0;
+	};
+
+	void HandleClick( InputButton button, int64_t time_ns, const InputEventTiming &timing, Result &out );
+	void Press( InputButton button, int64_t time_ns, const InputEventTiming &timing, Result &out );
+	// Apply releases and the brightness single-click deadline up to and including up_to_ns, in time order
+	void Advance( int64_t up_to_ns, const InputEventTiming &timing, Result &out );
+	void Emit( InputButton button, bool pressed, int64_t time_ns, Result &out );
+
+	QueuedClick queue_[ kQueueSize ] = {};
+	std::atomic< size_t > head_{ 0 };
+	std::atomic< size_t > tail_{ 0 };
+	std::atomic< uint64_t > dropped_{ 0 };
+
+	ButtonState state_[ static_cast< size_t >( InputButton::Count ) ];
+	bool brightness_pending_ = false;
+	int64_t brightness_click_ns_ = 0;
+};
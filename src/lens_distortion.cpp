@@ -0,0 +1,141 @@
+#include "lens_distortion.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+// Scale factor for a point at normalised radius^2 r2
+float RadialScale( const LensChannelCoefficients &k, float r2 )
+{
+	return 1.f + r2 * ( k.k1 + r2 * ( k.k2 + r2 * k.k3 ) );
+}
+
+// Solves r * RadialScale( r^2 ) = target for r. Starts from the target radius; stops at the first
+// turning point if the polynomial folds over (a profile that strong is outside the usable field).
+float InverseRadius( const LensChannelCoefficients &k, float target )
+{
+	float r = target;
+	for ( int i = 0; i < 12; ++i )
+	{
+		const float r2 = r * r;
+		const float f = r * RadialScale( k, r2 ) - target;
+		const float df = 1.f + r2 * ( 3.f * k.k1 + r2 * ( 5.f * k.k2 + r2 * 7.f * k.k3 ) );
+		if ( !( df > 1e-4f ) )
+			break;
+		const float step = f / df;
+		r -= step;
+		if ( std::fabs( step ) < 1e-7f )
+			break;
+	}
+	return r > 0.f ? r : 0.f;
+}
+} // namespace
+
+bool LensDistortionProfile::IsIdentity() const
+{
+	for ( const auto &c : channel )
+	{
+		if ( c.k1 != 0.f || c.k2 != 0.f || c.k3 != 0.f )
+			return false;
+	}
+	return true;
+}
+
+void LensDistortion::Build( const LensDistortionProfile &profile, float eye_aspect )
+{
+	profile_ = profile;
+	if ( !( profile_.radius_scale > 0.f ) )
+		profile_.radius_scale = 0.5f;
+	aspect_ = eye_aspect > 0.f ? eye_aspect : 1.f;
+	identity_ = profile_.IsIdentity();
+
+	forward_.clear();
+	inverse_.clear();
+	if ( identity_ )
+		return;
+
+	const size_t count = size_t( 2 ) * 3 * kGridSize * kGridSize;
+	forward_.resize( count );
+	inverse_.resize( count );
+	const float step = 1.f / float( kGridSize - 1 );
+	for ( int eye = 0; eye < 2; ++eye )
+	{
+		for ( int c = 0; c < 3; ++c )
+		{
+			for ( int row = 0; row < kGridSize; ++row )
+			{
+				for ( int col = 0; col < kGridSize; ++col )
+				{
+					const size_t i = ( size_t( eye * 3 + c ) * kGridSize + row ) * kGridSize + col;
+					forward_[ i ] = DistortExact( eye, c, col * step, row * step );
+					inverse_[ i ] = UndistortExact( eye, c, col * step, row * step );
+				}
+			}
+		}
+	}
+}
+
+LensUv LensDistortion::DistortExact( int eye, int channel, float u, float v ) const
+{
+	const float cu = profile_.center_u[ eye ], cv = profile_.center_v[ eye ];
+	// Offsets in viewport heights so the radius is isotropic on the panel
+	const float dx = ( u - cu ) * aspect_ / profile_.radius_scale;
+	const float dy = ( v - cv ) / profile_.radius_scale;
+	const float s = RadialScale( profile_.channel[ channel ], dx * dx + dy * dy );
+	return LensUv{ cu + ( u - cu ) * s, cv + ( v - cv ) * s };
+}
+
+LensUv LensDistortion::UndistortExact( int eye, int channel, float u, float v ) const
+{
+	const float cu = profile_.center_u[ eye ], cv = profile_.center_v[ eye ];
+	const float dx = ( u - cu ) * aspect_ / profile_.radius_scale;
+	const float dy = ( v - cv ) / profile_.radius_scale;
+	const float rs = std::sqrt( dx * dx + dy * dy );
+	if ( rs < 1e-7f )
+		return LensUv{ u, v };
+	const float s = InverseRadius( profile_.channel[ channel ], rs ) / rs;
+	return LensUv{ cu + ( u - cu ) * s, cv + ( v - cv ) * s };
+}
+
+LensUv LensDistortion::Sample( const std::vector< LensUv > &grid, int eye, int channel, float u, float v ) const
+{
+	const float max_index = float( kGridSize - 1 );
+	const float x = std::clamp( u, 0.f, 1.f ) * max_index;
+	const float y = std::clamp( v, 0.f, 1.f ) * max_index;
+	const int x0 = std::min( int( x ), kGridSize - 2 );
+	const int y0 = std::min( int( y ), kGridSize - 2 );
+	const float fx = x - float( x0 ), fy = y - float( y0 );
+
+	const LensUv *row0 = &grid[ ( size_t( eye * 3 + channel ) * kGridSize + y0 ) * kGridSize + x0 ];
+	const LensUv *row1 = row0 + kGridSize;
+	const float w00 = ( 1.f - fx ) * ( 1.f - fy ), w10 = fx * ( 1.f - fy ), w01 = ( 1.f - fx ) * fy, w11 = fx * fy;
+	return LensUv{
+		row0[ 0 ].u * w00 + row0[ 1 ].u * w10 + row1[ 0 ].u * w01 + row1[ 1 ].u * w11,
+		row0[ 0 ].v * w00 + row0[ 1 ].v * w10 + row1[ 0 ].v * w01 + row1[ 1 ].v * w11,
+	};
+}
+
+void LensDistortion::Distort( int eye, float u, float v, LensUv out[ 3 ] ) const
+{
+	eye = eye ? 1 : 0;
+	if ( identity_ )
+	{
+		out[ 0 ] = out[ 1 ] = out[ 2 ] = LensUv{ u, v };
+		return;
+	}
+	// The grids cover the viewport; the rare query outside it is evaluated directly
+	const bool inside = u >= 0.f && u <= 1.f && v >= 0.f && v <= 1.f;
+	for ( int c = 0; c < 3; ++c )
+		out[ c ] = inside ? Sample( forward_, eye, c, u, v ) : DistortExact( eye, c, u, v );
+}
+
+LensUv LensDistortion::Undistort( int eye, int channel, float u, float v ) const
+{
+	eye = eye ? 1 : 0;
+	channel = std::clamp( channel, 0, 2 );
+	if ( identity_ )
+		return LensUv{ u, v };
+	const bool inside = u >= 0.f && u <= 1.f && v >= 0.f && v <= 1.f;
+	return inside ? Sample( inverse_, eye, channel, u, v ) : UndistortExact( eye, channel, u, v );
+}
@@ -0,0 +1,70 @@
+// Radial lens distortion / chromatic aberration model for the RayNeo optics, baked into lookup grids.
+#pragma once
+
+#include <vector>
+
+struct LensUv
+{
+	float u = 0.f;
+	float v = 0.f;
+};
+
+// Per colour channel radial polynomial: source = center + d * (1 + k1 r^2 + k2 r^4 + k3 r^6)
+struct LensChannelCoefficients
+{
+	float k1 = 0.f;
+	float k2 = 0.f;
+	float k3 = 0.f;
+};
+
+struct LensDistortionProfile
+{
+	// Optical centre per eye (0 = left, 1 = right) in that eye's viewport UV
+	float center_u[ 2 ] = { 0.5f, 0.5f };
+	float center_v[ 2 ] = { 0.5f, 0.5f };
+
+	// Distance from the centre, in viewport heights, that counts as r = 1
+	float radius_scale = 0.5f;
+
+	// Red, green, blue. All zero (the default) is an undistorted, CA-free lens.
+	LensChannelCoefficients channel[ 3 ];
+
+	bool IsIdentity() const;
+};
+
+//-----------------------------------------------------------------------------
+// Purpose: Evaluates the lens model for vrcompositor. The polynomial and its inverse (solved per
+// grid node with Newton's method at build time) are sampled once into kGridSize^2 grids per eye
+// and channel, so each ComputeDistortion / ComputeInverseDistortion call is one bilinear fetch.
+// Immutable after Build(); safe to share between threads.
+//-----------------------------------------------------------------------------
+class LensDistortion
+{
+public:
+	static constexpr int kGridSize = 65;
+
+	// eye_aspect: eye viewport width / height, so the radius is round on the panel, not in UV
+	void Build( const LensDistortionProfile &profile, float eye_aspect );
+
+	bool IsIdentity() const { return identity_; }
+	const LensDistortionProfile &Profile() const { return profile_; }
+
+	// Output (panel) UV -> render target UV for red, green and blue
+	void Distort( int eye, float u, float v, LensUv out[ 3 ] ) const;
+	// Render target UV -> panel UV for one channel (0 red, 1 green, 2 blue)
+	LensUv Undistort( int eye, int channel, float u, float v ) const;
+
+	// Direct polynomial evaluation, used to build the grids (and to check them)
+	LensUv DistortExact( int eye, int channel, float u, float v ) const;
+	LensUv UndistortExact( int eye, int channel, float u, float v ) const;
+
+private:
+	// Grid index: ( ( eye * 3 + channel ) * kGridSize + row ) * kGridSize + column
+	LensUv Sample( const std::vector< LensUv > &grid, int eye, int channel, float u, float v ) const;
+
+	LensDistortionProfile profile_;
+	float aspect_ = 1.f;
+	bool identity_ = true;
+	std::vector< LensUv > forward_;
+	std::vector< LensUv > inverse_;
+};
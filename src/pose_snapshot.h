@@ -0,0 +1,148 @@
+// Wait-free single-writer pose handoff between the RayNeo IMU thread and the pose publishing thread.
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <type_traits>
+
+//-----------------------------------------------------------------------------
+// Purpose: Sequence lock for a small trivially copyable value.
+// Exactly one thread may call Store(); any number of threads may call Load().
+// The writer never waits. Readers never take a lock: they copy the payload and retry only
+// if the writer was mid-update, so a reader always sees one complete, consistent value.
+// The payload is kept in relaxed atomic words so concurrent copies are well defined.
+//-----------------------------------------------------------------------------
+template < class T >
+class SeqLock
+{
+	static_assert( std::is_trivially_copyable_v< T >, "SeqLock payload must be trivially copyable" );
+
+public:
+	SeqLock()
+	{
+		Store( T{} );
+	}
+
+	void Store( const T &value )
+	{
+		std::array< uint64_t, kWordCount > words{};
+		std::memcpy( words.data(), &value, sizeof( T ) );
+
+		const uint32_t seq = sequence_.load( std::memory_order_relaxed );
+		sequence_.store( seq + 1, std::memory_order_relaxed );
+		std::atomic_thread_fence( std::memory_order_release );
+		for ( size_t i = 0; i < kWordCount; ++i )
+			words_[ i ].store( words[ i ], std::memory_order_relaxed );
+		sequence_.store( seq + 2, std::memory_order_release );
+	}
+
+	// Returns the sequence number of the value read (even, increases by 2 per Store()).
+	uint32_t Load( T &out ) const
+	{
+		std::array< uint64_t, kWordCount > words{};
+		uint32_t before = 0;
+		for ( ;; )
+		{
+			before = sequence_.load( std::memory_order_acquire );
+			if ( before & 1u )
+				continue;
+			for ( size_t i = 0; i < kWordCount; ++i )
+				words[ i ] = words_[ i ].load( std::memory_order_relaxed );
+			std::atomic_thread_fence( std::memory_order_acquire );
+			if ( sequence_.load( std::memory_order_relaxed ) == before )
+				break;
+		}
+		std::memcpy( static_cast< void * >( &out ), words.data(), sizeof( T ) );
+		return before;
+	}
+
+	uint32_t Sequence() const { return sequence_.load( std::memory_order_acquire ); }
+
+private:
+	static constexpr size_t kWordCount = ( sizeof( T ) + sizeof( uint64_t ) - 1 ) / sizeof( uint64_t );
+
+	alignas( 64 ) std::atomic< uint32_t > sequence_{ 0 };
+	std::array< std::atomic< uint64_t >, kWordCount > words_{};
+};
+
+//-----------------------------------------------------------------------------
+// Purpose: Everything GetPose() needs from one IMU sample, published as a single unit so
+// orientation and position always come from the same sample.
+//-----------------------------------------------------------------------------
+struct PoseSnapshot
+{
+	// Orientation relative to the recenter anchor (unit quaternion)
+	float q_w = 1.f;
+	float q_x = 0.f;
+	float q_y = 0.f;
+	float q_z = 0.f;
+
+	// Position (meters) and linear velocity (m/s) in driver space
+	float position[ 3 ] = { 0.f, 0.f, 0.f };
+	float velocity[ 3 ] = { 0.f, 0.f, 0.f };
+
+	// Filtered angular velocity (rad/s) and angular acceleration (rad/s^2) in driver space
+	float angular_velocity[ 3 ] = { 0.f, 0.f, 0.f };
+	float angular_acceleration[ 3 ] = { 0.f, 0.f, 0.f };
+
+	// IMU tick of the sample this snapshot was built from, when it was measured (tick mapped onto
+	// steady_clock ns) and when the SDK delivered it to us (steady_clock ns)
+	uint32_t sample_tick = 0;
+	int64_t sample_host_time_ns = 0;
+	int64_t receive_host_time_ns = 0;
+
+	// False until the first IMU sample has been integrated
+	bool valid = false;
+
+	// Link state when published: USB session streaming, glasses reporting sleep. The writer
+	// republishes on every change, so a reader needs nothing beyond the snapshot itself.
+	bool connected = false;
+	bool sleeping = false;
+};
+
+//-----------------------------------------------------------------------------
+// Purpose: Wakes the pose publishing thread when a new snapshot has been stored.
+// Notify() is a single atomic increment unless a consumer is actually parked, in which case
+// it briefly takes the mutex to hand over the wakeup (futex path on all our platforms).
+//-----------------------------------------------------------------------------
+class PoseSampleSignal
+{
+public:
+	void Notify()
+	{
+		generation_.fetch_add( 1 );
+		if ( waiters_.load() != 0 )
+		{
+			std::lock_guard< std::mutex > lock( mutex_ );
+			cv_.notify_all();
+		}
+	}
+
+	uint64_t Generation() const { return generation_.load(); }
+
+	// Blocks until the generation differs from last_seen or the timeout expires.
+	// Returns the current generation (equal to last_seen on timeout).
+	uint64_t WaitFor( uint64_t last_seen, std::chrono::nanoseconds timeout )
+	{
+		uint64_t current = generation_.load();
+		if ( current != last_seen )
+			return current;
+
+		std::unique_lock< std::mutex > lock( mutex_ );
+		waiters_.fetch_add( 1 );
+		cv_.wait_for( lock, timeout, [ & ] { return generation_.load() != last_seen; } );
+		waiters_.fetch_sub( 1 );
+		return generation_.load();
+	}
+
+private:
+	std::atomic< uint64_t > generation_{ 0 };
+	std::atomic< uint32_t > waiters_{ 0 };
+	std::mutex mutex_;
+	std::condition_variable cv_;
+};
@@ -0,0 +1,148 @@
+#include "position_engine.h"
+
+#include <cmath>
+#include <cstring>
+
+const char *PositionModeName( PositionMode mode )
+{
+	switch ( mode )
+	{
+		case PositionMode::Fixed: return "fixed";
+		case PositionMode::HeadModel: return "head_model";
+		case PositionMode::Inertial: return "inertial";
+	}
+	return "unknown";
+}
+
+bool ParsePositionMode( const char *name, PositionMode &out )
+{
+	if ( !name )
+		return false;
+	static const PositionMode kModes[] = { PositionMode::Fixed, PositionMode::HeadModel, PositionMode::Inertial };
+	for ( PositionMode m : kModes )
+	{
+		if ( std::strcmp( name, PositionModeName( m ) ) == 0 )
+		{
+			out = m;
+			return true;
+		}
+	}
+	return false;
+}
+
+void PositionEngine::Update( const float accel_world[ 3 ], float gyro_rate, float dt )
+{
+	if ( params_.mode != PositionMode::Inertial || !( dt > 0.f ) )
+		return;
+
+	if ( !have_gravity_ )
+	{
+		// First guess; refined as soon as the head holds still
+		for ( int i = 0; i < 3; ++i )
+			gravity_[ i ] = accel_world[ i ];
+		have_gravity_ = true;
+		return;
+	}
+
+	// Zero-velocity detection: rotation preserves the norm, so compare magnitudes
+	const float a_norm = std::sqrt( accel_world[ 0 ] * accel_world[ 0 ] + accel_world[ 1 ] * accel_world[ 1 ] + accel_world[ 2 ] * accel_world[ 2 ] );
+	const float g_norm = std::sqrt( gravity_[ 0 ] * gravity_[ 0 ] + gravity_[ 1 ] * gravity_[ 1 ] + gravity_[ 2 ] * gravity_[ 2 ] );
+	const bool quiet = gyro_rate < params_.zupt_gyro_threshold && std::fabs( a_norm - g_norm ) < params_.zupt_accel_threshold * 9.81f;
+	still_time_ = quiet ? still_time_ + dt : 0.f;
+	stationary_ = still_time_ >= params_.zupt_hold_time;
+
+	if ( stationary_ )
+	{
+		// ZUPT: velocity is known to be zero, and the specific force is pure gravity
+		const float k_gravity = dt / ( params_.gravity_time_constant + dt );
+		const float k_return = params_.return_time > 0.f ? dt / ( params_.return_time + dt ) : 0.f;
+		for ( int i = 0; i < 3; ++i )
+		{
+			gravity_[ i ] += k_gravity * ( accel_world[ i ] - gravity_[ i ] );
+			velocity_[ i ] = 0.f;
+			offset_[ i ] -= k_return * offset_[ i ];
+		}
+		return;
+	}
+
+	// Dead reckoning on the gravity-free acceleration, with a velocity leak
+	const float k_decay = params_.velocity_decay_time > 0.f ? dt / ( params_.velocity_decay_time + dt ) : 1.f;
+	for ( int i = 0; i < 3; ++i )
+	{
+		velocity_[ i ] += ( accel_world[ i ] - gravity_[ i ] ) * dt;
+		velocity_[ i ] -= k_decay * velocity_[ i ];
+		offset_[ i ] += velocity_[ i ] * dt;
+	}
+
+	// Hard bound: past the radius the offset is certainly drift, so stop integrating outward
+	const float len = std::sqrt( offset_[ 0 ] * offset_[ 0 ] + offset_[ 1 ] * offset_[ 1 ] + offset_[ 2 ] * offset_[ 2 ] );
+	if ( len > params_.max_offset )
+	{
+		const float s = len > 0.f ? params_.max_offset / len : 0.f;
+		for ( int i = 0; i < 3; ++i )
+		{
+			offset_[ i ] *= s;
+			velocity_[ i ] = 0.f;
+		}
+	}
+}
+
+void PositionEngine::Evaluate( const ImuQuat &anchor, const ImuQuat &rel, const float w[ 3 ], float position[ 3 ], float velocity[ 3 ] ) const
+{
+	// SteamVR's head frame looks down -Z
+	const ImuVec3 eye_head{ 0.f, params_.neck_eye_up, -params_.neck_eye_forward };
+	if ( params_.mode == PositionMode::Fixed )
+	{
+		position[ 0 ] = correction_[ 0 ];
+		position[ 1 ] = params_.standing_height + correction_[ 1 ];
+		position[ 2 ] = correction_[ 2 ];
+		velocity[ 0 ] = velocity[ 1 ] = velocity[ 2 ] = 0.f;
+		return;
+	}
+
+	// Neck model: the eyes swing around a pivot placed so a level head sits at standing_height
+	const ImuVec3 pivot = ImuVec3{ 0.f, params_.standing_height, 0.f } - eye_head;
+	const ImuVec3 eye = QuatRotate( rel, eye_head );
+	ImuVec3 p = pivot + eye;
+	ImuVec3 v = linalg::cross( ImuVec3{ w[ 0 ], w[ 1 ], w[ 2 ] }, eye );
+
+	if ( params_.mode == PositionMode::Inertial )
+	{
+		// The offset is integrated in the world frame; driver space is the anchor's yaw away
+		p += QuatRotateInverse( anchor, ImuVec3{ offset_[ 0 ], offset_[ 1 ], offset_[ 2 ] } );
+		v += QuatRotateInverse( anchor, ImuVec3{ velocity_[ 0 ], velocity_[ 1 ], velocity_[ 2 ] } );
+	}
+	for ( int i = 0; i < 3; ++i )
+	{
+		position[ i ] = p[ i ] + correction_[ i ];
+		velocity[ i ] = v[ i ];
+	}
+}
+
+void PositionEngine::AddCorrection( const float delta[ 3 ] )
+{
+	for ( int i = 0; i < 3; ++i )
+		correction_[ i ] += delta[ i ];
+}
+
+void PositionEngine::Recenter()
+{
+	for ( int i = 0; i < 3; ++i )
+	{
+		velocity_[ i ] = 0.f;
+		offset_[ i ] = 0.f;
+	}
+}
+
+void PositionEngine::ResumeAfterIdle()
+{
+	for ( int i = 0; i < 3; ++i )
+		velocity_[ i ] = 0.f;
+	still_time_ = 0.f;
+	stationary_ = false;
+}
+
+void PositionEngine::Reset()
+{
+	*this = PositionEngine( params_ );
+}
@@ -0,0 +1,95 @@
+// Head position for the RayNeo IMU: a neck model, optionally with ZUPT-aided inertial dead
+// reckoning on top. Headless like the rest of the tracking pipeline (no OpenVR or SDK).
+#pragma once
+
+#include "imu_math.h"
+
+enum class PositionMode
+{
+	Fixed,     // eyes parked at standing_height; vrserver may apply its own head model
+	HeadModel, // eyes swing around a fixed neck pivot with the head orientation
+	Inertial,  // head model plus a bounded, zero-velocity-updated accelerometer offset
+};
+
+struct PositionEngineParams
+{
+	PositionMode mode = PositionMode::Fixed;
+
+	// Eye height with the head level, in driver space (meters); the neck pivot sits below it
+	float standing_height = 1.5f;
+	// Neck pivot to the point between the eyes, in the head frame (meters up / forward)
+	float neck_eye_up = 0.075f;
+	float neck_eye_forward = 0.08f;
+
+	// Zero-velocity detector: the head counts as stationary once the bias-corrected gyro rate
+	// stays below zupt_gyro_threshold (rad/s) and the specific force within zupt_accel_threshold
+	// (g) of the gravity estimate for zupt_hold_time (seconds)
+	float zupt_gyro_threshold = 0.1f;
+	float zupt_accel_threshold = 0.03f;
+	float zupt_hold_time = 0.05f;
+
+	// Time constant of the world-frame gravity estimate, refined only while stationary (seconds)
+	float gravity_time_constant = 1.0f;
+	// Between zero-velocity updates, velocity leaks toward zero with this time constant (seconds)
+	float velocity_decay_time = 0.5f;
+	// While stationary the offset returns to the neck pivot with this time constant (0: hold)
+	float return_time = 5.0f;
+	// Largest inertial offset from the neck pivot (meters)
+	float max_offset = 0.3f;
+};
+
+const char *PositionModeName( PositionMode mode );
+
+// Accepts "fixed", "head_model" or "inertial"; returns false if unknown
+bool ParsePositionMode( const char *name, PositionMode &out );
+
+//-----------------------------------------------------------------------------
+// Purpose: Translation is not observable from a consumer IMU over more than a fraction of a
+// second, so the position is a neck model (always bounded) plus, in Inertial mode, a short-lived
+// offset from double integration that zero-velocity updates, a velocity leak, a return-to-pivot
+// term and a hard radius keep bounded. Gravity is removed with a world-frame estimate learned
+// while stationary, which also absorbs the accelerometer's sign convention and scale error.
+// Constant time per sample, no allocation; single threaded like TrackingPipeline.
+//-----------------------------------------------------------------------------
+class PositionEngine
+{
+public:
+	explicit PositionEngine( const PositionEngineParams &params = {} ) : params_( params ) {}
+
+	// accel_world: specific force rotated into the world frame (m/s^2, gravity included);
+	// gyro_rate: magnitude of the body rate after gyro_scale, less the stillness estimator's bias
+	// when learning is on (the fusion filter's own bias estimate is not removed) (rad/s)
+	void Update( const float accel_world[ 3 ], float gyro_rate, float dt );
+
+	// Eye position and linear velocity in driver space for the anchored orientation rel
+	// (driver from head) with driver-space angular velocity w; anchor maps driver to world
+	void Evaluate( const ImuQuat &anchor, const ImuQuat &rel, const float w[ 3 ], float position[ 3 ], float velocity[ 3 ] ) const;
+
+	bool IsStationary() const { return stationary_; }
+	const PositionEngineParams &Params() const { return params_; }
+	void SetParams( const PositionEngineParams &params ) { params_ = params; }
+
+	// External tracker correction (driver space, meters), added on top of every mode's output
+	void AddCorrection( const float delta[ 3 ] );
+
+	// Back to the neck pivot (keeps the gravity estimate and the external correction)
+	void Recenter();
+	// After an IMU gap: drop velocity and the detector, keep offset and gravity
+	void ResumeAfterIdle();
+	void Reset();
+
+private:
+	PositionEngineParams params_;
+
+	float gravity_[ 3 ] = { 0.f, 0.f, 0.f };
+	bool have_gravity_ = false;
+	float still_time_ = 0.f;
+	bool stationary_ = false;
+
+	// World frame
+	float velocity_[ 3 ] = { 0.f, 0.f, 0.f };
+	float offset_[ 3 ] = { 0.f, 0.f, 0.f };
+
+	// Driver space
+	float correction_[ 3 ] = { 0.f, 0.f, 0.f };
+};
@@ -0,0 +1,72 @@
+// Driver power state: vrserver standby and the glasses' own sleep both idle the IMU and pose threads.
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+
+enum class PowerState
+{
+	Active, // IMU streaming, poses published at the full rate
+	Idle,   // IMU disabled, pose thread parked and publishing at the standby rate
+};
+
+// Independent reasons to idle; the driver is Active only while none is set
+enum PowerReason : uint32_t
+{
+	kPowerReasonStandby = 1u << 0,      // IServerTrackedDeviceProvider::EnterStandby / device EnterStandby
+	kPowerReasonGlassesSleep = 1u << 1, // RAYNEO_NOTIFY_SLEEP (cleared by RAYNEO_NOTIFY_WAKE)
+};
+
+//-----------------------------------------------------------------------------
+// Purpose: Collects idle reasons from any thread and lets the pose thread park until the state
+// changes. State() is a single relaxed load so GetPose() and the hot paths can check it freely;
+// transitions are rare and take the mutex to hand over wakeups.
+//-----------------------------------------------------------------------------
+class PowerStateMachine
+{
+public:
+	// Returns true when the effective state changed as a result
+	bool SetReason( uint32_t reason, bool set )
+	{
+		std::lock_guard< std::mutex > lock( mutex_ );
+		const uint32_t before = reasons_.load( std::memory_order_relaxed );
+		const uint32_t after = set ? ( before | reason ) : ( before & ~reason );
+		reasons_.store( after, std::memory_order_relaxed );
+		if ( ( before == 0 ) == ( after == 0 ) )
+			return false;
+		generation_.fetch_add( 1, std::memory_order_release );
+		cv_.notify_all();
+		return true;
+	}
+
+	PowerState State() const { return reasons_.load( std::memory_order_relaxed ) == 0 ? PowerState::Active : PowerState::Idle; }
+	bool IsIdle() const { return State() == PowerState::Idle; }
+	uint32_t Reasons() const { return reasons_.load( std::memory_order_relaxed ); }
+
+	// Pose thread: blocks while idle until the state changes, Wake() is called or the timeout expires
+	void WaitWhileIdle( std::chrono::nanoseconds timeout )
+	{
+		std::unique_lock< std::mutex > lock( mutex_ );
+		const uint64_t seen = generation_.load( std::memory_order_acquire );
+		cv_.wait_for( lock, timeout, [ & ] {
+			return reasons_.load( std::memory_order_relaxed ) == 0 || generation_.load( std::memory_order_acquire ) != seen;
+		} );
+	}
+
+	// Release any parked waiter (e.g. so Deactivate doesn't wait out a standby interval)
+	void Wake()
+	{
+		std::lock_guard< std::mutex > lock( mutex_ );
+		generation_.fetch_add( 1, std::memory_order_release );
+		cv_.notify_all();
+	}
+
+private:
+	std::atomic< uint32_t > reasons_{ 0 };
+	std::atomic< uint64_t > generation_{ 0 };
+	std::mutex mutex_;
+	std::condition_variable cv_;
+};
@@ -0,0 +1,226 @@
+#include "rayneo_unit.h"
+
+#include "driverlog.h"
+#include "driver_stats.h"
+#include "thread_policy.h"
+
+#include <algorithm>
+#include <cstdio>
+
+namespace
+{
+	// Extra units are orientation-only trackers parked at a fixed spot; a neck model or
+	// inertial offset means nothing on a device nobody is wearing as the HMD
+	TrackingPipelineConfig UnitPipelineConfig( const DriverSettings &settings )
+	{
+		TrackingPipelineConfig config = settings.PipelineConfig();
+		config.position.mode = PositionMode::Fixed;
+		return config;
+	}
+}
+
+RayneoUnit::RayneoUnit( int device_index, const DriverSettings &settings )
+	: device_index_( device_index ), settings_( settings ), pipeline_( UnitPipelineConfig( settings ) )
+{
+	applied_settings_generation_ = settings_.Generation();
+}
+
+void RayneoUnit::Start()
+{
+	if ( thread_.joinable() )
+		return;
+	stop_.store( false );
+	thread_ = std::thread( &RayneoUnit::SupervisorLoop, this );
+}
+
+void RayneoUnit::Stop()
+{
+	{
+		std::lock_guard< std::mutex > lock( stop_mutex_ );
+		stop_.store( true );
+	}
+	stop_cv_.notify_all();
+	if ( thread_.joinable() )
+		thread_.join();
+	if ( ctx_ )
+	{
+		// Rayneo_Destroy(ctx_); (kept alive, as for the primary context)
+		ctx_ = nullptr;
+	}
+}
+
+std::string RayneoUnit::Serial() const
+{
+	std::lock_guard< std::mutex > lock( serial_mutex_ );
+	return serial_;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Same connect / stream / reconnect-with-backoff cycle as the primary unit.
+//-----------------------------------------------------------------------------
+void RayneoUnit::SupervisorLoop()
+{
+	const std::string thread_name = "rayneo-unit" + std::to_string( device_index_ );
+	const ScopedThreadPolicy thread_policy( thread_name.c_str(), settings_.EventThreadPolicy() );
+	int64_t backoff_ms = 0;
+	while ( !stop_.load() )
+	{
+		if ( Connect() )
+		{
+			DriverLog( "[unit %d] connected", device_index_ );
+			clock_.Reset();
+			pipeline_.ResumeAfterIdle();
+			PublishLinkState( true );
+			backoff_ms = 0;
+
+			EventLoop();
+
+			PublishLinkState( false );
+			Disconnect();
+			if ( stop_.load() )
+				break;
+			DriverLog( "[unit %d] detached; reconnecting", device_index_ );
+		}
+
+		const int64_t initial_ms = settings_.reconnect_initial_backoff_ms.load();
+		const int64_t max_ms = std::max< int64_t >( settings_.reconnect_max_backoff_ms.load(), initial_ms );
+		backoff_ms = backoff_ms == 0 ? initial_ms : std::min( backoff_ms * 2, max_ms );
+
+		std::unique_lock< std::mutex > lock( stop_mutex_ );
+		stop_cv_.wait_for( lock, std::chrono::milliseconds( backoff_ms ), [ this ] { return stop_.load(); } );
+	}
+}
+
+bool RayneoUnit::Connect()
+{
+	if ( !ctx_ )
+	{
+		if ( Rayneo_Create( &ctx_ ) != RAYNEO_OK || !ctx_ )
+		{
+			ctx_ = nullptr;
+			return false;
+		}
+	}
+	Rayneo_SetTargetVidPid( ctx_, static_cast< uint16_t >( settings_.usb_vid.load() ), static_cast< uint16_t >( settings_.usb_pid.load() ) );
+
+	// Quiet on failure: an absent unit is retried for the whole session
+	if ( Rayneo_Start( ctx_, device_index_ ) != RAYNEO_OK )
+		return false;
+	started_ = true;
+
+	const RAYNEO_Result rc = Rayneo_EnableImu( ctx_ );
+	if ( rc != RAYNEO_OK )
+		DriverLog( "[unit %d] Rayneo_EnableImu failed: %d", device_index_, (int)rc );
+	Rayneo_RequestDeviceInfo( ctx_ );
+	return true;
+}
+
+void RayneoUnit::Disconnect()
+{
+	if ( started_ )
+	{
+		Rayneo_DisableImu( ctx_ );
+		Rayneo_Stop( ctx_ );
+		started_ = false;
+	}
+}
+
+void RayneoUnit::EventLoop()
+{
+	bool attached = true;
+	while ( attached && !stop_.load() )
+	{
+		if ( Rayneo_PollEvent( ctx_, &event_batch_[ 0 ], 500 ) != RAYNEO_OK )
+			continue;
+		size_t count = 1;
+		while ( count < kMaxEventBatch && Rayneo_PollEvent( ctx_, &event_batch_[ count ], 0 ) == RAYNEO_OK )
+			++count;
+
+		const int64_t receive_ns = StatsNowNs();
+		size_t imu_count = 0;
+		int64_t last_sample_ns = 0;
+		for ( size_t i = 0; i < count; ++i )
+		{
+			const RAYNEO_Event &evt = event_batch_[ i ];
+			if ( evt.type != RAYNEO_EVENT_IMU_SAMPLE || !evt.data.imu.valid )
+				continue;
+			const RAYNEO_ImuSample &s = evt.data.imu;
+			last_sample_ns = clock_.Update( s.tick, receive_ns );
+			TrackingImuSample &in = imu_batch_[ imu_count++ ];
+			in.tick = s.tick;
+			for ( int k = 0; k < 3; ++k )
+			{
+				in.gyro_rad[ k ] = s.gyroRad[ k ];
+				in.gyro_dps[ k ] = s.gyroDps[ k ];
+				in.acc[ k ] = s.acc[ k ];
+			}
+		}
+		if ( imu_count > 0 )
+		{
+			Integrate( imu_count );
+			pipeline_.BuildSnapshot( published_ );
+			published_.sample_tick = imu_batch_[ imu_count - 1 ].tick;
+			published_.sample_host_time_ns = last_sample_ns;
+			published_.receive_host_time_ns = receive_ns;
+			tracking_->Publish( published_ );
+		}
+
+		for ( size_t i = 0; i < count; ++i )
+		{
+			const RAYNEO_Event &evt = event_batch_[ i ];
+			if ( evt.type == RAYNEO_EVENT_IMU_SAMPLE )
+				continue;
+			if ( evt.type == RAYNEO_EVENT_DEVICE_DETACHED )
+			{
+				attached = false;
+				break;
+			}
+			Dispatch( evt );
+		}
+	}
+}
+
+void RayneoUnit::Dispatch( const RAYNEO_Event &evt )
+{
+	if ( evt.type == RAYNEO_EVENT_DEVICE_INFO )
+	{
+		// The SDK reports no USB serial; board id + firmware date is what identifies a unit
+		// (the provider disambiguates identical pairs when it registers the tracker)
+		if ( !has_serial_.load( std::memory_order_relaxed ) )
+		{
+			char serial[ 96 ];
+			snprintf( serial, sizeof( serial ), "RayNeo-%d-%.32s", (int)evt.data.info.board_id, evt.data.info.date );
+			{
+				std::lock_guard< std::mutex > lock( serial_mutex_ );
+				serial_ = serial;
+			}
+			has_serial_.store( true, std::memory_order_release );
+			DriverLog( "[unit %d] device info: serial %s, %d fps", device_index_, serial, (int)evt.data.info.glasses_fps );
+		}
+	}
+	else if ( evt.type == RAYNEO_EVENT_NOTIFY )
+	{
+		DriverLog( "[unit %d] notify code=0x%X", device_index_, (unsigned)evt.data.notify.code );
+	}
+}
+
+void RayneoUnit::PublishLinkState( bool connected )
+{
+	published_.connected = connected;
+	tracking_->Publish( published_ );
+}
+
+void RayneoUnit::Integrate( size_t count )
+{
+	// Settings reloads and recenter requests are applied between batches, as on the primary unit
+	const uint64_t generation = settings_.Generation();
+	if ( generation != applied_settings_generation_ )
+	{
+		applied_settings_generation_ = generation;
+		pipeline_.SetConfig( UnitPipelineConfig( settings_ ) );
+	}
+	if ( recenter_requested_.exchange( false, std::memory_order_relaxed ) )
+		pipeline_.Recenter();
+
+	pipeline_.ProcessBatch( imu_batch_, count );
+}
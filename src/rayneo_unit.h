@@ -0,0 +1,88 @@
+// One additional pair of RayNeo glasses, tracked on its own SDK context and thread and exposed
+// to SteamVR as a generic tracker (the primary unit stays in MyDeviceProvider as the HMD).
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "rayneo_api.h"
+
+#include "driver_settings.h"
+#include "imu_clock.h"
+#include "tracking_pipeline.h"
+#include "tracking_state.h"
+
+//-----------------------------------------------------------------------------
+// Purpose: Per-device session: SDK context, supervisor/event thread with reconnect backoff,
+// clock sync and tracking pipeline, publishing into its own TrackingState (handed to the tracker).
+// Everything below is owned by the unit's own thread except the flags at the end. Each unit and
+// each TrackingState is its own allocation, so several units streaming at 1 kHz never false-share.
+//
+// The SDK has no enumeration call: units are opened by index among the devices matching the
+// configured VID/PID (index 0 is the HMD), and a missing index is simply retried with backoff.
+//-----------------------------------------------------------------------------
+class alignas( 64 ) RayneoUnit
+{
+public:
+	RayneoUnit( int device_index, const DriverSettings &settings );
+	~RayneoUnit() { Stop(); }
+
+	RayneoUnit( const RayneoUnit & ) = delete;
+	RayneoUnit &operator=( const RayneoUnit & ) = delete;
+
+	void Start();
+	void Stop();
+
+	int DeviceIndex() const { return device_index_; }
+	// Pose plus link state (connected), for the tracker that publishes this unit
+	const std::shared_ptr< TrackingState > &Tracking() const { return tracking_; }
+
+	// Derived from the first RAYNEO_EVENT_DEVICE_INFO ("RayNeo-<board id>-<date>"); empty until then
+	bool HasSerial() const { return has_serial_.load( std::memory_order_acquire ); }
+	std::string Serial() const;
+
+	// Any thread; applied by the unit's thread before its next sample
+	void Recenter() { recenter_requested_.store( true, std::memory_order_relaxed ); }
+
+private:
+	void SupervisorLoop();
+	bool Connect();
+	void Disconnect();
+	void EventLoop();
+	void Dispatch( const RAYNEO_Event &evt );
+	// The first count samples of imu_batch_
+	void Integrate( size_t count );
+	void PublishLinkState( bool connected );
+
+	const int device_index_;
+	const DriverSettings &settings_;
+
+	std::thread thread_;
+	std::atomic< bool > stop_{ false };
+	std::mutex stop_mutex_;
+	std::condition_variable stop_cv_;
+
+	// Unit thread only
+	RAYNEO_Context ctx_ = nullptr;
+	bool started_ = false;
+	static constexpr size_t kMaxEventBatch = 64;
+	RAYNEO_Event event_batch_[ kMaxEventBatch ] = {};
+	TrackingImuSample imu_batch_[ kMaxEventBatch ];
+	alignas( 64 ) TrackingPipeline pipeline_;
+	ImuClockSync clock_;
+	uint64_t applied_settings_generation_ = 0;
+	PoseSnapshot published_;
+	const std::shared_ptr< TrackingState > tracking_ = std::make_shared< TrackingState >();
+
+	// Shared with the provider
+	alignas( 64 ) std::atomic< bool > has_serial_{ false };
+	std::atomic< bool > recenter_requested_{ false };
+
+	mutable std::mutex serial_mutex_;
+	std::string serial_;
+};
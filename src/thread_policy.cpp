@@ -0,0 +1,294 @@
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#include <avrt.h>
+#include <timeapi.h>
+#else
+#include <cerrno>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+#endif
+
+#include "thread_policy.h"
+
+#include "driverlog.h"
+
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include <thread>
+
+namespace
+{
+#ifdef _WIN32
+	// Windows 10 1803+; older systems fall back to a timer bound by the system tick
+	constexpr DWORD kHighResolutionTimerFlag = 0x00000002; // CREATE_WAITABLE_TIMER_HIGH_RESOLUTION
+#else
+	constexpr int kHighNice = -10;
+
+	pid_t CurrentTid()
+	{
+		return static_cast< pid_t >( syscall( SYS_gettid ) );
+	}
+#endif
+}
+
+const char *ThreadPriorityName( ThreadPriority priority )
+{
+	switch ( priority )
+	{
+	case ThreadPriority::High: return "high";
+	case ThreadPriority::Realtime: return "realtime";
+	case ThreadPriority::Normal: break;
+	}
+	return "normal";
+}
+
+bool ParseThreadPriority( const char *name, ThreadPriority &out )
+{
+	if ( !name )
+		return false;
+	if ( strcmp( name, "normal" ) == 0 )
+		out = ThreadPriority::Normal;
+	else if ( strcmp( name, "high" ) == 0 )
+		out = ThreadPriority::High;
+	else if ( strcmp( name, "realtime" ) == 0 )
+		out = ThreadPriority::Realtime;
+	else
+		return false;
+	return true;
+}
+
+void SetCurrentThreadName( const char *name )
+{
+	if ( !name || !*name )
+		return;
+#ifdef _WIN32
+	// Looked up at run time: the export is missing before Windows 10 1607
+	using SetThreadDescriptionFn = HRESULT( WINAPI * )( HANDLE, PCWSTR );
+	static const auto set_description = reinterpret_cast< SetThreadDescriptionFn >(
+		reinterpret_cast< void * >( GetProcAddress( GetModuleHandleW( L"kernel32.dll" ), "SetThreadDescription" ) ) );
+	if ( !set_description )
+		return;
+	wchar_t wide[ 64 ] = {};
+	MultiByteToWideChar( CP_UTF8, 0, name, -1, wide, static_cast< int >( sizeof( wide ) / sizeof( wide[ 0 ] ) ) - 1 );
+	set_description( GetCurrentThread(), wide );
+#else
+	char truncated[ 16 ] = {};
+	strncpy( truncated, name, sizeof( truncated ) - 1 );
+	pthread_setname_np( pthread_self(), truncated );
+#endif
+}
+
+ScopedThreadPolicy::ScopedThreadPolicy( const char *name, const ThreadPolicy &policy )
+{
+	SetCurrentThreadName( name );
+
+	std::string how;
+#ifdef _WIN32
+	HANDLE thread = GetCurrentThread();
+	previous_priority_ = GetThreadPriority( thread );
+	if ( policy.priority == ThreadPriority::Realtime )
+	{
+		DWORD task_index = 0;
+		mmcss_handle_ = AvSetMmThreadCharacteristicsW( L"Pro Audio", &task_index );
+		if ( mmcss_handle_ )
+		{
+			AvSetMmThreadPriority( mmcss_handle_, AVRT_PRIORITY_CRITICAL );
+			applied_ = ThreadPriority::Realtime;
+			how = "MMCSS Pro Audio";
+		}
+		else if ( SetThreadPriority( thread, THREAD_PRIORITY_TIME_CRITICAL ) )
+		{
+			priority_changed_ = true;
+			applied_ = ThreadPriority::Realtime;
+			how = "time critical; MMCSS unavailable";
+		}
+	}
+	if ( policy.priority != ThreadPriority::Normal && applied_ == ThreadPriority::Normal && SetThreadPriority( thread, THREAD_PRIORITY_HIGHEST ) )
+	{
+		priority_changed_ = true;
+		applied_ = ThreadPriority::High;
+	}
+
+	if ( policy.affinity_mask != 0 )
+	{
+		const DWORD_PTR previous = SetThreadAffinityMask( thread, static_cast< DWORD_PTR >( policy.affinity_mask ) );
+		if ( previous != 0 )
+		{
+			previous_affinity_ = previous;
+			affinity_changed_ = true;
+		}
+	}
+#else
+	sched_param param = {};
+	pthread_getschedparam( pthread_self(), &previous_policy_, &param );
+	previous_priority_ = param.sched_priority;
+	errno = 0;
+	previous_nice_ = getpriority( PRIO_PROCESS, static_cast< id_t >( CurrentTid() ) );
+	if ( errno != 0 )
+		previous_nice_ = 0;
+
+	if ( policy.priority == ThreadPriority::Realtime )
+	{
+		sched_param rt = {};
+		rt.sched_priority = std::clamp( policy.realtime_priority, sched_get_priority_min( SCHED_FIFO ), sched_get_priority_max( SCHED_FIFO ) );
+		const int rc = pthread_setschedparam( pthread_self(), SCHED_FIFO, &rt );
+		if ( rc == 0 )
+		{
+			priority_changed_ = true;
+			applied_ = ThreadPriority::Realtime;
+			how = "SCHED_FIFO " + std::to_string( rt.sched_priority );
+		}
+		else
+		{
+			how = std::string( "SCHED_FIFO refused: " ) + strerror( rc );
+		}
+	}
+	if ( policy.priority != ThreadPriority::Normal && applied_ == ThreadPriority::Normal )
+	{
+		// Per thread on Linux: the "process" id here is the calling thread's tid
+		if ( setpriority( PRIO_PROCESS, static_cast< id_t >( CurrentTid() ), kHighNice ) == 0 )
+		{
+			priority_changed_ = true;
+			applied_ = ThreadPriority::High;
+		}
+		else if ( how.empty() )
+		{
+			how = std::string( "nice refused: " ) + strerror( errno );
+		}
+	}
+
+	if ( policy.affinity_mask != 0 )
+	{
+		cpu_set_t previous;
+		CPU_ZERO( &previous );
+		pthread_getaffinity_np( pthread_self(), sizeof( previous ), &previous );
+		cpu_set_t wanted;
+		CPU_ZERO( &wanted );
+		for ( int cpu = 0; cpu < 64; ++cpu )
+		{
+			if ( policy.affinity_mask & ( uint64_t( 1 ) << cpu ) )
+				CPU_SET( cpu, &wanted );
+		}
+		if ( pthread_setaffinity_np( pthread_self(), sizeof( wanted ), &wanted ) == 0 )
+		{
+			for ( int cpu = 0; cpu < 64; ++cpu )
+			{
+				if ( CPU_ISSET( cpu, &previous ) )
+					previous_affinity_ |= uint64_t( 1 ) << cpu;
+			}
+			affinity_changed_ = true;
+		}
+	}
+#endif
+
+	DriverLog( "[thread] %s: priority %s (requested %s%s%s), affinity %s 0x%llx", name ? name : "?", ThreadPriorityName( applied_ ),
+		ThreadPriorityName( policy.priority ), how.empty() ? "" : "; ", how.c_str(),
+		policy.affinity_mask == 0 ? "any" : affinity_changed_ ? "pinned to" : "refused for", (unsigned long long)policy.affinity_mask );
+}
+
+ScopedThreadPolicy::~ScopedThreadPolicy()
+{
+#ifdef _WIN32
+	if ( mmcss_handle_ )
+		AvRevertMmThreadCharacteristics( mmcss_handle_ );
+	if ( priority_changed_ )
+		SetThreadPriority( GetCurrentThread(), previous_priority_ );
+	if ( affinity_changed_ )
+		SetThreadAffinityMask( GetCurrentThread(), static_cast< DWORD_PTR >( previous_affinity_ ) );
+#else
+	if ( priority_changed_ )
+	{
+		sched_param param = {};
+		param.sched_priority = previous_priority_;
+		pthread_setschedparam( pthread_self(), previous_policy_, &param );
+		setpriority( PRIO_PROCESS, static_cast< id_t >( CurrentTid() ), previous_nice_ );
+	}
+	if ( affinity_changed_ )
+	{
+		cpu_set_t previous;
+		CPU_ZERO( &previous );
+		for ( int cpu = 0; cpu < 64; ++cpu )
+		{
+			if ( previous_affinity_ & ( uint64_t( 1 ) << cpu ) )
+				CPU_SET( cpu, &previous );
+		}
+		pthread_setaffinity_np( pthread_self(), sizeof( previous ), &previous );
+	}
+#endif
+}
+
+void TimerResolution::Request( uint32_t milliseconds )
+{
+	Release();
+#ifdef _WIN32
+	if ( milliseconds > 0 && timeBeginPeriod( milliseconds ) == TIMERR_NOERROR )
+	{
+		period_ms_ = milliseconds;
+		DriverLog( "[thread] timer resolution raised to %u ms", milliseconds );
+	}
+#else
+	(void)milliseconds;
+#endif
+}
+
+void TimerResolution::Release()
+{
+#ifdef _WIN32
+	if ( period_ms_ > 0 )
+		timeEndPeriod( period_ms_ );
+#endif
+	period_ms_ = 0;
+}
+
+PreciseSleeper::PreciseSleeper()
+{
+#ifdef _WIN32
+	timer_ = CreateWaitableTimerExW( nullptr, nullptr, kHighResolutionTimerFlag, TIMER_ALL_ACCESS );
+	if ( !timer_ )
+		timer_ = CreateWaitableTimerExW( nullptr, nullptr, 0, TIMER_ALL_ACCESS );
+#endif
+}
+
+PreciseSleeper::~PreciseSleeper()
+{
+#ifdef _WIN32
+	if ( timer_ )
+		CloseHandle( static_cast< HANDLE >( timer_ ) );
+#endif
+}
+
+void PreciseSleeper::SleepUntil( std::chrono::steady_clock::time_point deadline )
+{
+#ifdef _WIN32
+	const auto remaining = deadline - std::chrono::steady_clock::now();
+	if ( remaining <= std::chrono::steady_clock::duration::zero() )
+		return;
+	if ( !timer_ )
+	{
+		std::this_thread::sleep_until( deadline );
+		return;
+	}
+	// Relative due time, in 100 ns units (negative)
+	LARGE_INTEGER due;
+	due.QuadPart = -std::max< LONGLONG >( 1, std::chrono::duration_cast< std::chrono::nanoseconds >( remaining ).count() / 100 );
+	if ( SetWaitableTimer( static_cast< HANDLE >( timer_ ), &due, 0, nullptr, nullptr, FALSE ) )
+		WaitForSingleObject( static_cast< HANDLE >( timer_ ), INFINITE );
+	else
+		std::this_thread::sleep_until( deadline );
+#else
+	// steady_clock is CLOCK_MONOTONIC on Linux, so its epoch is the absolute deadline's
+	const auto ns = std::chrono::duration_cast< std::chrono::nanoseconds >( deadline.time_since_epoch() ).count();
+	timespec ts;
+	ts.tv_sec = static_cast< time_t >( ns / 1000000000 );
+	ts.tv_nsec = static_cast< long >( ns % 1000000000 );
+	while ( clock_nanosleep( CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, nullptr ) == EINTR )
+	{
+	}
+#endif
+}
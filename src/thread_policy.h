@@ -0,0 +1,105 @@
+// Scheduling for the driver's latency critical threads: priority (MMCSS / SCHED_FIFO where
+// permitted), CPU affinity, timer resolution, precise sleeps and thread names for profilers.
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+
+enum class ThreadPriority
+{
+	Normal,   // OS default
+	High,     // THREAD_PRIORITY_HIGHEST / nice -10
+	Realtime, // MMCSS "Pro Audio" (else THREAD_PRIORITY_TIME_CRITICAL) / SCHED_FIFO
+};
+
+const char *ThreadPriorityName( ThreadPriority priority );
+
+// Accepts "normal", "high" or "realtime"; returns false if unknown
+bool ParseThreadPriority( const char *name, ThreadPriority &out );
+
+struct ThreadPolicy
+{
+	ThreadPriority priority = ThreadPriority::Normal;
+	// SCHED_FIFO priority (1..99) for Realtime on Linux; MMCSS picks its own on Windows
+	int realtime_priority = 10;
+	// Bit i allows logical CPU i; 0 leaves placement to the OS
+	uint64_t affinity_mask = 0;
+};
+
+// Names the calling thread (SetThreadDescription on Windows 10+, pthread_setname_np on Linux,
+// which keeps the first 15 characters)
+void SetCurrentThreadName( const char *name );
+
+//-----------------------------------------------------------------------------
+// Purpose: Names the calling thread and applies policy to it until destruction, which restores
+// the previous priority and affinity (an MMCSS registration must be reverted by the thread that
+// made it, so construct it on the stack at the top of the thread function). Each step that is
+// not permitted (no CAP_SYS_NICE / RLIMIT_RTPRIO, MMCSS service off) falls back one level and
+// is logged once; the thread keeps running either way.
+//-----------------------------------------------------------------------------
+class ScopedThreadPolicy
+{
+public:
+	ScopedThreadPolicy( const char *name, const ThreadPolicy &policy );
+	~ScopedThreadPolicy();
+
+	ScopedThreadPolicy( const ScopedThreadPolicy & ) = delete;
+	ScopedThreadPolicy &operator=( const ScopedThreadPolicy & ) = delete;
+
+	// What the thread actually got
+	ThreadPriority Applied() const { return applied_; }
+
+private:
+	ThreadPriority applied_ = ThreadPriority::Normal;
+	void *mmcss_handle_ = nullptr;
+	bool priority_changed_ = false;
+	bool affinity_changed_ = false;
+	// Previous state: Windows thread priority / Linux policy, sched priority and nice
+	int previous_policy_ = 0;
+	int previous_priority_ = 0;
+	int previous_nice_ = 0;
+	uint64_t previous_affinity_ = 0;
+};
+
+//-----------------------------------------------------------------------------
+// Purpose: Process wide timer resolution request (timeBeginPeriod) while held. Windows rounds
+// sleeps and condition variable timeouts up to the 15.6 ms default tick otherwise, which caps
+// the pose thread near 64 Hz. No-op on Linux, whose timers are high resolution already.
+//-----------------------------------------------------------------------------
+class TimerResolution
+{
+public:
+	TimerResolution() = default;
+	~TimerResolution() { Release(); }
+
+	TimerResolution( const TimerResolution & ) = delete;
+	TimerResolution &operator=( const TimerResolution & ) = delete;
+
+	// 0 keeps the system default
+	void Request( uint32_t milliseconds );
+	void Release();
+
+private:
+	uint32_t period_ms_ = 0;
+};
+
+//-----------------------------------------------------------------------------
+// Purpose: Sleeps to an absolute steady_clock deadline with sub-millisecond accuracy: a high
+// resolution waitable timer on Windows 10 1803+ (a regular one, bound by TimerResolution,
+// before that), clock_nanosleep on CLOCK_MONOTONIC on Linux. One per thread.
+//-----------------------------------------------------------------------------
+class PreciseSleeper
+{
+public:
+	PreciseSleeper();
+	~PreciseSleeper();
+
+	PreciseSleeper( const PreciseSleeper & ) = delete;
+	PreciseSleeper &operator=( const PreciseSleeper & ) = delete;
+
+	void SleepUntil( std::chrono::steady_clock::time_point deadline );
+	void SleepFor( std::chrono::steady_clock::duration duration ) { SleepUntil( std::chrono::steady_clock::now() + duration ); }
+
+private:
+	void *timer_ = nullptr; // HANDLE
+};
@@ -0,0 +1,925 @@
+// Microbenchmarks and latency regression checks for the driver's hot paths: gyro integration,
+// the tracking pipeline, EDID decoding, the input event path, the async logger and the pose
+// snapshot under reader/writer contention. Every benchmark reports nanoseconds per operation
+// and a p99; with --baseline the run fails when either exceeds the stored limit, which is how
+// CTest runs it (one test per benchmark). No SteamVR, headset or display needed.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <openvr_driver.h>
+
+#include "display_edid_finder.h"
+#include "driver_stats.h"
+#include "driverlog.h"
+#include "edid_parser.h"
+#include "imu_math.h"
+#include "input_event_processor.h"
+#include "thread_policy.h"
+#include "tracking_pipeline.h"
+#include "tracking_state.h"
+
+namespace
+{
+	// The stored limits describe optimized code; an unoptimized build still runs every benchmark and
+	// fails on misbehavior, but only reports limits it exceeds
+#if ( defined( _MSC_VER ) && defined( _DEBUG ) ) || ( !defined( _MSC_VER ) && !defined( __OPTIMIZE__ ) )
+	constexpr bool kOptimizedBuild = false;
+#else
+	constexpr bool kOptimizedBuild = true;
+#endif
+
+	struct Options
+	{
+		std::vector< std::string > only;
+		std::vector< std::string > edid_paths;
+		std::string baseline_path;
+		std::string write_baseline_path;
+		double margin = 3.0;
+		int64_t min_time_ns = 200'000'000;
+		int repeat = 3;
+		ThreadPriority priority = ThreadPriority::Normal;
+		bool list = false;
+	};
+
+	void Usage()
+	{
+		printf(
+			"usage: rayneo_bench [options]\n"
+			"  --only <name>             run one benchmark (repeatable; default all)\n"
+			"  --list                    list the benchmarks and exit\n"
+			"  --baseline <file>         compare against stored limits; exit 1 on a regression\n"
+			"  --write-baseline <file>   store this run's results times --margin as the new limits\n"
+			"  --margin <k>              headroom for --write-baseline (default 3)\n"
+			"  --min-time <ms>           minimum duration of one pass (default 200)\n"
+			"  --repeat <n>              passes per benchmark, ns/op is the best one (default 3)\n"
+			"  --edid <file>             add a raw EDID dump (e.g. /sys/class/drm/*/edid) to the EDID benchmarks\n"
+			"  --priority <p>            normal, high or realtime for the benchmark threads (default normal)\n" );
+	}
+
+	bool ParseOptions( int argc, char **argv, Options &opt )
+	{
+		for ( int i = 1; i < argc; ++i )
+		{
+			const char *arg = argv[ i ];
+			const char *value = i + 1 < argc ? argv[ i + 1 ] : nullptr;
+			auto need = [ & ]() -> const char * {
+				if ( !value )
+				{
+					fprintf( stderr, "missing value for %s\n", arg );
+					return nullptr;
+				}
+				++i;
+				return value;
+			};
+
+			if ( !strcmp( arg, "--help" ) || !strcmp( arg, "-h" ) )
+				return false;
+			else if ( !strcmp( arg, "--list" ) )
+				opt.list = true;
+			else if ( !strcmp( arg, "--only" ) && need() )
+				opt.only.push_back( value );
+			else if ( !strcmp( arg, "--baseline" ) && need() )
+				opt.baseline_path = value;
+			else if ( !strcmp( arg, "--write-baseline" ) && need() )
+				opt.write_baseline_path = value;
+			else if ( !strcmp( arg, "--margin" ) && need() )
+				opt.margin = atof( value );
+			else if ( !strcmp( arg, "--min-time" ) && need() )
+				opt.min_time_ns = static_cast< int64_t >( atof( value ) * 1e6 );
+			else if ( !strcmp( arg, "--repeat" ) && need() )
+				opt.repeat = atoi( value );
+			else if ( !strcmp( arg, "--edid" ) && need() )
+				opt.edid_paths.push_back( value );
+			else if ( !strcmp( arg, "--priority" ) && need() )
+			{
+				if ( !ParseThreadPriority( value, opt.priority ) )
+				{
+					fprintf( stderr, "unknown priority '%s'\n", value );
+					return false;
+				}
+			}
+			else
+			{
+				fprintf( stderr, "unknown or incomplete option: %s\n", arg );
+				return false;
+			}
+		}
+		return opt.repeat > 0 && opt.min_time_ns > 0 && opt.margin >= 1.0;
+	}
+
+	struct BenchResult
+	{
+		LatencyHistogram latency; // per operation (per-block time / ops in the block)
+		double ns_per_op = 0.0;   // best pass
+		uint64_t ops = 0;
+		std::string error;        // set when the code under test misbehaved; always a failure
+	};
+
+	// ns_per_op keeps the fastest pass: slower ones measured interference, not the code
+	void AddPass( BenchResult &result, double ns_per_op, uint64_t ops )
+	{
+		if ( result.ops == 0 || ns_per_op < result.ns_per_op )
+			result.ns_per_op = ns_per_op;
+		result.ops += ops;
+	}
+
+	//-----------------------------------------------------------------------------
+	// Purpose: Calls block() (ops_per_block operations each) for at least min_time, --repeat
+	// times. Single operations of a few ns are below the clock's resolution, so they are timed
+	// in groups and the histogram gets the group's time divided by its size.
+	//-----------------------------------------------------------------------------
+	template < typename Block >
+	void MeasureBlocks( const Options &opt, size_t ops_per_block, BenchResult &result, Block &&block )
+	{
+		for ( int pass = 0; pass < opt.repeat; ++pass )
+		{
+			const int64_t start = StatsNowNs();
+			int64_t now = start;
+			uint64_t ops = 0;
+			while ( now - start < opt.min_time_ns )
+			{
+				const int64_t t0 = StatsNowNs();
+				block();
+				now = StatsNowNs();
+				result.latency.Record( ( now - t0 ) / static_cast< int64_t >( ops_per_block ) );
+				ops += ops_per_block;
+			}
+			AddPass( result, static_cast< double >( now - start ) / static_cast< double >( ops ), ops );
+		}
+	}
+
+	//-----------------------------------------------------------------------------
+	// Gyro integration and the tracking pipeline
+	//-----------------------------------------------------------------------------
+
+	// Head-like angular rate (rad/s) at sample k of a 1 kHz stream
+	void SyntheticGyro( uint64_t k, float out[ 3 ] )
+	{
+		const double t = static_cast< double >( k ) * 0.001;
+		out[ 0 ] = static_cast< float >( 0.8 * std::sin( 2.0 * 3.14159265358979323846 * 0.31 * t ) );
+		out[ 1 ] = static_cast< float >( 1.5 * std::sin( 2.0 * 3.14159265358979323846 * 0.17 * t + 1.0 ) );
+		out[ 2 ] = static_cast< float >( 0.4 * std::sin( 2.0 * 3.14159265358979323846 * 0.53 * t + 2.0 ) );
+	}
+
+	void RunQuatIntegrate( const Options &opt, BenchResult &result )
+	{
+		// One driver batch worth of samples per call, as the event thread drains them
+		constexpr size_t kBatch = 64;
+		constexpr size_t kBatches = 64;
+		std::vector< float > gyro( kBatch * kBatches * 3 );
+		std::vector< float > dt( kBatch * kBatches, 0.001f );
+		for ( size_t k = 0; k < kBatch * kBatches; ++k )
+			SyntheticGyro( k, &gyro[ k * 3 ] );
+
+		ImuQuat orientations[ kBatch ];
+		ImuQuat q;
+		size_t batch = 0;
+		MeasureBlocks( opt, kBatch, result, [ & ] {
+			q = IntegrateGyroBatch( q, &gyro[ batch * kBatch * 3 ], &dt[ batch * kBatch ], kBatch, 0.1f, orientations );
+			batch = ( batch + 1 ) % kBatches;
+		} );
+
+		const float norm = std::sqrt( q.w * q.w + q.x * q.x + q.y * q.y + q.z * q.z );
+		if ( !( std::fabs( norm - 1.f ) < 1e-3f ) )
+			result.error = "orientation lost unit length (|q| = " + std::to_string( norm ) + ")";
+	}
+
+	void RunPipelineBatch( const Options &opt, BenchResult &result )
+	{
+		// The driver's batched drain: ProcessBatch over what one SDK callback delivered, then one snapshot
+		constexpr size_t kBatch = 8;
+		constexpr size_t kStream = 4096;
+		std::vector< TrackingImuSample > stream( kStream );
+		for ( size_t k = 0; k < kStream; ++k )
+		{
+			TrackingImuSample &s = stream[ k ];
+			SyntheticGyro( k, s.gyro_rad );
+			for ( int i = 0; i < 3; ++i )
+				s.gyro_dps[ i ] = s.gyro_rad[ i ] * 180.f / 3.14159265f;
+			s.acc[ 1 ] = 1.f;
+		}
+
+		TrackingPipelineConfig config;
+		TrackingPipeline pipeline( config );
+		PoseSnapshot snap;
+		TrackingImuSample samples[ kBatch ];
+		uint32_t tick = 1000;
+		size_t k = 0;
+		MeasureBlocks( opt, kBatch, result, [ & ] {
+			// Ticks keep counting across passes of the stream so the pipeline never sees a gap
+			for ( TrackingImuSample &s : samples )
+			{
+				s = stream[ k ];
+				s.tick = tick++;
+				k = ( k + 1 ) % kStream;
+			}
+			pipeline.ProcessBatch( samples, kBatch );
+			pipeline.BuildSnapshot( snap );
+		} );
+
+		if ( !snap.valid )
+			result.error = "pipeline never produced a valid snapshot";
+	}
+
+	//-----------------------------------------------------------------------------
+	// EDID decoding
+	//-----------------------------------------------------------------------------
+
+	struct EdidMode
+	{
+		uint32_t pixel_clock_khz;
+		uint16_t h_active, h_blank, h_front_porch, h_sync_width;
+		uint16_t v_active, v_blank, v_front_porch, v_sync_width;
+	};
+
+	struct EdidBlob
+	{
+		std::string name;
+		std::vector< uint8_t > bytes;
+		// What ParseEdid must decode, so a broken decoder fails the run instead of speeding it up.
+		// Unchecked (product 0) for dumps given with --edid.
+		uint16_t product_code = 0;
+		std::string monitor_name;
+		uint32_t preferred_width = 0;
+		uint32_t preferred_height = 0;
+	};
+
+	void PutDetailedTiming( uint8_t *d, const EdidMode &m )
+	{
+		const uint32_t clock = m.pixel_clock_khz / 10;
+		d[ 0 ] = clock & 0xFF;
+		d[ 1 ] = ( clock >> 8 ) & 0xFF;
+		d[ 2 ] = m.h_active & 0xFF;
+		d[ 3 ] = m.h_blank & 0xFF;
+		d[ 4 ] = static_cast< uint8_t >( ( ( m.h_active >> 8 ) << 4 ) | ( ( m.h_blank >> 8 ) & 0x0F ) );
+		d[ 5 ] = m.v_active & 0xFF;
+		d[ 6 ] = m.v_blank & 0xFF;
+		d[ 7 ] = static_cast< uint8_t >( ( ( m.v_active >> 8 ) << 4 ) | ( ( m.v_blank >> 8 ) & 0x0F ) );
+		d[ 8 ] = m.h_front_porch & 0xFF;
+		d[ 9 ] = m.h_sync_width & 0xFF;
+		d[ 10 ] = static_cast< uint8_t >( ( ( m.v_front_porch & 0x0F ) << 4 ) | ( m.v_sync_width & 0x0F ) );
+		d[ 11 ] = static_cast< uint8_t >( ( ( m.h_front_porch >> 8 ) & 3 ) << 6 | ( ( m.h_sync_width >> 8 ) & 3 ) << 4 |
+			( ( m.v_front_porch >> 4 ) & 3 ) << 2 | ( ( m.v_sync_width >> 4 ) & 3 ) );
+		d[ 17 ] = 0x1E; // digital separate sync, both polarities positive
+	}
+
+	void PutTextDescriptor( uint8_t *d, uint8_t tag, const char *text )
+	{
+		d[ 3 ] = tag;
+		size_t i = 0;
+		for ( ; i < 13 && text[ i ]; ++i )
+			d[ 5 + i ] = static_cast< uint8_t >( text[ i ] );
+		if ( i < 13 )
+			d[ 5 + i++ ] = 0x0A;
+		for ( ; i < 13; ++i )
+			d[ 5 + i ] = 0x20;
+	}
+
+	void PutChecksum( uint8_t *block )
+	{
+		uint8_t sum = 0;
+		for ( int i = 0; i < 127; ++i )
+			sum = static_cast< uint8_t >( sum + block[ i ] );
+		block[ 127 ] = static_cast< uint8_t >( 0x100 - sum );
+	}
+
+	//-----------------------------------------------------------------------------
+	// Purpose: A well-formed EDID 1.4 base block (preferred DTD, optional second DTD, range
+	// limits and product name) plus, when vics or cta_modes are given, a CTA-861 extension with
+	// a video data block, an HDMI vendor block and the extra DTDs.
+	//-----------------------------------------------------------------------------
+	std::vector< uint8_t > MakeEdid( const char pnp[ 3 ], uint16_t product, uint32_t serial, const char *name, const EdidMode &preferred,
+		const EdidMode *second, const std::vector< uint8_t > &vics, const std::vector< EdidMode > &cta_modes )
+	{
+		const bool extension = !vics.empty() || !cta_modes.empty();
+		std::vector< uint8_t > e( extension ? 256 : 128, 0 );
+		const uint8_t header[ 8 ] = { 0x00, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0x00 };
+		memcpy( e.data(), header, sizeof( header ) );
+		const uint16_t id = static_cast< uint16_t >( ( ( pnp[ 0 ] - 64 ) << 10 ) | ( ( pnp[ 1 ] - 64 ) << 5 ) | ( pnp[ 2 ] - 64 ) );
+		e[ 8 ] = id >> 8;
+		e[ 9 ] = id & 0xFF;
+		e[ 10 ] = product & 0xFF;
+		e[ 11 ] = product >> 8;
+		for ( int i = 0; i < 4; ++i )
+			e[ 12 + i ] = ( serial >> ( 8 * i ) ) & 0xFF;
+		e[ 16 ] = 12;          // week
+		e[ 17 ] = 2024 - 1990; // year
+		e[ 18 ] = 1;
+		e[ 19 ] = 4;
+		e[ 20 ] = 0xA5; // digital, 8 bpc, DisplayPort
+		e[ 21 ] = 16;   // cm
+		e[ 22 ] = 9;
+		e[ 23 ] = 120;  // gamma 2.2
+		e[ 24 ] = 0x0A;
+		const uint8_t chromaticity[ 10 ] = { 0xEE, 0x91, 0xA3, 0x54, 0x4C, 0x99, 0x26, 0x0F, 0x50, 0x54 };
+		memcpy( &e[ 25 ], chromaticity, sizeof( chromaticity ) );
+		for ( int i = 38; i < 54; ++i )
+			e[ i ] = 0x01; // unused standard timings
+
+		PutDetailedTiming( &e[ 54 ], preferred );
+		if ( second )
+		{
+			PutDetailedTiming( &e[ 72 ], *second );
+		}
+		else
+		{
+			// Range limits: 24-120 Hz, 30-140 kHz, 600 MHz
+			const uint8_t limits[ 18 ] = { 0, 0, 0, 0xFD, 0, 24, 120, 30, 140, 60, 0, 0x0A, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20 };
+			memcpy( &e[ 72 ], limits, sizeof( limits ) );
+		}
+		PutTextDescriptor( &e[ 90 ], 0xFC, name );
+		PutTextDescriptor( &e[ 108 ], 0xFF, std::to_string( serial ).c_str() );
+		e[ 126 ] = extension ? 1 : 0;
+		PutChecksum( &e[ 0 ] );
+
+		if ( extension )
+		{
+			uint8_t *cta = &e[ 128 ];
+			cta[ 0 ] = 0x02;
+			cta[ 1 ] = 0x03;
+			size_t pos = 4;
+			cta[ pos++ ] = static_cast< uint8_t >( ( 2 << 5 ) | vics.size() );
+			for ( uint8_t vic : vics )
+				cta[ pos++ ] = vic;
+			// HDMI vendor-specific data block (OUI 00-0C-03), physical address 1.0.0.0
+			const uint8_t hdmi[ 6 ] = { ( 3 << 5 ) | 5, 0x03, 0x0C, 0x00, 0x10, 0x00 };
+			memcpy( cta + pos, hdmi, sizeof( hdmi ) );
+			pos += sizeof( hdmi );
+			cta[ 2 ] = static_cast< uint8_t >( pos );
+			cta[ 3 ] = 0x70 | 1; // underscan, audio, YCbCr 4:4:4; one native DTD
+			for ( const EdidMode &m : cta_modes )
+			{
+				if ( pos + 18 > 127 )
+					break;
+				PutDetailedTiming( cta + pos, m );
+				pos += 18;
+			}
+			PutChecksum( cta );
+		}
+		return e;
+	}
+
+	//-----------------------------------------------------------------------------
+	// Purpose: Built-in blobs shaped like what the driver meets: the glasses' 3D mode (product
+	// and serial are the display_edid_* defaults; the vendor id and name are stand-ins, matching
+	// uses neither), their 2D mode and a plain desktop monitor without extension blocks.
+	//-----------------------------------------------------------------------------
+	std::vector< EdidBlob > MakeBuiltInEdids()
+	{
+		const EdidMode sbs_60 = { 266640, 3840, 160, 48, 32, 1080, 31, 3, 5 };
+		const EdidMode sbs_120 = { 533280, 3840, 160, 48, 32, 1080, 31, 3, 5 };
+		const EdidMode fhd_60 = { 148500, 1920, 280, 88, 44, 1080, 45, 4, 5 };
+		const EdidMode fhd_120 = { 280800, 1920, 160, 48, 32, 1080, 45, 3, 5 };
+		const EdidMode hd_60 = { 74250, 1280, 370, 110, 40, 720, 30, 5, 5 };
+		const EdidMode qhd_60 = { 241500, 2560, 160, 48, 32, 1440, 41, 3, 5 };
+
+		std::vector< EdidBlob > blobs;
+		EdidBlob b;
+		b.name = "glasses_3d";
+		b.bytes = MakeEdid( "RNO", 980, 17, "RayNeo 3D", sbs_60, &fhd_60, { 0x80 | 16, 4, 2 }, { sbs_120 } );
+		b.product_code = 980;
+		b.monitor_name = "RayNeo 3D";
+		b.preferred_width = 3840;
+		b.preferred_height = 1080;
+		blobs.push_back( b );
+
+		b = EdidBlob{};
+		b.name = "glasses_2d";
+		b.bytes = MakeEdid( "RNO", 981, 17, "RayNeo", fhd_60, &fhd_120, { 0x80 | 16, 4, 3, 2, 1 }, { hd_60 } );
+		b.product_code = 981;
+		b.monitor_name = "RayNeo";
+		b.preferred_width = 1920;
+		b.preferred_height = 1080;
+		blobs.push_back( b );
+
+		b = EdidBlob{};
+		b.name = "desktop_base_only";
+		b.bytes = MakeEdid( "DEL", 41234, 0x01020304, "DESKTOP 27IN", qhd_60, nullptr, {}, {} );
+		b.product_code = 41234;
+		b.monitor_name = "DESKTOP 27IN";
+		b.preferred_width = 2560;
+		b.preferred_height = 1440;
+		blobs.push_back( b );
+		return blobs;
+	}
+
+	bool ReadFile( const std::string &path, std::vector< uint8_t > &out )
+	{
+		FILE *f = fopen( path.c_str(), "rb" );
+		if ( !f )
+			return false;
+		out.clear();
+		uint8_t buf[ 4096 ];
+		size_t n;
+		while ( ( n = fread( buf, 1, sizeof( buf ), f ) ) > 0 )
+			out.insert( out.end(), buf, buf + n );
+		fclose( f );
+		return true;
+	}
+
+	// Built-in blobs plus --edid dumps; false (with error set) if a dump cannot be used
+	bool LoadEdids( const Options &opt, std::vector< EdidBlob > &blobs, BenchResult &result )
+	{
+		blobs = MakeBuiltInEdids();
+		for ( const std::string &path : opt.edid_paths )
+		{
+			EdidBlob b;
+			b.name = path;
+			if ( !ReadFile( path, b.bytes ) || b.bytes.size() < 128 )
+			{
+				result.error = "cannot read a 128+ byte EDID from " + path;
+				return false;
+			}
+			blobs.push_back( std::move( b ) );
+		}
+		return true;
+	}
+
+	std::string CheckEdid( const EdidBlob &blob, const DisplayEdidInfo &info )
+	{
+		if ( blob.product_code == 0 )
+			return {};
+		if ( info.product_code != blob.product_code || info.monitor_name != blob.monitor_name || info.preferred_width != blob.preferred_width ||
+			info.preferred_height != blob.preferred_height || info.timings.empty() )
+		{
+			char what[ 256 ];
+			snprintf( what, sizeof( what ), "%s decoded as product %u '%s' %ux%u with %zu timings", blob.name.c_str(), (unsigned)info.product_code,
+				info.monitor_name.c_str(), info.preferred_width, info.preferred_height, info.timings.size() );
+			return what;
+		}
+		return {};
+	}
+
+	void RunEdidParse( const Options &opt, BenchResult &result )
+	{
+		std::vector< EdidBlob > blobs;
+		if ( !LoadEdids( opt, blobs, result ) )
+			return;
+		for ( const EdidBlob &blob : blobs )
+		{
+			result.error = CheckEdid( blob, ParseEdid( blob.name, blob.bytes ) );
+			if ( !result.error.empty() )
+				return;
+		}
+
+		// One op is one full ParseEdid (identity, name and every timing), as each enumeration does per output
+		volatile size_t sink = 0;
+		MeasureBlocks( opt, blobs.size(), result, [ & ] {
+			for ( const EdidBlob &blob : blobs )
+				sink = sink + ParseEdid( blob.name, blob.bytes ).timings.size();
+		} );
+	}
+
+	void RunEdidMonitorName( const Options &opt, BenchResult &result )
+	{
+		std::vector< EdidBlob > blobs;
+		if ( !LoadEdids( opt, blobs, result ) )
+			return;
+		for ( const EdidBlob &blob : blobs )
+		{
+			if ( blob.product_code != 0 && ExtractMonitorName( blob.bytes.data(), blob.bytes.size() ) != blob.monitor_name )
+			{
+				result.error = blob.name + ": wrong monitor name";
+				return;
+			}
+		}
+
+		constexpr size_t kRounds = 16;
+		volatile size_t sink = 0;
+		MeasureBlocks( opt, kRounds * blobs.size(), result, [ & ] {
+			for ( size_t r = 0; r < kRounds; ++r )
+				for ( const EdidBlob &blob : blobs )
+					sink = sink + ExtractMonitorName( blob.bytes.data(), blob.bytes.size() ).size();
+		} );
+	}
+
+	//-----------------------------------------------------------------------------
+	// Purpose: One op is a click through the whole path: Push from the "event thread", the
+	// RunFrame that reports the press and the RunFrame after the hold that reports the release.
+	// Every button is exercised, the brightness one with its double click window; each click
+	// must come out as exactly one press and one release.
+	//-----------------------------------------------------------------------------
+	void RunInputEvent( const Options &opt, BenchResult &result )
+	{
+		constexpr size_t kClicks = 16;
+		InputEventProcessor processor;
+		const InputEventTiming timing;
+		static InputEventProcessor::Result out;
+		const int64_t settle_ns = timing.double_click_ns + 2 * timing.hold_ns;
+		int64_t t = 1'000'000'000;
+		uint64_t clicks = 0;
+		uint64_t edges = 0;
+		MeasureBlocks( opt, kClicks, result, [ & ] {
+			for ( size_t i = 0; i < kClicks; ++i )
+			{
+				const InputButton button = static_cast< InputButton >( clicks % static_cast< size_t >( InputButton::Count ) );
+				processor.Push( button, t );
+				processor.Process( t + 1'000'000, timing, out );
+				edges += out.edge_count;
+				processor.Process( t + settle_ns, timing, out );
+				edges += out.edge_count;
+				t += settle_ns + 1'000'000;
+				++clicks;
+			}
+		} );
+
+		if ( edges != 2 * clicks )
+			result.error = std::to_string( clicks ) + " clicks produced " + std::to_string( edges ) + " edges";
+	}
+
+	//-----------------------------------------------------------------------------
+	// Async logger: DriverLog formats into the ring and returns; the flusher hands lines to this
+	// sink instead of vrserver. Outside the log benchmarks it echoes, so "[thread]" lines show.
+	//-----------------------------------------------------------------------------
+	class BenchDriverLog : public vr::IVRDriverLog
+	{
+	public:
+		void Log( const char *pchLogMessage ) override
+		{
+			lines.fetch_add( 1, std::memory_order_relaxed );
+			if ( echo.load( std::memory_order_relaxed ) )
+				printf( "%s\n", pchLogMessage );
+		}
+
+		std::atomic< uint64_t > lines{ 0 };
+		std::atomic< bool > echo{ true };
+	};
+
+	class BenchDriverContext : public vr::IVRDriverContext
+	{
+	public:
+		void *GetGenericInterface( const char *pchInterfaceVersion, vr::EVRInitError *peError ) override
+		{
+			if ( !strcmp( pchInterfaceVersion, vr::IVRDriverLog_Version ) )
+			{
+				if ( peError )
+					*peError = vr::VRInitError_None;
+				return &log;
+			}
+			if ( peError )
+				*peError = vr::VRInitError_Init_InterfaceNotFound;
+			return nullptr;
+		}
+
+		vr::DriverHandle_t GetDriverHandle() override { return 1; }
+
+		BenchDriverLog log;
+	};
+
+	BenchDriverContext g_context;
+
+	// The driver's rate limiter allows 200 lines per second; the enqueue benchmark stays under it
+	constexpr int kLogBurst = 200;
+	constexpr int kLogLinesPerWindow = 150;
+	constexpr auto kLogWindow = std::chrono::milliseconds( 1050 );
+
+	// When the last rate limiter window was opened, shared by both log benchmarks
+	std::chrono::steady_clock::time_point g_log_window_start;
+
+	// Waits out the current window; the next line opens a fresh one
+	void WaitForLogWindow()
+	{
+		std::this_thread::sleep_until( g_log_window_start + kLogWindow );
+		g_log_window_start = std::chrono::steady_clock::now();
+	}
+
+	void RunLogEnqueue( const Options &opt, BenchResult &result )
+	{
+		g_context.log.echo.store( false );
+		const DriverLogStats before = DriverLogGetStats();
+		DriverLogStartAsync();
+
+		// Lines are timed one by one (~100 ns each, well above the clock's resolution). A pass is
+		// one rate window, so passes are capped to keep the test quick.
+		const int passes = std::min( opt.repeat, 3 );
+		for ( int pass = 0; pass < passes; ++pass )
+		{
+			WaitForLogWindow();
+			int64_t total = 0;
+			for ( int i = 0; i < kLogLinesPerWindow; ++i )
+			{
+				const int64_t t0 = StatsNowNs();
+				DriverLog( "[bench] pose %d age %.3f ms, %s", i, 1.25 + i * 0.001, "connected" );
+				const int64_t dt = StatsNowNs() - t0;
+				result.latency.Record( dt );
+				total += dt;
+			}
+			AddPass( result, static_cast< double >( total ) / kLogLinesPerWindow, kLogLinesPerWindow );
+		}
+
+		DriverLogStopAsync();
+		const DriverLogStats after = DriverLogGetStats();
+		g_context.log.echo.store( true );
+		if ( after.dropped_full != before.dropped_full || after.dropped_rate != before.dropped_rate )
+			result.error = "lines dropped below the rate limit";
+		else if ( after.written - before.written < static_cast< uint64_t >( passes ) * kLogLinesPerWindow )
+			result.error = "flusher lost lines";
+	}
+
+	// What a log storm costs the thread that keeps logging once the rate limiter has tripped
+	void RunLogRateLimited( const Options &opt, BenchResult &result )
+	{
+		g_context.log.echo.store( false );
+		const DriverLogStats before = DriverLogGetStats();
+		DriverLogStartAsync();
+
+		constexpr size_t kLines = 64;
+		Options pass_opt = opt;
+		pass_opt.repeat = 1;
+		// Every measured line must fall in the window the burst opened
+		pass_opt.min_time_ns = std::min< int64_t >( opt.min_time_ns, 500'000'000 );
+		const int passes = std::min( opt.repeat, 3 );
+		for ( int pass = 0; pass < passes; ++pass )
+		{
+			WaitForLogWindow();
+			for ( int i = 0; i < kLogBurst; ++i )
+				DriverLog( "[bench] burst %d", i );
+			MeasureBlocks( pass_opt, kLines, result, [ & ] {
+				for ( size_t i = 0; i < kLines; ++i )
+					DriverLog( "[bench] storm %zu age %.3f ms", i, 1.25 );
+			} );
+		}
+
+		DriverLogStopAsync();
+		const DriverLogStats after = DriverLogGetStats();
+		g_context.log.echo.store( true );
+		if ( after.dropped_rate - before.dropped_rate < result.ops )
+			result.error = "rate limiter let a storm through";
+	}
+
+	//-----------------------------------------------------------------------------
+	// Purpose: The pose handoff under contention: one writer publishing as fast as it can (the
+	// event thread's Publish: SeqLock store plus signal) against readers loading in a loop (the
+	// pose thread and GetPose). The measured side runs on this thread, the other roles on helper
+	// threads, at most one per spare CPU so a reader never spins on a descheduled writer. Every
+	// snapshot read is checked for tearing.
+	//-----------------------------------------------------------------------------
+	void FillSnapshot( PoseSnapshot &snap, uint32_t k )
+	{
+		const float v = static_cast< float >( k & 0xFFFF );
+		snap.q_w = snap.q_x = snap.q_y = snap.q_z = v;
+		for ( int i = 0; i < 3; ++i )
+			snap.position[ i ] = snap.velocity[ i ] = snap.angular_velocity[ i ] = snap.angular_acceleration[ i ] = v;
+		snap.sample_tick = k;
+		snap.sample_host_time_ns = snap.receive_host_time_ns = static_cast< int64_t >( k ) * 1000;
+		snap.valid = snap.connected = true;
+	}
+
+	bool SnapshotConsistent( const PoseSnapshot &snap )
+	{
+		if ( !snap.valid )
+			return snap.sample_tick == 0; // the initial value
+		const float v = static_cast< float >( snap.sample_tick & 0xFFFF );
+		return snap.q_w == v && snap.q_z == v && snap.position[ 0 ] == v && snap.angular_acceleration[ 2 ] == v &&
+			snap.receive_host_time_ns == static_cast< int64_t >( snap.sample_tick ) * 1000;
+	}
+
+	void RunSnapshot( const Options &opt, BenchResult &result, bool measure_writer )
+	{
+		TrackingState state;
+		std::atomic< bool > stop{ false };
+		std::atomic< uint64_t > torn{ 0 };
+		const ThreadPolicy policy{ opt.priority };
+
+		auto reader = [ & ] {
+			ScopedThreadPolicy scoped( "bench-reader", policy );
+			PoseSnapshot snap;
+			while ( !stop.load( std::memory_order_relaxed ) )
+			{
+				state.pose.Load( snap );
+				if ( !SnapshotConsistent( snap ) )
+					torn.fetch_add( 1, std::memory_order_relaxed );
+			}
+		};
+		auto writer = [ & ] {
+			ScopedThreadPolicy scoped( "bench-writer", policy );
+			PoseSnapshot snap;
+			for ( uint32_t k = 1; !stop.load( std::memory_order_relaxed ); ++k )
+			{
+				FillSnapshot( snap, k );
+				state.Publish( snap );
+			}
+		};
+
+		// Driver shape: one writer, two readers
+		const unsigned cpus = std::max( 1u, std::thread::hardware_concurrency() );
+		const unsigned helpers = std::clamp( cpus - 1, 1u, 2u );
+		std::vector< std::thread > threads;
+		for ( unsigned i = 0; i < helpers; ++i )
+		{
+			if ( !measure_writer && i == 0 )
+				threads.emplace_back( writer );
+			else
+				threads.emplace_back( reader );
+		}
+
+		constexpr size_t kOps = 16;
+		if ( measure_writer )
+		{
+			PoseSnapshot snap;
+			uint32_t k = 0;
+			MeasureBlocks( opt, kOps, result, [ & ] {
+				for ( size_t i = 0; i < kOps; ++i )
+				{
+					FillSnapshot( snap, ++k );
+					state.Publish( snap );
+				}
+			} );
+		}
+		else
+		{
+			PoseSnapshot snap;
+			uint64_t local_torn = 0;
+			MeasureBlocks( opt, kOps, result, [ & ] {
+				for ( size_t i = 0; i < kOps; ++i )
+				{
+					state.pose.Load( snap );
+					local_torn += SnapshotConsistent( snap ) ? 0 : 1;
+				}
+			} );
+			torn.fetch_add( local_torn );
+		}
+
+		stop.store( true );
+		for ( std::thread &t : threads )
+			t.join();
+		if ( torn.load() != 0 )
+			result.error = std::to_string( torn.load() ) + " torn snapshot reads";
+	}
+
+	void RunSnapshotRead( const Options &opt, BenchResult &result ) { RunSnapshot( opt, result, false ); }
+	void RunSnapshotWrite( const Options &opt, BenchResult &result ) { RunSnapshot( opt, result, true ); }
+
+	//-----------------------------------------------------------------------------
+	// Registry and baselines
+	//-----------------------------------------------------------------------------
+
+	struct Benchmark
+	{
+		const char *name;
+		const char *what;
+		void ( *run )( const Options &opt, BenchResult &result );
+	};
+
+	const Benchmark kBenchmarks[] = {
+		{ "quat_integrate", "IntegrateGyroBatch, per sample (64-sample batches)", RunQuatIntegrate },
+		{ "pipeline_batch", "TrackingPipeline ProcessBatch(8) + BuildSnapshot, per sample", RunPipelineBatch },
+		{ "edid_parse", "ParseEdid, per blob", RunEdidParse },
+		{ "edid_monitor_name", "ExtractMonitorName, per blob", RunEdidMonitorName },
+		{ "input_event", "InputEventProcessor Push + press/release Process, per click", RunInputEvent },
+		{ "log_enqueue", "async DriverLog below the rate limit, per line", RunLogEnqueue },
+		{ "log_rate_limited", "async DriverLog past the rate limit, per line", RunLogRateLimited },
+		{ "snapshot_read", "SeqLock<PoseSnapshot> Load against a publishing writer, per load", RunSnapshotRead },
+		{ "snapshot_write", "TrackingState::Publish against spinning readers, per publish", RunSnapshotWrite },
+	};
+
+	struct BaselineLimit
+	{
+		double ns_per_op = 0.0;
+		double p99_ns = 0.0;
+	};
+
+	// "name ns_per_op p99_ns" per line; '#' starts a comment
+	bool ReadBaselines( const std::string &path, std::map< std::string, BaselineLimit > &out )
+	{
+		FILE *f = fopen( path.c_str(), "r" );
+		if ( !f )
+			return false;
+		char line[ 256 ];
+		while ( fgets( line, sizeof( line ), f ) )
+		{
+			if ( char *hash = strchr( line, '#' ) )
+				*hash = '\0';
+			char name[ 64 ];
+			BaselineLimit limit;
+			if ( sscanf( line, "%63s %lf %lf", name, &limit.ns_per_op, &limit.p99_ns ) == 3 )
+				out[ name ] = limit;
+		}
+		fclose( f );
+		return true;
+	}
+
+	// Small values get an absolute allowance on top of the margin: a few ns of jitter is noise
+	double LimitFor( double measured, double margin )
+	{
+		return std::ceil( std::max( measured * margin, measured + 20.0 ) );
+	}
+
+	bool WriteBaselines( const std::string &path, const std::vector< std::pair< const Benchmark *, const BenchResult * > > &results, double margin )
+	{
+		FILE *f = fopen( path.c_str(), "w" );
+		if ( !f )
+			return false;
+		fprintf( f,
+			"# rayneo_bench limits: a benchmark fails when its ns/op or p99 exceeds these (nanoseconds).\n"
+			"# Written by rayneo_bench --write-baseline with --margin %.1f; regenerate after an intended change.\n"
+			"# name                ns_per_op     p99_ns\n",
+			margin );
+		for ( const auto &[ bench, r ] : results )
+			fprintf( f, "%-20s %10.0f %10.0f\n", bench->name, LimitFor( r->ns_per_op, margin ),
+				LimitFor( static_cast< double >( r->latency.Percentile( 0.99 ) ), margin ) );
+		fclose( f );
+		return true;
+	}
+}
+
+int main( int argc, char **argv )
+{
+	Options opt;
+	if ( !ParseOptions( argc, argv, opt ) )
+	{
+		Usage();
+		return 2;
+	}
+	if ( opt.list )
+	{
+		for ( const Benchmark &b : kBenchmarks )
+			printf( "%-20s %s\n", b.name, b.what );
+		return 0;
+	}
+
+	std::vector< const Benchmark * > selected;
+	for ( const Benchmark &b : kBenchmarks )
+		if ( opt.only.empty() || std::find( opt.only.begin(), opt.only.end(), b.name ) != opt.only.end() )
+			selected.push_back( &b );
+	if ( selected.size() < opt.only.size() )
+	{
+		fprintf( stderr, "unknown benchmark in --only (see --list)\n" );
+		return 2;
+	}
+
+	std::map< std::string, BaselineLimit > limits;
+	if ( !opt.baseline_path.empty() && !ReadBaselines( opt.baseline_path, limits ) )
+	{
+		fprintf( stderr, "cannot read baseline '%s'\n", opt.baseline_path.c_str() );
+		return 2;
+	}
+
+	// DriverLog (and the thread policy's report) go to BenchDriverLog
+	vr::InitServerDriverContext( &g_context );
+	ScopedThreadPolicy main_policy( "bench-main", ThreadPolicy{ opt.priority } );
+
+	if ( !kOptimizedBuild && !limits.empty() )
+		printf( "unoptimized build: limits are reported, not enforced\n" );
+	printf( "%-20s %12s %10s %9s %9s %9s %9s | %10s %9s %s\n", "benchmark", "ops", "ns/op", "p50 ns", "p99 ns", "p99.9 ns", "max ns",
+		"limit ns/op", "limit p99", "result" );
+	std::vector< BenchResult > results( selected.size() );
+	int failures = 0;
+	for ( size_t i = 0; i < selected.size(); ++i )
+	{
+		const Benchmark &bench = *selected[ i ];
+		BenchResult &r = results[ i ];
+		bench.run( opt, r );
+
+		const double p99 = static_cast< double >( r.latency.Percentile( 0.99 ) );
+		const auto limit = limits.find( bench.name );
+		const char *verdict = "-";
+		if ( !r.error.empty() )
+			verdict = "ERROR";
+		else if ( limit != limits.end() && ( r.ns_per_op > limit->second.ns_per_op || p99 > limit->second.p99_ns ) )
+			verdict = kOptimizedBuild ? "FAIL" : "over (unoptimized build)";
+		else if ( limit != limits.end() )
+			verdict = "ok";
+		else if ( !opt.baseline_path.empty() )
+			verdict = "no baseline";
+		if ( !strcmp( verdict, "ERROR" ) || !strcmp( verdict, "FAIL" ) )
+			++failures;
+
+		printf( "%-20s %12llu %10.1f %9lld %9lld %9lld %9lld | ", bench.name, (unsigned long long)r.ops, r.ns_per_op,
+			(long long)r.latency.Percentile( 0.50 ), (long long)r.latency.Percentile( 0.99 ), (long long)r.latency.Percentile( 0.999 ),
+			(long long)r.latency.Max() );
+		if ( limit != limits.end() )
+			printf( "%10.0f %9.0f %s\n", limit->second.ns_per_op, limit->second.p99_ns, verdict );
+		else
+			printf( "%10s %9s %s\n", "-", "-", verdict );
+		if ( !r.error.empty() )
+			printf( "  %s: %s\n", bench.name, r.error.c_str() );
+	}
+
+	if ( !opt.write_baseline_path.empty() )
+	{
+		std::vector< std::pair< const Benchmark *, const BenchResult * > > written;
+		for ( size_t i = 0; i < selected.size(); ++i )
+			if ( results[ i ].error.empty() )
+				written.emplace_back( selected[ i ], &results[ i ] );
+		if ( !WriteBaselines( opt.write_baseline_path, written, opt.margin ) )
+		{
+			fprintf( stderr, "cannot write baseline '%s'\n", opt.write_baseline_path.c_str() );
+			return 2;
+		}
+		printf( "wrote %s (margin %.1f)\n", opt.write_baseline_path.c_str(), opt.margin );
+	}
+
+	vr::CleanupDriverContext();
+	return failures == 0 ? 0 : 1;
+}
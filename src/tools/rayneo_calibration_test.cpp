@@ -0,0 +1,163 @@
+// Regression tests for the stillness-gated gyro bias estimator: it must learn a real bias at
+// rest, follow one that has moved, and never take a slow steady turn (which looks like rest to a
+// variance detector) for bias. Exit code 0 when every check passes.
+
+#include <cmath>
+#include <cstdio>
+#include <random>
+
+#include "imu_calibration.h"
+
+namespace
+{
+	constexpr float kRate = 1000.f; // Hz, as the glasses stream
+	int g_failures = 0;
+
+	void Check( bool ok, const char *what, const float bias[ 3 ] )
+	{
+		printf( "%-4s %s (bias %.5f, %.5f, %.5f rad/s)\n", ok ? "ok" : "FAIL", what, bias[ 0 ], bias[ 1 ], bias[ 2 ] );
+		if ( !ok )
+			++g_failures;
+	}
+
+	//-----------------------------------------------------------------------------
+	// Purpose: Feeds seconds of a head at rest in a Y-up world, turning at a constant rate
+	// (rad/s, body frame) and read by a gyro with the given constant bias and white noise
+	// (rad/s). Gravity is along Y throughout (a yaw turn does not move it).
+	//-----------------------------------------------------------------------------
+	void Feed( GyroBiasEstimator &estimator, float seconds, const float turn[ 3 ], const float true_bias[ 3 ], std::mt19937 &rng, float gyro_sigma = 0.002f )
+	{
+		std::normal_distribution< float > gyro_noise( 0.f, gyro_sigma );
+		std::normal_distribution< float > acc_noise( 0.f, 0.002f );
+		const float dt = 1.f / kRate;
+		const int count = static_cast< int >( seconds * kRate );
+		for ( int k = 0; k < count; ++k )
+		{
+			float gyro[ 3 ];
+			float acc[ 3 ];
+			for ( int i = 0; i < 3; ++i )
+			{
+				gyro[ i ] = turn[ i ] + true_bias[ i ] + gyro_noise( rng );
+				acc[ i ] = ( i == 1 ? 1.f : 0.f ) + acc_noise( rng );
+			}
+			estimator.Update( gyro, acc, dt );
+		}
+	}
+
+	bool Near( const float a[ 3 ], const float b[ 3 ], float tolerance )
+	{
+		for ( int i = 0; i < 3; ++i )
+		{
+			if ( !( std::fabs( a[ i ] - b[ i ] ) <= tolerance ) )
+				return false;
+		}
+		return true;
+	}
+}
+
+int main()
+{
+	std::mt19937 rng( 1 );
+	const float zero[ 3 ] = { 0.f, 0.f, 0.f };
+	const float slow_yaw[ 3 ] = { 0.f, 0.05f, 0.f }; // ~2.9 deg/s
+	float bias[ 3 ];
+
+	// A steady yaw turn from a fresh estimator is never learned, however long it lasts
+	{
+		GyroBiasEstimator estimator;
+		Feed( estimator, 60.f, slow_yaw, zero, rng );
+		estimator.GetBias( bias );
+		Check( Near( bias, zero, 1e-4f ) && estimator.LearnedSeconds() == 0.f, "constant 0.05 rad/s yaw, fresh: nothing learned", bias );
+	}
+
+	// Nor from a backed estimate (e.g. the per-device cache)
+	{
+		GyroBiasEstimator estimator;
+		const float seeded[ 3 ] = { 0.004f, -0.003f, 0.002f };
+		estimator.SetBias( seeded, 120.f );
+		Feed( estimator, 60.f, slow_yaw, seeded, rng );
+		estimator.GetBias( bias );
+		Check( Near( bias, seeded, 1e-5f ), "constant 0.05 rad/s yaw, seeded: estimate untouched", bias );
+	}
+
+	// A turn slow enough to pass max_bias is still rejected against a backed estimate
+	{
+		GyroBiasEstimator estimator;
+		const float seeded[ 3 ] = { 0.004f, -0.003f, 0.002f };
+		const float slower_yaw[ 3 ] = { 0.f, 0.012f, 0.f };
+		estimator.SetBias( seeded, 120.f );
+		Feed( estimator, 15.f, slower_yaw, seeded, rng );
+		estimator.GetBias( bias );
+		Check( Near( bias, seeded, 1e-5f ), "constant 0.012 rad/s yaw for 15 s, seeded: estimate untouched", bias );
+	}
+
+	// A real bias at rest is learned
+	{
+		GyroBiasEstimator estimator;
+		const float true_bias[ 3 ] = { 0.01f, -0.006f, 0.003f };
+		Feed( estimator, 10.f, zero, true_bias, rng );
+		estimator.GetBias( bias );
+		Check( Near( bias, true_bias, 5e-4f ), "bias at rest learned within 10 s", bias );
+	}
+
+	// At realistic gyro noise the estimate must not hinge on any single sample: across many
+	// streams, 5 s of rest always lands close to the true bias
+	{
+		const float true_bias[ 3 ] = { 0.01f, -0.006f, 0.003f };
+		const float max_bias = GyroBiasEstimatorParams{}.max_bias;
+		for ( float sigma : { 0.003f, 0.005f } )
+		{
+			int bad = 0;
+			float worst[ 3 ] = { 0.f, 0.f, 0.f };
+			float worst_error = 0.f;
+			for ( unsigned seed = 0; seed < 50; ++seed )
+			{
+				std::mt19937 stream( 100 + seed );
+				GyroBiasEstimator estimator;
+				Feed( estimator, 5.f, zero, true_bias, stream, sigma );
+				estimator.GetBias( bias );
+				float error = 0.f;
+				bool plausible = true;
+				for ( int i = 0; i < 3; ++i )
+				{
+					error = std::fmax( error, std::fabs( bias[ i ] - true_bias[ i ] ) );
+					plausible = plausible && std::fabs( bias[ i ] ) <= max_bias;
+				}
+				if ( error > 1e-3f || !plausible )
+					++bad;
+				if ( error >= worst_error )
+				{
+					worst_error = error;
+					for ( int i = 0; i < 3; ++i )
+						worst[ i ] = bias[ i ];
+				}
+			}
+			char what[ 96 ];
+			snprintf( what, sizeof( what ), "bias at rest, %.3f rad/s noise: 50/50 streams within 1e-3 (worst shown)", sigma );
+			Check( bad == 0, what, worst );
+		}
+	}
+
+	// A stale cached estimate is replaced once rest away from it has lasted relearn_time
+	{
+		GyroBiasEstimator estimator;
+		const float stale[ 3 ] = { 0.f, 0.f, 0.f };
+		const float true_bias[ 3 ] = { 0.012f, 0.f, -0.008f };
+		estimator.SetBias( stale, 300.f );
+		Feed( estimator, 30.f, zero, true_bias, rng );
+		estimator.GetBias( bias );
+		Check( Near( bias, true_bias, 5e-4f ), "stale seeded bias relearned after relearn_time", bias );
+	}
+
+	// A cached bias no real gyro has (learned from motion by an older build) is refused
+	{
+		GyroBiasEstimator estimator;
+		const float implausible[ 3 ] = { 0.f, 0.05f, 0.f };
+		const bool accepted = estimator.SetBias( implausible, 60.f );
+		estimator.GetBias( bias );
+		Check( !accepted && Near( bias, zero, 0.f ), "implausible cached bias refused", bias );
+	}
+
+	printf( "%s\n", g_failures == 0 ? "all checks passed" : "FAILED" );
+	return g_failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,376 @@
+// Offline replay / benchmark for the RayNeo tracking pipeline.
+// Feeds a recorded capture (or a synthetic stream with known ground truth) through
+// TrackingPipeline for each fusion filter and reports throughput, per-sample latency
+// percentiles and orientation error against the capture's reference.
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "driver_stats.h"
+#include "imu_capture.h"
+#include "imu_math.h"
+#include "tracking_pipeline.h"
+
+namespace
+{
+	struct Options
+	{
+		std::string capture_path;
+		std::string write_synthetic_path;
+		std::string filter = "all";
+		double synthetic_seconds = 60.0;
+		double synthetic_rate_hz = 1000.0;
+		float synthetic_bias = 0.01f;  // rad/s on every axis
+		float synthetic_noise = 0.005f; // rad/s gyro white noise (1 sigma)
+		uint32_t seed = 1;
+		float gyro_scale = 1.0f;
+		bool learn_gyro_bias = true;
+		int repeat = 5;
+		int batch = 8;
+	};
+
+	void Usage()
+	{
+		printf(
+			"usage: rayneo_tracking_bench [options]\n"
+			"  --capture <file>          replay a capture instead of the synthetic stream\n"
+			"  --write-synthetic <file>  save the synthetic stream as a capture and continue\n"
+			"  --filter <name|all>       gyro, complementary, mahony, madgwick (default all)\n"
+			"  --seconds <s>             synthetic duration (default 60)\n"
+			"  --rate <hz>               synthetic sample rate (default 1000)\n"
+			"  --bias <rad/s>            synthetic constant gyro bias (default 0.01)\n"
+			"  --noise <rad/s>           synthetic gyro noise sigma (default 0.005)\n"
+			"  --seed <n>                synthetic random seed (default 1)\n"
+			"  --gyro-scale <k>          gyro sensitivity correction (default 1, as the driver)\n"
+			"  --no-bias-learning        disable the stillness bias estimator\n"
+			"  --repeat <n>              throughput passes (default 5)\n"
+			"  --batch <n>               samples per ProcessBatch call in the throughput passes (default 8)\n" );
+	}
+
+	bool ParseOptions( int argc, char **argv, Options &opt )
+	{
+		for ( int i = 1; i < argc; ++i )
+		{
+			const char *arg = argv[ i ];
+			const char *value = i + 1 < argc ? argv[ i + 1 ] : nullptr;
+			auto need = [ & ]() -> const char * {
+				if ( !value )
+				{
+					fprintf( stderr, "missing value for %s\n", arg );
+					return nullptr;
+				}
+				++i;
+				return value;
+			};
+
+			if ( !strcmp( arg, "--help" ) || !strcmp( arg, "-h" ) )
+				return false;
+			else if ( !strcmp( arg, "--no-bias-learning" ) )
+				opt.learn_gyro_bias = false;
+			else if ( !strcmp( arg, "--capture" ) && need() )
+				opt.capture_path = value;
+			else if ( !strcmp( arg, "--write-synthetic" ) && need() )
+				opt.write_synthetic_path = value;
+			else if ( !strcmp( arg, "--filter" ) && need() )
+				opt.filter = value;
+			else if ( !strcmp( arg, "--seconds" ) && need() )
+				opt.synthetic_seconds = atof( value );
+			else if ( !strcmp( arg, "--rate" ) && need() )
+				opt.synthetic_rate_hz = atof( value );
+			else if ( !strcmp( arg, "--bias" ) && need() )
+				opt.synthetic_bias = static_cast< float >( atof( value ) );
+			else if ( !strcmp( arg, "--noise" ) && need() )
+				opt.synthetic_noise = static_cast< float >( atof( value ) );
+			else if ( !strcmp( arg, "--seed" ) && need() )
+				opt.seed = static_cast< uint32_t >( strtoul( value, nullptr, 10 ) );
+			else if ( !strcmp( arg, "--gyro-scale" ) && need() )
+				opt.gyro_scale = static_cast< float >( atof( value ) );
+			else if ( !strcmp( arg, "--repeat" ) && need() )
+				opt.repeat = atoi( value );
+			else if ( !strcmp( arg, "--batch" ) && need() )
+				opt.batch = atoi( value );
+			else
+			{
+				fprintf( stderr, "unknown or incomplete option: %s\n", arg );
+				return false;
+			}
+		}
+		return opt.synthetic_rate_hz > 0.0 && opt.synthetic_seconds > 0.0 && opt.batch > 0;
+	}
+
+	double AngleBetweenDeg( const ImuQuat &a, const ImuQuat &b )
+	{
+		double d = std::fabs( (double)a.w * b.w + (double)a.x * b.x + (double)a.y * b.y + (double)a.z * b.z );
+		if ( d > 1.0 )
+			d = 1.0;
+		return 2.0 * std::acos( d ) * 180.0 / 3.14159265358979323846;
+	}
+
+	// Angle between the two orientations' idea of "up" in the body frame (yaw-independent)
+	double TiltErrorDeg( const ImuQuat &a, const ImuQuat &b )
+	{
+		const float up[ 3 ] = { 0.f, 1.f, 0.f };
+		float ua[ 3 ], ub[ 3 ];
+		QuatRotateInverse( a, up, ua );
+		QuatRotateInverse( b, up, ub );
+		double d = (double)ua[ 0 ] * ub[ 0 ] + (double)ua[ 1 ] * ub[ 1 ] + (double)ua[ 2 ] * ub[ 2 ];
+		if ( d > 1.0 )
+			d = 1.0;
+		if ( d < -1.0 )
+			d = -1.0;
+		return std::acos( d ) * 180.0 / 3.14159265358979323846;
+	}
+
+	//-----------------------------------------------------------------------------
+	// Purpose: Head-like motion with ground truth: alternating 10 s of smooth multi-axis motion
+	// and 5 s of stillness (so the bias estimator has something to learn from), sampled with a
+	// constant gyro bias, gyro white noise and a little accelerometer noise.
+	//-----------------------------------------------------------------------------
+	std::vector< ImuCaptureRecord > MakeSyntheticCapture( const Options &opt )
+	{
+		std::mt19937 rng( opt.seed );
+		std::normal_distribution< float > gyro_noise( 0.f, opt.synthetic_noise );
+		std::normal_distribution< float > acc_noise( 0.f, 0.003f );
+
+		const size_t count = static_cast< size_t >( opt.synthetic_seconds * opt.synthetic_rate_hz );
+		std::vector< ImuCaptureRecord > records;
+		records.reserve( count );
+
+		ImuQuat truth;
+		uint32_t prev_tick = 1000;
+		for ( size_t k = 0; k < count; ++k )
+		{
+			const double t = static_cast< double >( k ) / opt.synthetic_rate_hz;
+			const uint32_t tick = 1000 + static_cast< uint32_t >( std::llround( t * 1000.0 ) );
+
+			const double phase = std::fmod( t, 15.0 );
+			const double envelope = phase < 10.0 ? std::sin( 3.14159265358979323846 * phase / 10.0 ) : 0.0;
+			const float w[ 3 ] = {
+				static_cast< float >( envelope * 0.8 * std::sin( 2.0 * 3.14159265358979323846 * 0.31 * t ) ),
+				static_cast< float >( envelope * 1.5 * std::sin( 2.0 * 3.14159265358979323846 * 0.17 * t + 1.0 ) ),
+				static_cast< float >( envelope * 0.4 * std::sin( 2.0 * 3.14159265358979323846 * 0.53 * t + 2.0 ) ),
+			};
+
+			// Advance the truth with the same tick-derived dt the pipeline will see
+			const float dt = static_cast< float >( tick - prev_tick ) * 0.001f;
+			prev_tick = tick;
+			const float mag = std::sqrt( w[ 0 ] * w[ 0 ] + w[ 1 ] * w[ 1 ] + w[ 2 ] * w[ 2 ] );
+			if ( mag * dt > 0.f )
+			{
+				const float half = 0.5f * mag * dt;
+				const float s = std::sin( half ) / mag;
+				// Exact sqrt normalization here: the ground truth must not inherit the kernels' rounding
+				truth = QuatMultiply( truth, ImuQuat{ std::cos( half ), w[ 0 ] * s, w[ 1 ] * s, w[ 2 ] * s } );
+				const float n = std::sqrt( truth.w * truth.w + truth.x * truth.x + truth.y * truth.y + truth.z * truth.z );
+				truth = { truth.w / n, truth.x / n, truth.y / n, truth.z / n };
+			}
+
+			// Specific force of a head at rest in a Y-up world, in the body frame
+			const float up[ 3 ] = { 0.f, 1.f, 0.f };
+			float acc[ 3 ];
+			QuatRotateInverse( truth, up, acc );
+
+			ImuCaptureRecord rec{};
+			rec.tick = tick;
+			rec.flags = kImuCaptureValid | kImuCaptureHasReference;
+			for ( int i = 0; i < 3; ++i )
+			{
+				rec.gyro_rad[ i ] = w[ i ] + opt.synthetic_bias + gyro_noise( rng );
+				rec.gyro_dps[ i ] = rec.gyro_rad[ i ] * 180.f / 3.14159265f;
+				rec.acc[ i ] = acc[ i ] + acc_noise( rng );
+			}
+			rec.reference_q[ 0 ] = truth.w;
+			rec.reference_q[ 1 ] = truth.x;
+			rec.reference_q[ 2 ] = truth.y;
+			rec.reference_q[ 3 ] = truth.z;
+			rec.receive_host_time_ns = static_cast< int64_t >( t * 1e9 );
+			records.push_back( rec );
+		}
+		return records;
+	}
+
+	TrackingImuSample ToSample( const ImuCaptureRecord &rec )
+	{
+		TrackingImuSample s;
+		s.tick = rec.tick;
+		for ( int i = 0; i < 3; ++i )
+		{
+			s.gyro_rad[ i ] = rec.gyro_rad[ i ];
+			s.gyro_dps[ i ] = rec.gyro_dps[ i ];
+			s.acc[ i ] = rec.acc[ i ];
+		}
+		return s;
+	}
+
+	struct BenchResult
+	{
+		LatencyHistogram latency;
+		double samples_per_second = 0.0;
+		size_t compared = 0;
+		double final_error_deg = 0.0;
+		double max_error_deg = 0.0;
+		double rms_error_deg = 0.0;
+		double final_tilt_deg = 0.0;
+		double max_tilt_deg = 0.0;
+	};
+
+	void RunFilter( ImuFusionType type, const Options &opt, const std::vector< ImuCaptureRecord > &records, BenchResult &result )
+	{
+		TrackingPipelineConfig config;
+		config.fusion_type = type;
+		config.gyro_scale = opt.gyro_scale;
+		config.learn_gyro_bias = opt.learn_gyro_bias;
+
+		// Pass 1: accuracy and per-sample latency (ProcessSample + BuildSnapshot, as in the driver)
+		{
+			TrackingPipeline pipeline( config );
+			PoseSnapshot snap;
+			double sum_sq = 0.0;
+			for ( const ImuCaptureRecord &rec : records )
+			{
+				if ( !( rec.flags & kImuCaptureValid ) )
+					continue;
+				const TrackingImuSample s = ToSample( rec );
+				const int64_t start = StatsNowNs();
+				pipeline.ProcessSample( s );
+				pipeline.BuildSnapshot( snap );
+				result.latency.Record( StatsNowNs() - start );
+
+				if ( rec.flags & kImuCaptureHasReference )
+				{
+					const ImuQuat ref{ rec.reference_q[ 0 ], rec.reference_q[ 1 ], rec.reference_q[ 2 ], rec.reference_q[ 3 ] };
+					const ImuQuat est = pipeline.Orientation();
+					const double err = AngleBetweenDeg( est, ref );
+					const double tilt = TiltErrorDeg( est, ref );
+					sum_sq += err * err;
+					result.final_error_deg = err;
+					result.final_tilt_deg = tilt;
+					if ( err > result.max_error_deg )
+						result.max_error_deg = err;
+					if ( tilt > result.max_tilt_deg )
+						result.max_tilt_deg = tilt;
+					++result.compared;
+				}
+			}
+			if ( result.compared )
+				result.rms_error_deg = std::sqrt( sum_sq / static_cast< double >( result.compared ) );
+		}
+
+		// Pass 2..n: raw throughput, no per-sample clock reads; samples go in ProcessBatch chunks
+		// of --batch, one snapshot per chunk, as the driver's batched drain does
+		std::vector< TrackingImuSample > samples;
+		samples.reserve( records.size() );
+		for ( const ImuCaptureRecord &rec : records )
+			if ( rec.flags & kImuCaptureValid )
+				samples.push_back( ToSample( rec ) );
+
+		double best = 0.0;
+		volatile float sink = 0.f;
+		for ( int pass = 0; pass < opt.repeat && !samples.empty(); ++pass )
+		{
+			TrackingPipeline pipeline( config );
+			PoseSnapshot snap;
+			const auto start = std::chrono::steady_clock::now();
+			const size_t batch = static_cast< size_t >( opt.batch );
+			for ( size_t i = 0; i < samples.size(); i += batch )
+			{
+				pipeline.ProcessBatch( samples.data() + i, std::min( batch, samples.size() - i ) );
+				pipeline.BuildSnapshot( snap );
+			}
+			const double elapsed = std::chrono::duration< double >( std::chrono::steady_clock::now() - start ).count();
+			sink = sink + snap.q_w;
+			if ( elapsed > 0.0 )
+			{
+				const double rate = static_cast< double >( samples.size() ) / elapsed;
+				if ( rate > best )
+					best = rate;
+			}
+		}
+		result.samples_per_second = best;
+	}
+}
+
+int main( int argc, char **argv )
+{
+	Options opt;
+	if ( !ParseOptions( argc, argv, opt ) )
+	{
+		Usage();
+		return 2;
+	}
+
+	std::vector< ImuCaptureRecord > records;
+	if ( !opt.capture_path.empty() )
+	{
+		ImuCaptureHeader header;
+		if ( !ReadImuCapture( opt.capture_path.c_str(), header, records ) )
+		{
+			fprintf( stderr, "cannot read capture '%s'\n", opt.capture_path.c_str() );
+			return 1;
+		}
+		printf( "capture: %s (%zu records, source '%.32s')\n", opt.capture_path.c_str(), records.size(), header.source );
+	}
+	else
+	{
+		records = MakeSyntheticCapture( opt );
+		printf( "synthetic: %.0f s at %.0f Hz (%zu samples), bias %.4f rad/s, noise %.4f rad/s, seed %u\n", opt.synthetic_seconds,
+			opt.synthetic_rate_hz, records.size(), opt.synthetic_bias, opt.synthetic_noise, opt.seed );
+		if ( !opt.write_synthetic_path.empty() )
+		{
+			if ( !WriteImuCapture( opt.write_synthetic_path.c_str(), MakeImuCaptureHeader( "synthetic" ), records ) )
+			{
+				fprintf( stderr, "cannot write capture '%s'\n", opt.write_synthetic_path.c_str() );
+				return 1;
+			}
+			printf( "wrote %s\n", opt.write_synthetic_path.c_str() );
+		}
+	}
+	if ( records.empty() )
+	{
+		fprintf( stderr, "no samples to replay\n" );
+		return 1;
+	}
+
+	std::vector< ImuFusionType > types;
+	if ( opt.filter == "all" )
+	{
+		types = { ImuFusionType::GyroOnly, ImuFusionType::Complementary, ImuFusionType::Mahony, ImuFusionType::Madgwick };
+	}
+	else
+	{
+		ImuFusionType type;
+		if ( !ParseImuFusionType( opt.filter.c_str(), type ) )
+		{
+			fprintf( stderr, "unknown filter '%s'\n", opt.filter.c_str() );
+			return 2;
+		}
+		types.push_back( type );
+	}
+
+	const double duration_min = records.size() > 1 ?
+		static_cast< double >( records.back().tick - records.front().tick ) / 60000.0 : 0.0;
+
+	printf( "%-14s %12s %9s %9s %9s %9s | %9s %9s %9s %9s %11s\n", "filter", "samples/s", "p50 ns", "p99 ns", "p99.9 ns", "max ns",
+		"final deg", "rms deg", "max deg", "tilt deg", "drift d/min" );
+	for ( ImuFusionType type : types )
+	{
+		BenchResult r;
+		RunFilter( type, opt, records, r );
+		printf( "%-14s %12.0f %9lld %9lld %9lld %9lld | ", ImuFusionTypeName( type ), r.samples_per_second,
+			(long long)r.latency.Percentile( 0.50 ), (long long)r.latency.Percentile( 0.99 ), (long long)r.latency.Percentile( 0.999 ),
+			(long long)r.latency.Max() );
+		if ( r.compared )
+			printf( "%9.3f %9.3f %9.3f %9.3f %11.3f\n", r.final_error_deg, r.rms_error_deg, r.max_error_deg, r.final_tilt_deg,
+				duration_min > 0.0 ? r.final_error_deg / duration_min : 0.0 );
+		else
+			printf( "%9s %9s %9s %9s %11s\n", "-", "-", "-", "-", "-" );
+	}
+	return 0;
+}
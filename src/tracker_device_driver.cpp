@@ -0,0 +1,129 @@
+//============ Copyright (c) Valve Corporation, All rights reserved. ============
+#include "tracker_device_driver.h"
+
+#include "driverlog.h"
+#include "driver_settings.h"
+#include "thread_policy.h"
+
+#include <algorithm>
+#include <chrono>
+#include <string.h>
+
+MyTrackerDeviceDriver::MyTrackerDeviceDriver( std::shared_ptr< TrackingState > tracking, int unit_index, const DriverSettings &settings, std::string serial_number )
+	: tracking_( std::move( tracking ) ), unit_index_( unit_index ), settings_( settings ), serial_number_( std::move( serial_number ) )
+{
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Generic tracker properties; no inputs (the secondary units' buttons are not mapped).
+//-----------------------------------------------------------------------------
+vr::EVRInitError MyTrackerDeviceDriver::Activate( uint32_t unObjectId )
+{
+	device_index_ = unObjectId;
+	is_active_ = true;
+
+	vr::PropertyContainerHandle_t container = vr::VRProperties()->TrackedDeviceToPropertyContainer( device_index_ );
+	vr::VRProperties()->SetStringProperty( container, vr::Prop_ModelNumber_String, "RayNeo Air 3S Pro" );
+	vr::VRProperties()->SetStringProperty( container, vr::Prop_ManufacturerName_String, "RayNeo" );
+	vr::VRProperties()->SetStringProperty( container, vr::Prop_ControllerType_String, "rayneo_tracker" );
+	vr::VRProperties()->SetStringProperty( container, vr::Prop_InputProfilePath_String, "{rayneo}/input/rayneo_tracker_profile.json" );
+
+	DriverLog( "[tracker] %s activated as device %u (RayNeo unit %d)", serial_number_.c_str(), unObjectId, unit_index_ );
+	pose_thread_ = std::thread( &MyTrackerDeviceDriver::MyPoseUpdateThread, this );
+	return vr::VRInitError_None;
+}
+
+void MyTrackerDeviceDriver::EnterStandby()
+{
+}
+
+void *MyTrackerDeviceDriver::GetComponent( const char * /*pchComponentNameAndVersion*/ )
+{
+	return nullptr;
+}
+
+void MyTrackerDeviceDriver::DebugRequest( const char * /*pchRequest*/, char *pchResponseBuffer, uint32_t unResponseBufferSize )
+{
+	if ( unResponseBufferSize >= 1 )
+		pchResponseBuffer[ 0 ] = 0;
+}
+
+vr::DriverPose_t MyTrackerDeviceDriver::GetPose()
+{
+	vr::DriverPose_t pose = { 0 };
+	pose.qWorldFromDriverRotation.w = 1.f;
+	pose.qDriverFromHeadRotation.w = 1.f;
+
+	PoseSnapshot snap;
+	tracking_->pose.Load( snap );
+	const bool connected = snap.connected;
+
+	pose.qRotation.w = snap.q_w;
+	pose.qRotation.x = snap.q_x;
+	pose.qRotation.y = snap.q_y;
+	pose.qRotation.z = snap.q_z;
+	if ( snap.valid && connected )
+	{
+		const int64_t now_ns = std::chrono::duration_cast< std::chrono::nanoseconds >(
+			std::chrono::steady_clock::now().time_since_epoch() ).count();
+		pose.poseTimeOffset = static_cast< double >( snap.sample_host_time_ns - now_ns ) * 1e-9;
+		for ( int i = 0; i < 3; ++i )
+		{
+			pose.vecAngularVelocity[ i ] = snap.angular_velocity[ i ];
+			pose.vecAngularAcceleration[ i ] = snap.angular_acceleration[ i ];
+		}
+	}
+
+	// Orientation only: park each unit at a fixed spot in front of the user, side by side
+	pose.vecPosition[ 0 ] = 0.25 * unit_index_;
+	pose.vecPosition[ 1 ] = 1.0;
+	pose.vecPosition[ 2 ] = -0.5;
+
+	pose.deviceIsConnected = connected;
+	pose.poseIsValid = connected && snap.valid;
+	pose.result = pose.poseIsValid ? vr::TrackingResult_Running_OK : vr::TrackingResult_Running_OutOfRange;
+	return pose;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Event-driven like the HMD's pose thread: wake on each fused sample, cap the rate,
+// publish at the idle rate when no samples arrive (disconnected units included).
+//-----------------------------------------------------------------------------
+void MyTrackerDeviceDriver::MyPoseUpdateThread()
+{
+	using clock = std::chrono::steady_clock;
+
+	const std::string thread_name = "rayneo-tracker" + std::to_string( unit_index_ );
+	const ScopedThreadPolicy thread_policy( thread_name.c_str(), settings_.PoseThreadPolicy() );
+	PreciseSleeper sleeper;
+
+	uint64_t last_generation = 0;
+	clock::time_point last_publish{};
+	while ( is_active_ )
+	{
+		const auto min_interval = std::chrono::duration_cast< clock::duration >(
+			std::chrono::duration< double >( 1.0 / std::max( settings_.pose_max_rate_hz.load( std::memory_order_relaxed ), 1.0f ) ) );
+		const auto idle_interval = std::chrono::duration_cast< clock::duration >(
+			std::chrono::duration< double >( 1.0 / std::max( settings_.pose_idle_rate_hz.load( std::memory_order_relaxed ), 0.5f ) ) );
+
+		last_generation = tracking_->pose_signal.WaitFor( last_generation, idle_interval );
+		const auto earliest = last_publish + min_interval;
+		if ( clock::now() < earliest )
+		{
+			sleeper.SleepUntil( earliest );
+			last_generation = tracking_->pose_signal.Generation();
+		}
+		if ( !is_active_ )
+			break;
+
+		vr::VRServerDriverHost()->TrackedDevicePoseUpdated( device_index_, GetPose(), sizeof( vr::DriverPose_t ) );
+		last_publish = clock::now();
+	}
+}
+
+void MyTrackerDeviceDriver::Deactivate()
+{
+	if ( is_active_.exchange( false ) )
+		pose_thread_.join();
+	device_index_ = vr::k_unTrackedDeviceIndexInvalid;
+}
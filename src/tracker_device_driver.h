@@ -0,0 +1,43 @@
+//============ Copyright (c) Valve Corporation, All rights reserved. ============
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+
+#include "openvr_driver.h"
+#include "tracking_state.h"
+
+class DriverSettings;
+
+//-----------------------------------------------------------------------------
+// Purpose: A secondary pair of glasses exposed as a generic tracker (orientation only).
+// Reads the TrackingState of RayneoUnit unit_index, which it shares ownership of.
+//-----------------------------------------------------------------------------
+class MyTrackerDeviceDriver : public vr::ITrackedDeviceServerDriver
+{
+public:
+	MyTrackerDeviceDriver( std::shared_ptr< TrackingState > tracking, int unit_index, const DriverSettings &settings, std::string serial_number );
+
+	vr::EVRInitError Activate( uint32_t unObjectId ) override;
+	void EnterStandby() override;
+	void *GetComponent( const char *pchComponentNameAndVersion ) override;
+	void DebugRequest( const char *pchRequest, char *pchResponseBuffer, uint32_t unResponseBufferSize ) override;
+	vr::DriverPose_t GetPose() override;
+	void Deactivate() override;
+
+	const std::string &MyGetSerialNumber() const { return serial_number_; }
+
+private:
+	void MyPoseUpdateThread();
+
+	const std::shared_ptr< TrackingState > tracking_;
+	const int unit_index_;
+	const DriverSettings &settings_;
+	std::string serial_number_;
+
+	std::atomic< bool > is_active_{ false };
+	std::atomic< uint32_t > device_index_{ vr::k_unTrackedDeviceIndexInvalid };
+	std::thread pose_thread_;
+};
@@ -0,0 +1,231 @@
+#include "tracking_pipeline.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "imu_math.h"
+
+TrackingPipeline::TrackingPipeline( const TrackingPipelineConfig &config )
+	: config_( config ), fusion_filter_( CreateImuFusionFilter( config.fusion_type, config.fusion_params ) ), bias_estimator_( config.bias_params ),
+	  position_engine_( config.position )
+{
+}
+
+void TrackingPipeline::Reset()
+{
+	const TrackingPipelineConfig config = config_;
+	*this = TrackingPipeline( config );
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Per sample, in order: dt from the tick, rad/s conversion and sensitivity scaling, bias
+// learning (all sequential, cheap). The samples that advance are packed and handed to the fusion filter
+// in one call, and (inertial position only) their accelerations rotated into the world frame
+// in one batched kernel.
+// The rate filters use the fusion bias as of the end of each batch (it moves by micro-rad/s
+// per sample, far below the filters' own noise).
+//-----------------------------------------------------------------------------
+size_t TrackingPipeline::ProcessBatch( const TrackingImuSample *samples, size_t n, ImuQuat *orientations_out )
+{
+	float w[ 3 * kMaxBatch ];
+	float acc[ 3 * kMaxBatch ];
+	float dt[ kMaxBatch ];
+	float rate[ kMaxBatch ];
+	ImuQuat *const fused = batch_orientation_;
+	uint8_t advanced[ kMaxBatch ];
+
+	size_t total = 0;
+	for ( size_t base = 0; base < n; base += kMaxBatch )
+	{
+		const size_t m = std::min( kMaxBatch, n - base );
+		size_t count = 0;
+		for ( size_t j = 0; j < m; ++j )
+		{
+			const TrackingImuSample &s = samples[ base + j ];
+
+			// Compute dt (tick is milliseconds)
+			float sample_dt = 0.f;
+			if ( have_tick_ && s.tick > last_tick_ )
+				sample_dt = static_cast< float >( s.tick - last_tick_ ) * 0.001f;
+			last_tick_ = s.tick;
+			have_tick_ = true;
+
+			advanced[ j ] = sample_dt > 0.f && sample_dt < config_.max_dt;
+			if ( !advanced[ j ] )
+				continue;
+
+			// Angular velocity in rad/s (use gyro_rad if filled else convert from gyro_dps)
+			float *wi = w + 3 * count;
+			for ( int i = 0; i < 3; ++i )
+				wi[ i ] = s.gyro_rad[ i ];
+			if ( wi[ 0 ] == 0.f && wi[ 1 ] == 0.f && wi[ 2 ] == 0.f )
+			{
+				const float deg2rad = 3.14159265358979323846f / 180.f;
+				for ( int i = 0; i < 3; ++i )
+					wi[ i ] = s.gyro_dps[ i ] * deg2rad;
+			}
+			for ( int i = 0; i < 3; ++i )
+				wi[ i ] *= config_.gyro_scale;
+
+			// Learn bias while still and remove it before fusion
+			if ( config_.learn_gyro_bias )
+			{
+				bias_estimator_.Update( wi, s.acc, sample_dt );
+				float learned[ 3 ];
+				bias_estimator_.GetBias( learned );
+				for ( int i = 0; i < 3; ++i )
+					wi[ i ] -= learned[ i ];
+			}
+			rate[ count ] = std::sqrt( wi[ 0 ] * wi[ 0 ] + wi[ 1 ] * wi[ 1 ] + wi[ 2 ] * wi[ 2 ] );
+
+			for ( int i = 0; i < 3; ++i )
+				acc[ 3 * count + i ] = s.acc[ i ];
+			dt[ count ] = sample_dt;
+			++count;
+		}
+
+		if ( count > 0 )
+		{
+			// Fuse gyro + accelerometer tilt (constant time per sample, no allocation)
+			fusion_filter_->UpdateBatch( w, acc, dt, count, fused );
+
+			float bias[ 3 ];
+			fusion_filter_->GetGyroBias( bias );
+			for ( size_t k = 0; k < count; ++k )
+			{
+				const float w_corrected[ 3 ] = { w[ 3 * k ] - bias[ 0 ], w[ 3 * k + 1 ] - bias[ 1 ], w[ 3 * k + 2 ] - bias[ 2 ] };
+				UpdateAngularRates( w_corrected, dt[ k ] );
+			}
+
+			if ( config_.position.mode == PositionMode::Inertial )
+			{
+				// Sensor to world frame at each sample's own orientation, g to m/s^2
+				for ( size_t k = 0; k < 3 * count; ++k )
+					acc[ k ] *= 9.81f;
+				QuatRotateBatch( fused, acc, acc, count );
+				for ( size_t k = 0; k < count; ++k )
+					position_engine_.Update( acc + 3 * k, rate[ k ], dt[ k ] );
+			}
+		}
+
+		if ( orientations_out )
+		{
+			for ( size_t j = 0, k = 0; j < m; ++j )
+			{
+				if ( advanced[ j ] )
+					orientation_ = fused[ k++ ];
+				orientations_out[ base + j ] = orientation_;
+			}
+		}
+		else if ( count > 0 )
+		{
+			orientation_ = fused[ count - 1 ];
+		}
+		total += count;
+	}
+	return total;
+}
+
+void TrackingPipeline::UpdateAngularRates( const float w[ 3 ], float dt )
+{
+	if ( !have_ang_vel_ )
+	{
+		for ( int i = 0; i < 3; ++i )
+		{
+			ang_vel_filtered_[ i ] = w[ i ];
+			ang_acc_filtered_[ i ] = 0.f;
+		}
+		have_ang_vel_ = true;
+		return;
+	}
+	// One-pole low-pass filters; derivative taken on the filtered rate to keep noise down
+	const float a_vel = dt / ( config_.ang_vel_time_constant + dt );
+	const float a_acc = dt / ( config_.ang_acc_time_constant + dt );
+	for ( int i = 0; i < 3; ++i )
+	{
+		const float prev = ang_vel_filtered_[ i ];
+		ang_vel_filtered_[ i ] += a_vel * ( w[ i ] - prev );
+		const float raw_acc = ( ang_vel_filtered_[ i ] - prev ) / dt;
+		ang_acc_filtered_[ i ] += a_acc * ( raw_acc - ang_acc_filtered_[ i ] );
+	}
+}
+
+void TrackingPipeline::Recenter()
+{
+	anchor_ = orientation_;
+	if ( fusion_filter_->Type() != ImuFusionType::GyroOnly )
+	{
+		// Tilt is absolute (gravity referenced) now, so only take the yaw twist as anchor;
+		// otherwise recentering while looking down would tilt the horizon.
+		const float nrm = std::sqrt( orientation_.w * orientation_.w + orientation_.y * orientation_.y );
+		if ( nrm > 1e-6f )
+			anchor_ = { orientation_.w / nrm, 0.f, orientation_.y / nrm, 0.f };
+	}
+	position_engine_.Recenter();
+}
+
+void TrackingPipeline::ApplyYawCorrection( float radians )
+{
+	// rel = anchor^-1 * q, so anchor * R_y(-a) turns rel into R_y(a) * rel
+	const ImuQuat r{ std::cos( radians * 0.5f ), 0.f, -std::sin( radians * 0.5f ), 0.f };
+	anchor_ = QuatNormalizeFast( QuatMultiply( anchor_, r ) );
+}
+
+void TrackingPipeline::ResumeAfterIdle()
+{
+	have_tick_ = false;
+	have_ang_vel_ = false;
+	for ( int i = 0; i < 3; ++i )
+	{
+		ang_vel_filtered_[ i ] = 0.f;
+		ang_acc_filtered_[ i ] = 0.f;
+	}
+	position_engine_.ResumeAfterIdle();
+}
+
+void TrackingPipeline::SetConfig( const TrackingPipelineConfig &config )
+{
+	const PositionMode previous_mode = config_.position.mode;
+	SetFusionFilter( config.fusion_type );
+	config_ = config;
+	fusion_filter_->SetParams( config_.fusion_params );
+	bias_estimator_.SetParams( config_.bias_params );
+	position_engine_.SetParams( config_.position );
+	// A mode switch starts the offset from the pivot rather than from stale state
+	if ( config_.position.mode != previous_mode )
+		position_engine_.Reset();
+}
+
+bool TrackingPipeline::SetFusionFilter( ImuFusionType type )
+{
+	if ( type == fusion_filter_->Type() )
+		return false;
+
+	// Swap engines without a visible jump: carry orientation and bias over
+	auto next = CreateImuFusionFilter( type, config_.fusion_params );
+	float bias[ 3 ];
+	fusion_filter_->GetGyroBias( bias );
+	next->SetGyroBias( bias );
+	next->SetOrientation( fusion_filter_->GetOrientation() );
+	fusion_filter_ = std::move( next );
+	config_.fusion_type = type;
+	return true;
+}
+
+void TrackingPipeline::BuildSnapshot( PoseSnapshot &snap ) const
+{
+	// Relative quaternion q_rel = q_anchor^{-1} * q_current (inverse of a unit quaternion is its conjugate)
+	const ImuQuat rel = QuatMultiply( QuatConjugate( anchor_ ), orientation_ );
+	snap.q_w = rel.w;
+	snap.q_x = rel.x;
+	snap.q_y = rel.y;
+	snap.q_z = rel.z;
+
+	// Gyro rates are body frame; SteamVR wants them in driver space, i.e. rotated by q_rel
+	QuatRotate( rel, ang_vel_filtered_, snap.angular_velocity );
+	QuatRotate( rel, ang_acc_filtered_, snap.angular_acceleration );
+
+	// Eye position and velocity (the neck model's share of it follows the rotation rate)
+	position_engine_.Evaluate( anchor_, rel, snap.angular_velocity, snap.position, snap.velocity );
+	snap.valid = true;
+}
@@ -0,0 +1,128 @@
+// Headless IMU tracking pipeline: bias learning, orientation fusion, prediction rates and the
+// position engine (neck model, optional ZUPT-aided inertial offset). No OpenVR, SDK or logging dependencies, so the driver and
+// the offline tools (rayneo_tracking_bench) run exactly the same code.
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#include "imu_calibration.h"
+#include "imu_fusion.h"
+#include "pose_snapshot.h"
+#include "position_engine.h"
+
+// One IMU sample as delivered by the SDK (mirrors RAYNEO_ImuSample without depending on it)
+struct TrackingImuSample
+{
+	uint32_t tick = 0;                     // device time, milliseconds
+	float gyro_rad[ 3 ] = { 0.f, 0.f, 0.f }; // rad/s; all zero if the SDK only filled gyro_dps
+	float gyro_dps[ 3 ] = { 0.f, 0.f, 0.f }; // deg/s
+	float acc[ 3 ] = { 0.f, 0.f, 0.f };      // g
+};
+
+struct TrackingPipelineConfig
+{
+	ImuFusionType fusion_type = ImuFusionType::Mahony;
+	ImuFusionParams fusion_params;
+
+	// Stillness-gated gyro bias learning (rad/s after gyro_scale, removed before fusion)
+	bool learn_gyro_bias = true;
+	GyroBiasEstimatorParams bias_params;
+
+	// Gyro sensitivity correction, applied to every raw rate before anything else looks at it
+	// (bias learning, stillness detection, fusion), so all of them agree with the accelerometer's
+	// gravity reference. 1 trusts the sensor's own scale; set it only from a measured turn error.
+	float gyro_scale = 1.0f;
+
+	// Samples with a tick gap outside (0, max_dt) seconds only reset the integration clock
+	float max_dt = 0.1f;
+
+	// Prediction inputs: time constants of the angular velocity / acceleration low-pass filters
+	float ang_vel_time_constant = 0.004f;
+	float ang_acc_time_constant = 0.020f;
+
+	// Eye position: fixed, neck model, or neck model plus the inertial offset
+	PositionEngineParams position;
+};
+
+//-----------------------------------------------------------------------------
+// Purpose: Turns a stream of IMU samples into poses. Single threaded: the owner serializes
+// every call (in the driver that is the RayNeo event thread). Constant time per sample,
+// no allocation after construction except when switching fusion engines.
+//-----------------------------------------------------------------------------
+class TrackingPipeline
+{
+public:
+	explicit TrackingPipeline( const TrackingPipelineConfig &config = {} );
+
+	// Returns true if the sample advanced the state (the first sample and tick glitches only
+	// re-arm the integration clock).
+	bool ProcessSample( const TrackingImuSample &s ) { return ProcessBatch( &s, 1 ) > 0; }
+
+	// Same result as ProcessSample() on each sample in order, but the fusion update and the
+	// inertial position's acceleration rotation run over the whole batch at once. Returns how
+	// many samples advanced the state; orientations_out, if given, receives the fused
+	// orientation after every input sample.
+	size_t ProcessBatch( const TrackingImuSample *samples, size_t n, ImuQuat *orientations_out = nullptr );
+
+	// Take the current orientation as the new forward direction and bring the position back to the neck pivot
+	void Recenter();
+
+	// External tracker corrections: rotate the output about driver-space Y (through the anchor),
+	// shift the output position (driver space, meters)
+	void ApplyYawCorrection( float radians );
+	void ApplyPositionCorrection( const float delta[ 3 ] ) { position_engine_.AddCorrection( delta ); }
+
+	// Swap the fusion engine, carrying orientation and bias over. Returns false if unchanged.
+	bool SetFusionFilter( ImuFusionType type );
+	const IImuFusionFilter &FusionFilter() const { return *fusion_filter_; }
+
+	// Orientation relative to the recenter anchor, position, velocity and rates; leaves the
+	// timestamp and link fields of snap untouched.
+	void BuildSnapshot( PoseSnapshot &snap ) const;
+	const PositionEngine &Position() const { return position_engine_; }
+
+	// Fused orientation in the world frame, without the recenter anchor
+	ImuQuat Orientation() const { return orientation_; }
+
+	void GetFusionGyroBias( float out[ 3 ] ) const { fusion_filter_->GetGyroBias( out ); }
+	const GyroBiasEstimator &BiasEstimator() const { return bias_estimator_; }
+	bool SeedGyroBias( const float bias[ 3 ], float learned_seconds ) { return bias_estimator_.SetBias( bias, learned_seconds ); }
+
+	const TrackingPipelineConfig &Config() const { return config_; }
+	// Retune in place (settings reload): keeps orientation, learned bias, position offset and the recenter anchor.
+	// A different fusion_type swaps the engine as SetFusionFilter() does.
+	void SetConfig( const TrackingPipelineConfig &config );
+
+	// After the IMU was idled: keep orientation, biases and anchor, but drop the rate filters,
+	// linear velocity and tick so the first samples neither extrapolate stale motion nor integrate the gap
+	void ResumeAfterIdle();
+
+	// Back to the freshly constructed state (keeps the configuration)
+	void Reset();
+
+private:
+	void UpdateAngularRates( const float w[ 3 ], float dt );
+
+	// ProcessBatch hands the fusion filter at most kMaxBatch samples per call
+	static constexpr size_t kMaxBatch = 64;
+
+	TrackingPipelineConfig config_;
+	std::unique_ptr< IImuFusionFilter > fusion_filter_;
+	GyroBiasEstimator bias_estimator_;
+	PositionEngine position_engine_;
+
+	ImuQuat orientation_;
+	ImuQuat anchor_;
+	uint32_t last_tick_ = 0;
+	bool have_tick_ = false;
+
+	float ang_vel_filtered_[ 3 ] = { 0.f, 0.f, 0.f };
+	float ang_acc_filtered_[ 3 ] = { 0.f, 0.f, 0.f };
+	bool have_ang_vel_ = false;
+
+	// ProcessBatch scratch: per-sample fused orientations (a member, so a call does not
+	// default-construct kMaxBatch quaternions on the stack)
+	ImuQuat batch_orientation_[ kMaxBatch ];
+};
@@ -0,0 +1,32 @@
+// Tracking handoff from the thread that integrates a unit's IMU to the device that publishes it.
+#pragma once
+
+#include "pose_snapshot.h"
+#include "power_state.h"
+
+//-----------------------------------------------------------------------------
+// Purpose: Everything a device's pose thread reads, in one object owned through std::shared_ptr
+// by both the producer (MyDeviceProvider, RayneoUnit) and the device it was injected into, so a
+// pose thread can never outlive the state it reads, whatever order Cleanup and Deactivate run in.
+//
+// GetPose() takes one SeqLock load (a single acquire of the sequence word): the snapshot carries
+// the link state next to the pose. The sequence word and the 96-byte payload fill the first two
+// cache lines; the signal and power state, touched only around waits, sit on lines of their own.
+// pose has exactly one writer, the producer's IMU/event thread; Publish() is for that thread only.
+//-----------------------------------------------------------------------------
+struct TrackingState
+{
+	SeqLock< PoseSnapshot > pose;
+	alignas( 64 ) PoseSampleSignal pose_signal;
+	// Driven by the provider for the HMD; extra units never idle and leave it Active
+	alignas( 64 ) PowerStateMachine power;
+
+	void Publish( const PoseSnapshot &snap )
+	{
+		pose.Store( snap );
+		pose_signal.Notify();
+	}
+};
+
+// SeqLock keeps its sequence word at the start of the first line and the payload right behind it
+static_assert( sizeof( PoseSnapshot ) <= 128 - sizeof( uint64_t ), "PoseSnapshot no longer fits two cache lines" );